@@ -0,0 +1,51 @@
+/**
+ * Native Addon Loader
+ * 
+ * Loads the PowerMon native addon once for the whole process, with graceful
+ * fallback to simulation mode.
+ */
+
+const path = require('path');
+const fs = require('fs');
+const logger = require('./logger');
+
+let powermon = null;
+let simulationMode = false;
+
+// Check if we're in simulation mode via environment variable
+// SIMULATION_MODE=true skips loading native addon entirely (avoids crash on incompatible binaries)
+if (process.env.SIMULATION_MODE === 'true' || process.env.SIMULATION_MODE === '1') {
+  simulationMode = true;
+  logger.info('Running in SIMULATION MODE - no real device connections');
+} else {
+  // Only attempt to load addon if not in simulation mode
+  // Note: If addon is compiled for different architecture, Node will crash on require()
+  // Set SIMULATION_MODE=true to avoid this on EC2 until addon is rebuilt for target platform
+  const addonPath = path.join(__dirname, '../build/Release/powermon_addon.node');
+  
+  if (!fs.existsSync(addonPath)) {
+    logger.warn('PowerMon addon not found at ' + addonPath + ', running in simulation mode');
+    simulationMode = true;
+  } else {
+    try {
+      powermon = require(addonPath);
+      logger.info('PowerMon addon loaded successfully');
+      const backend = powermon.PowermonDevice.getBackend ? powermon.PowermonDevice.getBackend() : 'vendor';
+      if (backend === 'fake') {
+        // POWERMON_BACKEND=fake: in-process fake devices, see POWERMON_FAKE in README
+        logger.warn('PowerMon addon using FAKE device backend', { spec: process.env.POWERMON_FAKE || '' });
+      } else if (backend === 'replay') {
+        logger.warn('PowerMon addon replaying recorded device traces', { spec: process.env.POWERMON_REPLAY || '' });
+      }
+      if (process.env.POWERMON_RECORD) {
+        logger.info('Recording device traces', { dir: process.env.POWERMON_RECORD });
+      }
+    } catch (err) {
+      logger.error('Failed to load PowerMon addon', { error: err.message });
+      logger.warn('Set SIMULATION_MODE=true to avoid crash on incompatible binaries');
+      simulationMode = true;
+    }
+  }
+}
+
+module.exports = { powermon, simulationMode };
@@ -3,6 +3,8 @@
  * 
  * Detects gaps in data and uses log sync to backfill missing samples.
  * Runs as a background task, processing devices with pending backfills.
+ * Within a device's gap window only the ranges the coverage tracker has no
+ * data for are read from the device logs.
  */
 
 const path = require('path');
@@ -10,6 +12,9 @@ const { config } = require('./config');
 const logger = require('./logger');
 const db = require('./database');
 const batchWriter = require('./batch-writer');
+const coverageTracker = require('./coverage');
+const { connectionPool } = require('./connection-pool');
+const { powermon } = require('./addon');
 
 // Load log sync module
 const logSync = require(path.join(__dirname, '../lib/log-sync.js'));
@@ -25,6 +30,8 @@ class BackfillService {
       successfulBackfills: 0,
       failedBackfills: 0,
       totalSamplesBackfilled: 0,
+      totalEnergyInWh: 0,
+      totalEnergyOutWh: 0,
       lastCheckTime: null,
     };
   }
@@ -86,6 +93,7 @@ class BackfillService {
     if (!this.isRunning) return;
 
     this.stats.lastCheckTime = new Date();
+    coverageTracker.trim();
 
     try {
       // Get devices needing backfill
@@ -153,82 +161,99 @@ class BackfillService {
         'in_progress'
       );
 
-      // Load the native addon and connect to device
-      const powermon = require(path.join(__dirname, '../build/Release/powermon_addon.node'));
-      const device = powermon.createInstance();
-      
-      // Parse applink URL
-      const urlParams = new URL(deviceInfo.applink_url);
-      const params = new URLSearchParams(urlParams.search);
-      
-      const result = device.Connect(
-        params.get('n'),
-        params.get('s'),
-        parseInt(params.get('h') || '0', 10),
-        params.get('c')
-      );
-
-      if (result !== 0) {
-        throw new Error(`Failed to connect to device: ${result}`);
-      }
-
-      // Prepare sync state from database
-      const syncState = deviceInfo.last_log_file_id ? {
-        deviceSerial: deviceInfo.serial_number,
-        lastFileId: parseInt(deviceInfo.last_log_file_id, 10),
-        lastFileOffset: deviceInfo.last_log_offset || 0,
-        totalSamplesSynced: 0,
-      } : null;
+      // Work out which parts of the gap window actually lack data
+      const windowStart = deviceInfo.gap_start_at ? new Date(deviceInfo.gap_start_at).getTime() : null;
+      const windowEnd = deviceInfo.gap_end_at ? new Date(deviceInfo.gap_end_at).getTime() : Date.now();
+      const gaps = windowStart !== null
+        ? coverageTracker.getGaps(deviceId, windowStart, windowEnd, config.backfill.gapThresholdMs)
+        : null;
 
-      // Run log sync
       let totalSamples = 0;
-      const syncResult = await logSync.syncDeviceLogs(
-        device,
-        deviceInfo.serial_number,
-        syncState,
-        (phase, progress, message) => {
-          log.debug('Backfill progress', { phase, progress, message });
+      let syncResult = { samples: [], segments: [], newState: null };
+
+      if (gaps && gaps.length === 0) {
+        log.info('Gap window already covered, nothing to fetch');
+      } else {
+        // Log reads share the pool's live connection to the device, woken
+        // from hibernation if need be and kept awake until the sync is done
+        const conn = connectionPool.getConnection(deviceId);
+        if (conn && conn.status === 'hibernating') {
+          await conn.wake();
         }
-      );
+        if (!conn || conn.status !== 'connected' || !conn.device) {
+          throw new Error('Device not connected');
+        }
+        const device = conn.device;
+        conn.pin();
+        try {
+          const onProgress = (progress) => {
+            log.debug('Backfill progress', { phase: progress.phase, message: progress.message });
+          };
+
+          if (gaps) {
+            // Fetch only the missing ranges
+            log.info('Backfilling coverage gaps', { gaps: gaps.length });
+            for (const gap of gaps) {
+              const result = await logSync.syncRange(
+                device,
+                deviceInfo.serial_number,
+                Math.floor(gap.start / 1000),
+                Math.ceil(gap.end / 1000),
+                onProgress
+              );
+              if (!result.success) {
+                throw new Error(result.error);
+              }
+              this.fillMeters(result.samples, conn.lastMeasurement, log);
+              for (const segment of result.segments) {
+                syncResult.segments.push({ ...segment, start: segment.start + syncResult.samples.length });
+              }
+              syncResult.samples.push(...result.samples);
+            }
+          } else {
+            // No gap window recorded - resume from the last synced file position
+            const syncState = deviceInfo.last_log_file_id ? {
+              deviceSerial: deviceInfo.serial_number,
+              lastFileId: parseInt(deviceInfo.last_log_file_id, 10),
+              lastFileOffset: deviceInfo.last_log_offset || 0,
+              totalSamplesSynced: 0,
+            } : null;
+
+            syncResult = await logSync.syncDeviceLogs(device, deviceInfo.serial_number, syncState, onProgress);
+            this.fillMeters(syncResult.samples, conn.lastMeasurement, log);
+          }
+        } finally {
+          conn.unpin();
+        }
+      }
 
       // Process synced samples
       if (syncResult.samples && syncResult.samples.length > 0) {
         totalSamples = syncResult.samples.length;
-        
-        // Convert samples to measurements and enqueue
-        for (const sample of syncResult.samples) {
-          const measurement = {
-            organizationId: deviceInfo.organization_id,
-            deviceId: deviceId,
-            truckId: null, // Could look up from device
-            fleetId: null,
-            voltage1: sample.voltage1,
-            voltage2: sample.voltage2,
-            current: sample.current,
-            power: sample.power || (sample.voltage1 * sample.current),
-            temperature: sample.temperature,
-            soc: sample.soc,
-            energy: sample.energy,
-            charge: sample.charge,
-            runtime: sample.runtime,
-            source: 'backfill',
-            recordedAt: new Date(sample.timestamp),
-          };
-          
-          batchWriter.enqueue(measurement);
-        }
 
-        log.info('Backfill samples enqueued', { count: totalSamples });
+        for (const segment of syncResult.segments || []) {
+          coverageTracker.recordLogSamples(
+            deviceId, syncResult.samples, segment.samplePeriod, segment.start, segment.count
+          );
+        }
+        
+        // Hand samples to the batch writer, which merges them with the poll
+        // stream so time ranges already covered by polls are not written twice
+        const accepted = batchWriter.enqueueLogSamples({
+          organizationId: deviceInfo.organization_id,
+          deviceId: deviceId,
+          truckId: null, // Could look up from device
+          fleetId: null,
+        }, syncResult.samples);
+
+        log.info('Backfill samples enqueued', { count: totalSamples, accepted });
       }
 
-      // Disconnect
-      device.Disconnect();
-
-      // Update status to completed
+      // Update status to completed (ranged syncs leave the resume position alone)
       await db.updateBackfillProgress(
         deviceId,
         syncResult.newState?.lastFileId?.toString() || deviceInfo.last_log_file_id,
-        syncResult.newState?.lastFileOffset || 0,
+        syncResult.newState ? syncResult.newState.lastFileOffset : (deviceInfo.last_log_offset || 0),
         totalSamples,
         'completed'
       );
@@ -254,6 +279,44 @@ class BackfillService {
     }
   }
 
+  /**
+   * Fill the energy and charge meters that log records lack by integrating
+   * power and current over the samples (trapezoidal, skipping logging gaps).
+   * The meters are absolute device counters, so values are only written when
+   * the run of samples ends close to a poll reading to anchor them to; the
+   * charge/discharge totals are counted either way.
+   * @param {Array} samples - Decoded samples in time order (time in seconds)
+   * @param {Object|null} anchor - Latest poll measurement for the device
+   */
+  fillMeters(samples, anchor, log) {
+    if (!powermon || !powermon.integrateEnergy || !samples || samples.length === 0) {
+      return;
+    }
+
+    const maxGapSec = config.backfill.integrationMaxGapSec;
+    const result = powermon.integrateEnergy(samples, { maxGapSec });
+    this.stats.totalEnergyInWh += result.totals.energyInWh;
+    this.stats.totalEnergyOutWh += result.totals.energyOutWh;
+
+    const last = samples.length - 1;
+    const anchored = anchor
+      && typeof anchor.energy === 'number'
+      && typeof anchor.charge === 'number'
+      && result.totals.gaps === 0
+      && Math.abs(anchor.recordedAt.getTime() / 1000 - samples[last].time) <= maxGapSec;
+
+    if (anchored) {
+      const energyBase = anchor.energy - result.energyWh[last];
+      const chargeBase = anchor.charge - result.chargeAh[last];
+      for (let i = 0; i < samples.length; i++) {
+        samples[i].energy = energyBase + result.energyWh[i];
+        samples[i].charge = chargeBase + result.chargeAh[i];
+      }
+    }
+
+    log.debug('Integrated backfill samples', { ...result.totals, anchored: !!anchored });
+  }
+
   /**
    * Manually trigger backfill for a device
    */
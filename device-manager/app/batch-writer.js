@@ -3,17 +3,26 @@
  * 
  * Buffers measurements and writes them in bulk to reduce database load.
  * Flushes based on time interval or queue size, whichever comes first.
+ * 
+ * Poll measurements and backfilled log samples pass through the native
+ * SampleMerger (when the addon is available) so overlapping time ranges are
+ * written once, preferring the higher-resolution log samples.
  */
 
 const { config } = require('./config');
 const logger = require('./logger');
 const db = require('./database');
+const { powermon } = require('./addon');
 
 class BatchWriter {
   constructor() {
     this.measurementQueue = [];
     this.snapshotQueue = new Map(); // deviceId -> latest snapshot
+    this.merger = null;
+    this.deviceMeta = new Map(); // deviceId -> { organizationId, truckId, fleetId }
     this.flushTimer = null;
+    this.flushing = null; // in-flight flush promise
+    this.flushQueued = null; // flush to run after the in-flight one
     this.isRunning = false;
     
     this.stats = {
@@ -36,11 +45,21 @@ class BatchWriter {
     }
 
     this.isRunning = true;
+
+    if (config.merge.enabled && powermon && powermon.SampleMerger && !this.merger) {
+      this.merger = new powermon.SampleMerger({
+        toleranceMs: config.merge.toleranceMs,
+        holdMs: config.merge.holdMs,
+        historyMs: config.merge.historyMs,
+      });
+    }
+
     this.scheduleFlush();
     
     logger.info('Batch writer started', {
       flushIntervalMs: config.batchWriter.flushIntervalMs,
       maxBatchSize: config.batchWriter.maxBatchSize,
+      merging: !!this.merger,
     });
   }
 
@@ -55,7 +74,8 @@ class BatchWriter {
       this.flushTimer = null;
     }
 
-    // Final flush
+    // Final flush, including points still held by the merger
+    this.drainMerger(Number.MAX_SAFE_INTEGER);
     await this.flush();
     
     logger.info('Batch writer stopped', this.stats);
@@ -63,8 +83,87 @@ class BatchWriter {
 
   /**
    * Add a measurement to the queue
+   * Poll measurements go through the merger when it is enabled
    */
   enqueue(measurement) {
+    if (this.merger && measurement.source === 'poll') {
+      this.rememberDevice(measurement);
+      this.merger.addPoll(measurement.deviceId, measurement);
+      return;
+    }
+
+    this.pushMeasurement(measurement);
+  }
+
+  /**
+   * Add decoded log samples (time in seconds) for one device
+   * Returns the number of samples accepted after deduplication
+   */
+  enqueueLogSamples(deviceInfo, samples, timeOffsetMs = 0) {
+    if (!samples || samples.length === 0) {
+      return 0;
+    }
+
+    if (this.merger) {
+      this.rememberDevice(deviceInfo);
+      return this.merger.addLog(deviceInfo.deviceId, samples, timeOffsetMs);
+    }
+
+    for (const sample of samples) {
+      this.pushMeasurement({
+        organizationId: deviceInfo.organizationId,
+        deviceId: deviceInfo.deviceId,
+        truckId: deviceInfo.truckId || null,
+        fleetId: deviceInfo.fleetId || null,
+        voltage1: sample.voltage1,
+        voltage2: sample.voltage2,
+        current: sample.current,
+        power: sample.power,
+        temperature: sample.temperature,
+        soc: sample.soc,
+        energy: sample.energy ?? null,
+        charge: sample.charge ?? null,
+        runtime: null,
+        powerStatus: sample.powerStatus,
+        source: 'backfill',
+        recordedAt: new Date(sample.time * 1000 + timeOffsetMs),
+      });
+    }
+    return samples.length;
+  }
+
+  /**
+   * Remember the identifiers the merger does not carry
+   */
+  rememberDevice(info) {
+    this.deviceMeta.set(info.deviceId, {
+      organizationId: info.organizationId,
+      truckId: info.truckId || null,
+      fleetId: info.fleetId || null,
+    });
+  }
+
+  /**
+   * Move merged points that are past the hold window into the queue
+   */
+  drainMerger(nowMs) {
+    if (!this.merger) return;
+
+    for (const point of this.merger.drain(nowMs)) {
+      const meta = this.deviceMeta.get(point.deviceId) || {};
+      this.pushMeasurement({
+        organizationId: meta.organizationId,
+        truckId: meta.truckId || null,
+        fleetId: meta.fleetId || null,
+        ...point,
+      });
+    }
+  }
+
+  /**
+   * Append a measurement to the write queue
+   */
+  pushMeasurement(measurement) {
     if (this.measurementQueue.length >= config.batchWriter.maxQueueSize) {
       logger.warn('Measurement queue full, dropping oldest entries');
       this.measurementQueue.splice(0, 100); // Drop oldest 100
@@ -108,11 +207,41 @@ class BatchWriter {
   /**
    * Flush queued data to database
    * 
+   * Only one flush runs at a time: a flush requested while one is in flight
+   * (timer or max batch size) runs once after it, whether that one succeeded
+   * or not, instead of writing the same queued rows again concurrently.
+   */
+  flush() {
+    if (this.flushing) {
+      if (!this.flushQueued) {
+        const next = () => {
+          this.flushQueued = null;
+          return this.flush();
+        };
+        this.flushQueued = this.flushing.then(next, next);
+      }
+      return this.flushQueued;
+    }
+
+    // Started on the next microtask so a flush requested while this one
+    // drains the merger (max batch size reached) queues behind it
+    this.flushing = Promise.resolve()
+      .then(() => this.flushOnce())
+      .finally(() => {
+        this.flushing = null;
+      });
+    return this.flushing;
+  }
+
+  /**
+   * Write the current queue contents
+   * 
    * IMPORTANT: Only clears queue on successful write to prevent data loss.
    * Failed writes keep data in queue for retry on next flush.
    */
-  async flush() {
+  async flushOnce() {
     const flushStart = Date.now();
+    this.drainMerger(flushStart);
     
     // Snapshot current queue state (don't clear yet - only clear on success)
     const measurementsToFlush = this.measurementQueue.length;
@@ -185,6 +314,7 @@ class BatchWriter {
       isRunning: this.isRunning,
       currentQueueSize: this.measurementQueue.length,
       pendingSnapshots: this.snapshotQueue.size,
+      merger: this.merger ? this.merger.stats() : null,
     };
   }
 
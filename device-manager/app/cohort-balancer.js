@@ -0,0 +1,148 @@
+/**
+ * Cohort Balancer
+ * 
+ * Devices start in the cohort their serial number hashes to, which can leave
+ * some cohorts with many more, or much slower, devices than others: their
+ * ticks hit the concurrency limit and skip devices while other ticks idle.
+ * Every few poll intervals the balancer sums each cohort's expected poll time
+ * from its devices' measured poll cost and moves a few devices from the
+ * heaviest cohort to the lightest one with room, until all are within the
+ * tolerance of the mean. A tick polls at most maxConcurrentPolls devices, so
+ * no move takes a cohort past that many. A moved device is polled at its new
+ * cohort's next tick, so one of its poll intervals is stretched or shortened.
+ * Moves are saved and kept across restarts.
+ */
+
+const { config } = require('./config');
+const logger = require('./logger');
+const { connectionPool } = require('./connection-pool');
+
+class CohortBalancer {
+  constructor() {
+    this.loads = []; // Expected poll ms per cohort after the last pass
+    this.stats = {
+      passes: 0,
+      moves: 0,
+      lastMoves: 0,
+      spread: 0, // (heaviest - lightest) / mean load after the last pass
+    };
+  }
+
+  /**
+   * Expected poll time of each cohort's tick. Only devices a tick polls
+   * count; those not polled yet count the mean of the measured ones
+   */
+  measure() {
+    const cohortCount = config.polling.cohortCount;
+    const loads = new Array(cohortCount).fill(0);
+    const members = Array.from({ length: cohortCount }, () => []);
+
+    const polled = connectionPool.getAllConnections()
+      .filter(conn => conn.isReady() || conn.status === 'hibernating');
+    const measured = polled
+      .map(conn => conn.expectedPollCostMs())
+      .filter(cost => cost !== null);
+    const defaultCost = measured.length > 0
+      ? measured.reduce((sum, cost) => sum + cost, 0) / measured.length
+      : 1;
+
+    for (const conn of polled) {
+      if (conn.cohortId < 0 || conn.cohortId >= cohortCount) {
+        continue;
+      }
+      const expected = conn.expectedPollCostMs();
+      const cost = expected === null ? defaultCost : expected;
+      loads[conn.cohortId] += cost;
+      members[conn.cohortId].push({ conn, cost });
+    }
+
+    return { loads, members };
+  }
+
+  /**
+   * One balancing pass, at most rebalanceMaxMoves moves
+   * @returns {number} Devices moved
+   */
+  rebalance() {
+    const { loads, members } = this.measure();
+    const total = loads.reduce((sum, load) => sum + load, 0);
+    const mean = total / loads.length;
+
+    const capacity = config.polling.maxConcurrentPolls;
+    let moves = 0;
+
+    while (mean > 0 && moves < config.polling.rebalanceMaxMoves) {
+      // A cohort with more devices than a tick can poll is emptied first,
+      // whatever its load; otherwise the heaviest gives to the lightest
+      let heavy = 0;
+      let light = -1;
+      let over = -1;
+      for (let i = 0; i < loads.length; i++) {
+        if (loads[i] > loads[heavy]) heavy = i;
+        if (members[i].length < capacity && (light < 0 || loads[i] < loads[light])) light = i;
+        if (members[i].length > capacity && (over < 0 || members[i].length > members[over].length)) over = i;
+      }
+      if (over >= 0) heavy = over;
+      if (light < 0 || light === heavy) {
+        break;
+      }
+
+      const gap = loads[heavy] - loads[light];
+      if (over < 0 && gap <= config.polling.rebalanceTolerance * mean) {
+        break;
+      }
+
+      // Moving a device of cost c leaves the pair |gap - 2c| apart, so the
+      // best fit is the device closest to half the gap (for an overfull
+      // cohort, its cheapest device). Hibernating devices stay: their wake
+      // is timed for their current cohort's tick
+      let best = -1;
+      let bestResidual = over >= 0 ? Infinity : gap;
+      members[heavy].forEach((member, index) => {
+        if (member.conn.status === 'hibernating') return;
+        const residual = over >= 0 ? member.cost : Math.abs(gap - 2 * member.cost);
+        if (residual < bestResidual) {
+          best = index;
+          bestResidual = residual;
+        }
+      });
+      if (best < 0) {
+        break;
+      }
+
+      const [member] = members[heavy].splice(best, 1);
+      members[light].push(member);
+      loads[heavy] -= member.cost;
+      loads[light] += member.cost;
+      connectionPool.moveToCohort(member.conn.deviceId, light);
+      moves++;
+    }
+
+    this.loads = loads;
+    this.stats.passes++;
+    this.stats.moves += moves;
+    this.stats.lastMoves = moves;
+    this.stats.spread = mean > 0 ? (Math.max(...loads) - Math.min(...loads)) / mean : 0;
+
+    if (moves > 0) {
+      logger.info('Rebalanced cohorts', {
+        moved: moves,
+        meanLoadMs: Math.round(mean),
+        spread: this.stats.spread.toFixed(2),
+      });
+    }
+    return moves;
+  }
+
+  getStats() {
+    return {
+      ...this.stats,
+      loadsMs: this.loads.map(load => Math.round(load)),
+    };
+  }
+}
+
+// Singleton instance
+const cohortBalancer = new CohortBalancer();
+
+module.exports = { cohortBalancer };
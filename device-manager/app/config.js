@@ -19,6 +19,19 @@ const config = {
     cohortCount: parseInt(process.env.COHORT_COUNT || '10', 10), // Number of polling cohorts
     maxConcurrentPolls: parseInt(process.env.MAX_CONCURRENT_POLLS || '100', 10),
     timeoutMs: parseInt(process.env.POLL_TIMEOUT_MS || '8000', 10), // 8 second timeout
+    // Native multi-rate scheduler (addon PollScheduler) instead of the JS
+    // cohort ticks: monitor data every intervalMs, statistics at their own
+    // periods and device info on every connect, results delivered in batches
+    native: process.env.NATIVE_POLLING === 'true',
+    statisticsIntervalMs: parseInt(process.env.POLL_STATISTICS_INTERVAL_MS || '300000', 10), // 5 minutes, 0 = off
+    fgStatisticsIntervalMs: parseInt(process.env.POLL_FG_STATISTICS_INTERVAL_MS || '900000', 10), // 15 minutes, 0 = off
+    batchMs: parseInt(process.env.POLL_BATCH_MS || '1000', 10), // Max delay of a native result
+    // Move devices between cohorts so every tick carries the same expected
+    // poll time, from each device's measured poll duration and failure rate
+    rebalance: process.env.COHORT_REBALANCE !== 'false',
+    rebalanceEveryIntervals: parseInt(process.env.COHORT_REBALANCE_EVERY || '6', 10), // 1 minute at 10 s
+    rebalanceMaxMoves: parseInt(process.env.COHORT_REBALANCE_MAX_MOVES || '10', 10), // Per pass
+    rebalanceTolerance: parseFloat(process.env.COHORT_REBALANCE_TOLERANCE || '0.1'), // Allowed spread over the mean load
   },
 
   // Connection management
@@ -26,6 +39,14 @@ const config = {
     maxReconnectAttempts: parseInt(process.env.MAX_RECONNECT_ATTEMPTS || '5', 10),
     baseReconnectDelayMs: parseInt(process.env.BASE_RECONNECT_DELAY_MS || '1000', 10),
     maxReconnectDelayMs: parseInt(process.env.MAX_RECONNECT_DELAY_MS || '60000', 10),
+    // Native pool of disconnected Powermon instances reused across reconnects
+    instancePoolIdle: parseInt(process.env.INSTANCE_POOL_IDLE || '64', 10),
+    instancePoolPrewarm: parseInt(process.env.INSTANCE_POOL_PREWARM || '0', 10),
+    // Disconnect devices between polls and reconnect them ahead of their
+    // cohort tick, by each device's measured connect lead time
+    hibernate: process.env.HIBERNATE_ENABLED === 'true',
+    hibernateMinSleepMs: parseInt(process.env.HIBERNATE_MIN_SLEEP_MS || '3000', 10), // Stay connected for shorter gaps
+    hibernateWakeMarginMs: parseInt(process.env.HIBERNATE_WAKE_MARGIN_MS || '500', 10), // Extra lead on top of the estimate
   },
 
   // Batch writer configuration
@@ -35,11 +56,26 @@ const config = {
     maxQueueSize: parseInt(process.env.MAX_QUEUE_SIZE || '10000', 10),
   },
 
+  // Poll/backfill stream merging (native SampleMerger)
+  merge: {
+    enabled: process.env.MERGE_ENABLED !== 'false',
+    toleranceMs: parseInt(process.env.MERGE_TOLERANCE_MS || '2000', 10), // Max poll/log timestamp skew
+    holdMs: parseInt(process.env.MERGE_HOLD_MS || '30000', 10), // Delay before polls are written
+    historyMs: parseInt(process.env.MERGE_HISTORY_MS || '3600000', 10), // 1 hour of dedup history
+  },
+
   // Backfill configuration
   backfill: {
     gapThresholdMs: parseInt(process.env.GAP_THRESHOLD_MS || '30000', 10), // 30 seconds = 3 missed polls
     maxConcurrentBackfills: parseInt(process.env.MAX_CONCURRENT_BACKFILLS || '5', 10),
     batchSize: parseInt(process.env.BACKFILL_BATCH_SIZE || '1000', 10),
+    integrationMaxGapSec: parseInt(process.env.BACKFILL_INTEGRATION_MAX_GAP_SEC || '60', 10), // Don't integrate across longer gaps
+  },
+
+  // Data coverage tracking (native CoverageMap)
+  coverage: {
+    slackMs: parseInt(process.env.COVERAGE_SLACK_MS || '2000', 10), // Join ranges closer than this
+    historyMs: parseInt(process.env.COVERAGE_HISTORY_MS || '86400000', 10), // 24 hours
   },
 
   // Health check / metrics server
@@ -47,6 +83,7 @@ const config = {
     port: parseInt(process.env.DM_PORT || '3001', 10),
     metricsPath: '/metrics',
     healthPath: '/health',
+    linksPath: '/links',
   },
 
   // Logging
@@ -74,6 +111,10 @@ function validateConfig() {
     errors.push('COHORT_COUNT must be at least 1');
   }
 
+  if (config.polling.rebalanceEveryIntervals < 1) {
+    errors.push('COHORT_REBALANCE_EVERY must be at least 1');
+  }
+
   if (errors.length > 0) {
     throw new Error(`Configuration validation failed:\n${errors.join('\n')}`);
   }
@@ -5,41 +5,25 @@
  * Devices are sharded into cohorts for staggered polling.
  */
 
-const path = require('path');
 const { config } = require('./config');
 const logger = require('./logger');
 const db = require('./database');
+const { powermon } = require('./addon');
 
-// Load the native addon - with graceful fallback to simulation mode
-let powermon = null;
-let simulationMode = false;
-
-// Check if we're in simulation mode via environment variable
-// SIMULATION_MODE=true skips loading native addon entirely (avoids crash on incompatible binaries)
-if (process.env.SIMULATION_MODE === 'true' || process.env.SIMULATION_MODE === '1') {
-  simulationMode = true;
-  logger.info('Running in SIMULATION MODE - no real device connections');
-} else {
-  // Only attempt to load addon if not in simulation mode
-  // Note: If addon is compiled for different architecture, Node will crash on require()
-  // Set SIMULATION_MODE=true to avoid this on EC2 until addon is rebuilt for target platform
-  const addonPath = path.join(__dirname, '../build/Release/powermon_addon.node');
-  const fs = require('fs');
-  
-  if (!fs.existsSync(addonPath)) {
-    logger.warn('PowerMon addon not found at ' + addonPath + ', running in simulation mode');
-    simulationMode = true;
-  } else {
-    try {
-      powermon = require(addonPath);
-      logger.info('PowerMon addon loaded successfully');
-    } catch (err) {
-      logger.error('Failed to load PowerMon addon', { error: err.message });
-      logger.warn('Set SIMULATION_MODE=true to avoid crash on incompatible binaries');
-      simulationMode = true;
-    }
-  }
-}
+// Polls run on the addon's PollScheduler, which also fetches device info on
+// every connect
+const nativePolling = config.polling.native && !!(powermon && powermon.PollScheduler);
+
+// Weight of the latest poll in a device's smoothed poll cost
+const POLL_COST_ALPHA = 0.2;
+
+// Hibernation counters across all devices
+const hibernation = {
+  hibernations: 0,
+  wakes: 0,
+  wakeFailures: 0,
+  lateWakes: 0, // Still hibernating or waking when their cohort tick came
+};
 
 /**
  * Connection state for a single device
@@ -55,12 +39,23 @@ class DeviceConnection {
     this.cohortId = deviceInfo.cohort_id || 0;
     
     this.device = null; // PowerMon device instance
-    this.status = 'disconnected'; // disconnected, connecting, connected, reconnecting
+    this.status = 'disconnected'; // disconnected, connecting, connected, reconnecting, hibernating
     this.lastPollAt = null;
     this.lastSuccessfulPollAt = deviceInfo.last_successful_poll_at;
+    this.lastMeasurement = null;
     this.consecutiveFailures = 0;
     this.reconnectAttempts = 0;
     this.reconnectTimer = null;
+    this.wakeTimer = null;
+    this.sleeping = null; // Settles once the hibernate disconnect is done
+    this.waking = null;
+    this.pins = 0; // Backfills reading from the device
+    this.nativePoll = null; // { id, device } while on the native PollScheduler
+    this.lastStatistics = null; // Native statistics polls
+    this.lastFuelgaugeStatistics = null;
+    // Poll cost for cohort balancing: how long a poll holds a concurrency
+    // slot (wake included) and how often it fails, smoothed over polls
+    this.pollCost = { samples: 0, meanMs: 0, failureRate: 0 };
     
     this.log = logger.child({ 
       deviceId: this.deviceId, 
@@ -72,35 +67,53 @@ class DeviceConnection {
   /**
    * Connect to the device
    */
-  connect() {
+  async connect() {
     if (!powermon) {
       this.log.error('PowerMon addon not available');
-      return Promise.resolve(false);
+      return false;
     }
 
     if (this.status === 'connected') {
-      return Promise.resolve(true);
+      return true;
     }
 
     this.status = 'connecting';
     this.log.info('Connecting to device');
 
+    // Create the device instance on a worker thread so a reconnect storm
+    // does not block the event loop in createInstance()
+    let device;
+    try {
+      device = powermon.PowermonDevice.create
+        ? await powermon.PowermonDevice.create()
+        : new powermon.PowermonDevice();
+    } catch (err) {
+      this.status = 'disconnected';
+      this.log.error('Connection failed', { error: err.message });
+      return false;
+    }
+    if (this.status !== 'connecting') {
+      // disconnect() was called while the instance was being created
+      if (device.close) {
+        device.close();
+      }
+      return false;
+    }
+
     return new Promise((resolve) => {
       try {
         // Parse applink URL to get access key
         const parsed = powermon.PowermonDevice.parseAccessURL(this.applinkUrl);
         
-        // Create device instance
-        this.device = new powermon.PowermonDevice();
+        // The instance from the previous attempt is disconnected already
+        this.closeDevice();
+        this.device = device;
         
         // Set connection timeout
         const timeout = setTimeout(() => {
           this.log.warn('Connection timeout');
           this.status = 'disconnected';
-          if (this.device) {
-            this.device.disconnect();
-            this.device = null;
-          }
+          this.closeDevice();
           resolve(false);
         }, 15000);
         
@@ -117,7 +130,9 @@ class DeviceConnection {
             await db.markDeviceConnected(this.deviceId);
             
             // Fetch and update device info on first connection
-            await this.fetchAndUpdateDeviceInfo();
+            if (!nativePolling) {
+              await this.fetchAndUpdateDeviceInfo();
+            }
             
             resolve(true);
           },
@@ -143,17 +158,35 @@ class DeviceConnection {
   }
 
   /**
-   * Disconnect from the device
+   * Drop the device instance. close() disconnects and deletes the native
+   * instance on a background thread instead of leaving it to the GC
+   * finalizer
    */
-  disconnect() {
-    if (this.device) {
-      try {
+  closeDevice() {
+    if (!this.device) {
+      return;
+    }
+    try {
+      if (this.device.close) {
+        this.device.close();
+      } else {
         this.device.disconnect();
-      } catch (err) {
-        this.log.warn('Error during disconnect', { error: err.message });
       }
-      this.device = null;
+    } catch (err) {
+      this.log.warn('Error during disconnect', { error: err.message });
+    }
+    this.device = null;
+  }
+
+  /**
+   * Disconnect from the device
+   */
+  disconnect() {
+    if (this.wakeTimer) {
+      clearTimeout(this.wakeTimer);
+      this.wakeTimer = null;
     }
+    this.closeDevice();
     
     if (this.reconnectTimer) {
       clearTimeout(this.reconnectTimer);
@@ -178,29 +211,34 @@ class DeviceConnection {
           this.log.warn('Failed to get device info', { code: result.code });
           return;
         }
-        
-        const info = result.data;
-        const deviceInfo = {};
-        
-        // Map PowerMon info fields to database fields
-        // PowerMon returns: serial, firmwareVersion, hardwareRevision, hardwareString, name
-        if (info.serial) deviceInfo.serialNumber = info.serial;
-        if (info.firmwareVersion) deviceInfo.firmwareVersion = info.firmwareVersion;
-        if (info.hardwareString) deviceInfo.hardwareRevision = info.hardwareString;
-        if (info.name) deviceInfo.deviceName = info.name;
-        
-        if (Object.keys(deviceInfo).length > 0) {
-          this.log.info('Fetched device info from PowerMon', deviceInfo);
-          db.updateDeviceInfo(this.deviceId, deviceInfo).catch((err) => {
-            this.log.error('Failed to update device info in database', { error: err.message });
-          });
-        }
+        this.applyDeviceInfo(result.data);
       });
     } catch (err) {
       this.log.warn('Error fetching device info', { error: err.message });
     }
   }
 
+  /**
+   * Store device info from getInfo() or a native info poll in the database
+   */
+  applyDeviceInfo(info) {
+    const deviceInfo = {};
+    
+    // Map PowerMon info fields to database fields
+    // PowerMon returns: serial, firmwareVersion, hardwareRevision, hardwareString, name
+    if (info.serial) deviceInfo.serialNumber = info.serial;
+    if (info.firmwareVersion) deviceInfo.firmwareVersion = info.firmwareVersion;
+    if (info.hardwareString) deviceInfo.hardwareRevision = info.hardwareString;
+    if (info.name) deviceInfo.deviceName = info.name;
+    
+    if (Object.keys(deviceInfo).length > 0) {
+      this.log.info('Fetched device info from PowerMon', deviceInfo);
+      db.updateDeviceInfo(this.deviceId, deviceInfo).catch((err) => {
+        this.log.error('Failed to update device info in database', { error: err.message });
+      });
+    }
+  }
+
   /**
    * Poll the device for current data
    */
@@ -209,58 +247,13 @@ class DeviceConnection {
       return Promise.resolve(null);
     }
 
-    this.lastPollAt = new Date();
+    const polledAt = new Date();
 
     return new Promise((resolve) => {
       try {
         // Get monitor data from device using callback API
         this.device.getMonitorData((result) => {
-          if (!result.success) {
-            this.consecutiveFailures++;
-            this.log.warn('Poll failed', { 
-              code: result.code, 
-              failures: this.consecutiveFailures 
-            });
-
-            // Mark as disconnected if too many failures
-            if (this.consecutiveFailures >= 3) {
-              this.status = 'disconnected';
-              db.markDeviceDisconnected(this.deviceId, this.lastSuccessfulPollAt)
-                .then(() => this.scheduleReconnect());
-            }
-
-            resolve(null);
-            return;
-          }
-
-          const data = result.data;
-          this.lastSuccessfulPollAt = this.lastPollAt;
-          this.consecutiveFailures = 0;
-
-          // Transform to measurement format
-          const measurement = {
-            organizationId: this.orgId,
-            deviceId: this.deviceId,
-            truckId: this.truckId,
-            fleetId: null, // Will be looked up if needed
-            voltage1: data.voltage1,
-            voltage2: data.voltage2,
-            current: data.current,
-            power: data.power,
-            temperature: data.temperature,
-            soc: data.soc,
-            energy: data.energyMeter,
-            charge: data.coulombMeter,
-            runtime: data.runtime,
-            rssi: data.rssi,
-            powerStatus: data.powerStatus,
-            powerStatusString: data.powerStatusString,
-            source: 'poll',
-            recordedAt: this.lastPollAt,
-          };
-
-          this.log.debug('Poll successful', { soc: data.soc, voltage: data.voltage1 });
-          resolve(measurement);
+          resolve(this.handleMonitorResult(result, polledAt));
         });
       } catch (err) {
         this.consecutiveFailures++;
@@ -273,6 +266,88 @@ class DeviceConnection {
     });
   }
 
+  /**
+   * Turn a getMonitorData() or native monitor result into a measurement;
+   * null when the poll failed
+   */
+  handleMonitorResult(result, polledAt) {
+    this.lastPollAt = polledAt;
+
+    if (!result.success) {
+      this.consecutiveFailures++;
+      this.log.warn('Poll failed', { 
+        code: result.code, 
+        failures: this.consecutiveFailures 
+      });
+
+      // Mark as disconnected if too many failures
+      if (this.consecutiveFailures >= 3 && this.status === 'connected') {
+        this.status = 'disconnected';
+        db.markDeviceDisconnected(this.deviceId, this.lastSuccessfulPollAt)
+          .then(() => this.scheduleReconnect());
+      }
+
+      return null;
+    }
+
+    const data = result.data;
+    this.lastSuccessfulPollAt = polledAt;
+    this.consecutiveFailures = 0;
+
+    // Transform to measurement format
+    const measurement = {
+      organizationId: this.orgId,
+      deviceId: this.deviceId,
+      truckId: this.truckId,
+      fleetId: null, // Will be looked up if needed
+      voltage1: data.voltage1,
+      voltage2: data.voltage2,
+      current: data.current,
+      power: data.power,
+      temperature: data.temperature,
+      soc: data.soc,
+      energy: data.energyMeter,
+      charge: data.coulombMeter,
+      runtime: data.runtime,
+      rssi: data.rssi,
+      powerStatus: data.powerStatus,
+      powerStatusString: data.powerStatusString,
+      source: 'poll',
+      recordedAt: polledAt,
+    };
+
+    this.lastMeasurement = measurement;
+    this.log.debug('Poll successful', { soc: data.soc, voltage: data.voltage1 });
+    return measurement;
+  }
+
+  /**
+   * Record one poll's slot time and outcome
+   */
+  recordPollCost(durationMs, success) {
+    const cost = this.pollCost;
+    if (cost.samples === 0) {
+      cost.meanMs = durationMs;
+      cost.failureRate = success ? 0 : 1;
+    } else {
+      cost.meanMs += POLL_COST_ALPHA * (durationMs - cost.meanMs);
+      cost.failureRate += POLL_COST_ALPHA * ((success ? 0 : 1) - cost.failureRate);
+    }
+    cost.samples++;
+  }
+
+  /**
+   * Expected slot time of this device's next poll, null before its first
+   * poll. A failing device is charged a timeout per failure: its polls tend
+   * to run to the timeout and end in a reconnect
+   */
+  expectedPollCostMs() {
+    if (this.pollCost.samples === 0) {
+      return null;
+    }
+    return this.pollCost.meanMs + this.pollCost.failureRate * config.polling.timeoutMs;
+  }
+
   /**
    * Schedule a reconnection attempt with exponential backoff
    */
@@ -309,6 +384,113 @@ class DeviceConnection {
   isReady() {
     return this.status === 'connected' && this.device !== null;
   }
+
+  /**
+   * Keep the device connected while something other than polling uses it
+   */
+  pin() {
+    this.pins++;
+  }
+
+  unpin() {
+    this.pins--;
+  }
+
+  /**
+   * Disconnect until the poll due at nextPollAt. The wake is scheduled the
+   * device's connect lead time (mean plus four deviations of its measured
+   * connects) and a margin ahead of it; devices whose sleep would be
+   * shorter than hibernateMinSleepMs stay connected
+   */
+  hibernate(nextPollAt) {
+    if (!config.connection.hibernate || !this.isReady() || !this.device.hibernate || this.pins > 0) {
+      return false;
+    }
+
+    const estimate = this.device.getConnectEstimate();
+    if (estimate.samples === 0) {
+      return false;
+    }
+    const wakeAt = nextPollAt - estimate.leadMs - config.connection.hibernateWakeMarginMs;
+    const sleepMs = wakeAt - Date.now();
+    if (sleepMs < config.connection.hibernateMinSleepMs) {
+      return false;
+    }
+
+    const device = this.device;
+    try {
+      this.sleeping = new Promise((resolve) => device.hibernate(resolve));
+    } catch (err) {
+      this.log.warn('Hibernate failed', { error: err.message });
+      return false;
+    }
+    this.status = 'hibernating';
+    this.wakeTimer = setTimeout(() => {
+      this.wakeTimer = null;
+      this.wake();
+    }, sleepMs);
+    hibernation.hibernations++;
+    this.log.debug('Hibernating', { sleepMs: Math.round(sleepMs), leadMs: Math.round(estimate.leadMs) });
+    return true;
+  }
+
+  /**
+   * Reconnect a hibernating device. Resolves to whether it is ready; a
+   * failed wake falls back to the reconnect backoff. forPoll: called by the
+   * cohort tick, which the scheduled wake should have beaten
+   */
+  wake(forPoll = false) {
+    if (this.status !== 'hibernating') {
+      return Promise.resolve(this.isReady());
+    }
+    if (forPoll) {
+      hibernation.lateWakes++;
+    }
+    if (this.wakeTimer) {
+      clearTimeout(this.wakeTimer);
+      this.wakeTimer = null;
+    }
+    if (!this.waking) {
+      this.waking = this.reconnectFromHibernation().finally(() => {
+        this.waking = null;
+      });
+    }
+    return this.waking;
+  }
+
+  async reconnectFromHibernation() {
+    const device = this.device;
+    await this.sleeping;
+    if (this.device !== device || this.status !== 'hibernating') {
+      return this.isReady();
+    }
+
+    const result = await new Promise((resolve) => {
+      try {
+        device.wake(resolve);
+      } catch (err) {
+        resolve({ success: false, error: err.message });
+      }
+    });
+    if (this.device !== device || this.status !== 'hibernating') {
+      // Closed while waking
+      return this.isReady();
+    }
+
+    if (result.success) {
+      this.status = 'connected';
+      hibernation.wakes++;
+      this.log.debug('Woke', { latencyMs: Math.round(result.latencyMs) });
+      return true;
+    }
+
+    hibernation.wakeFailures++;
+    this.log.warn('Wake failed', { reason: result.reason, error: result.error });
+    this.closeDevice();
+    this.status = 'disconnected';
+    this.scheduleReconnect();
+    return false;
+  }
 }
 
 /**
@@ -335,7 +517,7 @@ class ConnectionPool {
     // Assign devices to cohorts using hash-based sharding
     for (let i = 0; i < devices.length; i++) {
       const device = devices[i];
-      const cohortId = this.hashToCohort(device.serial_number);
+      const cohortId = this.initialCohort(device);
       
       // Create connection object
       const conn = new DeviceConnection({
@@ -363,6 +545,20 @@ class ConnectionPool {
     return this.connections.size;
   }
 
+  /**
+   * Cohort a device starts in: with rebalancing on, the one it was last moved
+   * to (device_sync_status.cohort_id) while that still exists, otherwise its
+   * serial number's hash
+   */
+  initialCohort(device) {
+    const saved = device.cohort_id;
+    if (config.polling.rebalance && Number.isInteger(saved) &&
+        saved >= 0 && saved < config.polling.cohortCount) {
+      return saved;
+    }
+    return this.hashToCohort(device.serial_number);
+  }
+
   /**
    * Hash a serial number to a cohort ID
    */
@@ -404,6 +600,38 @@ class ConnectionPool {
     return Array.from(deviceIds).map(id => this.connections.get(id)).filter(Boolean);
   }
 
+  /**
+   * Move a device to another cohort; it is polled at that cohort's next tick
+   */
+  moveToCohort(deviceId, cohortId) {
+    const conn = this.connections.get(deviceId);
+    if (!conn || conn.cohortId === cohortId) {
+      return false;
+    }
+
+    const from = this.cohorts.get(conn.cohortId);
+    if (from) {
+      from.delete(deviceId);
+    }
+    if (!this.cohorts.has(cohortId)) {
+      this.cohorts.set(cohortId, new Set());
+    }
+    this.cohorts.get(cohortId).add(deviceId);
+
+    conn.log.debug('Moved to cohort', { to: cohortId });
+    conn.cohortId = cohortId;
+    conn.log = logger.child({ 
+      deviceId: conn.deviceId, 
+      serial: conn.serialNumber,
+      cohort: cohortId 
+    });
+
+    db.upsertDeviceSyncStatus(deviceId, conn.orgId, cohortId).catch((err) => {
+      conn.log.warn('Failed to store cohort assignment', { error: err.message });
+    });
+    return true;
+  }
+
   /**
    * Get all cohort IDs
    */
@@ -435,7 +663,9 @@ class ConnectionPool {
       connecting: 0,
       disconnected: 0,
       reconnecting: 0,
+      hibernating: 0,
       cohorts: this.cohorts.size,
+      hibernation: { ...hibernation },
     };
 
     for (const conn of this.connections.values()) {
@@ -474,7 +704,7 @@ class ConnectionPool {
     // Add new devices
     for (const device of devices) {
       if (!currentIds.has(device.device_id)) {
-        const cohortId = this.hashToCohort(device.serial_number);
+        const cohortId = this.initialCohort(device);
         const conn = new DeviceConnection({
           ...device,
           cohort_id: cohortId,
@@ -523,4 +753,4 @@ class ConnectionPool {
 // Singleton instance
 const connectionPool = new ConnectionPool();
 
-module.exports = { connectionPool, DeviceConnection };
+module.exports = { connectionPool, DeviceConnection, nativePolling };
@@ -0,0 +1,75 @@
+/**
+ * Coverage Tracker
+ * 
+ * Records which time ranges of each device's data have been collected, from
+ * successful polls and from backfilled log samples, so backfill can ask for
+ * the precise gaps instead of re-reading whole log files.
+ * Falls back to treating the whole window as missing without the native addon.
+ */
+
+const { config } = require('./config');
+const { powermon } = require('./addon');
+
+class CoverageTracker {
+  constructor() {
+    this.map = powermon && powermon.CoverageMap
+      ? new powermon.CoverageMap({ slackMs: config.coverage.slackMs })
+      : null;
+  }
+
+  /**
+   * Record a successful poll; it covers one poll interval
+   */
+  recordPoll(deviceId, recordedAt) {
+    if (!this.map) return;
+    this.map.addPoll(deviceId, recordedAt, config.polling.intervalMs);
+  }
+
+  /**
+   * Record decoded log samples from one file
+   * @param {Array} samples - Decoded samples (time in Unix seconds)
+   * @param {number|null} samplePeriod - File sample period in seconds
+   */
+  recordLogSamples(deviceId, samples, samplePeriod, start = 0, count = samples.length) {
+    if (!this.map || count === 0) return;
+
+    // Without a known period, assume contiguous samples at their observed spacing
+    let periodSec = samplePeriod;
+    if (!periodSec) {
+      periodSec = count > 1 ? samples[start + 1].time - samples[start].time : 1;
+    }
+    this.map.addLogSamples(deviceId, samples, Math.max(1, periodSec) * 1000, start, count);
+  }
+
+  /**
+   * Get uncovered ranges of [fromMs, toMs) at least minGapMs long
+   * @returns {Array} [{ start, end }] in ms
+   */
+  getGaps(deviceId, fromMs, toMs, minGapMs = 0) {
+    if (toMs <= fromMs) return [];
+    if (!this.map) return [{ start: fromMs, end: toMs }];
+    return this.map.gaps(deviceId, fromMs, toMs, minGapMs);
+  }
+
+  /**
+   * Drop coverage older than the configured history
+   */
+  trim() {
+    if (!this.map) return;
+    this.map.trim(Date.now() - config.coverage.historyMs);
+  }
+
+  removeDevice(deviceId) {
+    if (!this.map) return;
+    this.map.removeDevice(deviceId);
+  }
+
+  getStats() {
+    return this.map ? this.map.stats() : { devices: 0, intervals: 0 };
+  }
+}
+
+// Singleton instance
+const coverageTracker = new CoverageTracker();
+
+module.exports = coverageTracker;
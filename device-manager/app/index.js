@@ -17,6 +17,7 @@ const { pollingScheduler } = require('./polling-scheduler');
 const batchWriter = require('./batch-writer');
 const { backfillService } = require('./backfill-service');
 const { startMetricsServer, stopMetricsServer } = require('./metrics');
+const { powermon } = require('./addon');
 
 let isShuttingDown = false;
 
@@ -46,6 +47,15 @@ async function main() {
       logger.warn('No active devices found. Waiting for devices to be added...');
     }
 
+    // Size the native instance pool; prewarming creates instances up front,
+    // on a worker thread, so the first connects and reconnect storms skip
+    // createInstance()
+    if (powermon && powermon.PowermonDevice.configurePool) {
+      powermon.PowermonDevice.configurePool({ maxIdle: config.connection.instancePoolIdle });
+      const pool = await powermon.PowermonDevice.prewarmPool(config.connection.instancePoolPrewarm);
+      logger.info('Instance pool ready', { idle: pool.idle, maxIdle: pool.maxIdle, createMeanMs: pool.createMeanMs });
+    }
+
     // Start metrics server
     startMetricsServer();
 
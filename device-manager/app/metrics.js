@@ -2,6 +2,7 @@
  * Metrics and Health Check Server
  * 
  * Exposes Prometheus-compatible metrics and health check endpoint.
+ * Device-level metrics (dm_native_*) are kept by the addon and rendered there.
  * Runs on a separate port from the main app.
  */
 
@@ -12,6 +13,7 @@ const { connectionPool } = require('./connection-pool');
 const { pollingScheduler } = require('./polling-scheduler');
 const batchWriter = require('./batch-writer');
 const { backfillService } = require('./backfill-service');
+const { powermon } = require('./addon');
 
 let server = null;
 
@@ -37,6 +39,22 @@ function generateMetrics() {
     '# TYPE dm_devices_disconnected gauge',
     `dm_devices_disconnected ${poolStats.disconnected}`,
     '',
+    '# HELP dm_devices_hibernating Devices disconnected between polls',
+    '# TYPE dm_devices_hibernating gauge',
+    `dm_devices_hibernating ${poolStats.hibernating}`,
+    '',
+    '# HELP dm_wakes_total Hibernating devices reconnected for a poll',
+    '# TYPE dm_wakes_total counter',
+    `dm_wakes_total ${poolStats.hibernation.wakes}`,
+    '',
+    '# HELP dm_wakes_failed_total Wakes whose reconnect failed',
+    '# TYPE dm_wakes_failed_total counter',
+    `dm_wakes_failed_total ${poolStats.hibernation.wakeFailures}`,
+    '',
+    '# HELP dm_wakes_late_total Wakes not connected by the cohort tick',
+    '# TYPE dm_wakes_late_total counter',
+    `dm_wakes_late_total ${poolStats.hibernation.lateWakes}`,
+    '',
     '# HELP dm_polls_total Total number of polls',
     '# TYPE dm_polls_total counter',
     `dm_polls_total ${schedulerStats.totalPolls}`,
@@ -90,9 +108,98 @@ function generateMetrics() {
     `dm_samples_backfilled_total ${backfillStats.totalSamplesBackfilled}`,
   ];
 
+  // Cohort balancing: expected poll time per tick and devices moved
+  const balance = schedulerStats.balance;
+  lines.push(
+    '',
+    '# HELP dm_cohort_load_ms Expected poll time of a cohort\'s tick, from measured device poll cost',
+    '# TYPE dm_cohort_load_ms gauge',
+    ...balance.loadsMs.map((load, cohort) => `dm_cohort_load_ms{cohort="${cohort}"} ${load}`),
+    '',
+    '# HELP dm_cohort_load_spread Heaviest minus lightest cohort load over the mean',
+    '# TYPE dm_cohort_load_spread gauge',
+    `dm_cohort_load_spread ${balance.spread.toFixed(3)}`,
+    '',
+    '# HELP dm_cohort_moves_total Devices moved between cohorts by rebalancing',
+    '# TYPE dm_cohort_moves_total counter',
+    `dm_cohort_moves_total ${balance.moves}`,
+  );
+
+  // Native PollScheduler: how late its timers fire and how results batch
+  if (schedulerStats.native) {
+    const native = schedulerStats.native;
+    lines.push(
+      '',
+      '# HELP dm_native_poll_lag_ms Mean delay from a native poll falling due to being issued',
+      '# TYPE dm_native_poll_lag_ms gauge',
+      `dm_native_poll_lag_ms ${native.meanLagMs.toFixed(2)}`,
+      '',
+      '# HELP dm_native_poll_lag_max_ms Largest native poll delay',
+      '# TYPE dm_native_poll_lag_max_ms gauge',
+      `dm_native_poll_lag_max_ms ${native.maxLagMs}`,
+      '',
+      '# HELP dm_native_polls_skipped_total Native polls due while the device was not connected',
+      '# TYPE dm_native_polls_skipped_total counter',
+      `dm_native_polls_skipped_total ${native.skipped}`,
+      '',
+      '# HELP dm_native_poll_batches_total Native result batches delivered to JS',
+      '# TYPE dm_native_poll_batches_total counter',
+      `dm_native_poll_batches_total ${native.batches}`,
+    );
+  }
+
+  // In-flight requests, callback queue, connects/disconnects by reason, log
+  // bytes, decode time and request latency, counted in the addon
+  if (powermon && powermon.PowermonDevice.getMetrics) {
+    lines.push('', powermon.PowermonDevice.getMetrics());
+  }
+
   return lines.join('\n');
 }
 
+/**
+ * Per-device link quality over the addon's rolling window (getLinkStats),
+ * worst first: by timeout rate, then disconnects per hour
+ */
+function generateLinkReport() {
+  if (!powermon || !powermon.PowermonDevice.getLinkStats) {
+    return { windowSeconds: 0, devices: [] };
+  }
+
+  const stats = powermon.PowermonDevice.getLinkStats();
+  const bySerial = new Map();
+  for (const conn of connectionPool.connections.values()) {
+    if (conn.serialNumber) {
+      bySerial.set(String(conn.serialNumber).toUpperCase(), conn);
+    }
+  }
+
+  const devices = [];
+  for (let i = 0; i < stats.count; i++) {
+    const conn = bySerial.get(stats.serial[i]);
+    devices.push({
+      serial: stats.serial[i] || null,
+      deviceId: conn ? conn.deviceId : null,
+      truckId: conn ? conn.truckId : null,
+      connected: stats.connected[i] === 1,
+      observedSeconds: stats.observedSeconds[i],
+      requests: stats.requests[i],
+      errors: stats.errors[i],
+      timeoutRate: stats.timeoutRate[i],
+      rttMs: { p50: stats.rttP50Ms[i], p90: stats.rttP90Ms[i], p99: stats.rttP99Ms[i], max: stats.rttMaxMs[i] },
+      connects: stats.connects[i],
+      connectFailures: stats.connectFailures[i],
+      disconnectsPerHour: stats.disconnectsPerHour[i],
+      disconnectsByReason: Array.from(stats.disconnects.subarray(i * 8, i * 8 + 8)),
+      rssiMin: stats.rssiMin[i],
+      rssiMean: Number.isNaN(stats.rssiMean[i]) ? null : stats.rssiMean[i],
+    });
+  }
+  devices.sort((a, b) => (b.timeoutRate - a.timeoutRate) || (b.disconnectsPerHour - a.disconnectsPerHour));
+
+  return { windowSeconds: stats.windowSeconds, devices };
+}
+
 /**
  * Generate health check response
  */
@@ -111,9 +218,10 @@ function generateHealthCheck() {
     timestamp: new Date().toISOString(),
     components: {
       connectionPool: {
-        status: poolStats.connected > 0 ? 'ok' : 'warning',
+        status: poolStats.connected + poolStats.hibernating > 0 ? 'ok' : 'warning',
         devices: poolStats.totalDevices,
         connected: poolStats.connected,
+        hibernating: poolStats.hibernating,
       },
       pollingScheduler: {
         status: schedulerStats.isRunning ? 'ok' : 'error',
@@ -139,6 +247,9 @@ function startMetricsServer() {
     if (req.url === config.server.metricsPath) {
       res.writeHead(200, { 'Content-Type': 'text/plain; charset=utf-8' });
       res.end(generateMetrics());
+    } else if (req.url === config.server.linksPath) {
+      res.writeHead(200, { 'Content-Type': 'application/json' });
+      res.end(JSON.stringify(generateLinkReport(), null, 2));
     } else if (req.url === config.server.healthPath) {
       const health = generateHealthCheck();
       const statusCode = health.status === 'healthy' ? 200 : 503;
@@ -155,6 +266,7 @@ function startMetricsServer() {
       port: config.server.port,
       metricsPath: config.server.metricsPath,
       healthPath: config.server.healthPath,
+      linksPath: config.server.linksPath,
     });
   });
 }
@@ -180,4 +292,5 @@ module.exports = {
   stopMetricsServer,
   generateMetrics,
   generateHealthCheck,
+  generateLinkReport,
 };
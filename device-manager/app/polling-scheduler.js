@@ -2,20 +2,32 @@
  * Staggered Polling Scheduler
  * 
  * Spreads device polling across the poll interval to avoid thundering herd.
- * Uses a timing wheel approach with cohorts.
+ * Uses a timing wheel approach with cohorts. With NATIVE_POLLING=true the
+ * addon's PollScheduler runs the polls instead, on its own thread, and this
+ * module only keeps its device list current and handles the result batches.
  */
 
 const { config } = require('./config');
 const logger = require('./logger');
-const { connectionPool } = require('./connection-pool');
+const { powermon } = require('./addon');
+const { connectionPool, nativePolling } = require('./connection-pool');
 const batchWriter = require('./batch-writer');
+const coverageTracker = require('./coverage');
+const { cohortBalancer } = require('./cohort-balancer');
+
+// How often connected devices are (re)registered with the native scheduler
+const NATIVE_SYNC_MS = 1000;
 
 class PollingScheduler {
   constructor() {
     this.isRunning = false;
     this.tickTimer = null;
     this.currentTick = 0;
+    this.native = null; // addon PollScheduler
+    this.nativeSyncTimer = null;
+    this.nativeDevices = new Map(); // scheduler id -> DeviceConnection
     this.ticksPerInterval = config.polling.cohortCount;
+    this.intervalsProcessed = 0;
     this.tickDurationMs = config.polling.intervalMs / this.ticksPerInterval;
     
     // Semaphore for concurrent poll limiting
@@ -30,6 +42,7 @@ class PollingScheduler {
       ticksProcessed: 0,
       lastTickTime: null,
       averagePollDurationMs: 0,
+      resultBatches: 0, // Native result batches handled
     };
   }
 
@@ -43,6 +56,12 @@ class PollingScheduler {
     }
 
     this.isRunning = true;
+
+    if (nativePolling) {
+      this.startNative();
+      return;
+    }
+
     logger.info('Starting polling scheduler', {
       intervalMs: config.polling.intervalMs,
       cohorts: this.ticksPerInterval,
@@ -53,6 +72,109 @@ class PollingScheduler {
     this.scheduleTick();
   }
 
+  /**
+   * Hand polling to the addon's PollScheduler: monitor data, statistics and
+   * fuelgauge statistics at their own periods, device info on every connect
+   */
+  startNative() {
+    logger.info('Starting native polling scheduler', {
+      intervalMs: config.polling.intervalMs,
+      statisticsIntervalMs: config.polling.statisticsIntervalMs,
+      fgStatisticsIntervalMs: config.polling.fgStatisticsIntervalMs,
+      batchMs: config.polling.batchMs,
+    });
+
+    this.native = new powermon.PollScheduler({
+      batchMs: config.polling.batchMs,
+      onResults: (results) => this.processResults(results),
+    });
+    this.syncNativeDevices();
+    this.nativeSyncTimer = setInterval(() => this.syncNativeDevices(), NATIVE_SYNC_MS);
+  }
+
+  /**
+   * Register connected devices with the native scheduler and drop devices
+   * that disconnected, were replaced by a reconnect or left the pool. A
+   * device registered again after a reconnect has its info fetched again
+   */
+  syncNativeDevices() {
+    for (const [id, conn] of this.nativeDevices) {
+      const current = connectionPool.getConnection(conn.deviceId) === conn;
+      if (!current || !conn.isReady() || conn.nativePoll.device !== conn.device) {
+        this.native.remove(id);
+        this.nativeDevices.delete(id);
+        conn.nativePoll = null;
+      }
+    }
+
+    for (const conn of connectionPool.getAllConnections()) {
+      if (conn.nativePoll || !conn.isReady()) {
+        continue;
+      }
+      try {
+        const id = this.native.add(conn.device, {
+          monitorMs: config.polling.intervalMs,
+          statisticsMs: config.polling.statisticsIntervalMs,
+          fgStatisticsMs: config.polling.fgStatisticsIntervalMs,
+          info: true,
+        });
+        conn.nativePoll = { id, device: conn.device };
+        this.nativeDevices.set(id, conn);
+      } catch (err) {
+        conn.log.warn('Could not add device to native scheduler', { error: err.message });
+      }
+    }
+  }
+
+  /**
+   * Handle one batch of native poll results
+   */
+  processResults(results) {
+    this.stats.resultBatches++;
+    this.stats.lastTickTime = new Date();
+
+    for (const result of results) {
+      const conn = this.nativeDevices.get(result.id);
+      if (!conn) {
+        continue; // Removed since the request was issued
+      }
+
+      switch (result.kind) {
+        case 'monitor': {
+          // recordedAt is when the request went out, as for JS polls
+          const measurement = conn.handleMonitorResult(result, new Date(result.at - result.latencyMs));
+          this.stats.totalPolls++;
+          if (measurement) {
+            this.stats.successfulPolls++;
+            this.recordMeasurement(measurement);
+          } else {
+            this.stats.failedPolls++;
+          }
+          this.stats.averagePollDurationMs =
+            (this.stats.averagePollDurationMs * 0.9) + (result.latencyMs * 0.1);
+          break;
+        }
+        case 'statistics':
+          if (result.success) {
+            conn.lastStatistics = { ...result.data, receivedAt: new Date(result.at) };
+          }
+          break;
+        case 'fgStatistics':
+          if (result.success) {
+            conn.lastFuelgaugeStatistics = { ...result.data, receivedAt: new Date(result.at) };
+          }
+          break;
+        case 'info':
+          if (result.success) {
+            conn.applyDeviceInfo(result.data);
+          } else {
+            conn.log.warn('Failed to get device info', { code: result.code });
+          }
+          break;
+      }
+    }
+  }
+
   /**
    * Stop the polling scheduler
    */
@@ -63,6 +185,17 @@ class PollingScheduler {
       clearTimeout(this.tickTimer);
       this.tickTimer = null;
     }
+
+    if (this.native) {
+      clearInterval(this.nativeSyncTimer);
+      this.nativeSyncTimer = null;
+      this.native.stop();
+      this.native = null;
+      for (const conn of this.nativeDevices.values()) {
+        conn.nativePoll = null;
+      }
+      this.nativeDevices.clear();
+    }
     
     logger.info('Polling scheduler stopped', this.stats);
   }
@@ -96,7 +229,9 @@ class PollingScheduler {
     // Get the cohort for this tick
     const cohortId = this.currentTick;
     const devices = connectionPool.getCohortDevices(cohortId);
-    const readyDevices = devices.filter(conn => conn.isReady());
+    // Hibernating devices should be awake by now; those that are not are
+    // woken and polled once connected
+    const readyDevices = devices.filter(conn => conn.isReady() || conn.status === 'hibernating');
     
     // Calculate how many polls we can start (respect concurrency limit)
     const availableSlots = Math.max(0, this.maxConcurrentPolls - this.activePolls);
@@ -122,8 +257,12 @@ class PollingScheduler {
       activePolls: this.activePolls
     });
 
+    // This cohort's next tick, early by the jitter so hibernating devices
+    // are woken in time for it
+    const nextPollAt = tickStart + config.polling.intervalMs - config.polling.jitterMs;
+
     // Poll devices with concurrency tracking
-    const pollPromises = devicesToPoll.map(conn => this.pollDeviceWithSemaphore(conn));
+    const pollPromises = devicesToPoll.map(conn => this.pollDeviceWithSemaphore(conn, nextPollAt));
 
     const results = await Promise.allSettled(pollPromises);
 
@@ -151,6 +290,15 @@ class PollingScheduler {
     // Move to next tick
     this.currentTick = (this.currentTick + 1) % this.ticksPerInterval;
 
+    // Every few full intervals, even out the cohorts' expected poll time
+    if (this.currentTick === 0) {
+      this.intervalsProcessed++;
+      if (config.polling.rebalance &&
+          this.intervalsProcessed % config.polling.rebalanceEveryIntervals === 0) {
+        cohortBalancer.rebalance();
+      }
+    }
+
     // Schedule next tick
     this.scheduleTick();
   }
@@ -158,29 +306,38 @@ class PollingScheduler {
   /**
    * Poll device with semaphore tracking
    */
-  async pollDeviceWithSemaphore(conn) {
+  async pollDeviceWithSemaphore(conn, nextPollAt) {
     this.activePolls++;
+    const start = Date.now();
+    let measurement = null;
     try {
-      return await this.pollDevice(conn);
+      measurement = await this.pollDevice(conn, nextPollAt);
+      return measurement;
     } finally {
       this.activePolls--;
+      // The slot time, wake included, is what cohort balancing evens out
+      conn.recordPollCost(Date.now() - start, measurement !== null);
     }
   }
 
   /**
-   * Poll a single device
+   * Poll a single device. With hibernation on, a successful poll puts the
+   * device to sleep until shortly before nextPollAt
    */
-  async pollDevice(conn) {
+  async pollDevice(conn, nextPollAt = null) {
     try {
+      if (conn.status === 'hibernating') {
+        await conn.wake(true);
+      }
+
       const measurement = await conn.poll();
       
       if (measurement) {
-        // Add to batch writer queue
-        batchWriter.enqueue(measurement);
-        
-        // Update snapshot for dashboard
-        batchWriter.enqueueSnapshot(measurement);
-        
+        if (nextPollAt !== null) {
+          conn.hibernate(nextPollAt);
+        }
+
+        this.recordMeasurement(measurement);
         return measurement;
       }
       
@@ -194,6 +351,20 @@ class PollingScheduler {
     }
   }
 
+  /**
+   * Queue a polled measurement for writing
+   */
+  recordMeasurement(measurement) {
+    // Add to batch writer queue
+    batchWriter.enqueue(measurement);
+    
+    // Update snapshot for dashboard
+    batchWriter.enqueueSnapshot(measurement);
+
+    // Remember this interval is covered so backfill can skip it
+    coverageTracker.recordPoll(measurement.deviceId, measurement.recordedAt);
+  }
+
   /**
    * Get scheduler statistics
    */
@@ -205,6 +376,8 @@ class PollingScheduler {
       ticksPerInterval: this.ticksPerInterval,
       activePolls: this.activePolls,
       maxConcurrentPolls: this.maxConcurrentPolls,
+      native: this.native ? this.native.stats() : null,
+      balance: cohortBalancer.getStats(),
       poolStats: connectionPool.getStats(),
     };
   }
@@ -218,7 +391,9 @@ class PollingScheduler {
       throw new Error(`Device ${deviceId} not found in pool`);
     }
 
-    if (!conn.isReady()) {
+    if (conn.status === 'hibernating') {
+      await conn.wake();
+    } else if (!conn.isReady()) {
       await conn.connect();
     }
 
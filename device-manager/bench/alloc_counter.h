@@ -0,0 +1,20 @@
+#ifndef ALLOC_COUNTER_H
+#define ALLOC_COUNTER_H
+
+#include <stdint.h>
+
+// Process-wide count of operator new calls made by code linked into the
+// bench addon. V8 heap allocations are not included; bench/run.js measures
+// those separately.
+namespace AllocCounter {
+
+struct Snapshot {
+    uint64_t count;
+    uint64_t bytes;
+};
+
+Snapshot Get();
+
+}
+
+#endif
@@ -0,0 +1,334 @@
+#!/usr/bin/env node
+/**
+ * PowerMon Bridge Benchmark
+ *
+ * Drives powermon-bridge through PowermonBridgeClient against the fake
+ * device backend and measures the IPC stack itself: commands/s, round-trip
+ * p50/p99, bytes on the pipe and CPU per command for the client (this
+ * process) and the bridge (from /proc).
+ *
+ * Each command type runs in its own phase so per-command costs are clean,
+ * followed by a weighted mix and a monitor stream. Commands are issued
+ * back to back, as the bridge handles one command at a time.
+ *
+ * Results go to stdout as JSON; a summary table goes to stderr.
+ *
+ * Usage: npm run bench:bridge -- [--bridge <path>] [--fake <spec>] [--time <ms per phase>]
+ *          [--filter <substring>] [--stream <events>] [--out <file>]
+ */
+
+const { execSync } = require('child_process');
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+const { PowermonBridgeClient } = require('../lib/bridge-client');
+
+// Any valid access URL works: the fake backend derives the device from it
+const FAKE_URL = 'https://applinks.thornwave.com/?n=DCL-Bench&s=a3a5b30ea9b3ff98&h=41' +
+  '&c=c1HOvvGTYe4HcxZ1AWUUVg%3D%3D&k=qN19gp1NyTIjTcKXIFUagek74WSxnF9446mW1lX0Ca4%3D';
+
+// Zero device latency so the numbers are the bridge's own overhead
+const DEFAULT_FAKE = 'dist=fixed,rtt=0,jitter=0,connect=0,log_hours=24,file_hours=24';
+
+const READ_SIZES = [4096, 65536, 524288];
+
+// Relative weights for the mixed phase, roughly a polling cycle with backfill
+const MIX = [
+  { name: 'monitor', weight: 60 },
+  { name: 'statistics', weight: 20 },
+  { name: 'readlog', size: 4096, weight: 12 },
+  { name: 'readlog', size: 65536, weight: 6 },
+  { name: 'readlog', size: 524288, weight: 2 },
+];
+
+function parseArgs(argv) {
+  const args = {
+    bridge: path.join(__dirname, '..', 'powermon-bridge'),
+    fake: DEFAULT_FAKE,
+    timeMs: 3000,
+    filter: null,
+    streamEvents: 2000,
+    out: null,
+  };
+  for (let i = 0; i < argv.length; i++) {
+    if (argv[i] === '--bridge') args.bridge = path.resolve(argv[++i]);
+    else if (argv[i] === '--fake') args.fake = argv[++i];
+    else if (argv[i] === '--time') args.timeMs = parseInt(argv[++i], 10);
+    else if (argv[i] === '--filter') args.filter = argv[++i];
+    else if (argv[i] === '--stream') args.streamEvents = parseInt(argv[++i], 10);
+    else if (argv[i] === '--out') args.out = argv[++i];
+  }
+  return args;
+}
+
+function percentile(sorted, p) {
+  if (sorted.length === 0) {
+    return null;
+  }
+  const rank = Math.ceil(p / 100 * sorted.length) - 1;
+  return sorted[Math.min(sorted.length - 1, Math.max(0, rank))];
+}
+
+function clockTicks() {
+  try {
+    return parseInt(execSync('getconf CLK_TCK', { encoding: 'utf8' }), 10) || 100;
+  } catch (err) {
+    return 100;
+  }
+}
+
+const CLK_TCK = clockTicks();
+
+/**
+ * Bridge process CPU time in microseconds (utime + stime), null off Linux
+ */
+function bridgeCpuUs(pid) {
+  try {
+    const stat = fs.readFileSync(`/proc/${pid}/stat`, 'utf8');
+    // Fields after the parenthesized command name; utime and stime are 14 and 15
+    const fields = stat.slice(stat.lastIndexOf(')') + 2).split(' ');
+    return (parseInt(fields[11], 10) + parseInt(fields[12], 10)) * 1e6 / CLK_TCK;
+  } catch (err) {
+    return null;
+  }
+}
+
+/**
+ * Counts bytes written to and read from the bridge's pipes
+ */
+function instrumentPipes(client) {
+  const counters = { out: 0, in: 0 };
+  const stdin = client.process.stdin;
+  const write = stdin.write.bind(stdin);
+  stdin.write = (chunk, ...rest) => {
+    counters.out += Buffer.byteLength(chunk);
+    return write(chunk, ...rest);
+  };
+  client.process.stdout.on('data', (chunk) => {
+    counters.in += chunk.length;
+  });
+  return counters;
+}
+
+/**
+ * Snapshot of everything a phase reports as a delta
+ */
+function snapshot(client, pipes) {
+  return {
+    ns: process.hrtime.bigint(),
+    clientCpu: process.cpuUsage(),
+    bridgeCpu: bridgeCpuUs(client.process.pid),
+    out: pipes.out,
+    in: pipes.in,
+  };
+}
+
+function summarize(name, params, before, after, latenciesNs, commands) {
+  const elapsed = Number(after.ns - before.ns);
+  const clientUs = (after.clientCpu.user - before.clientCpu.user) +
+    (after.clientCpu.system - before.clientCpu.system);
+  const bridgeUs = before.bridgeCpu === null || after.bridgeCpu === null
+    ? null : after.bridgeCpu - before.bridgeCpu;
+  const sorted = latenciesNs.slice().sort((a, b) => a - b);
+  const mean = sorted.reduce((sum, v) => sum + v, 0) / (sorted.length || 1);
+
+  return {
+    name,
+    params,
+    commands,
+    commandsPerSec: commands * 1e9 / elapsed,
+    p50Ms: sorted.length ? percentile(sorted, 50) / 1e6 : null,
+    p99Ms: sorted.length ? percentile(sorted, 99) / 1e6 : null,
+    meanMs: sorted.length ? mean / 1e6 : null,
+    bytesToBridgePerCmd: (after.out - before.out) / commands,
+    bytesFromBridgePerCmd: (after.in - before.in) / commands,
+    clientCpuUsPerCmd: clientUs / commands,
+    bridgeCpuUsPerCmd: bridgeUs === null ? null : bridgeUs / commands,
+  };
+}
+
+function issue(client, file, command) {
+  switch (command.name) {
+    case 'monitor': return client.getMonitorData();
+    case 'statistics': return client.getStatistics();
+    case 'fgstatistics': return client.getFuelgaugeStatistics();
+    case 'info': return client.getInfo();
+    case 'readlog': return client.readLogFile(file.id, 0, Math.min(command.size, file.size));
+    default: throw new Error(`Unknown bench command ${command.name}`);
+  }
+}
+
+/**
+ * Runs commands from next() back to back for timeMs
+ */
+async function runPhase(client, pipes, file, name, params, next, timeMs) {
+  // Warm up (first readlog also primes the fake's window cache)
+  for (let i = 0; i < 5; i++) {
+    await issue(client, file, next());
+  }
+
+  const latencies = [];
+  const before = snapshot(client, pipes);
+  const deadline = before.ns + BigInt(timeMs) * 1000000n;
+  let now = before.ns;
+  while (now < deadline) {
+    const start = now;
+    const result = await issue(client, file, next());
+    if (!result.success) {
+      throw new Error(`${name} failed with code ${result.code}`);
+    }
+    now = process.hrtime.bigint();
+    latencies.push(Number(now - start));
+  }
+  return summarize(name, params, before, snapshot(client, pipes), latencies, latencies.length);
+}
+
+/**
+ * Streams monitor events with no interval; latency is the gap between events
+ */
+async function runStream(client, pipes, events) {
+  const gaps = [];
+  let last = null;
+  const onMonitor = () => {
+    const now = process.hrtime.bigint();
+    if (last !== null) {
+      gaps.push(Number(now - last));
+    }
+    last = now;
+  };
+
+  client.on('monitor', onMonitor);
+  const before = snapshot(client, pipes);
+  await client._sendCommandAsync(`stream 0 ${events}`);
+  const after = snapshot(client, pipes);
+  client.removeListener('monitor', onMonitor);
+
+  return summarize('stream', { events }, before, after, gaps, events);
+}
+
+async function connect(client) {
+  const connected = new Promise((resolve, reject) => {
+    client.once('connected', resolve);
+    client.once('disconnected', (reason) => reject(new Error(`Fake device disconnected (${reason})`)));
+  });
+  const result = await client.connect(FAKE_URL);
+  if (!result.success) {
+    throw new Error('Bridge rejected the connect command');
+  }
+  await connected;
+
+  const files = await client.getLogFiles();
+  if (!files.success || files.data.length === 0) {
+    throw new Error('Fake device has no log files');
+  }
+  // Largest file
+  return files.data.reduce((a, b) => (b.size > a.size ? b : a));
+}
+
+function printTable(results) {
+  const fmt = (v, digits) => (v === null ? '-' : v.toFixed(digits));
+  const rows = results.map((r) => [
+    r.name + (r.params ? ' ' + Object.entries(r.params).filter(([k]) => k !== 'weights').map(([k, v]) => `${k}=${v}`).join(',') : ''),
+    fmt(r.commandsPerSec, 0),
+    fmt(r.p50Ms, 3),
+    fmt(r.p99Ms, 3),
+    fmt(r.bytesToBridgePerCmd, 0),
+    fmt(r.bytesFromBridgePerCmd, 0),
+    fmt(r.clientCpuUsPerCmd, 1),
+    fmt(r.bridgeCpuUsPerCmd, 1),
+  ]);
+  const header = ['phase', 'cmd/s', 'p50 ms', 'p99 ms', 'B out', 'B in', 'client us', 'bridge us'];
+  const widths = header.map((h, i) => Math.max(h.length, ...rows.map((row) => row[i].length)));
+  const line = (cols) => cols.map((c, i) => (i === 0 ? c.padEnd(widths[i]) : c.padStart(widths[i]))).join('  ');
+  process.stderr.write(line(header) + '\n');
+  for (const row of rows) {
+    process.stderr.write(line(row) + '\n');
+  }
+}
+
+async function main() {
+  const args = parseArgs(process.argv.slice(2));
+
+  if (!fs.existsSync(args.bridge)) {
+    console.error(`Bridge not found at ${args.bridge}; run make first`);
+    process.exit(1);
+  }
+
+  // Inherited by the spawned bridge
+  process.env.POWERMON_BACKEND = 'fake';
+  process.env.POWERMON_FAKE = args.fake;
+
+  const client = new PowermonBridgeClient({ bridgePath: args.bridge });
+  client.on('stderr', (text) => process.stderr.write(`[bridge] ${text}`));
+  await client.start();
+  const pipes = instrumentPipes(client);
+
+  const wanted = (name) => !args.filter || name.includes(args.filter);
+  const results = [];
+
+  try {
+    const file = await connect(client);
+
+    for (const name of ['monitor', 'statistics']) {
+      if (wanted(name)) {
+        results.push(await runPhase(client, pipes, file, name, null, () => ({ name }), args.timeMs));
+      }
+    }
+
+    if (wanted('readlog')) {
+      for (const size of READ_SIZES) {
+        const command = { name: 'readlog', size };
+        results.push(await runPhase(client, pipes, file, 'readlog',
+          { size: Math.min(size, file.size) }, () => command, args.timeMs));
+      }
+    }
+
+    if (wanted('mix')) {
+      // Deterministic weighted sequence (LCG) so runs are comparable
+      const total = MIX.reduce((sum, c) => sum + c.weight, 0);
+      let state = 1;
+      const next = () => {
+        state = (state * 1103515245 + 12345) % 2147483648;
+        let pick = state % total;
+        for (const command of MIX) {
+          if (pick < command.weight) return command;
+          pick -= command.weight;
+        }
+        return MIX[0];
+      };
+      const weights = MIX.map((c) => `${c.name}${c.size ? c.size : ''}:${c.weight}`).join(' ');
+      results.push(await runPhase(client, pipes, file, 'mix', { weights }, next, args.timeMs));
+    }
+
+    if (wanted('stream')) {
+      results.push(await runStream(client, pipes, args.streamEvents));
+    }
+
+    await client.disconnect();
+  } finally {
+    client.stop();
+  }
+
+  const report = {
+    timestamp: new Date().toISOString(),
+    node: process.version,
+    platform: `${os.platform()}-${os.arch()}`,
+    cpu: os.cpus()[0] ? os.cpus()[0].model : 'unknown',
+    bridge: args.bridge,
+    fake: args.fake,
+    results,
+  };
+
+  printTable(results);
+  const json = JSON.stringify(report, null, 2);
+  if (args.out) {
+    fs.writeFileSync(args.out, json + '\n');
+  }
+  process.stdout.write(json + '\n');
+  process.exit(0);
+}
+
+main().catch((err) => {
+  console.error(err);
+  process.exit(1);
+});
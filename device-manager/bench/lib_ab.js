@@ -0,0 +1,160 @@
+#!/usr/bin/env node
+/**
+ * Vendor Library A/B Benchmark
+ *
+ * Runs the same workloads (bench/lib_ab_bench.cpp) linked against
+ * libpowermon_bin and libpowermon_bin_old and reports the per-workload delta:
+ * instance create/destroy, access URL parsing and formatting, password
+ * hashing, log decoding, and request throughput against the fake backend (and
+ * a replay trace with --trace).
+ *
+ * The two binaries run alternately for --rounds rounds, swapping which goes
+ * first, and each workload's median ns/op is compared. fake_requests and
+ * replay_requests contain no library code, so their delta is the noise floor
+ * for the rest.
+ *
+ * Results go to stdout as JSON; a summary table goes to stderr.
+ *
+ * Usage: npm run bench:lib -- [--new <binary>] [--old <binary>] [--rounds <n>]
+ *          [--time <s per workload>] [--filter <substring>] [--trace <file.pmtrace>]
+ *          [--out <file>]
+ */
+
+const { execFileSync } = require('child_process');
+const fs = require('fs');
+const path = require('path');
+
+function parseArgs(argv) {
+  const args = {
+    newBin: path.join(__dirname, '..', 'powermon-abbench-new'),
+    oldBin: path.join(__dirname, '..', 'powermon-abbench-old'),
+    rounds: 5,
+    time: 1,
+    filter: null,
+    trace: null,
+    out: null,
+  };
+  for (let i = 0; i < argv.length; i++) {
+    if (argv[i] === '--new') args.newBin = path.resolve(argv[++i]);
+    else if (argv[i] === '--old') args.oldBin = path.resolve(argv[++i]);
+    else if (argv[i] === '--rounds') args.rounds = parseInt(argv[++i], 10);
+    else if (argv[i] === '--time') args.time = parseFloat(argv[++i]);
+    else if (argv[i] === '--filter') args.filter = argv[++i];
+    else if (argv[i] === '--trace') args.trace = path.resolve(argv[++i]);
+    else if (argv[i] === '--out') args.out = argv[++i];
+  }
+  return args;
+}
+
+function median(values) {
+  if (values.length === 0) return null;
+  const sorted = [...values].sort((a, b) => a - b);
+  const mid = sorted.length >> 1;
+  return sorted.length % 2 ? sorted[mid] : (sorted[mid - 1] + sorted[mid]) / 2;
+}
+
+/**
+ * Runs one binary once and returns its JSON lines
+ * @param {string} binary
+ * @param {string} label
+ * @param {Object} args
+ * @returns {Object[]}
+ */
+function runOnce(binary, label, args) {
+  const argv = ['--label', label, '--time', String(args.time)];
+  if (args.filter) argv.push('--filter', args.filter);
+  if (args.trace) argv.push('--trace', args.trace);
+
+  const output = execFileSync(binary, argv, { encoding: 'utf8', stdio: ['ignore', 'pipe', 'inherit'] });
+  return output.split('\n').filter((line) => line.trim()).map((line) => JSON.parse(line));
+}
+
+function main() {
+  const args = parseArgs(process.argv.slice(2));
+  for (const binary of [args.newBin, args.oldBin]) {
+    if (!fs.existsSync(binary)) {
+      console.error(`Benchmark binary not found: ${binary} (build with: make abbench)`);
+      process.exit(1);
+    }
+  }
+
+  // samples[workload][label] = { nsPerOp: [], nsPerItem: [], failures, error, libVersion }
+  const samples = {};
+  const order = [];
+  const sides = [['new', args.newBin], ['old', args.oldBin]];
+
+  for (let round = 0; round < args.rounds; round++) {
+    const roundSides = round % 2 ? [...sides].reverse() : sides;
+    for (const [label, binary] of roundSides) {
+      process.stderr.write(`round ${round + 1}/${args.rounds}: ${label}\n`);
+      for (const result of runOnce(binary, label, args)) {
+        if (!samples[result.workload]) {
+          samples[result.workload] = {};
+          order.push(result.workload);
+        }
+        const entry = samples[result.workload][label] ||
+          (samples[result.workload][label] = { nsPerOp: [], nsPerItem: [], failures: 0, error: null, libVersion: result.libVersion });
+        entry.failures += result.failures;
+        if (result.error) {
+          entry.error = result.error;
+        } else if (result.ops > 0) {
+          entry.nsPerOp.push(result.nsPerOp);
+          if (result.nsPerItem !== undefined) entry.nsPerItem.push(result.nsPerItem);
+        }
+      }
+    }
+  }
+
+  const workloads = order.map((workload) => {
+    const summarize = (entry) => entry && {
+      libVersion: entry.libVersion,
+      nsPerOp: median(entry.nsPerOp),
+      nsPerItem: median(entry.nsPerItem),
+      failures: entry.failures,
+      error: entry.error,
+    };
+    const newSide = summarize(samples[workload].new);
+    const oldSide = summarize(samples[workload].old);
+    const delta = newSide && oldSide && newSide.nsPerOp && oldSide.nsPerOp
+      ? (newSide.nsPerOp - oldSide.nsPerOp) / oldSide.nsPerOp * 100
+      : null;
+    return { workload, new: newSide, old: oldSide, deltaPct: delta };
+  });
+
+  const report = {
+    date: new Date().toISOString(),
+    rounds: args.rounds,
+    timePerWorkloadS: args.time,
+    trace: args.trace,
+    workloads,
+  };
+
+  const fmt = (side) => {
+    if (!side) return 'n/a';
+    if (side.error) return 'error';
+    return side.nsPerOp === null ? '-' : side.nsPerOp.toFixed(1);
+  };
+  process.stderr.write('\n' + [
+    'workload'.padEnd(26), 'new ns/op'.padStart(14), 'old ns/op'.padStart(14), 'delta'.padStart(9),
+  ].join('') + '\n');
+  for (const w of workloads) {
+    const delta = w.deltaPct === null ? '' : `${w.deltaPct > 0 ? '+' : ''}${w.deltaPct.toFixed(1)}%`;
+    process.stderr.write([
+      w.workload.padEnd(26), fmt(w.new).padStart(14), fmt(w.old).padStart(14), delta.padStart(9),
+    ].join('') + '\n');
+  }
+  for (const w of workloads) {
+    for (const label of ['new', 'old']) {
+      if (w[label] && w[label].error) {
+        process.stderr.write(`${w.workload} (${label}): ${w[label].error}\n`);
+      }
+    }
+  }
+  process.stderr.write('delta is new vs old; negative is faster. *_requests rows run no library code.\n');
+
+  const json = JSON.stringify(report, null, 2);
+  if (args.out) fs.writeFileSync(args.out, json + '\n');
+  process.stdout.write(json + '\n');
+}
+
+main();
@@ -0,0 +1,359 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include <powermon.h>
+#include <powermon_log.h>
+
+#include "fake_powermon.h"
+#include "log_format.h"
+#include "replay_powermon.h"
+#include "signal_model.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// One side of the vendor library A/B benchmark (bench/lib_ab.js). The Makefile
+// builds this file twice, against libpowermon_bin and libpowermon_bin_old, so
+// both binaries run the same workloads and only the library differs. Prints
+// one JSON line per workload.
+//
+// fake_requests and replay_requests run our own backends and no library code;
+// their deltas show how much of a difference is run-to-run noise.
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const char* URL = "https://applinks.thornwave.com/?n=DCL-Bench&s=a3a5b30ea9b3ff98&h=41"
+                  "&c=c1HOvvGTYe4HcxZ1AWUUVg%3D%3D&k=qN19gp1NyTIjTcKXIFUagek74WSxnF9446mW1lX0Ca4%3D";
+
+struct Options {
+    std::string label = "lib";
+    double seconds = 1.0;
+    std::string filter;
+    std::string trace;
+    uint32_t window = 64;
+};
+
+struct Result {
+    uint64_t ops = 0;
+    uint64_t failures = 0;
+    double ns = 0;
+    double items = 0;           // samples decoded, where that is the unit of work
+    std::string error;          // what() of an exception that ended the workload
+};
+
+void usage(const char* argv0) {
+    fprintf(stderr,
+        "Usage: %s [options]\n"
+        "  -l, --label <name>      label for the output (default lib)\n"
+        "  -t, --time <s>          seconds per workload (default 1)\n"
+        "  -f, --filter <text>     only workloads whose name contains text\n"
+        "  -r, --trace <file>      trace for replay_requests (skipped without)\n"
+        "  -w, --window <n>        requests in flight (default 64)\n",
+        argv0);
+}
+
+bool parse_args(int argc, char** argv, Options& options) {
+    static const struct option long_options[] = {
+        { "label", required_argument, nullptr, 'l' },
+        { "time", required_argument, nullptr, 't' },
+        { "filter", required_argument, nullptr, 'f' },
+        { "trace", required_argument, nullptr, 'r' },
+        { "window", required_argument, nullptr, 'w' },
+        { "help", no_argument, nullptr, 'h' },
+        { nullptr, 0, nullptr, 0 }
+    };
+
+    int c;
+    while ((c = getopt_long(argc, argv, "l:t:f:r:w:h", long_options, nullptr)) != -1) {
+        switch (c) {
+            case 'l': options.label = optarg; break;
+            case 't': options.seconds = atof(optarg); break;
+            case 'f': options.filter = optarg; break;
+            case 'r': options.trace = optarg; break;
+            case 'w': options.window = static_cast<uint32_t>(strtoul(optarg, nullptr, 10)); break;
+            default: return false;
+        }
+    }
+    return options.seconds > 0 && options.window > 0;
+}
+
+// Runs fn in growing batches until the time budget is spent; fn returns false on failure
+Result Loop(double seconds, const std::function<bool()>& fn) {
+    Result result;
+    uint64_t batch = 1;
+    auto start = Clock::now();
+    auto deadline = start + std::chrono::duration<double>(seconds);
+    for (;;) {
+        for (uint64_t i = 0; i < batch; i++) {
+            if (!fn()) {
+                result.failures++;
+            }
+        }
+        result.ops += batch;
+        auto now = Clock::now();
+        if (now >= deadline) {
+            result.ns = std::chrono::duration<double, std::nano>(now - start).count();
+            return result;
+        }
+        if (batch < (1u << 16)) {
+            batch *= 2;
+        }
+    }
+}
+
+std::vector<char> MakeLogFile(uint8_t mode, uint32_t hours, bool with_v2) {
+    const uint32_t period = LogFormat::SamplePeriod(mode);
+    const uint32_t count = hours * 3600 / period;
+    const uint32_t start = 1700000000 - 1700000000 % period;
+
+    std::vector<PowermonLogFile::Sample> samples(count);
+    for (uint32_t i = 0; i < count; i++) {
+        SignalModel::Generate(SignalModel::PROFILE_TRUCK, 1, start + i * period, with_v2, samples[i]);
+    }
+
+    LogFormat::Header header;
+    memset(&header, 0, sizeof(header));
+    header.version = PowermonLogFile::VER_POWERMON_WIFI_5W;
+    header.mode = mode;
+    header.time = start;
+    header.mask = with_v2 ? LogFormat::MASK_V2 : 0;
+
+    std::vector<uint8_t> file;
+    LogFormat::Encode(header, samples.data(), samples.size(), file);
+    return std::vector<char>(file.begin(), file.end());
+}
+
+Result Decode(double seconds, uint8_t mode, uint32_t hours, bool with_v2) {
+    const std::vector<char> file = MakeLogFile(mode, hours, with_v2);
+    const uint32_t expected = hours * 3600 / LogFormat::SamplePeriod(mode);
+    std::vector<PowermonLogFile::Sample> samples;
+
+    Result result = Loop(seconds, [&]() {
+        samples.clear();
+        PowermonLogFile::decode(file, samples);
+        return samples.size() == expected;
+    });
+    result.items = static_cast<double>(result.ops) * expected;
+    return result;
+}
+
+// Keeps window requests in flight against powermon until the time budget is
+// spent; each completion issues the next request from the callback thread
+Result Requests(double seconds, uint32_t window, Powermon* powermon) {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool connected = false;
+    bool failed = false;
+
+    powermon->setOnConnectCallback([&]() {
+        std::lock_guard<std::mutex> lock(mutex);
+        connected = true;
+        cv.notify_all();
+    });
+    powermon->setOnDisconnectCallback([&](Powermon::DisconnectReason) {
+        std::lock_guard<std::mutex> lock(mutex);
+        failed = true;
+        cv.notify_all();
+    });
+
+    Powermon::DeviceIdentifier id;
+    id.fromURL(URL);
+    powermon->connectWifi(id.access_key);
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!cv.wait_for(lock, std::chrono::seconds(10), [&]() { return connected || failed; }) || !connected) {
+            Result result;
+            result.failures = 1;
+            return result;
+        }
+    }
+
+    std::atomic<uint64_t> ops(0);
+    std::atomic<uint64_t> failures(0);
+    uint32_t active = window;
+    const auto start = Clock::now();
+    const auto deadline = start + std::chrono::duration<double>(seconds);
+
+    std::function<void()> issue = [&]() {
+        powermon->requestGetMonitorData([&](Powermon::ResponseCode rsp, const Powermon::MonitorData&) {
+            ops++;
+            if (rsp != Powermon::RSP_SUCCESS) {
+                failures++;
+            }
+            if (Clock::now() < deadline) {
+                issue();
+                return;
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--active == 0) {
+                cv.notify_all();
+            }
+        });
+    };
+    for (uint32_t i = 0; i < window; i++) {
+        issue();
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&]() { return active == 0; });
+    }
+
+    Result result;
+    result.ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    result.ops = ops;
+    result.failures = failures;
+    return result;
+}
+
+Result FakeRequests(const Options& options) {
+    FakePowermon::Config config;
+    std::string error;
+    FakePowermon::Config::Parse("dist=fixed,rtt=0,jitter=0,connect=0", config, &error);
+    std::unique_ptr<Powermon> powermon(new FakePowermon(config));
+    return Requests(options.seconds, options.window, powermon.get());
+}
+
+Result ReplayRequests(const Options& options) {
+    std::string error;
+    std::shared_ptr<const ReplayPowermon::Trace> trace = ReplayPowermon::Trace::Load(options.trace, &error);
+    if (!trace) {
+        fprintf(stderr, "%s\n", error.c_str());
+        Result result;
+        result.failures = 1;
+        return result;
+    }
+    ReplayPowermon::Config config;
+    config.trace = options.trace;
+    config.scale = 0;
+    std::unique_ptr<Powermon> powermon(new ReplayPowermon(trace, config));
+    return Requests(options.seconds, options.window, powermon.get());
+}
+
+void Report(const Options& options, const char* workload, const Result& result) {
+    printf("{\"lib\":\"%s\",\"libVersion\":%u,\"workload\":\"%s\",\"ops\":%llu,\"failures\":%llu,"
+           "\"ns\":%.0f,\"nsPerOp\":%.3f",
+           options.label.c_str(), Powermon::getVersion(), workload,
+           static_cast<unsigned long long>(result.ops), static_cast<unsigned long long>(result.failures),
+           result.ns, result.ops ? result.ns / result.ops : 0.0);
+    if (result.items > 0) {
+        printf(",\"nsPerItem\":%.3f", result.ns / result.items);
+    }
+    if (!result.error.empty()) {
+        std::string error;
+        for (char c : result.error) {
+            if (c == '"' || c == '\\') error += '\\';
+            error += (c >= 0x20) ? c : ' ';
+        }
+        printf(",\"error\":\"%s\"", error.c_str());
+    }
+    printf("}\n");
+    fflush(stdout);
+}
+
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parse_args(argc, argv, options)) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    struct Workload {
+        const char* name;
+        std::function<Result()> run;
+    };
+
+    const double seconds = options.seconds;
+    std::vector<Workload> workloads = {
+        { "create_destroy", [&]() {
+            return Loop(seconds, []() {
+                Powermon* powermon = Powermon::createInstance();
+                delete powermon;
+                return powermon != nullptr;
+            });
+        } },
+#ifndef POWERMON_NO_INIT_BLE
+        // v1.16 brought BLE up inside createInstance(); this is the equivalent here
+        { "create_init_ble_destroy", [&]() {
+            return Loop(seconds, []() {
+                Powermon* powermon = Powermon::createInstance();
+                if (powermon) powermon->initBle();
+                delete powermon;
+                return powermon != nullptr;
+            });
+        } },
+#endif
+        { "url_parse", [&]() {
+            return Loop(seconds, []() {
+                Powermon::DeviceIdentifier id;
+                return id.fromURL(URL);
+            });
+        } },
+        { "url_format", [&]() {
+            Powermon::DeviceIdentifier id;
+            id.fromURL(URL);
+            return Loop(seconds, [&id]() {
+                return !id.toURL().empty();
+            });
+        } },
+        { "auth_key_from_password", [&]() {
+            return Loop(seconds, []() {
+                Powermon::AuthKey key = Powermon::getAuthKeyFromPassword("bench-password");
+                return key.data[0] != 0 || key.data[1] != 0;
+            });
+        } },
+        { "hardware_strings", [&]() {
+            return Loop(seconds, []() {
+                return !Powermon::getHardwareString(0x41).empty() &&
+                       !Powermon::getPowerStatusString(Powermon::PS_ON).empty();
+            });
+        } },
+        { "decode_1s_24h", [&]() {
+            return Decode(seconds, PowermonConfig::LOG_MODE_1_SEC, 24, false);
+        } },
+        { "decode_10s_24h_v2", [&]() {
+            return Decode(seconds, PowermonConfig::LOG_MODE_10_SEC, 24, true);
+        } },
+        { "decode_60s_7d", [&]() {
+            return Decode(seconds, PowermonConfig::LOG_MODE_60_SEC, 7 * 24, false);
+        } },
+        { "fake_requests", [&]() {
+            return FakeRequests(options);
+        } },
+        { "replay_requests", [&]() {
+            return ReplayRequests(options);
+        } },
+    };
+
+    for (const Workload& workload : workloads) {
+        if (!options.filter.empty() && strstr(workload.name, options.filter.c_str()) == nullptr) {
+            continue;
+        }
+        if (strcmp(workload.name, "replay_requests") == 0 && options.trace.empty()) {
+            continue;
+        }
+        // v1.16 createInstance() throws without a Bluetooth adapter
+        Result result;
+        try {
+            result = workload.run();
+        } catch (const std::exception& e) {
+            result.failures++;
+            result.error = e.what();
+        }
+        Report(options, workload.name, result);
+    }
+    return EXIT_SUCCESS;
+}
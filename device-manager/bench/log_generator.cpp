@@ -0,0 +1,292 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+#include <math.h>
+
+#include <powermon.h>
+#include <powermon_log.h>
+
+#include "log_format.h"
+#include "signal_model.h"
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Writes synthetic PowerMon log files (one per mode and profile) and checks
+// that each decodes back through PowermonLogFile::decode() to the quantized
+// input. Prints one JSON line per file.
+
+struct Options {
+    std::vector<uint8_t> modes;
+    std::vector<SignalModel::Profile> profiles;
+    double hours = 24;
+    uint32_t samples = 0;
+    uint32_t mask = 0;
+    bool v2 = false;
+    uint64_t seed = 1;
+    uint32_t start = 0;
+    std::string out_dir = ".";
+    bool verify = true;
+};
+
+struct Errors {
+    double voltage1 = 0;
+    double voltage2 = 0;
+    double current = 0;
+    double power = 0;
+    double temperature = 0;
+    uint32_t mismatches = 0;
+};
+
+static void usage(const char* argv0) {
+    fprintf(stderr,
+        "Usage: %s [options]\n"
+        "  -m, --mode <1-7|all>        log mode (default all)\n"
+        "  -d, --hours <h>             duration per file (default 24)\n"
+        "  -n, --samples <n>           sample count per file, overrides --hours\n"
+        "  -p, --profile <name|all>    daily, truck, solar or edge (default daily)\n"
+        "  -k, --mask <hex>            header channel mask (default 0)\n"
+        "      --v2                    add the V2 channel to the mask\n"
+        "  -s, --seed <n>              signal seed / device serial (default 1)\n"
+        "  -t, --start <unix time>     first sample time (default now minus the duration)\n"
+        "  -o, --out <dir>             output directory (default .)\n"
+        "      --no-verify             skip the decode round trip\n",
+        argv0);
+}
+
+static bool parse_args(int argc, char** argv, Options& options) {
+    static const struct option long_options[] = {
+        { "mode", required_argument, nullptr, 'm' },
+        { "hours", required_argument, nullptr, 'd' },
+        { "samples", required_argument, nullptr, 'n' },
+        { "profile", required_argument, nullptr, 'p' },
+        { "mask", required_argument, nullptr, 'k' },
+        { "v2", no_argument, nullptr, 'V' },
+        { "seed", required_argument, nullptr, 's' },
+        { "start", required_argument, nullptr, 't' },
+        { "out", required_argument, nullptr, 'o' },
+        { "no-verify", no_argument, nullptr, 'N' },
+        { "help", no_argument, nullptr, 'h' },
+        { nullptr, 0, nullptr, 0 }
+    };
+
+    int c;
+    while ((c = getopt_long(argc, argv, "m:d:n:p:k:s:t:o:h", long_options, nullptr)) != -1) {
+        switch (c) {
+            case 'm':
+                if (strcmp(optarg, "all") == 0) {
+                    options.modes.clear();
+                    for (uint8_t mode = PowermonConfig::LOG_MODE_1_SEC; mode <= PowermonConfig::LOG_MODE_60_SEC; mode++) {
+                        options.modes.push_back(mode);
+                    }
+                } else {
+                    uint8_t mode = static_cast<uint8_t>(atoi(optarg));
+                    if (LogFormat::SamplePeriod(mode) == 0) {
+                        fprintf(stderr, "Invalid log mode: %s\n", optarg);
+                        return false;
+                    }
+                    options.modes.push_back(mode);
+                }
+                break;
+            case 'd':
+                options.hours = atof(optarg);
+                break;
+            case 'n':
+                options.samples = static_cast<uint32_t>(strtoul(optarg, nullptr, 10));
+                break;
+            case 'p':
+                if (strcmp(optarg, "all") == 0) {
+                    options.profiles = { SignalModel::PROFILE_DAILY, SignalModel::PROFILE_TRUCK,
+                                         SignalModel::PROFILE_SOLAR, SignalModel::PROFILE_EDGE };
+                } else {
+                    SignalModel::Profile profile;
+                    if (!SignalModel::ParseProfile(optarg, profile)) {
+                        fprintf(stderr, "Invalid profile: %s\n", optarg);
+                        return false;
+                    }
+                    options.profiles.push_back(profile);
+                }
+                break;
+            case 'k':
+                options.mask = static_cast<uint32_t>(strtoul(optarg, nullptr, 16));
+                break;
+            case 'V':
+                options.v2 = true;
+                break;
+            case 's':
+                options.seed = strtoull(optarg, nullptr, 0);
+                break;
+            case 't':
+                options.start = static_cast<uint32_t>(strtoul(optarg, nullptr, 10));
+                break;
+            case 'o':
+                options.out_dir = optarg;
+                break;
+            case 'N':
+                options.verify = false;
+                break;
+            default:
+                return false;
+        }
+    }
+
+    if (options.modes.empty()) {
+        for (uint8_t mode = PowermonConfig::LOG_MODE_1_SEC; mode <= PowermonConfig::LOG_MODE_60_SEC; mode++) {
+            options.modes.push_back(mode);
+        }
+    }
+    if (options.v2) {
+        options.mask |= LogFormat::MASK_V2;
+    }
+    if (options.profiles.empty()) {
+        options.profiles.push_back(SignalModel::PROFILE_DAILY);
+    }
+    return true;
+}
+
+// Value the encoder stores for an input, mirroring LogFormat's quantization
+static double quantized(float value, double scale, double min, double max) {
+    double scaled = round(static_cast<double>(value) * scale);
+    if (!(scaled >= min)) {
+        scaled = min;
+    } else if (scaled > max) {
+        scaled = max;
+    }
+    return scaled / scale;
+}
+
+static void check(double decoded, double expected, double tolerance, double& max_error, uint32_t& mismatches) {
+    double error = fabs(decoded - expected);
+    max_error = std::max(max_error, error);
+    if (!(error <= tolerance)) {
+        mismatches++;
+    }
+}
+
+static Errors verify(const LogFormat::Header& header, const std::vector<PowermonLogFile::Sample>& input,
+                     const std::vector<PowermonLogFile::Sample>& decoded) {
+    const double v_max = (1 << LogFormat::V_BITS) - 1;
+    const double i_min = -LogFormat::I_LIMIT;
+    const double i_max = LogFormat::I_LIMIT - 1;
+    const double t_min = -(1 << (LogFormat::T_BITS - 1));
+    const double t_max = (1 << (LogFormat::T_BITS - 1)) - 1;
+    const uint32_t period = LogFormat::SamplePeriod(header.mode);
+
+    Errors errors;
+    if (decoded.size() != input.size()) {
+        errors.mismatches = static_cast<uint32_t>(std::max(decoded.size(), input.size()));
+        return errors;
+    }
+
+    for (size_t i = 0; i < input.size(); i++) {
+        const PowermonLogFile::Sample& in = input[i];
+        const PowermonLogFile::Sample& out = decoded[i];
+
+        double v1 = quantized(in.voltage1, 1000.0, 0, v_max);
+        double current = quantized(in.current, 1000.0, i_min, i_max);
+        double temperature = quantized(in.temperature, 4.0, t_min, t_max);
+
+        check(out.voltage1, v1, 1e-4, errors.voltage1, errors.mismatches);
+        // Without MASK_V2 the decoder reports V2 as NaN
+        if (header.mask & LogFormat::MASK_V2) {
+            check(out.voltage2, quantized(in.voltage2, 1000.0, 0, v_max), 1e-4, errors.voltage2, errors.mismatches);
+        } else if (!isnan(out.voltage2)) {
+            errors.mismatches++;
+        }
+        check(out.current, current, 1e-4, errors.current, errors.mismatches);
+        check(out.temperature, temperature, 1e-4, errors.temperature, errors.mismatches);
+        // The decoder derives power from the decoded V1 and I
+        check(out.power, v1 * current, 1e-3 + 1e-5 * fabs(v1 * current), errors.power, errors.mismatches);
+
+        if (out.time != header.time + i * period ||
+            out.soc != std::min<uint32_t>(in.soc, (1 << LogFormat::SOC_BITS) - 1) ||
+            out.ps != (in.ps & ((1 << LogFormat::PS_BITS) - 1))) {
+            errors.mismatches++;
+        }
+    }
+    return errors;
+}
+
+static bool generate(const Options& options, uint8_t mode, SignalModel::Profile profile) {
+    const uint32_t period = LogFormat::SamplePeriod(mode);
+    const uint32_t count = options.samples
+        ? options.samples
+        : static_cast<uint32_t>(options.hours * 3600.0 / period);
+    uint32_t start = options.start;
+    if (start == 0) {
+        start = static_cast<uint32_t>(time(nullptr)) - count * period;
+        start -= start % period;
+    }
+
+    std::vector<PowermonLogFile::Sample> samples(count);
+    for (uint32_t i = 0; i < count; i++) {
+        SignalModel::Generate(profile, options.seed, start + i * period,
+                              (options.mask & LogFormat::MASK_V2) != 0, samples[i]);
+    }
+
+    LogFormat::Header header;
+    memset(&header, 0, sizeof(header));
+    header.version = PowermonLogFile::VER_POWERMON_WIFI_5W;
+    header.mode = mode;
+    header.time = start;
+    header.mask = options.mask;
+
+    std::vector<uint8_t> file;
+    LogFormat::Encode(header, samples.data(), samples.size(), file);
+
+    char name[64];
+    snprintf(name, sizeof(name), "mode%u-%us-%s%s.bin", mode, period, SignalModel::ProfileName(profile),
+             (options.mask & LogFormat::MASK_V2) ? "-v2" : "");
+    std::string path = options.out_dir + "/" + name;
+
+    FILE* f = fopen(path.c_str(), "wb");
+    if (f == nullptr || fwrite(file.data(), 1, file.size(), f) != file.size()) {
+        fprintf(stderr, "Failed to write %s\n", path.c_str());
+        if (f) fclose(f);
+        return false;
+    }
+    fclose(f);
+
+    printf("{\"file\":\"%s\",\"mode\":%u,\"period\":%u,\"profile\":\"%s\",\"mask\":%u,\"start\":%u,"
+           "\"samples\":%u,\"bytes\":%zu",
+           path.c_str(), mode, period, SignalModel::ProfileName(profile), options.mask, start, count, file.size());
+
+    bool ok = true;
+    if (options.verify) {
+        std::vector<char> data(file.begin(), file.end());
+        std::vector<PowermonLogFile::Sample> decoded;
+
+        auto begin = std::chrono::steady_clock::now();
+        PowermonLogFile::decode(data, decoded);
+        double decode_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+        Errors errors = verify(header, samples, decoded);
+        ok = errors.mismatches == 0;
+        printf(",\"verified\":%s,\"decoded\":%zu,\"mismatches\":%u,\"decodeMs\":%.3f,"
+               "\"maxError\":{\"voltage1\":%g,\"voltage2\":%g,\"current\":%g,\"power\":%g,\"temperature\":%g}",
+               ok ? "true" : "false", decoded.size(), errors.mismatches, decode_ms,
+               errors.voltage1, errors.voltage2, errors.current, errors.power, errors.temperature);
+    }
+    printf("}\n");
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parse_args(argc, argv, options)) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    bool ok = true;
+    for (SignalModel::Profile profile : options.profiles) {
+        for (uint8_t mode : options.modes) {
+            ok = generate(options, mode, profile) && ok;
+        }
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,270 @@
+#!/usr/bin/env node
+/**
+ * PowerMon Addon Microbenchmarks
+ *
+ * Measures ns/op, native allocations/op and V8 heap bytes/op for the N-API
+ * conversion helpers, decodeLogData on realistic file sizes and the
+ * readLogFile copy path (against the in-process fake device backend).
+ *
+ * Results go to stdout as JSON; a summary table goes to stderr.
+ *
+ * Usage: npm run bench -- [--filter <substring>] [--time <ms per case>] [--out <file>]
+ */
+
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+
+const BENCH_ADDON = path.join(__dirname, '../build/Release/powermon_bench.node');
+
+// Any valid access URL works: the fake backend derives the device from it
+const FAKE_URL = 'https://applinks.thornwave.com/?n=DCL-Bench&s=a3a5b30ea9b3ff98&h=41' +
+  '&c=c1HOvvGTYe4HcxZ1AWUUVg%3D%3D&k=qN19gp1NyTIjTcKXIFUagek74WSxnF9446mW1lX0Ca4%3D';
+
+const LOG_MODES = [
+  { mode: 1, label: '1s' },
+  { mode: 4, label: '10s' },
+  { mode: 7, label: '60s' },
+];
+
+const READ_SIZES = [4096, 65536, 524288];
+
+function parseArgs(argv) {
+  const args = { filter: null, timeMs: 1000, out: null };
+  for (let i = 0; i < argv.length; i++) {
+    if (argv[i] === '--filter') args.filter = argv[++i];
+    else if (argv[i] === '--time') args.timeMs = parseInt(argv[++i], 10);
+    else if (argv[i] === '--out') args.out = argv[++i];
+  }
+  return args;
+}
+
+function collectGarbage() {
+  if (global.gc) {
+    global.gc();
+  }
+}
+
+function median(values) {
+  const sorted = [...values].sort((a, b) => a - b);
+  return sorted[Math.floor(sorted.length / 2)];
+}
+
+/**
+ * V8 heap growth per op over a short batch; null when a GC ran in between
+ */
+function measureHeap(runBatch, ops) {
+  if (!global.gc) {
+    return null;
+  }
+  collectGarbage();
+  const before = process.memoryUsage().heapUsed;
+  runBatch(ops);
+  const delta = process.memoryUsage().heapUsed - before;
+  return delta > 0 ? delta / ops : null;
+}
+
+/**
+ * Runs a synchronous case. runBatch(n) performs n ops and returns elapsed ns
+ * (native cases time themselves; JS cases use hrtime).
+ */
+function runSync(name, params, runBatch, timeMs) {
+  runBatch(10);
+
+  // Calibrate to roughly a fifth of the time budget per round
+  let n = 10;
+  let ns = runBatch(n);
+  while (ns < 20e6 && n < 1e7) {
+    n *= 4;
+    ns = runBatch(n);
+  }
+  const perRound = Math.max(1, Math.round(n * (timeMs * 1e6 / 5) / ns));
+
+  const nsPerOp = [];
+  const allocs = [];
+  const allocBytes = [];
+  for (let round = 0; round < 5; round++) {
+    const before = bench.allocations();
+    const elapsed = runBatch(perRound);
+    const after = bench.allocations();
+    nsPerOp.push(elapsed / perRound);
+    allocs.push((after.count - before.count) / perRound);
+    allocBytes.push((after.bytes - before.bytes) / perRound);
+  }
+
+  const heapOps = Math.max(1, Math.min(1000, Math.floor(perRound / 10)));
+  return {
+    name,
+    params,
+    iterations: perRound * 5,
+    nsPerOp: median(nsPerOp),
+    opsPerSec: 1e9 / median(nsPerOp),
+    allocsPerOp: median(allocs),
+    allocBytesPerOp: median(allocBytes),
+    heapBytesPerOp: measureHeap(runBatch, heapOps),
+  };
+}
+
+function nativeCase(fn) {
+  return (n) => fn(n).ns;
+}
+
+function jsCase(fn) {
+  return (n) => {
+    const start = process.hrtime.bigint();
+    for (let i = 0; i < n; i++) {
+      fn();
+    }
+    return Number(process.hrtime.bigint() - start);
+  };
+}
+
+/**
+ * Sequential readLogFile round trips through the real wrapper path
+ * (fake device -> timer thread -> TSFN -> JS callback)
+ */
+async function runReadLogFile(device, file, size, timeMs) {
+  const read = () => new Promise((resolve, reject) => {
+    device.readLogFile(file.id, 0, size, (result) => {
+      if (!result.success) reject(new Error(`readLogFile failed: code ${result.code}`));
+      else resolve(result.data.length);
+    });
+  });
+
+  // Warm up and prime the fake's window cache so synthesis is excluded
+  for (let i = 0; i < 10; i++) await read();
+
+  const allocBefore = bench.allocations();
+  const deadline = process.hrtime.bigint() + BigInt(timeMs) * 1000000n;
+  const start = process.hrtime.bigint();
+  let ops = 0;
+  let bytes = 0;
+  while (process.hrtime.bigint() < deadline) {
+    bytes += await read();
+    ops++;
+  }
+  const elapsed = Number(process.hrtime.bigint() - start);
+  const allocAfter = bench.allocations();
+
+  return {
+    name: 'readLogFile',
+    params: { size, bytesPerOp: bytes / ops },
+    iterations: ops,
+    nsPerOp: elapsed / ops,
+    opsPerSec: ops * 1e9 / elapsed,
+    allocsPerOp: (allocAfter.count - allocBefore.count) / ops,
+    allocBytesPerOp: (allocAfter.bytes - allocBefore.bytes) / ops,
+    heapBytesPerOp: null,
+  };
+}
+
+function connectFake() {
+  bench.PowermonDevice.setBackend('fake', 'dist=fixed,rtt=0,jitter=0,connect=0,log_hours=24,file_hours=24');
+  const device = new bench.PowermonDevice();
+  return new Promise((resolve, reject) => {
+    device.connect({
+      url: FAKE_URL,
+      onConnect: () => {
+        device.getLogFileList((result) => {
+          if (!result.success || result.data.length === 0) {
+            reject(new Error('Fake device has no log files'));
+            return;
+          }
+          // Largest file
+          const file = result.data.reduce((a, b) => (b.size > a.size ? b : a));
+          resolve({ device, file });
+        });
+      },
+      onDisconnect: () => {},
+    });
+  });
+}
+
+function printTable(results) {
+  const rows = results.map((r) => [
+    r.name + (r.params ? ' ' + Object.entries(r.params).filter(([k]) => k !== 'bytesPerOp').map(([k, v]) => `${k}=${v}`).join(',') : ''),
+    r.nsPerOp.toFixed(0),
+    r.allocsPerOp.toFixed(2),
+    r.allocBytesPerOp.toFixed(0),
+    r.heapBytesPerOp === null ? '-' : r.heapBytesPerOp.toFixed(0),
+  ]);
+  const header = ['case', 'ns/op', 'allocs/op', 'alloc B/op', 'heap B/op'];
+  const widths = header.map((h, i) => Math.max(h.length, ...rows.map((row) => row[i].length)));
+  const line = (cols) => cols.map((c, i) => (i === 0 ? c.padEnd(widths[i]) : c.padStart(widths[i]))).join('  ');
+  process.stderr.write(line(header) + '\n');
+  for (const row of rows) {
+    process.stderr.write(line(row) + '\n');
+  }
+}
+
+let bench = null;
+
+async function main() {
+  const args = parseArgs(process.argv.slice(2));
+
+  if (!fs.existsSync(BENCH_ADDON)) {
+    console.error(`Bench addon not found at ${BENCH_ADDON}; run npm run build first`);
+    process.exit(1);
+  }
+  bench = require(BENCH_ADDON);
+
+  if (!global.gc) {
+    process.stderr.write('Run with --expose-gc for heap bytes/op\n');
+  }
+
+  const wanted = (name) => !args.filter || name.includes(args.filter);
+  const results = [];
+
+  if (wanted('monitorDataToObject')) {
+    results.push(runSync('monitorDataToObject', null, nativeCase(bench.monitorDataToObject), args.timeMs));
+  }
+  if (wanted('deviceInfoToObject')) {
+    results.push(runSync('deviceInfoToObject', null, nativeCase(bench.deviceInfoToObject), args.timeMs));
+  }
+  if (wanted('sampleToObject')) {
+    results.push(runSync('sampleToObject', null, nativeCase(bench.sampleToObject), args.timeMs));
+  }
+
+  // One day of logging per mode: 86400, 8640 and 1440 samples
+  for (const { mode, label } of LOG_MODES) {
+    const file = bench.makeLogFile(mode, 24);
+    const params = { mode: label, bytes: file.length };
+    if (wanted('decodeLogData')) {
+      results.push(runSync('decodeLogData', params,
+        jsCase(() => bench.PowermonDevice.decodeLogData(file)), args.timeMs));
+      results.push(runSync('decodeLogData', { ...params, packed: true },
+        jsCase(() => bench.PowermonDevice.decodeLogData(file, { packed: true })), args.timeMs));
+    }
+  }
+
+  if (wanted('readLogFile')) {
+    const { device, file } = await connectFake();
+    for (const size of READ_SIZES) {
+      results.push(await runReadLogFile(device, file, Math.min(size, file.size), args.timeMs));
+    }
+    device.disconnect();
+  }
+
+  const report = {
+    timestamp: new Date().toISOString(),
+    node: process.version,
+    platform: `${os.platform()}-${os.arch()}`,
+    cpu: os.cpus()[0] ? os.cpus()[0].model : 'unknown',
+    results,
+  };
+
+  printTable(results);
+  const json = JSON.stringify(report, null, 2);
+  if (args.out) {
+    fs.writeFileSync(args.out, json + '\n');
+  }
+  process.stdout.write(json + '\n');
+
+  // The fake's timer thread keeps no handles open, but TSFNs may linger
+  process.exit(0);
+}
+
+main().catch((err) => {
+  console.error(err);
+  process.exit(1);
+});
@@ -0,0 +1,348 @@
+#!/usr/bin/env node
+/**
+ * Device Manager Soak Test
+ *
+ * Runs the real connection pool, polling scheduler and batch writer against
+ * thousands of fake devices (POWERMON_BACKEND=fake in the addon, or recorded
+ * traces with --replay) and an in-memory Postgres stand-in, and records per
+ * interval:
+ *   - event loop lag (p50/p99/max)
+ *   - poll success rate, failed and skipped polls
+ *   - RSS, heap, thread count and CPU
+ *   - flush latency (p50/p99/max) and rows written
+ * and ends with a summary that includes the addon's per-request latency
+ * percentiles (getLatencyStats).
+ *
+ * The stand-in answers every query the pool and writer make after a modelled
+ * round trip (--db-query-ms per query plus --db-row-us per inserted row), so
+ * flush latency reflects the writer's query pattern, not a real server.
+ *
+ * Scheduler and writer settings come from the usual environment variables
+ * (MAX_CONCURRENT_POLLS, COHORT_COUNT, POLL_INTERVAL_MS, ...), so limits can
+ * be compared run against run.
+ *
+ * Usage: npm run soak -- [--devices <n>] [--duration <min>] [--interval <s>]
+ *          [--fake <spec> | --replay <spec>] [--connect-concurrency <n>] [--db-query-ms <ms>]
+ *          [--db-row-us <us>] [--out <file.jsonl>]
+ */
+
+const crypto = require('crypto');
+const fs = require('fs');
+const { monitorEventLoopDelay } = require('perf_hooks');
+
+// Device latency and loss close to the field; override with --fake
+const DEFAULT_FAKE = 'dist=lognormal,rtt=80,jitter=40,loss=0.001,connect=300';
+
+function parseArgs(argv) {
+  const args = {
+    devices: 1000,
+    durationMin: 10,
+    intervalSec: 10,
+    fake: DEFAULT_FAKE,
+    replay: null,
+    connectConcurrency: 200,
+    dbQueryMs: 0.5,
+    dbRowUs: 20,
+    out: null,
+  };
+  for (let i = 0; i < argv.length; i++) {
+    if (argv[i] === '--devices') args.devices = parseInt(argv[++i], 10);
+    else if (argv[i] === '--duration') args.durationMin = parseFloat(argv[++i]);
+    else if (argv[i] === '--interval') args.intervalSec = parseFloat(argv[++i]);
+    else if (argv[i] === '--fake') args.fake = argv[++i];
+    else if (argv[i] === '--replay') args.replay = argv[++i];
+    else if (argv[i] === '--connect-concurrency') args.connectConcurrency = parseInt(argv[++i], 10);
+    else if (argv[i] === '--db-query-ms') args.dbQueryMs = parseFloat(argv[++i]);
+    else if (argv[i] === '--db-row-us') args.dbRowUs = parseFloat(argv[++i]);
+    else if (argv[i] === '--out') args.out = argv[++i];
+  }
+  return args;
+}
+
+const args = parseArgs(process.argv.slice(2));
+
+// Must be set before the app modules load their config and the addon
+process.env.POWERMON_BACKEND = args.replay ? 'replay' : 'fake';
+process.env.POWERMON_FAKE = args.fake;
+if (args.replay) process.env.POWERMON_REPLAY = args.replay;
+process.env.DATABASE_URL = process.env.DATABASE_URL || 'postgres://soak-stand-in/device_manager';
+process.env.LOG_LEVEL = process.env.LOG_LEVEL || 'error';
+
+const { config } = require('../app/config');
+const db = require('../app/database');
+const { powermon } = require('../app/addon');
+const { connectionPool } = require('../app/connection-pool');
+const { pollingScheduler } = require('../app/polling-scheduler');
+const batchWriter = require('../app/batch-writer');
+
+const sleep = (ms) => new Promise((resolve) => setTimeout(resolve, ms));
+
+/**
+ * Synthetic fleet: one access URL per device, so the fake backend derives a
+ * distinct serial (and signal) for each
+ */
+function makeDevices(count) {
+  const devices = [];
+  for (let i = 0; i < count; i++) {
+    const serial = crypto.randomBytes(8).toString('hex');
+    const channel = encodeURIComponent(crypto.randomBytes(16).toString('base64'));
+    const key = encodeURIComponent(crypto.randomBytes(32).toString('base64'));
+    devices.push({
+      device_id: i + 1,
+      organization_id: 1,
+      serial_number: serial.toUpperCase(),
+      device_name: `SOAK-${i + 1}`,
+      truck_id: i + 1,
+      status: 'active',
+      applink_url: `https://applinks.thornwave.com/?n=SOAK-${i + 1}&s=${serial}&h=41&c=${channel}&k=${key}`,
+      cohort_id: null,
+      last_successful_poll_at: null,
+      connection_status: 'disconnected',
+      backfill_status: null,
+      gap_start_at: null,
+    });
+  }
+  return devices;
+}
+
+/**
+ * Replaces the database module's functions with an in-memory stand-in
+ */
+function installStandIn(devices) {
+  const counters = { queries: 0, rowsInserted: 0, snapshots: 0 };
+  const roundTrip = (rows = 0) => {
+    counters.queries++;
+    return sleep(args.dbQueryMs + rows * args.dbRowUs / 1000);
+  };
+
+  db.initDatabase = () => null;
+  db.closeDatabase = async () => {};
+  db.query = async () => {
+    await roundTrip();
+    return { rows: [], rowCount: 0 };
+  };
+  db.getActiveDevicesWithCredentials = async () => {
+    await roundTrip(devices.length);
+    return devices;
+  };
+  db.upsertDeviceSyncStatus = () => roundTrip();
+  db.updateDevicePollStatus = () => roundTrip();
+  db.markDeviceConnected = () => roundTrip();
+  db.markDeviceDisconnected = () => roundTrip();
+  db.updateDeviceInfo = () => roundTrip();
+  db.getDevicesNeedingBackfill = async () => {
+    await roundTrip();
+    return [];
+  };
+  db.updateBackfillProgress = () => roundTrip();
+  db.bulkInsertMeasurements = async (measurements) => {
+    await roundTrip(measurements.length);
+    counters.rowsInserted += measurements.length;
+  };
+  db.upsertDeviceSnapshot = async () => {
+    await roundTrip();
+    counters.snapshots++;
+  };
+  return counters;
+}
+
+/**
+ * Times every batchWriter.flush() call
+ */
+function instrumentFlush() {
+  const flushes = [];
+  const flush = batchWriter.flush.bind(batchWriter);
+  batchWriter.flush = async () => {
+    const start = process.hrtime.bigint();
+    try {
+      return await flush();
+    } finally {
+      flushes.push(Number(process.hrtime.bigint() - start) / 1e6);
+    }
+  };
+  return flushes;
+}
+
+function threadCount() {
+  try {
+    const match = fs.readFileSync('/proc/self/status', 'utf8').match(/^Threads:\s+(\d+)/m);
+    return match ? parseInt(match[1], 10) : null;
+  } catch (err) {
+    return null;
+  }
+}
+
+function percentile(values, p) {
+  if (values.length === 0) return null;
+  const sorted = values.slice().sort((a, b) => a - b);
+  return sorted[Math.min(sorted.length - 1, Math.max(0, Math.ceil(p / 100 * sorted.length) - 1))];
+}
+
+/**
+ * Connects every device with bounded parallelism (connectAll() is sequential,
+ * which at fleet scale measures nothing but startup time)
+ */
+async function connectFleet(concurrency) {
+  const connections = connectionPool.getAllConnections();
+  let next = 0;
+  let connected = 0;
+  const worker = async () => {
+    while (next < connections.length) {
+      const conn = connections[next++];
+      if (await conn.connect()) connected++;
+    }
+  };
+  await Promise.all(Array.from({ length: Math.min(concurrency, connections.length) }, worker));
+  return connected;
+}
+
+async function main() {
+  if (!powermon) {
+    console.error('PowerMon addon not available; run npm run build first');
+    process.exit(1);
+  }
+
+  const devices = makeDevices(args.devices);
+  const dbCounters = installStandIn(devices);
+  const flushes = instrumentFlush();
+  const out = args.out ? fs.createWriteStream(args.out) : null;
+
+  const settings = {
+    devices: args.devices,
+    fake: args.replay ? null : args.fake,
+    replay: args.replay,
+    pollIntervalMs: config.polling.intervalMs,
+    cohortCount: config.polling.cohortCount,
+    maxConcurrentPolls: config.polling.maxConcurrentPolls,
+    pollTimeoutMs: config.polling.timeoutMs,
+    flushIntervalMs: config.batchWriter.flushIntervalMs,
+    maxBatchSize: config.batchWriter.maxBatchSize,
+    mergeEnabled: config.merge.enabled,
+    dbQueryMs: args.dbQueryMs,
+    dbRowUs: args.dbRowUs,
+  };
+  process.stderr.write(`soak: ${JSON.stringify(settings)}\n`);
+
+  // Startup: pool initialization and connecting the fleet
+  const startupBegin = Date.now();
+  await connectionPool.initialize();
+  const initMs = Date.now() - startupBegin;
+  const connected = await connectFleet(args.connectConcurrency);
+  const connectMs = Date.now() - startupBegin - initMs;
+  process.stderr.write(`soak: initialized in ${initMs} ms, ${connected}/${args.devices} connected in ${connectMs} ms\n`);
+
+  batchWriter.start();
+  pollingScheduler.start();
+
+  const lag = monitorEventLoopDelay({ resolution: 10 });
+  lag.enable();
+
+  const intervalMs = args.intervalSec * 1000;
+  const end = Date.now() + args.durationMin * 60 * 1000;
+  const timeline = [];
+  let previous = {
+    time: Date.now(),
+    cpu: process.cpuUsage(),
+    scheduler: { ...pollingScheduler.getStats() },
+    rowsInserted: 0,
+    queries: 0,
+  };
+
+  while (Date.now() < end) {
+    await sleep(Math.min(intervalMs, end - Date.now()));
+
+    const now = Date.now();
+    const cpu = process.cpuUsage();
+    const scheduler = pollingScheduler.getStats();
+    const writer = batchWriter.getStats();
+    const pool = scheduler.poolStats;
+    const memory = process.memoryUsage();
+    const elapsed = now - previous.time;
+    const polls = scheduler.totalPolls - previous.scheduler.totalPolls;
+    const intervalFlushes = flushes.splice(0);
+
+    const sample = {
+      t: Math.round((now - startupBegin) / 1000),
+      lagP50Ms: lag.percentile(50) / 1e6,
+      lagP99Ms: lag.percentile(99) / 1e6,
+      lagMaxMs: lag.max / 1e6,
+      polls,
+      pollSuccessRate: polls > 0 ? (scheduler.successfulPolls - previous.scheduler.successfulPolls) / polls : null,
+      failedPolls: scheduler.failedPolls - previous.scheduler.failedPolls,
+      skippedPolls: scheduler.skippedPolls - previous.scheduler.skippedPolls,
+      // Polls the fleet should get in this interval at POLL_INTERVAL_MS
+      expectedPolls: Math.round(args.devices * elapsed / config.polling.intervalMs),
+      connected: pool.connected,
+      reconnecting: pool.reconnecting,
+      disconnected: pool.disconnected,
+      rssMb: memory.rss / 1048576,
+      heapUsedMb: memory.heapUsed / 1048576,
+      threads: threadCount(),
+      cpuPercent: ((cpu.user - previous.cpu.user) + (cpu.system - previous.cpu.system)) / (elapsed * 10),
+      flushes: intervalFlushes.length,
+      flushP50Ms: percentile(intervalFlushes, 50),
+      flushP99Ms: percentile(intervalFlushes, 99),
+      flushMaxMs: intervalFlushes.length ? Math.max(...intervalFlushes) : null,
+      rowsWritten: dbCounters.rowsInserted - previous.rowsInserted,
+      queries: dbCounters.queries - previous.queries,
+      writerQueue: writer.currentQueueSize,
+      cohortSpread: scheduler.balance.spread,
+      cohortMoves: scheduler.balance.moves - previous.scheduler.balance.moves,
+    };
+    lag.reset();
+
+    timeline.push(sample);
+    if (out) out.write(JSON.stringify(sample) + '\n');
+    process.stderr.write(
+      `t=${sample.t}s lag p99=${sample.lagP99Ms.toFixed(1)}ms polls=${polls}/${sample.expectedPolls} ` +
+      `ok=${sample.pollSuccessRate === null ? '-' : (sample.pollSuccessRate * 100).toFixed(1) + '%'} ` +
+      `skipped=${sample.skippedPolls} rss=${sample.rssMb.toFixed(0)}MB threads=${sample.threads} ` +
+      `flush p99=${sample.flushP99Ms === null ? '-' : sample.flushP99Ms.toFixed(1) + 'ms'} queue=${sample.writerQueue}\n`);
+
+    previous = {
+      time: now,
+      cpu,
+      scheduler: { ...scheduler },
+      rowsInserted: dbCounters.rowsInserted,
+      queries: dbCounters.queries,
+    };
+  }
+
+  lag.disable();
+  pollingScheduler.stop();
+  await batchWriter.stop();
+  connectionPool.disconnectAll();
+  if (out) out.end();
+
+  const totals = pollingScheduler.getStats();
+  const summary = {
+    settings,
+    startup: { initMs, connectMs, connected },
+    durationSec: Math.round((Date.now() - startupBegin) / 1000),
+    polls: totals.totalPolls,
+    pollSuccessRate: totals.totalPolls > 0 ? totals.successfulPolls / totals.totalPolls : null,
+    skippedPolls: totals.skippedPolls,
+    cohortMoves: totals.balance.moves,
+    pollCoverage: timeline.reduce((sum, s) => sum + s.polls, 0) /
+      Math.max(1, timeline.reduce((sum, s) => sum + s.expectedPolls, 0)),
+    lagP99MaxMs: Math.max(0, ...timeline.map((s) => s.lagP99Ms)),
+    lagMaxMs: Math.max(0, ...timeline.map((s) => s.lagMaxMs)),
+    rssMaxMb: Math.max(0, ...timeline.map((s) => s.rssMb)),
+    rssGrowthMb: timeline.length > 1 ? timeline[timeline.length - 1].rssMb - timeline[0].rssMb : 0,
+    threadsMax: Math.max(0, ...timeline.map((s) => s.threads || 0)),
+    flushP99MaxMs: Math.max(0, ...timeline.map((s) => s.flushP99Ms || 0)),
+    rowsWritten: dbCounters.rowsInserted,
+    writerQueueHighWaterMark: batchWriter.getStats().queueHighWaterMark,
+    // Per request type, from connect to the end of the run
+    requestLatency: powermon.PowermonDevice.getLatencyStats ? powermon.PowermonDevice.getLatencyStats() : null,
+    // Threads and RSS per library instance, TSFNs and native buffers left at the end
+    resources: powermon.PowermonDevice.getResourceStats ? powermon.PowermonDevice.getResourceStats() : null,
+  };
+  process.stdout.write(JSON.stringify(summary, null, 2) + '\n');
+  process.exit(0);
+}
+
+main().catch((err) => {
+  console.error(err);
+  process.exit(1);
+});
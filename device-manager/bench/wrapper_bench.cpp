@@ -0,0 +1,181 @@
+#include <napi.h>
+
+#include <string.h>
+#include <time.h>
+
+#include <chrono>
+#include <vector>
+
+#include "alloc_counter.h"
+#include "fake_powermon.h"
+#include "log_format.h"
+#include "powermon_wrapper.h"
+
+// Native side of npm run bench. The conversion helpers are timed in a native
+// loop (one HandleScope per iteration, as in a real callback) so the numbers
+// exclude the JS call overhead; paths that are only reachable from JS
+// (decodeLogData, readLogFile) are driven by bench/run.js against the
+// PowermonDevice class exported here.
+class WrapperBench {
+public:
+    static Napi::Object Init(Napi::Env env, Napi::Object exports);
+
+private:
+    static Napi::Value Allocations(const Napi::CallbackInfo& info);
+    static Napi::Value MonitorDataToObject(const Napi::CallbackInfo& info);
+    static Napi::Value DeviceInfoToObject(const Napi::CallbackInfo& info);
+    static Napi::Value SampleToObject(const Napi::CallbackInfo& info);
+    static Napi::Value MakeLogFile(const Napi::CallbackInfo& info);
+
+    template <typename F>
+    static Napi::Value Measure(const Napi::CallbackInfo& info, F fn);
+};
+
+namespace {
+
+const uint64_t SERIAL = 0x64F57B44F201ULL;
+
+uint32_t Now() {
+    return static_cast<uint32_t>(time(nullptr));
+}
+
+Napi::Object SnapshotToObject(Napi::Env env, const AllocCounter::Snapshot& snapshot) {
+    Napi::Object obj = Napi::Object::New(env);
+    obj.Set("count", Napi::Number::New(env, static_cast<double>(snapshot.count)));
+    obj.Set("bytes", Napi::Number::New(env, static_cast<double>(snapshot.bytes)));
+    return obj;
+}
+
+}
+
+template <typename F>
+Napi::Value WrapperBench::Measure(const Napi::CallbackInfo& info, F fn) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsNumber()) {
+        Napi::TypeError::New(env, "Iteration count expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    uint32_t iterations = info[0].As<Napi::Number>().Uint32Value();
+
+    AllocCounter::Snapshot before = AllocCounter::Get();
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < iterations; i++) {
+        Napi::HandleScope scope(env);
+        fn(env);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    AllocCounter::Snapshot after = AllocCounter::Get();
+
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("iterations", Napi::Number::New(env, iterations));
+    result.Set("ns", Napi::Number::New(env,
+        static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count())));
+    result.Set("allocs", Napi::Number::New(env, static_cast<double>(after.count - before.count)));
+    result.Set("allocBytes", Napi::Number::New(env, static_cast<double>(after.bytes - before.bytes)));
+    return result;
+}
+
+Napi::Object WrapperBench::Init(Napi::Env env, Napi::Object exports) {
+    PowermonWrapper::Init(env, exports);
+
+    exports.Set("allocations", Napi::Function::New(env, Allocations, "allocations"));
+    exports.Set("monitorDataToObject", Napi::Function::New(env, MonitorDataToObject, "monitorDataToObject"));
+    exports.Set("deviceInfoToObject", Napi::Function::New(env, DeviceInfoToObject, "deviceInfoToObject"));
+    exports.Set("sampleToObject", Napi::Function::New(env, SampleToObject, "sampleToObject"));
+    exports.Set("makeLogFile", Napi::Function::New(env, MakeLogFile, "makeLogFile"));
+    return exports;
+}
+
+Napi::Value WrapperBench::Allocations(const Napi::CallbackInfo& info) {
+    return SnapshotToObject(info.Env(), AllocCounter::Get());
+}
+
+Napi::Value WrapperBench::MonitorDataToObject(const Napi::CallbackInfo& info) {
+    PowermonLogFile::Sample sample;
+    FakePowermon::Synthesize(SERIAL, Now(), sample);
+
+    Powermon::MonitorData data = {};
+    data.firmware_version_bcd = 0x0115;
+    data.hardware_revision_bcd = 0x41;
+    data.time = sample.time;
+    data.voltage1 = sample.voltage1;
+    data.voltage2 = sample.voltage2;
+    data.current = sample.current;
+    data.power = sample.power;
+    data.temperature = sample.temperature;
+    data.coulomb_meter = 123456;
+    data.energy_meter = 1580000;
+    data.power_status = Powermon::PS_ON;
+    data.fg_soc = sample.soc;
+    data.fg_runtime = 0xFFFF;
+    data.rssi = -61;
+
+    return Measure(info, [&data](Napi::Env env) {
+        PowermonWrapper::MonitorDataToObject(env, data);
+    });
+}
+
+Napi::Value WrapperBench::DeviceInfoToObject(const Napi::CallbackInfo& info) {
+    Powermon::DeviceInfo device = Powermon::DeviceInfo();
+    device.name = "DCL-Bench-Truck";
+    device.firmware_version_bcd = 0x0115;
+    device.hardware_revision_bcd = 0x41;
+    device.serial = SERIAL;
+    device.address = 0xA4CF12345678ULL;
+
+    return Measure(info, [&device](Napi::Env env) {
+        PowermonWrapper::DeviceInfoToObject(env, device);
+    });
+}
+
+Napi::Value WrapperBench::SampleToObject(const Napi::CallbackInfo& info) {
+    PowermonLogFile::Sample sample;
+    FakePowermon::Synthesize(SERIAL, Now(), sample);
+
+    return Measure(info, [&sample](Napi::Env env) {
+        PowermonWrapper::SampleToObject(env, sample);
+    });
+}
+
+Napi::Value WrapperBench::MakeLogFile(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsNumber()) {
+        Napi::TypeError::New(env, "Log mode and hours expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    uint8_t mode = static_cast<uint8_t>(info[0].As<Napi::Number>().Uint32Value());
+    uint32_t period = LogFormat::SamplePeriod(mode);
+    if (period == 0) {
+        Napi::RangeError::New(env, "Log mode must be 1-7").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    uint32_t count = info[1].As<Napi::Number>().Uint32Value() * 3600 / period;
+    uint32_t start = Now() - count * period;
+
+    std::vector<PowermonLogFile::Sample> samples(count);
+    for (uint32_t i = 0; i < count; i++) {
+        FakePowermon::Synthesize(SERIAL, start + i * period, samples[i]);
+    }
+
+    LogFormat::Header header;
+    memset(&header, 0, sizeof(header));
+    header.mode = mode;
+    header.time = start;
+
+    std::vector<uint8_t> file;
+    LogFormat::Encode(header, samples.data(), samples.size(), file);
+
+    Napi::Uint8Array out = Napi::Uint8Array::New(env, file.size());
+    memcpy(out.Data(), file.data(), file.size());
+    return out;
+}
+
+Napi::Object InitBench(Napi::Env env, Napi::Object exports) {
+    return WrapperBench::Init(env, exports);
+}
+
+NODE_API_MODULE(powermon_bench, InitBench)
@@ -1,32 +1,89 @@
 {
+  "variables": {
+    "core_sources": [
+      "src/powermon_wrapper.cpp",
+      "src/log_format.cpp",
+      "src/log_index.cpp",
+      "src/log_index_wrapper.cpp",
+      "src/sample_merger.cpp",
+      "src/sample_merger_wrapper.cpp",
+      "src/coverage_map.cpp",
+      "src/coverage_map_wrapper.cpp",
+      "src/energy_wrapper.cpp",
+      "src/packed_samples.cpp",
+      "src/packed_samples_wrapper.cpp",
+      "src/powermon_factory.cpp",
+      "src/fake_powermon.cpp",
+      "src/signal_model.cpp",
+      "src/device_timer.cpp",
+      "src/device_trace.cpp",
+      "src/recording_powermon.cpp",
+      "src/replay_powermon.cpp",
+      "src/latency_stats.cpp",
+      "src/link_stats.cpp",
+      "src/resource_stats.cpp",
+      "src/instance_pool.cpp",
+      "src/instance_reaper.cpp",
+      "src/timer_wheel.cpp",
+      "src/poll_scheduler.cpp",
+      "src/poll_scheduler_wrapper.cpp",
+      "src/native_metrics.cpp",
+      "src/request_trace.cpp"
+    ]
+  },
+  "target_defaults": {
+    "include_dirs": [
+      "<!@(node -p \"require('node-addon-api').include\")",
+      "<(module_root_dir)/libpowermon_bin/inc",
+      "../libpowermon_bin/inc"
+    ],
+    "libraries": [
+      "<(module_root_dir)/libpowermon_bin/powermon_lib_pic.a",
+      "-lstdc++",
+      "-lbluetooth",
+      "-ldbus-1",
+      "-lpthread"
+    ],
+    "cflags!": ["-fno-exceptions"],
+    "cflags_cc!": ["-fno-exceptions"],
+    "cflags_cc": ["-std=c++17", "-fexceptions"],
+    "defines": ["NAPI_DISABLE_CPP_EXCEPTIONS=0"],
+    "conditions": [
+      ["OS=='linux'", {
+        "cflags_cc": ["-Wno-unused-parameter"]
+      }]
+    ]
+  },
   "targets": [
+    {
+      # The energy integration kernel alone is built with -fno-trapping-math,
+      # which lets its loop compute both area formulas and blend them without
+      # branches; the rest of the addon keeps the default floating point rules.
+      "target_name": "energy_kernel",
+      "type": "static_library",
+      "sources": ["src/energy_integration.cpp"],
+      "cflags_cc": ["-fno-trapping-math"]
+    },
     {
       "target_name": "powermon_addon",
+      "dependencies": ["energy_kernel"],
       "sources": [
         "src/addon.cpp",
-        "src/powermon_wrapper.cpp"
-      ],
-      "include_dirs": [
-        "<!@(node -p \"require('node-addon-api').include\")",
-        "<(module_root_dir)/libpowermon_bin/inc",
-        "../libpowermon_bin/inc"
-      ],
-      "libraries": [
-        "<(module_root_dir)/libpowermon_bin/powermon_lib_pic.a",
-        "-lstdc++",
-        "-lbluetooth",
-        "-ldbus-1",
-        "-lpthread"
-      ],
-      "cflags!": ["-fno-exceptions"],
-      "cflags_cc!": ["-fno-exceptions"],
-      "cflags_cc": ["-std=c++17", "-fexceptions"],
-      "defines": ["NAPI_DISABLE_CPP_EXCEPTIONS=0"],
-      "conditions": [
-        ["OS=='linux'", {
-          "cflags_cc": ["-Wno-unused-parameter"]
-        }]
+        "<@(core_sources)"
       ]
+    },
+    {
+      # Microbenchmarks (npm run bench). -Bsymbolic binds the addon's own
+      # calls to the counting operator new in bench/alloc_counter.cpp.
+      "target_name": "powermon_bench",
+      "dependencies": ["energy_kernel"],
+      "sources": [
+        "bench/wrapper_bench.cpp",
+        "bench/alloc_counter.cpp",
+        "<@(core_sources)"
+      ],
+      "include_dirs": ["src"],
+      "ldflags": ["-Wl,-Bsymbolic"]
     }
   ]
 }
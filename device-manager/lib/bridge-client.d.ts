@@ -112,6 +112,8 @@ export declare class PowermonBridgeClient extends EventEmitter {
   getFuelgaugeStatistics(): Promise<BridgeResult<FuelgaugeStatistics>>;
   getLogFiles(): Promise<BridgeResult<LogFileDescriptor[]>>;
   readLogFile(fileId: number, offset: number, size: number): Promise<BridgeResult<string>>;
+  setTracing(events: number): Promise<BridgeResult<{ events: number }>>;
+  dumpTrace(path?: string): Promise<BridgeResult<object | string>>;
   
   startStreaming(intervalMs?: number, count?: number): void;
   isConnected(): boolean;
@@ -232,6 +232,25 @@ class PowermonBridgeClient extends EventEmitter {
     return this._sendCommandAsync(`readlog ${fileId} ${offset} ${size}`);
   }
 
+  /**
+   * Start (events > 0, or true for 1M) or stop (0 or false) request tracing in
+   * the bridge; other values are rejected by the bridge
+   */
+  async setTracing(events) {
+    if (typeof events === 'boolean') {
+      events = events ? 1 << 20 : 0;
+    }
+    return this._sendCommandAsync(`trace ${events}`);
+  }
+
+  /**
+   * Chrome trace_event JSON of the traced requests, written to path when given;
+   * without a path it comes back inline as the result data
+   */
+  async dumpTrace(path) {
+    return this._sendCommandAsync(path ? `tracedump ${path}` : 'tracedump');
+  }
+
   startStreaming(intervalMs = 2000, count = 0) {
     const cmdId = this._generateCommandId();
     this._sendCommand(`${cmdId} stream ${intervalMs} ${count}`);
@@ -101,13 +101,29 @@ export interface ConnectOptions {
     onConnect?: () => void;
     onDisconnect?: (reason: number) => void;
 }
+export interface SleepResult {
+    success: boolean;
+    latencyMs?: number;
+    reason?: number;
+}
+export interface ConnectEstimate {
+    samples: number;
+    meanMs: number;
+    deviationMs: number;
+    leadMs: number;
+}
 /**
  * PowerMon Device class for communicating with PowerMon battery monitors
  */
 export declare class PowermonDevice {
     private device;
     private initialized;
-    constructor();
+    constructor(device?: any);
+    /**
+     * Create a device without blocking the event loop: the library instance
+     * is created (or taken from the pool) on a worker thread
+     */
+    static create(): Promise<PowermonDevice>;
     /**
      * Check if the device instance was successfully initialized
      */
@@ -144,6 +160,25 @@ export declare class PowermonDevice {
      * Disconnect from the device
      */
     disconnect(): void;
+    /**
+     * Disconnect and release the native instance on a background thread.
+     * The device cannot be used afterwards
+     */
+    close(): void;
+    /**
+     * Disconnect until wake(), without onDisconnect being called
+     */
+    hibernate(callback: (result: SleepResult) => void): void;
+    /**
+     * Reconnect a hibernating device with the same access key, without
+     * onConnect being called
+     */
+    wake(callback: (result: SleepResult) => void): void;
+    isHibernating(): boolean;
+    /**
+     * Connect time of this device, for starting a wake early enough
+     */
+    getConnectEstimate(): ConnectEstimate;
     /**
      * Check if connected
      */
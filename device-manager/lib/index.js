@@ -13,13 +13,20 @@ const addon = require('../build/Release/powermon_addon.node');
  * PowerMon Device class for communicating with PowerMon battery monitors
  */
 class PowermonDevice {
-    constructor() {
+    constructor(device) {
         this.initialized = false;
-        this.device = new addon.PowermonDevice();
+        this.device = device !== null && device !== void 0 ? device : new addon.PowermonDevice();
         this.initialized = true;
         // Note: BLE may not be available, check with isBleAvailable()
         // Static methods always work regardless of BLE status
     }
+    /**
+     * Create a device without blocking the event loop: the library instance
+     * is created (or taken from the pool) on a worker thread
+     */
+    static async create() {
+        return new PowermonDevice(await addon.PowermonDevice.create());
+    }
     /**
      * Check if the device instance was successfully initialized
      */
@@ -81,6 +88,37 @@ class PowermonDevice {
             this.device.disconnect();
         }
     }
+    /**
+     * Disconnect and release the native instance on a background thread.
+     * The device cannot be used afterwards
+     */
+    close() {
+        if (this.initialized) {
+            this.device.close();
+        }
+    }
+    /**
+     * Disconnect until wake(), without onDisconnect being called
+     */
+    hibernate(callback) {
+        this.device.hibernate(callback);
+    }
+    /**
+     * Reconnect a hibernating device with the same access key, without
+     * onConnect being called
+     */
+    wake(callback) {
+        this.device.wake(callback);
+    }
+    isHibernating() {
+        return this.initialized && this.device.isHibernating();
+    }
+    /**
+     * Connect time of this device, for starting a wake early enough
+     */
+    getConnectEstimate() {
+        return this.device.getConnectEstimate();
+    }
     /**
      * Check if connected
      */
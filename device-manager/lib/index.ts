@@ -117,6 +117,19 @@ export interface ConnectOptions {
   onDisconnect?: (reason: number) => void;
 }
 
+export interface SleepResult {
+  success: boolean;
+  latencyMs?: number; // wake() only: connect time
+  reason?: number;    // disconnect reason of a failed wake
+}
+
+export interface ConnectEstimate {
+  samples: number;
+  meanMs: number;
+  deviationMs: number;
+  leadMs: number;     // meanMs + 4 * deviationMs
+}
+
 /**
  * PowerMon Device class for communicating with PowerMon battery monitors
  */
@@ -124,13 +137,21 @@ export class PowermonDevice {
   private device: any;
   private initialized: boolean = false;
 
-  constructor() {
-    this.device = new addon.PowermonDevice();
+  constructor(device?: any) {
+    this.device = device ?? new addon.PowermonDevice();
     this.initialized = true;
     // Note: BLE may not be available, check with isBleAvailable()
     // Static methods always work regardless of BLE status
   }
 
+  /**
+   * Create a device without blocking the event loop: the library instance
+   * is created (or taken from the pool) on a worker thread
+   */
+  static async create(): Promise<PowermonDevice> {
+    return new PowermonDevice(await addon.PowermonDevice.create());
+  }
+
   /**
    * Check if the device instance was successfully initialized
    */
@@ -200,6 +221,42 @@ export class PowermonDevice {
     }
   }
 
+  /**
+   * Disconnect and release the native instance on a background thread.
+   * The device cannot be used afterwards
+   */
+  close(): void {
+    if (this.initialized) {
+      this.device.close();
+    }
+  }
+
+  /**
+   * Disconnect until wake(), without onDisconnect being called
+   */
+  hibernate(callback: (result: SleepResult) => void): void {
+    this.device.hibernate(callback);
+  }
+
+  /**
+   * Reconnect a hibernating device with the same access key, without
+   * onConnect being called
+   */
+  wake(callback: (result: SleepResult) => void): void {
+    this.device.wake(callback);
+  }
+
+  isHibernating(): boolean {
+    return this.initialized && this.device.isHibernating();
+  }
+
+  /**
+   * Connect time of this device, for starting a wake early enough
+   */
+  getConnectEstimate(): ConnectEstimate {
+    return this.device.getConnectEstimate();
+  }
+
   /**
    * Check if connected
    */
@@ -22,6 +22,30 @@ if (process.env.SIMULATION_MODE !== 'true' && process.env.SIMULATION_MODE !== '1
   }
 }
 
+// Size of the header at the start of every log file
+const LOG_HEADER_SIZE = 20;
+
+// Per-device log file indexes (serial -> LogIndex), learned from file headers.
+// Kept across syncs so repeat backfills can seek straight to the bytes they need.
+const logIndexes = new Map();
+
+/**
+ * Gets the log file index for a device, creating it on first use
+ * @param {string} deviceSerial
+ * @returns {Object|null} Native LogIndex, or null if the addon is unavailable
+ */
+function getLogIndex(deviceSerial) {
+  if (!addon || !addon.LogIndex) {
+    return null;
+  }
+  let index = logIndexes.get(deviceSerial);
+  if (!index) {
+    index = new addon.LogIndex();
+    logIndexes.set(deviceSerial, index);
+  }
+  return index;
+}
+
 /**
  * Creates initial sync state for a device
  * @param {string} deviceSerial 
@@ -33,6 +57,7 @@ function createInitialState(deviceSerial) {
     lastSyncTime: 0,
     lastFileId: 0,
     lastFileOffset: 0,
+    lastSampleTime: 0,
     totalSamplesSynced: 0
   };
 }
@@ -134,6 +159,88 @@ function decodeLogData(data) {
   return addon.PowermonDevice.decodeLogData(data);
 }
 
+/**
+ * Makes sure the index knows a file's header, reading just the header if needed
+ * @param {Object} device - Connected PowermonDevice
+ * @param {Object} index - LogIndex for the device
+ * @param {Object} file - { id, size } from the file list
+ * @returns {Promise<boolean>} true if the file is indexed
+ */
+async function ensureIndexed(device, index, file) {
+  if (index.has(file.id)) {
+    index.updateSize(file.id, file.size);
+    return true;
+  }
+  const header = await readLogFileRaw(device, file.id, 0, LOG_HEADER_SIZE);
+  return index.learn(file.id, file.size, header);
+}
+
+/**
+ * Reads and decodes only the part of a file holding samples at or after 'since'
+ * (and at or before 'until', when given)
+ * @param {Object} device - Connected PowermonDevice
+ * @param {Object} index - LogIndex for the device
+ * @param {Object} file - { id, size } from the file list
+ * @param {number} since - Unix timestamp of the first sample wanted
+ * @param {number} [until] - Unix timestamp of the last sample wanted
+ * @returns {Promise<Object>} { success, startTime, samples, bytesRead }
+ */
+async function readLogFileSince(device, index, file, since, until) {
+  if (!(await ensureIndexed(device, index, file))) {
+    throw new Error(`Log file ${file.id} has an invalid header`);
+  }
+
+  const range = until !== undefined ? index.locate(file.id, since, until) : index.locate(file.id, since);
+  if (!range) {
+    return { success: true, startTime: since, samples: [], bytesRead: 0 };
+  }
+
+  const rawData = await readLogFileRaw(device, file.id, range.offset, range.size);
+  const decoded = index.decodeRange(file.id, range, rawData);
+  return { ...decoded, bytesRead: rawData.length };
+}
+
+/**
+ * Converts a byte offset reached by a previous sync into the time of the first
+ * record that was not fully contained before it, i.e. the one straddling the
+ * offset when it falls mid-record
+ * @param {Object} entry - LogIndex entry for the file
+ * @param {number} offset - Byte offset
+ * @returns {number} Unix timestamp
+ */
+function offsetToTime(entry, offset) {
+  const bits = offset * 8 - LOG_HEADER_SIZE * 8;
+  const sample = Math.max(0, Math.floor(bits / entry.sampleBits));
+  return entry.startTime + sample * entry.samplePeriod;
+}
+
+/**
+ * Determines which log files hold samples at or after a timestamp. File IDs are
+ * the time of their first sample, so a file ends where the next one begins.
+ * @param {Array} files - Array of log files from device
+ * @param {number} sinceTimestamp - Unix timestamp to sync from
+ * @param {number} [untilTimestamp] - Unix timestamp to sync up to (inclusive)
+ * @returns {Array} [{ file, offset, since }] in file order
+ */
+function getFilesSince(files, sinceTimestamp, untilTimestamp = Infinity) {
+  const sorted = [...files].sort((a, b) => a.id - b.id);
+  const plan = [];
+
+  for (let i = 0; i < sorted.length; i++) {
+    const file = sorted[i];
+    const next = sorted[i + 1];
+    if (next && next.id <= sinceTimestamp) {
+      continue;
+    }
+    if (file.id > untilTimestamp) {
+      break;
+    }
+    plan.push({ file, offset: 0, since: file.id < sinceTimestamp ? sinceTimestamp : 0 });
+  }
+
+  return plan;
+}
+
 /**
  * Main sync function - syncs log data from a connected device
  * 
@@ -141,14 +248,16 @@ function decodeLogData(data) {
  * @param {string} deviceSerial - Device serial number
  * @param {Object|null} state - Previous sync state (null for first sync)
  * @param {Function} onProgress - Optional progress callback
- * @returns {Promise<Object>} SyncResult with samples and new state
+ * @param {Object} options - { since, until: Unix timestamps } to sync a time range instead of resuming state
+ * @returns {Promise<Object>} SyncResult with samples, per-file segments and new state
  */
-async function syncDeviceLogs(device, deviceSerial, state, onProgress) {
+async function syncDeviceLogs(device, deviceSerial, state, onProgress, options = {}) {
   const progress = {
     phase: 'listing',
     filesTotal: 0,
     filesCompleted: 0,
     samplesRetrieved: 0,
+    bytesRead: 0,
     message: null
   };
 
@@ -157,57 +266,109 @@ async function syncDeviceLogs(device, deviceSerial, state, onProgress) {
     if (onProgress) onProgress(progress);
   };
 
+  const index = getLogIndex(deviceSerial);
+
   try {
     // Get file list
     report({ phase: 'listing', message: 'Getting log file list...' });
     const files = await getLogFileList(device);
 
     // Determine what needs syncing
-    const { filesToSync, startOffset } = getFilesToSync(files, state);
+    let plan;
+    if (options.since !== undefined) {
+      plan = getFilesSince(files, options.since, options.until);
+    } else {
+      const { filesToSync, startOffset } = getFilesToSync(files, state);
+      const resumeTime = state?.lastSampleTime ? state.lastSampleTime + 1 : 0;
+      plan = filesToSync.map((file, i) => {
+        const resuming = i === 0 && startOffset > 0;
+        return { file, offset: resuming ? startOffset : 0, since: resuming ? resumeTime : 0 };
+      });
+    }
     
-    progress.filesTotal = filesToSync.length;
-    report({ phase: 'reading', message: `${filesToSync.length} files to sync` });
+    progress.filesTotal = plan.length;
+    report({ phase: 'reading', message: `${plan.length} files to sync` });
 
-    if (filesToSync.length === 0) {
+    if (plan.length === 0) {
       report({ phase: 'complete', message: 'Already up to date' });
       return {
         success: true,
         filesProcessed: 0,
         samplesRetrieved: 0,
         samples: [],
+        segments: [],
         newState: state || createInitialState(deviceSerial)
       };
     }
 
     const allSamples = [];
+    const segments = []; // { fileId, samplePeriod, start, count } slices of allSamples
+    const until = options.until;
     let lastFileId = state?.lastFileId || 0;
     let lastFileOffset = 0;
+    let lastSampleTime = state?.lastSampleTime || 0;
 
     // Process each file
-    for (let i = 0; i < filesToSync.length; i++) {
-      const file = filesToSync[i];
-      const offset = (i === 0) ? startOffset : 0;
-      const bytesToRead = file.size - offset;
+    for (let i = 0; i < plan.length; i++) {
+      const { file, offset } = plan[i];
+      let since = plan[i].since;
       
       report({ 
         phase: 'reading',
         filesCompleted: i,
-        message: `Reading file ${i + 1}/${filesToSync.length} (${bytesToRead} bytes)`
+        message: `Reading file ${i + 1}/${plan.length}`
       });
 
       try {
-        // Read the file data
-        const rawData = await readLogFileRaw(device, file.id, offset, bytesToRead);
+        let decoded;
+        let readOffset = offset;
+
+        if (index && since === 0 && offset > 0) {
+          // Resume: map the offset to a time through the file's header
+          const entry = (await ensureIndexed(device, index, file)) ? index.getEntry(file.id) : null;
+          if (entry) {
+            since = offsetToTime(entry, offset);
+          } else {
+            // No usable header to seek with: read the whole file again
+            readOffset = 0;
+          }
+        }
 
-        report({ phase: 'decoding', message: `Decoding ${rawData.length} bytes...` });
+        if (index && (since > 0 || until !== undefined)) {
+          // Partial file: seek to the first wanted record using the index
+          decoded = await readLogFileSince(device, index, file, since, until);
+          progress.bytesRead += decoded.bytesRead;
+        } else {
+          // Read the file data
+          const rawData = await readLogFileRaw(device, file.id, readOffset, file.size - readOffset);
+          progress.bytesRead += rawData.length;
 
-        // Decode the samples
-        const decoded = decodeLogData(rawData);
+          if (index && readOffset === 0) {
+            index.learn(file.id, file.size, rawData.subarray(0, LOG_HEADER_SIZE));
+          }
+
+          report({ phase: 'decoding', message: `Decoding ${rawData.length} bytes...` });
+
+          // Decode the samples
+          decoded = decodeLogData(rawData);
+          if (since > 0 || until !== undefined) {
+            decoded.samples = decoded.samples.filter(sample =>
+              sample.time >= since && (until === undefined || sample.time <= until));
+          }
+        }
         
         if (decoded.success && decoded.samples.length > 0) {
+          const entry = index ? index.getEntry(file.id) : null;
+          segments.push({
+            fileId: file.id,
+            samplePeriod: entry ? entry.samplePeriod : null,
+            start: allSamples.length,
+            count: decoded.samples.length
+          });
           allSamples.push(...decoded.samples);
           lastFileId = file.id;
           lastFileOffset = file.size;
+          lastSampleTime = decoded.samples[decoded.samples.length - 1].time;
           
           report({
             samplesRetrieved: allSamples.length,
@@ -225,21 +386,24 @@ async function syncDeviceLogs(device, deviceSerial, state, onProgress) {
       lastSyncTime: Date.now(),
       lastFileId,
       lastFileOffset,
+      lastSampleTime,
       totalSamplesSynced: (state?.totalSamplesSynced || 0) + allSamples.length
     };
 
     report({ 
       phase: 'complete',
-      filesCompleted: filesToSync.length,
+      filesCompleted: plan.length,
       samplesRetrieved: allSamples.length,
-      message: `Synced ${allSamples.length} samples from ${filesToSync.length} files`
+      message: `Synced ${allSamples.length} samples from ${plan.length} files (${progress.bytesRead} bytes)`
     });
 
     return {
       success: true,
-      filesProcessed: filesToSync.length,
+      filesProcessed: plan.length,
       samplesRetrieved: allSamples.length,
+      bytesRead: progress.bytesRead,
       samples: allSamples,
+      segments,
       newState
     };
 
@@ -252,6 +416,7 @@ async function syncDeviceLogs(device, deviceSerial, state, onProgress) {
       filesProcessed: 0,
       samplesRetrieved: 0,
       samples: [],
+      segments: [],
       newState: state || createInitialState(deviceSerial)
     };
   }
@@ -259,6 +424,9 @@ async function syncDeviceLogs(device, deviceSerial, state, onProgress) {
 
 /**
  * Helper to sync only new data since a specific timestamp
+ * 
+ * Files that end before the timestamp are skipped, and the file that spans it is
+ * read from the first record at or after the timestamp using the device's log index.
  * @param {Object} device - Connected PowermonDevice
  * @param {string} deviceSerial - Device serial
  * @param {number} sinceTimestamp - Unix timestamp to sync from
@@ -266,25 +434,39 @@ async function syncDeviceLogs(device, deviceSerial, state, onProgress) {
  * @returns {Promise<Object>}
  */
 async function syncSince(device, deviceSerial, sinceTimestamp, onProgress) {
-  // Create a synthetic state that starts from the given timestamp
-  const state = {
-    deviceSerial,
-    lastSyncTime: sinceTimestamp * 1000,
-    lastFileId: sinceTimestamp,
-    lastFileOffset: 0,
-    totalSamplesSynced: 0
-  };
-  
-  return syncDeviceLogs(device, deviceSerial, state, onProgress);
+  return syncDeviceLogs(device, deviceSerial, null, onProgress, { since: sinceTimestamp });
+}
+
+/**
+ * Helper to sync only the samples inside a time range, e.g. a coverage gap
+ * 
+ * Only the files overlapping the range are touched, and with a log index only
+ * the bytes holding [sinceTimestamp, untilTimestamp] are read.
+ * @param {Object} device - Connected PowermonDevice
+ * @param {string} deviceSerial - Device serial
+ * @param {number} sinceTimestamp - Unix timestamp of the first sample wanted
+ * @param {number} untilTimestamp - Unix timestamp of the last sample wanted
+ * @param {Function} onProgress - Progress callback
+ * @returns {Promise<Object>}
+ */
+async function syncRange(device, deviceSerial, sinceTimestamp, untilTimestamp, onProgress) {
+  return syncDeviceLogs(device, deviceSerial, null, onProgress, {
+    since: sinceTimestamp,
+    until: untilTimestamp
+  });
 }
 
 module.exports = {
   createInitialState,
+  getLogIndex,
   getFilesToSync,
+  getFilesSince,
   estimateLogTimeRange,
   getLogFileList,
   readLogFileRaw,
   decodeLogData,
+  readLogFileSince,
   syncDeviceLogs,
-  syncSince
+  syncSince,
+  syncRange
 };
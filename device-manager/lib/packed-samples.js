@@ -0,0 +1,185 @@
+/**
+ * PowerMon Packed Samples
+ *
+ * Decode-on-read view over the compact sample encoding produced by the
+ * addon (decodeLogData(data, { packed: true }), LogIndex.decodeRange(...,
+ * { packed: true }), packSamples()). Samples stay in a single ArrayBuffer of
+ * 20-byte records; values are only materialized when read.
+ *
+ * Record layout (little endian, see src/packed_samples.h):
+ *   0  uint16 dt           seconds since the previous sample (0 at an anchor)
+ *   2  uint16 voltage1     mV, low 16 bits
+ *   4  uint16 voltage2     mV, low 16 bits
+ *   6  int16  temperature  0.01 C
+ *   8  int32  current      mA
+ *   12 int32  power        mW
+ *   16 uint8  soc
+ *   17 uint8  powerStatus
+ *   18 uint8  voltage1Hi   mV, bits 16-23
+ *   19 uint8  voltage2Hi   mV, bits 16-23
+ *
+ * A voltage of 0xFFFFFF marks a channel the log does not record and reads as
+ * NaN, as in decodeLogData() samples.
+ */
+
+const RECORD_SIZE = 20;
+const VOLTAGE_ABSENT = 0xFFFFFF;
+
+function voltage(lo, hi) {
+  const mv = lo + hi * 65536;
+  return mv === VOLTAGE_ABSENT ? NaN : mv / 1000;
+}
+
+class PackedSamples {
+  /**
+   * @param {Object} packed - { count, records: ArrayBuffer, anchors: Uint32Array }
+   */
+  constructor(packed) {
+    this.packed = packed;
+    this.length = packed.count;
+    this.anchors = packed.anchors;
+
+    const buffer = packed.records;
+    this.u16 = new Uint16Array(buffer, 0, this.length * (RECORD_SIZE / 2));
+    this.i16 = new Int16Array(buffer, 0, this.length * (RECORD_SIZE / 2));
+    this.i32 = new Int32Array(buffer, 0, this.length * (RECORD_SIZE / 4));
+    this.u8 = new Uint8Array(buffer, 0, this.length * RECORD_SIZE);
+  }
+
+  /**
+   * Bytes held by the encoded records and anchors
+   * @returns {number}
+   */
+  get byteLength() {
+    return this.length * RECORD_SIZE + this.anchors.byteLength;
+  }
+
+  /**
+   * Time (Unix seconds) of sample i
+   * @param {number} i
+   * @returns {number}
+   */
+  time(i) {
+    // Last anchor at or before i
+    let lo = 0;
+    let hi = this.anchors.length / 2 - 1;
+    while (lo < hi) {
+      const mid = (lo + hi + 1) >> 1;
+      if (this.anchors[mid * 2] <= i) {
+        lo = mid;
+      } else {
+        hi = mid - 1;
+      }
+    }
+
+    let time = this.anchors[lo * 2 + 1];
+    for (let j = this.anchors[lo * 2] + 1; j <= i; j++) {
+      time += this.u16[j * 10];
+    }
+    return time;
+  }
+
+  /**
+   * Decodes sample i given its time
+   * @private
+   */
+  _decode(i, time) {
+    const h = i * 10;
+    const w = i * 5;
+    const b = i * RECORD_SIZE;
+    return {
+      time,
+      voltage1: voltage(this.u16[h + 1], this.u8[b + 18]),
+      voltage2: voltage(this.u16[h + 2], this.u8[b + 19]),
+      temperature: this.i16[h + 3] / 100,
+      current: this.i32[w + 2] / 1000,
+      power: this.i32[w + 3] / 1000,
+      soc: this.u8[b + 16],
+      powerStatus: this.u8[b + 17],
+    };
+  }
+
+  /**
+   * Sample i in the same shape as decodeLogData() samples
+   * @param {number} i
+   * @returns {Object}
+   */
+  get(i) {
+    return this._decode(i, this.time(i));
+  }
+
+  /**
+   * Iterates samples in order, tracking time without anchor lookups
+   */
+  *[Symbol.iterator]() {
+    let anchor = 0;
+    let time = 0;
+    for (let i = 0; i < this.length; i++) {
+      if (anchor < this.anchors.length && this.anchors[anchor] === i) {
+        time = this.anchors[anchor + 1];
+        anchor += 2;
+      } else {
+        time += this.u16[i * 10];
+      }
+      yield this._decode(i, time);
+    }
+  }
+
+  /**
+   * Materializes samples [start, start + count) as plain objects
+   * @param {number} [start=0]
+   * @param {number} [count]
+   * @returns {Array<Object>}
+   */
+  toArray(start = 0, count = this.length - start) {
+    const end = Math.min(this.length, start + count);
+    const out = [];
+    if (start >= end) {
+      return out;
+    }
+    let time = this.time(start);
+    out.push(this._decode(start, time));
+    for (let i = start + 1; i < end; i++) {
+      const dt = this.u16[i * 10];
+      time = dt === 0 ? this.time(i) : time + dt;
+      out.push(this._decode(i, time));
+    }
+    return out;
+  }
+
+  /**
+   * Decodes the series into typed-array columns (e.g. for integrateEnergy)
+   * @returns {{time: Float64Array, power: Float64Array, current: Float64Array,
+   *   voltage1: Float32Array, voltage2: Float32Array, temperature: Float32Array,
+   *   soc: Uint8Array, powerStatus: Uint8Array}}
+   */
+  columns() {
+    const n = this.length;
+    const cols = {
+      time: new Float64Array(n),
+      power: new Float64Array(n),
+      current: new Float64Array(n),
+      voltage1: new Float32Array(n),
+      voltage2: new Float32Array(n),
+      temperature: new Float32Array(n),
+      soc: new Uint8Array(n),
+      powerStatus: new Uint8Array(n),
+    };
+
+    let i = 0;
+    for (const s of this) {
+      cols.time[i] = s.time;
+      cols.power[i] = s.power;
+      cols.current[i] = s.current;
+      cols.voltage1[i] = s.voltage1;
+      cols.voltage2[i] = s.voltage2;
+      cols.temperature[i] = s.temperature;
+      cols.soc[i] = s.soc;
+      cols.powerStatus[i] = s.powerStatus;
+      i++;
+    }
+    return cols;
+  }
+}
+
+module.exports = { PackedSamples, RECORD_SIZE };
@@ -1,8 +1,21 @@
 #include <napi.h>
 #include "powermon_wrapper.h"
+#include "log_index_wrapper.h"
+#include "sample_merger_wrapper.h"
+#include "coverage_map_wrapper.h"
+#include "energy_wrapper.h"
+#include "packed_samples_wrapper.h"
+#include "poll_scheduler_wrapper.h"
 
 Napi::Object InitAll(Napi::Env env, Napi::Object exports) {
-    return PowermonWrapper::Init(env, exports);
+    PowermonWrapper::Init(env, exports);
+    LogIndexWrapper::Init(env, exports);
+    SampleMergerWrapper::Init(env, exports);
+    CoverageMapWrapper::Init(env, exports);
+    EnergyWrapper::Init(env, exports);
+    PackedSamplesWrapper::Init(env, exports);
+    PollSchedulerWrapper::Init(env, exports);
+    return exports;
 }
 
 NODE_API_MODULE(powermon_addon, InitAll)
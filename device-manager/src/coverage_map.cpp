@@ -0,0 +1,148 @@
+#include "coverage_map.h"
+
+#include <algorithm>
+
+CoverageMap::CoverageMap(int64_t slack_ms)
+    : slack_ms_(slack_ms) {
+}
+
+void CoverageMap::Insert(std::vector<Interval>& set, Interval interval) {
+    // Common case: new data extends or follows the newest range
+    if (set.empty() || interval.start > set.back().end + slack_ms_) {
+        set.push_back(interval);
+        return;
+    }
+    if (interval.start >= set.back().start) {
+        set.back().end = std::max(set.back().end, interval.end);
+        return;
+    }
+
+    // First range that ends close enough to touch the new one
+    auto first = std::lower_bound(set.begin(), set.end(), interval.start - slack_ms_,
+        [](const Interval& existing, int64_t t) { return existing.end < t; });
+    auto last = first;
+    while (last != set.end() && last->start <= interval.end + slack_ms_) {
+        interval.start = std::min(interval.start, last->start);
+        interval.end = std::max(interval.end, last->end);
+        ++last;
+    }
+
+    if (first == last) {
+        set.insert(first, interval);
+    } else {
+        *first = interval;
+        set.erase(first + 1, last);
+    }
+}
+
+void CoverageMap::AddRange(int64_t device_id, int64_t start_ms, int64_t end_ms) {
+    if (end_ms <= start_ms) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    Insert(devices_[device_id], { start_ms, end_ms });
+}
+
+void CoverageMap::AddPoints(int64_t device_id, const int64_t* times_ms, size_t count, int64_t period_ms) {
+    if (count == 0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<Interval>& set = devices_[device_id];
+
+    // Collapse runs of consecutive readings before touching the set
+    Interval run = { times_ms[0], times_ms[0] + period_ms };
+    for (size_t i = 1; i < count; i++) {
+        int64_t t = times_ms[i];
+        if (t >= run.start && t <= run.end + slack_ms_) {
+            run.end = std::max(run.end, t + period_ms);
+        } else {
+            Insert(set, run);
+            run = { t, t + period_ms };
+        }
+    }
+    Insert(set, run);
+}
+
+void CoverageMap::Gaps(int64_t device_id, int64_t from_ms, int64_t to_ms, int64_t min_gap_ms,
+                       std::vector<Interval>& out) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    int64_t cursor = from_ms;
+
+    auto it = devices_.find(device_id);
+    if (it != devices_.end()) {
+        const std::vector<Interval>& set = it->second;
+        auto iv = std::upper_bound(set.begin(), set.end(), from_ms,
+            [](int64_t t, const Interval& existing) { return t < existing.end; });
+
+        for (; iv != set.end() && iv->start < to_ms; ++iv) {
+            if (iv->start > cursor && iv->start - cursor >= min_gap_ms) {
+                out.push_back({ cursor, iv->start });
+            }
+            cursor = std::max(cursor, iv->end);
+        }
+    }
+
+    if (cursor < to_ms && to_ms - cursor >= min_gap_ms) {
+        out.push_back({ cursor, to_ms });
+    }
+}
+
+int64_t CoverageMap::Covered(int64_t device_id, int64_t from_ms, int64_t to_ms) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = devices_.find(device_id);
+    if (it == devices_.end()) {
+        return 0;
+    }
+
+    int64_t covered = 0;
+    const std::vector<Interval>& set = it->second;
+    auto iv = std::upper_bound(set.begin(), set.end(), from_ms,
+        [](int64_t t, const Interval& existing) { return t < existing.end; });
+    for (; iv != set.end() && iv->start < to_ms; ++iv) {
+        covered += std::min(iv->end, to_ms) - std::max(iv->start, from_ms);
+    }
+    return covered;
+}
+
+void CoverageMap::Intervals(int64_t device_id, std::vector<Interval>& out) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = devices_.find(device_id);
+    if (it != devices_.end()) {
+        out.insert(out.end(), it->second.begin(), it->second.end());
+    }
+}
+
+void CoverageMap::Trim(int64_t before_ms) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = devices_.begin(); it != devices_.end();) {
+        std::vector<Interval>& set = it->second;
+        set.erase(set.begin(), std::lower_bound(set.begin(), set.end(), before_ms,
+            [](const Interval& existing, int64_t t) { return existing.end < t; }));
+        if (set.empty()) {
+            it = devices_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void CoverageMap::RemoveDevice(int64_t device_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    devices_.erase(device_id);
+}
+
+size_t CoverageMap::DeviceCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return devices_.size();
+}
+
+size_t CoverageMap::IntervalCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t count = 0;
+    for (const auto& it : devices_) {
+        count += it.second.size();
+    }
+    return count;
+}
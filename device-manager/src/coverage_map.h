@@ -0,0 +1,50 @@
+#ifndef COVERAGE_MAP_H
+#define COVERAGE_MAP_H
+
+#include <stdint.h>
+
+#include <map>
+#include <mutex>
+#include <vector>
+
+// Per-device set of time ranges for which data is known to exist, built from
+// poll timestamps and decoded log sample times. A reading at time t covers
+// [t, t + period), where period is the poll interval or the log file's sample
+// period; ranges closer than slack_ms are joined so poll jitter does not
+// fragment the set. Gaps() returns what is left uncovered in a window, which is
+// exactly what a backfill needs to fetch.
+class CoverageMap {
+public:
+    struct Interval {
+        int64_t start;    // inclusive, ms
+        int64_t end;      // exclusive, ms
+    };
+
+    explicit CoverageMap(int64_t slack_ms);
+
+    void AddRange(int64_t device_id, int64_t start_ms, int64_t end_ms);
+    void AddPoints(int64_t device_id, const int64_t* times_ms, size_t count, int64_t period_ms);
+
+    // Uncovered parts of [from_ms, to_ms), skipping gaps shorter than min_gap_ms
+    void Gaps(int64_t device_id, int64_t from_ms, int64_t to_ms, int64_t min_gap_ms,
+              std::vector<Interval>& out) const;
+    int64_t Covered(int64_t device_id, int64_t from_ms, int64_t to_ms) const;
+    void Intervals(int64_t device_id, std::vector<Interval>& out) const;
+
+    // Drops coverage that ends before before_ms on every device
+    void Trim(int64_t before_ms);
+    void RemoveDevice(int64_t device_id);
+
+    size_t DeviceCount() const;
+    size_t IntervalCount() const;
+
+private:
+    int64_t slack_ms_;
+
+    mutable std::mutex mutex_;
+    std::map<int64_t, std::vector<Interval>> devices_;
+
+    void Insert(std::vector<Interval>& set, Interval interval);
+};
+
+#endif
@@ -0,0 +1,241 @@
+#include "coverage_map_wrapper.h"
+#include "packed_samples_wrapper.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const int64_t DEFAULT_SLACK_MS = 2000;
+
+// Accepts a Date or a number of milliseconds
+bool ReadTime(Napi::Value value, int64_t& time_ms) {
+    if (value.IsDate()) {
+        time_ms = static_cast<int64_t>(value.As<Napi::Date>().ValueOf());
+        return true;
+    }
+    if (value.IsNumber()) {
+        time_ms = value.As<Napi::Number>().Int64Value();
+        return true;
+    }
+    return false;
+}
+
+// A sample index or count: a non-negative integer, undefined for the default
+bool ReadIndex(const Napi::CallbackInfo& info, size_t index, uint32_t fallback, uint32_t& out) {
+    if (info.Length() <= index || info[index].IsUndefined()) {
+        out = fallback;
+        return true;
+    }
+    if (!info[index].IsNumber()) {
+        return false;
+    }
+    const double number = info[index].As<Napi::Number>().DoubleValue();
+    if (!(number >= 0 && number <= UINT32_MAX) || number != std::floor(number)) {
+        return false;
+    }
+    out = static_cast<uint32_t>(number);
+    return true;
+}
+
+}
+
+Napi::Object CoverageMapWrapper::Init(Napi::Env env, Napi::Object exports) {
+    Napi::Function func = DefineClass(env, "CoverageMap", {
+        InstanceMethod("addPoll", &CoverageMapWrapper::AddPoll),
+        InstanceMethod("addRange", &CoverageMapWrapper::AddRange),
+        InstanceMethod("addLogSamples", &CoverageMapWrapper::AddLogSamples),
+        InstanceMethod("gaps", &CoverageMapWrapper::Gaps),
+        InstanceMethod("covered", &CoverageMapWrapper::Covered),
+        InstanceMethod("intervals", &CoverageMapWrapper::GetIntervals),
+        InstanceMethod("trim", &CoverageMapWrapper::Trim),
+        InstanceMethod("removeDevice", &CoverageMapWrapper::RemoveDevice),
+        InstanceMethod("stats", &CoverageMapWrapper::GetStats),
+    });
+
+    exports.Set("CoverageMap", func);
+    return exports;
+}
+
+CoverageMapWrapper::CoverageMapWrapper(const Napi::CallbackInfo& info)
+    : Napi::ObjectWrap<CoverageMapWrapper>(info) {
+    int64_t slack_ms = DEFAULT_SLACK_MS;
+
+    if (info.Length() > 0 && info[0].IsObject()) {
+        Napi::Value slack = info[0].As<Napi::Object>().Get("slackMs");
+        if (slack.IsNumber()) {
+            slack_ms = slack.As<Napi::Number>().Int64Value();
+        }
+    }
+
+    map_.reset(new CoverageMap(slack_ms));
+}
+
+Napi::Array CoverageMapWrapper::IntervalsToArray(Napi::Env env, const std::vector<CoverageMap::Interval>& intervals) {
+    Napi::Array arr = Napi::Array::New(env, intervals.size());
+    for (size_t i = 0; i < intervals.size(); i++) {
+        Napi::Object obj = Napi::Object::New(env);
+        obj.Set("start", Napi::Number::New(env, static_cast<double>(intervals[i].start)));
+        obj.Set("end", Napi::Number::New(env, static_cast<double>(intervals[i].end)));
+        arr.Set(i, obj);
+    }
+    return arr;
+}
+
+Napi::Value CoverageMapWrapper::AddPoll(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    int64_t time_ms;
+    if (info.Length() < 3 || !info[0].IsNumber() || !ReadTime(info[1], time_ms) || !info[2].IsNumber()) {
+        Napi::TypeError::New(env, "deviceId, time and periodMs expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    map_->AddPoints(info[0].As<Napi::Number>().Int64Value(), &time_ms, 1,
+                    info[2].As<Napi::Number>().Int64Value());
+    return env.Undefined();
+}
+
+Napi::Value CoverageMapWrapper::AddRange(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    int64_t start_ms, end_ms;
+    if (info.Length() < 3 || !info[0].IsNumber() || !ReadTime(info[1], start_ms) || !ReadTime(info[2], end_ms)) {
+        Napi::TypeError::New(env, "deviceId, start and end expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    map_->AddRange(info[0].As<Napi::Number>().Int64Value(), start_ms, end_ms);
+    return env.Undefined();
+}
+
+Napi::Value CoverageMapWrapper::AddLogSamples(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    bool packed = info.Length() > 1 && PackedSamplesWrapper::IsPacked(info[1]);
+    if (info.Length() < 3 || !info[0].IsNumber() || !(packed || info[1].IsArray()) || !info[2].IsNumber()) {
+        Napi::TypeError::New(env, "deviceId, samples array and periodMs expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    int64_t period_ms = info[2].As<Napi::Number>().Int64Value();
+
+    std::vector<PowermonLogFile::Sample> decoded;
+    Napi::Array samples;
+    uint32_t start = 0;
+    uint32_t end;
+    if (packed) {
+        PackedSamplesWrapper::ReadSamples(info[1], decoded);
+        end = static_cast<uint32_t>(decoded.size());
+    } else {
+        samples = info[1].As<Napi::Array>();
+        end = samples.Length();
+    }
+    uint32_t count;
+    if (!ReadIndex(info, 3, 0, start) || !ReadIndex(info, 4, end, count)) {
+        Napi::RangeError::New(env, "start and count must be non-negative integers").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    start = std::min(start, end);
+    end = start + std::min(count, end - start);
+
+    // Log sample times are Unix seconds
+    std::vector<int64_t> times;
+    times.reserve(end - start);
+    for (uint32_t i = start; i < end; i++) {
+        if (packed) {
+            times.push_back(static_cast<int64_t>(decoded[i].time) * 1000);
+            continue;
+        }
+        Napi::Value sample = samples.Get(i);
+        if (!sample.IsObject()) {
+            continue;
+        }
+        Napi::Value time = sample.As<Napi::Object>().Get("time");
+        if (time.IsNumber()) {
+            times.push_back(static_cast<int64_t>(time.As<Napi::Number>().DoubleValue() * 1000.0));
+        }
+    }
+
+    map_->AddPoints(info[0].As<Napi::Number>().Int64Value(), times.data(), times.size(), period_ms);
+    return Napi::Number::New(env, static_cast<double>(times.size()));
+}
+
+Napi::Value CoverageMapWrapper::Gaps(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    int64_t from_ms, to_ms;
+    if (info.Length() < 3 || !info[0].IsNumber() || !ReadTime(info[1], from_ms) || !ReadTime(info[2], to_ms)) {
+        Napi::TypeError::New(env, "deviceId, from and to expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    int64_t min_gap_ms = 0;
+    if (info.Length() > 3 && info[3].IsNumber()) {
+        min_gap_ms = info[3].As<Napi::Number>().Int64Value();
+    }
+
+    std::vector<CoverageMap::Interval> gaps;
+    map_->Gaps(info[0].As<Napi::Number>().Int64Value(), from_ms, to_ms, min_gap_ms, gaps);
+    return IntervalsToArray(env, gaps);
+}
+
+Napi::Value CoverageMapWrapper::Covered(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    int64_t from_ms, to_ms;
+    if (info.Length() < 3 || !info[0].IsNumber() || !ReadTime(info[1], from_ms) || !ReadTime(info[2], to_ms)) {
+        Napi::TypeError::New(env, "deviceId, from and to expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    int64_t covered = map_->Covered(info[0].As<Napi::Number>().Int64Value(), from_ms, to_ms);
+    return Napi::Number::New(env, static_cast<double>(covered));
+}
+
+Napi::Value CoverageMapWrapper::GetIntervals(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsNumber()) {
+        Napi::TypeError::New(env, "deviceId expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    std::vector<CoverageMap::Interval> intervals;
+    map_->Intervals(info[0].As<Napi::Number>().Int64Value(), intervals);
+    return IntervalsToArray(env, intervals);
+}
+
+Napi::Value CoverageMapWrapper::Trim(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    int64_t before_ms;
+    if (info.Length() < 1 || !ReadTime(info[0], before_ms)) {
+        Napi::TypeError::New(env, "Cutoff time expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    map_->Trim(before_ms);
+    return env.Undefined();
+}
+
+Napi::Value CoverageMapWrapper::RemoveDevice(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsNumber()) {
+        Napi::TypeError::New(env, "deviceId expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    map_->RemoveDevice(info[0].As<Napi::Number>().Int64Value());
+    return env.Undefined();
+}
+
+Napi::Value CoverageMapWrapper::GetStats(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    Napi::Object obj = Napi::Object::New(env);
+    obj.Set("devices", Napi::Number::New(env, static_cast<double>(map_->DeviceCount())));
+    obj.Set("intervals", Napi::Number::New(env, static_cast<double>(map_->IntervalCount())));
+    return obj;
+}
@@ -0,0 +1,31 @@
+#ifndef COVERAGE_MAP_WRAPPER_H
+#define COVERAGE_MAP_WRAPPER_H
+
+#include <napi.h>
+
+#include <memory>
+
+#include "coverage_map.h"
+
+class CoverageMapWrapper : public Napi::ObjectWrap<CoverageMapWrapper> {
+public:
+    static Napi::Object Init(Napi::Env env, Napi::Object exports);
+    CoverageMapWrapper(const Napi::CallbackInfo& info);
+
+    Napi::Value AddPoll(const Napi::CallbackInfo& info);
+    Napi::Value AddRange(const Napi::CallbackInfo& info);
+    Napi::Value AddLogSamples(const Napi::CallbackInfo& info);
+    Napi::Value Gaps(const Napi::CallbackInfo& info);
+    Napi::Value Covered(const Napi::CallbackInfo& info);
+    Napi::Value GetIntervals(const Napi::CallbackInfo& info);
+    Napi::Value Trim(const Napi::CallbackInfo& info);
+    Napi::Value RemoveDevice(const Napi::CallbackInfo& info);
+    Napi::Value GetStats(const Napi::CallbackInfo& info);
+
+private:
+    std::unique_ptr<CoverageMap> map_;
+
+    static Napi::Array IntervalsToArray(Napi::Env env, const std::vector<CoverageMap::Interval>& intervals);
+};
+
+#endif
@@ -0,0 +1,57 @@
+#include "device_timer.h"
+
+#include <algorithm>
+#include <thread>
+
+DeviceTimer& DeviceTimer::Instance() {
+    static DeviceTimer* timer = new DeviceTimer();
+    return *timer;
+}
+
+DeviceTimer::DeviceTimer() {
+    std::thread([this]() { Run(); }).detach();
+}
+
+void DeviceTimer::Add(double delay_ms, std::function<void()> fn) {
+    auto due = std::chrono::steady_clock::now() +
+        std::chrono::microseconds(static_cast<int64_t>(std::max(0.0, delay_ms) * 1000.0));
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push({ due, seq_++, std::move(fn) });
+    }
+    cv_.notify_one();
+}
+
+void DeviceTimer::Add(const std::shared_ptr<Token>& token, double delay_ms, std::function<void()> fn) {
+    Add(delay_ms, [token, fn]() {
+        std::lock_guard<std::recursive_mutex> lock(token->mutex);
+        if (token->alive) {
+            fn();
+        }
+    });
+}
+
+void DeviceTimer::Revoke(const std::shared_ptr<Token>& token) {
+    std::lock_guard<std::recursive_mutex> lock(token->mutex);
+    token->alive = false;
+}
+
+void DeviceTimer::Run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        if (tasks_.empty()) {
+            cv_.wait(lock);
+            continue;
+        }
+        auto due = tasks_.top().due;
+        if (std::chrono::steady_clock::now() < due) {
+            cv_.wait_until(lock, due);
+            continue;
+        }
+        std::function<void()> fn = std::move(const_cast<Task&>(tasks_.top()).fn);
+        tasks_.pop();
+        lock.unlock();
+        fn();
+        lock.lock();
+    }
+}
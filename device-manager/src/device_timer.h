@@ -0,0 +1,57 @@
+#ifndef DEVICE_TIMER_H
+#define DEVICE_TIMER_H
+
+#include <stdint.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <vector>
+
+// One thread runs the callbacks of every in-process device (FakePowermon,
+// ReplayPowermon), like the vendor library's worker thread. Leaked on purpose:
+// callbacks can still be queued at exit.
+class DeviceTimer {
+public:
+    // Outlives its device so queued callbacks can tell it has been deleted.
+    // Callbacks run with the mutex held; the device's destructor takes it to
+    // clear alive, so no callback runs during or after destruction.
+    struct Token {
+        std::recursive_mutex mutex;
+        bool alive = true;
+    };
+
+    static DeviceTimer& Instance();
+
+    void Add(double delay_ms, std::function<void()> fn);
+
+    // Runs fn after delay_ms unless Revoke(token) has been called by then
+    void Add(const std::shared_ptr<Token>& token, double delay_ms, std::function<void()> fn);
+    static void Revoke(const std::shared_ptr<Token>& token);
+
+private:
+    struct Task {
+        std::chrono::steady_clock::time_point due;
+        uint64_t seq;
+        std::function<void()> fn;
+    };
+
+    struct Later {
+        bool operator()(const Task& a, const Task& b) const {
+            return a.due > b.due || (a.due == b.due && a.seq > b.seq);
+        }
+    };
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::priority_queue<Task, std::vector<Task>, Later> tasks_;
+    uint64_t seq_ = 0;
+
+    DeviceTimer();
+    void Run();
+};
+
+#endif
@@ -0,0 +1,271 @@
+#include "device_trace.h"
+
+#include <errno.h>
+
+namespace DeviceTrace {
+
+namespace {
+
+const size_t BUFFER_SIZE = 64 * 1024;
+
+void PutU32(uint32_t value, std::vector<uint8_t>& out) {
+    for (int i = 0; i < 4; i++) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+void PutU64(uint64_t value, std::vector<uint8_t>& out) {
+    for (int i = 0; i < 8; i++) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+void PutVarint(uint64_t value, std::vector<uint8_t>& out) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+void PutBytes(const std::vector<uint8_t>& bytes, std::vector<uint8_t>& out) {
+    PutVarint(bytes.size(), out);
+    out.insert(out.end(), bytes.begin(), bytes.end());
+}
+
+// Bounds-checked reads over a byte range
+class Cursor {
+public:
+    Cursor(const uint8_t* data, size_t size) : data_(data), size_(size), pos_(0) {}
+
+    bool AtEnd() const { return pos_ == size_; }
+
+    bool U8(uint8_t& value) {
+        if (pos_ >= size_) return false;
+        value = data_[pos_++];
+        return true;
+    }
+
+    bool U16(uint16_t& value) {
+        uint64_t v;
+        if (!Fixed(2, v)) return false;
+        value = static_cast<uint16_t>(v);
+        return true;
+    }
+
+    bool U64(uint64_t& value) {
+        return Fixed(8, value);
+    }
+
+    bool Varint(uint64_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t byte;
+            if (!U8(byte)) return false;
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) return true;
+        }
+        return false;
+    }
+
+    bool Bytes(size_t count, uint8_t* out) {
+        if (size_ - pos_ < count) return false;
+        memcpy(out, data_ + pos_, count);
+        pos_ += count;
+        return true;
+    }
+
+    bool Blob(std::vector<uint8_t>& out) {
+        uint64_t count;
+        if (!Varint(count) || size_ - pos_ < count) return false;
+        out.assign(data_ + pos_, data_ + pos_ + count);
+        pos_ += count;
+        return true;
+    }
+
+private:
+    const uint8_t* data_;
+    size_t size_;
+    size_t pos_;
+
+    bool Fixed(int bytes, uint64_t& value) {
+        if (size_ - pos_ < static_cast<size_t>(bytes)) return false;
+        value = 0;
+        for (int i = 0; i < bytes; i++) {
+            value |= static_cast<uint64_t>(data_[pos_++]) << (8 * i);
+        }
+        return true;
+    }
+};
+
+}
+
+std::vector<uint8_t> Key(uint32_t a, uint32_t b) {
+    std::vector<uint8_t> key;
+    PutU32(a, key);
+    PutU32(b, key);
+    return key;
+}
+
+std::vector<uint8_t> Key(uint32_t a, uint32_t b, uint32_t c) {
+    std::vector<uint8_t> key = Key(a, b);
+    PutU32(c, key);
+    return key;
+}
+
+void Encode(const Powermon::DeviceInfo& info, std::vector<uint8_t>& out) {
+    PutVarint(info.name.size(), out);
+    out.insert(out.end(), info.name.begin(), info.name.end());
+    out.push_back(static_cast<uint8_t>(info.firmware_version_bcd));
+    out.push_back(static_cast<uint8_t>(info.firmware_version_bcd >> 8));
+    out.push_back(info.hardware_revision_bcd);
+    PutU64(info.address, out);
+    PutU64(info.serial, out);
+    out.push_back(info.ssid_length);
+    out.insert(out.end(), info.ssid, info.ssid + MAX_WIFI_SSID_SIZE);
+    out.push_back(info.flags);
+    out.push_back(static_cast<uint8_t>(info.timezone));
+}
+
+bool Decode(const std::vector<uint8_t>& in, Powermon::DeviceInfo& info) {
+    Cursor cursor(in.data(), in.size());
+    std::vector<uint8_t> name;
+    uint8_t timezone;
+    if (!cursor.Blob(name) ||
+        !cursor.U16(info.firmware_version_bcd) ||
+        !cursor.U8(info.hardware_revision_bcd) ||
+        !cursor.U64(info.address) ||
+        !cursor.U64(info.serial) ||
+        !cursor.U8(info.ssid_length) ||
+        !cursor.Bytes(MAX_WIFI_SSID_SIZE, info.ssid) ||
+        !cursor.U8(info.flags) ||
+        !cursor.U8(timezone) ||
+        !cursor.AtEnd()) {
+        return false;
+    }
+    info.name.assign(name.begin(), name.end());
+    info.timezone = static_cast<int8_t>(timezone);
+    return true;
+}
+
+Writer::Writer() : file_(nullptr) {
+}
+
+Writer::~Writer() {
+    Close();
+}
+
+bool Writer::Open(const std::string& path, std::string* error) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (file_ != nullptr) {
+        if (error) *error = "Trace already open";
+        return false;
+    }
+
+    file_ = fopen(path.c_str(), "wb");
+    if (file_ == nullptr) {
+        if (error) *error = "Cannot create " + path + ": " + strerror(errno);
+        return false;
+    }
+
+    start_ = std::chrono::steady_clock::now();
+    uint64_t wall_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    buffer_.reserve(BUFFER_SIZE);
+    buffer_.insert(buffer_.end(), MAGIC, MAGIC + sizeof(MAGIC));
+    buffer_.push_back(VERSION);
+    buffer_.insert(buffer_.end(), 3, 0);
+    PutU64(wall_ms, buffer_);
+    FlushLocked();
+    return true;
+}
+
+void Writer::Close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (file_ == nullptr) {
+        return;
+    }
+    FlushLocked();
+    fclose(file_);
+    file_ = nullptr;
+}
+
+void Writer::Flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    FlushLocked();
+}
+
+uint64_t Writer::Now() const {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_).count();
+}
+
+void Writer::Write(const Record& record) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (file_ == nullptr) {
+        return;
+    }
+    buffer_.push_back(record.op);
+    buffer_.push_back(record.code);
+    PutVarint(record.at_us, buffer_);
+    PutVarint(record.latency_us, buffer_);
+    PutBytes(record.key, buffer_);
+    PutBytes(record.payload, buffer_);
+    if (buffer_.size() >= BUFFER_SIZE) {
+        FlushLocked();
+    }
+}
+
+void Writer::FlushLocked() {
+    if (file_ == nullptr || buffer_.empty()) {
+        return;
+    }
+    fwrite(buffer_.data(), 1, buffer_.size(), file_);
+    fflush(file_);
+    buffer_.clear();
+}
+
+bool Load(const std::string& path, std::vector<Record>& records, std::string* error) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        if (error) *error = "Cannot open " + path + ": " + strerror(errno);
+        return false;
+    }
+
+    std::vector<uint8_t> data;
+    uint8_t chunk[BUFFER_SIZE];
+    size_t count;
+    while ((count = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        data.insert(data.end(), chunk, chunk + count);
+    }
+    fclose(file);
+
+    if (data.size() < HEADER_SIZE || memcmp(data.data(), MAGIC, sizeof(MAGIC)) != 0) {
+        if (error) *error = path + " is not a device trace";
+        return false;
+    }
+    if (data[sizeof(MAGIC)] != VERSION) {
+        if (error) *error = path + ": unsupported trace version " + std::to_string(data[sizeof(MAGIC)]);
+        return false;
+    }
+
+    Cursor cursor(data.data() + HEADER_SIZE, data.size() - HEADER_SIZE);
+    while (!cursor.AtEnd()) {
+        Record record;
+        uint8_t op;
+        if (!cursor.U8(op) ||
+            !cursor.U8(record.code) ||
+            !cursor.Varint(record.at_us) ||
+            !cursor.Varint(record.latency_us) ||
+            !cursor.Blob(record.key) ||
+            !cursor.Blob(record.payload)) {
+            // A recording process killed mid-write leaves a partial last record
+            break;
+        }
+        record.op = static_cast<Op>(op);
+        records.push_back(std::move(record));
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,177 @@
+#ifndef DEVICE_TRACE_H
+#define DEVICE_TRACE_H
+
+#include <powermon.h>
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Binary trace of one device session: every request with its response code,
+// payload and latency, plus connects, unsolicited disconnects and pushed
+// monitor data, written by RecordingPowermon and played back by
+// ReplayPowermon.
+//
+// A file is a 16 byte header ("PMTR", version, 3 reserved bytes, wall clock
+// start in ms since the epoch, little endian) followed by records:
+//
+//   op (u8) code (u8) at_us (varint) latency_us (varint)
+//   key size (varint) key, payload size (varint) payload
+//
+// at_us is when the request was made (or the event happened) relative to the
+// start of the trace. The key holds the request arguments that select the
+// response (file id, offset and size of a log read) and is empty for requests
+// whose response does not depend on their arguments. Payloads are the response
+// structures' bytes as laid out by this build of the vendor headers;
+// DeviceInfo, which holds a std::string, is written field by field.
+namespace DeviceTrace {
+
+static const char MAGIC[4] = { 'P', 'M', 'T', 'R' };
+static const uint8_t VERSION = 1;
+static const size_t HEADER_SIZE = 16;
+
+enum Op : uint8_t {
+    // Connection events; code is the DisconnectReason where there is one
+    OP_CONNECT = 1,             // payload: isLocalConnection() (u8)
+    OP_CONNECT_FAILED,
+    OP_DISCONNECTED,            // not requested through disconnect()
+    OP_MONITOR_PUSH,            // payload: MonitorData
+
+    // Requests; code is the ResponseCode
+    OP_GET_INFO = 16,
+    OP_GET_MONITOR_DATA,
+    OP_GET_STATISTICS,
+    OP_GET_FG_STATISTICS,
+    OP_UNLOCK,
+    OP_SET_USER_PASSWORD_LOCK,
+    OP_SET_MASTER_PASSWORD_LOCK,
+    OP_CLEAR_USER_PASSWORD_LOCK,
+    OP_CLEAR_MASTER_PASSWORD_LOCK,
+    OP_GET_AUTH_KEY,
+    OP_RESET_AUTH_KEY,
+    OP_RESET_ENERGY_METER,
+    OP_RESET_COULOMB_METER,
+    OP_RESET_STATISTICS,
+    OP_SET_POWER_STATE,
+    OP_GET_CONFIG,
+    OP_SET_CONFIG,
+    OP_RESET_CONFIG,
+    OP_RENAME,
+    OP_SET_TIME,
+    OP_FG_SYNCHRONIZE,
+    OP_START_WIFI_SCAN,
+    OP_WIFI_CONFIGURE,
+    OP_GET_WIFI_NETWORKS,
+    OP_ADD_WIFI_NETWORK,
+    OP_REMOVE_WIFI_NETWORK,
+    OP_GET_ACCESS_KEYS,
+    OP_RESET_ACCESS_KEYS,
+    OP_ZERO_CURRENT_OFFSET,
+    OP_CALIBRATE_CURRENT,
+    OP_GET_SCHEDULES,
+    OP_ADD_SCHEDULES,
+    OP_UPDATE_SCHEDULE,
+    OP_DELETE_SCHEDULE,
+    OP_CLEAR_SCHEDULES,
+    OP_COMMIT_SCHEDULES,
+    OP_GET_LOG_FILE_LIST,
+    OP_READ_LOG_FILE,           // key: file id, offset, size (u32 each)
+    OP_CLEAR_LOG,
+    OP_UPDATE_FIRMWARE,
+    OP_READ_DEBUG,              // key: offset, size (u32 each)
+    OP_ERASE_DEBUG,
+    OP_REBOOT
+};
+
+struct Record {
+    Op op = OP_CONNECT;
+    uint8_t code = 0;
+    uint64_t at_us = 0;
+    uint64_t latency_us = 0;
+    std::vector<uint8_t> key;
+    std::vector<uint8_t> payload;
+};
+
+// Request arguments as a key (little endian u32s)
+std::vector<uint8_t> Key(uint32_t a, uint32_t b);
+std::vector<uint8_t> Key(uint32_t a, uint32_t b, uint32_t c);
+
+// Response payloads. Plain structures are copied as bytes.
+template <typename T>
+void Encode(const T& value, std::vector<uint8_t>& out) {
+    static_assert(std::is_trivially_copyable<T>::value, "payload must be trivially copyable");
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T>
+bool Decode(const std::vector<uint8_t>& in, T& value) {
+    static_assert(std::is_trivially_copyable<T>::value, "payload must be trivially copyable");
+    if (in.size() != sizeof(T)) {
+        return false;
+    }
+    memcpy(&value, in.data(), sizeof(T));
+    return true;
+}
+
+template <typename T>
+void Encode(const std::vector<T>& values, std::vector<uint8_t>& out) {
+    for (const T& value : values) {
+        Encode(value, out);
+    }
+}
+
+template <typename T>
+bool Decode(const std::vector<uint8_t>& in, std::vector<T>& values) {
+    static_assert(std::is_trivially_copyable<T>::value, "payload must be trivially copyable");
+    if (in.size() % sizeof(T) != 0) {
+        return false;
+    }
+    values.resize(in.size() / sizeof(T));
+    if (!values.empty()) {
+        memcpy(values.data(), in.data(), in.size());
+    }
+    return true;
+}
+
+void Encode(const Powermon::DeviceInfo& info, std::vector<uint8_t>& out);
+bool Decode(const std::vector<uint8_t>& in, Powermon::DeviceInfo& info);
+
+// Appends records to a trace file. Thread-safe; records are buffered and
+// reach the file on Flush(), Close() or when the buffer fills.
+class Writer {
+public:
+    Writer();
+    ~Writer();
+
+    bool Open(const std::string& path, std::string* error);
+    void Close();
+    void Flush();
+
+    // Microseconds since Open(), the time base of at_us
+    uint64_t Now() const;
+
+    void Write(const Record& record);
+
+private:
+    std::mutex mutex_;
+    FILE* file_;
+    std::chrono::steady_clock::time_point start_;
+    std::vector<uint8_t> buffer_;
+
+    void FlushLocked();
+};
+
+// Reads a whole trace; fails on a bad header. A truncated last record is dropped.
+bool Load(const std::string& path, std::vector<Record>& records, std::string* error);
+
+}
+
+#endif
@@ -0,0 +1,110 @@
+#include "energy_integration.h"
+
+#include <math.h>
+#include <string.h>
+
+namespace EnergyIntegration {
+
+namespace {
+
+// Area above zero of the line from a to b over dt: the trapezoid of the
+// positive parts, or with a sign change the triangle up to the crossing,
+// max(a, b)^2 / |a - b| * dt / 2. Both are computed and blended so the loop
+// has no branches (needs -fno-trapping-math to keep the division unconditional;
+// binding.gyp builds this file alone with it, as the energy_kernel target).
+inline double PositiveArea(double a, double b, double dt) {
+    double spread = fabs(a - b);
+    double high = (a + b + spread) * 0.5;
+    double positive = (a + fabs(a) + b + fabs(b)) * 0.5;
+    double crossing = high * high / (spread + 1e-30);
+    double cross = a * b < 0 ? 1.0 : 0.0;
+    return (cross * crossing + (1.0 - cross) * positive) * (0.5 * dt);
+}
+
+void AddPair(Totals& totals, double e, double e_in, double q, double q_in, double dt) {
+    totals.energy_wh += e;
+    totals.energy_in_wh += e_in;
+    totals.energy_out_wh += e_in - e;
+    totals.charge_ah += q;
+    totals.charge_in_ah += q_in;
+    totals.charge_out_ah += q_in - q;
+    totals.covered += dt;
+}
+
+}
+
+Options DefaultOptions() {
+    Options options;
+    options.max_gap = 60.0;
+    options.window = 0;
+    options.energy_start = 0;
+    options.charge_start = 0;
+    return options;
+}
+
+void Integrate(const double* time, const double* power, const double* current, size_t count,
+               const Options& options, double* energy_wh, double* charge_ah,
+               Totals& totals, std::vector<Window>* windows) {
+    memset(&totals, 0, sizeof(totals));
+    if (count == 0) {
+        return;
+    }
+
+    // Pass 1: per-pair areas (pair i spans samples i and i + 1), branch-free
+    const size_t pairs = count - 1;
+    std::vector<double> columns(pairs * 5);
+    double* __restrict e = columns.data();
+    double* __restrict e_in = e + pairs;
+    double* __restrict q = e_in + pairs;
+    double* __restrict q_in = q + pairs;
+    double* __restrict dt = q_in + pairs;
+    const double to_hours = 1.0 / 3600.0;
+    const double max_gap = options.max_gap;
+
+    for (size_t i = 0; i < pairs; i++) {
+        double d = time[i + 1] - time[i];
+        double valid = d > 0 ? to_hours : 0.0;
+        valid = d <= max_gap ? valid : 0.0;
+        double p0 = power[i], p1 = power[i + 1];
+        double c0 = current[i], c1 = current[i + 1];
+
+        dt[i] = d;
+        e[i] = (p0 + p1) * 0.5 * d * valid;
+        e_in[i] = PositiveArea(p0, p1, d) * valid;
+        q[i] = (c0 + c1) * 0.5 * d * valid;
+        q_in[i] = PositiveArea(c0, c1, d) * valid;
+    }
+
+    // Pass 2: running sums, totals and windows
+    double energy = options.energy_start;
+    double charge = options.charge_start;
+    if (energy_wh) energy_wh[0] = energy;
+    if (charge_ah) charge_ah[0] = charge;
+
+    Window* window = nullptr;
+    for (size_t i = 0; i < pairs; i++) {
+        energy += e[i];
+        charge += q[i];
+        if (energy_wh) energy_wh[i + 1] = energy;
+        if (charge_ah) charge_ah[i + 1] = charge;
+
+        if (dt[i] <= 0 || dt[i] > options.max_gap) {
+            totals.gaps++;
+            continue;
+        }
+        AddPair(totals, e[i], e_in[i], q[i], q_in[i], dt[i]);
+
+        if (windows && options.window > 0) {
+            double start = floor(time[i] / options.window) * options.window;
+            if (!window || window->start != start) {
+                windows->push_back(Window());
+                window = &windows->back();
+                memset(window, 0, sizeof(*window));
+                window->start = start;
+            }
+            AddPair(window->totals, e[i], e_in[i], q[i], q_in[i], dt[i]);
+        }
+    }
+}
+
+}
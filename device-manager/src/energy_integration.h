@@ -0,0 +1,56 @@
+#ifndef ENERGY_INTEGRATION_H
+#define ENERGY_INTEGRATION_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <vector>
+
+// Integrates power and current over a decoded sample series to recover the
+// energy (Wh) and charge (Ah) meters that log records do not carry.
+//
+// Each pair of neighbouring samples is one trapezoid. Pairs further apart than
+// max_gap seconds (or out of order) are not integrated, so a logging gap does
+// not smear the last reading across it. Where current or power changes sign
+// inside a pair the trapezoid is split at the zero crossing, giving exact
+// in (charging, positive) and out (discharging, negative) totals.
+//
+// The kernel works on columnar arrays: per-pair areas are computed in one
+// branch-free pass the compiler can vectorize, then a second pass builds the
+// cumulative series and window totals.
+namespace EnergyIntegration {
+
+struct Options {
+    double max_gap;         // seconds
+    double window;          // seconds, 0 = no window totals
+    double energy_start;    // Wh added to the cumulative series
+    double charge_start;    // Ah added to the cumulative series
+};
+
+struct Totals {
+    double energy_wh;       // net
+    double energy_in_wh;
+    double energy_out_wh;   // positive magnitude
+    double charge_ah;       // net
+    double charge_in_ah;
+    double charge_out_ah;   // positive magnitude
+    double covered;         // seconds integrated
+    uint32_t gaps;          // pairs skipped as gaps
+};
+
+struct Window {
+    double start;           // seconds, aligned to a multiple of the window
+    Totals totals;
+};
+
+Options DefaultOptions();
+
+// energy_wh and charge_ah receive the cumulative series (count entries each)
+// and may be null; windows may be null.
+void Integrate(const double* time, const double* power, const double* current, size_t count,
+               const Options& options, double* energy_wh, double* charge_ah,
+               Totals& totals, std::vector<Window>* windows);
+
+}
+
+#endif
@@ -0,0 +1,161 @@
+#include "energy_wrapper.h"
+#include "energy_integration.h"
+#include "packed_samples_wrapper.h"
+
+#include <vector>
+
+namespace EnergyWrapper {
+
+namespace {
+
+template <typename T>
+void CopyColumn(Napi::TypedArray array, std::vector<double>& out) {
+    const T* data = array.As<Napi::TypedArrayOf<T>>().Data();
+    out.assign(data, data + array.ElementLength());
+}
+
+// Accepts any numeric typed array
+bool ReadColumn(Napi::Value value, std::vector<double>& out) {
+    if (!value.IsTypedArray()) {
+        return false;
+    }
+
+    Napi::TypedArray array = value.As<Napi::TypedArray>();
+    switch (array.TypedArrayType()) {
+        case napi_float64_array: CopyColumn<double>(array, out); return true;
+        case napi_float32_array: CopyColumn<float>(array, out); return true;
+        case napi_uint32_array: CopyColumn<uint32_t>(array, out); return true;
+        case napi_int32_array: CopyColumn<int32_t>(array, out); return true;
+        case napi_uint16_array: CopyColumn<uint16_t>(array, out); return true;
+        case napi_int16_array: CopyColumn<int16_t>(array, out); return true;
+        default: return false;
+    }
+}
+
+double GetNumber(Napi::Object obj, const char* key, double fallback) {
+    Napi::Value value = obj.Get(key);
+    return value.IsNumber() ? value.As<Napi::Number>().DoubleValue() : fallback;
+}
+
+Napi::Object TotalsToObject(Napi::Env env, const EnergyIntegration::Totals& totals) {
+    Napi::Object obj = Napi::Object::New(env);
+    obj.Set("energyWh", Napi::Number::New(env, totals.energy_wh));
+    obj.Set("energyInWh", Napi::Number::New(env, totals.energy_in_wh));
+    obj.Set("energyOutWh", Napi::Number::New(env, totals.energy_out_wh));
+    obj.Set("chargeAh", Napi::Number::New(env, totals.charge_ah));
+    obj.Set("chargeInAh", Napi::Number::New(env, totals.charge_in_ah));
+    obj.Set("chargeOutAh", Napi::Number::New(env, totals.charge_out_ah));
+    obj.Set("coveredSec", Napi::Number::New(env, totals.covered));
+    obj.Set("gaps", Napi::Number::New(env, totals.gaps));
+    return obj;
+}
+
+}
+
+Napi::Object Init(Napi::Env env, Napi::Object exports) {
+    exports.Set("integrateEnergy", Napi::Function::New(env, IntegrateEnergy, "integrateEnergy"));
+    return exports;
+}
+
+Napi::Value IntegrateEnergy(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsObject()) {
+        Napi::TypeError::New(env, "Samples array or { time, power, current } columns expected")
+            .ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    std::vector<double> time, power, current;
+
+    if (PackedSamplesWrapper::IsPacked(info[0])) {
+        std::vector<PowermonLogFile::Sample> samples;
+        PackedSamplesWrapper::ReadSamples(info[0], samples);
+        time.resize(samples.size());
+        power.resize(samples.size());
+        current.resize(samples.size());
+        for (size_t i = 0; i < samples.size(); i++) {
+            time[i] = samples[i].time;
+            power[i] = samples[i].power;
+            current[i] = samples[i].current;
+        }
+    } else if (info[0].IsArray()) {
+        // Decoded sample objects (time in seconds)
+        Napi::Array samples = info[0].As<Napi::Array>();
+        uint32_t count = samples.Length();
+        time.resize(count);
+        power.resize(count);
+        current.resize(count);
+        for (uint32_t i = 0; i < count; i++) {
+            Napi::Value value = samples.Get(i);
+            if (!value.IsObject()) {
+                Napi::TypeError::New(env, "Sample objects expected").ThrowAsJavaScriptException();
+                return env.Undefined();
+            }
+            Napi::Object sample = value.As<Napi::Object>();
+            time[i] = GetNumber(sample, "time", 0);
+            power[i] = GetNumber(sample, "power", 0);
+            current[i] = GetNumber(sample, "current", 0);
+        }
+    } else {
+        Napi::Object columns = info[0].As<Napi::Object>();
+        if (!ReadColumn(columns.Get("time"), time) || !ReadColumn(columns.Get("power"), power) ||
+            !ReadColumn(columns.Get("current"), current)) {
+            Napi::TypeError::New(env, "time, power and current must be numeric typed arrays")
+                .ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        if (power.size() != time.size() || current.size() != time.size()) {
+            Napi::RangeError::New(env, "Columns must have the same length").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+    }
+
+    EnergyIntegration::Options options = EnergyIntegration::DefaultOptions();
+    bool cumulative = true;
+    if (info.Length() > 1 && info[1].IsObject()) {
+        Napi::Object opts = info[1].As<Napi::Object>();
+        options.max_gap = GetNumber(opts, "maxGapSec", options.max_gap);
+        options.window = GetNumber(opts, "windowSec", options.window);
+        options.energy_start = GetNumber(opts, "energyStart", options.energy_start);
+        options.charge_start = GetNumber(opts, "chargeStart", options.charge_start);
+        Napi::Value c = opts.Get("cumulative");
+        if (c.IsBoolean()) {
+            cumulative = c.As<Napi::Boolean>().Value();
+        }
+    }
+
+    size_t count = time.size();
+    Napi::Float64Array energy_wh, charge_ah;
+    if (cumulative) {
+        energy_wh = Napi::Float64Array::New(env, count);
+        charge_ah = Napi::Float64Array::New(env, count);
+    }
+
+    EnergyIntegration::Totals totals;
+    std::vector<EnergyIntegration::Window> windows;
+    EnergyIntegration::Integrate(time.data(), power.data(), current.data(), count, options,
+                                 cumulative ? energy_wh.Data() : nullptr,
+                                 cumulative ? charge_ah.Data() : nullptr,
+                                 totals, options.window > 0 ? &windows : nullptr);
+
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("count", Napi::Number::New(env, static_cast<double>(count)));
+    result.Set("totals", TotalsToObject(env, totals));
+    if (cumulative) {
+        result.Set("energyWh", energy_wh);
+        result.Set("chargeAh", charge_ah);
+    }
+
+    Napi::Array arr = Napi::Array::New(env, windows.size());
+    for (size_t i = 0; i < windows.size(); i++) {
+        Napi::Object window = TotalsToObject(env, windows[i].totals);
+        window.Set("start", Napi::Number::New(env, windows[i].start));
+        arr.Set(i, window);
+    }
+    result.Set("windows", arr);
+
+    return result;
+}
+
+}
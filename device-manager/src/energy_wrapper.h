@@ -0,0 +1,14 @@
+#ifndef ENERGY_WRAPPER_H
+#define ENERGY_WRAPPER_H
+
+#include <napi.h>
+
+// Exposes EnergyIntegration as integrateEnergy(input, options)
+namespace EnergyWrapper {
+
+Napi::Object Init(Napi::Env env, Napi::Object exports);
+Napi::Value IntegrateEnergy(const Napi::CallbackInfo& info);
+
+}
+
+#endif
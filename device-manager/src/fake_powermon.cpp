@@ -0,0 +1,745 @@
+#include "fake_powermon.h"
+#include "log_format.h"
+#include "signal_model.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <sstream>
+
+namespace {
+
+const uint16_t FIRMWARE_VERSION_BCD = 0x0115;
+const uint8_t HARDWARE_REVISION_BCD = 0x41;
+const double BATTERY_CAPACITY_AH = 200.0;
+
+using SignalModel::Mix;
+
+uint64_t HashBytes(const uint8_t* data, size_t size) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+uint32_t Now() {
+    return static_cast<uint32_t>(time(nullptr));
+}
+
+}
+
+bool FakePowermon::Config::Parse(const char* spec, Config& config, std::string* error) {
+    if (spec == nullptr) {
+        return true;
+    }
+
+    std::istringstream in(spec);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        if (item.empty()) {
+            continue;
+        }
+        size_t eq = item.find('=');
+        if (eq == std::string::npos) {
+            if (error) *error = "Expected key=value: " + item;
+            return false;
+        }
+        std::string key = item.substr(0, eq);
+        std::string value = item.substr(eq + 1);
+        char* end = nullptr;
+        double number = strtod(value.c_str(), &end);
+        bool numeric = end != value.c_str() && *end == '\0';
+
+        if (key == "dist") {
+            if (value == "fixed") config.rtt_distribution = RTT_FIXED;
+            else if (value == "uniform") config.rtt_distribution = RTT_UNIFORM;
+            else if (value == "normal") config.rtt_distribution = RTT_NORMAL;
+            else if (value == "lognormal") config.rtt_distribution = RTT_LOGNORMAL;
+            else {
+                if (error) *error = "Unknown RTT distribution: " + value;
+                return false;
+            }
+            continue;
+        }
+
+        if (!numeric || number < 0) {
+            if (error) *error = "Invalid value for " + key + ": " + value;
+            return false;
+        }
+
+        if (key == "rtt") config.rtt_ms = number;
+        else if (key == "jitter") config.rtt_jitter_ms = number;
+        else if (key == "loss") config.loss = number;
+        else if (key == "timeout") config.timeout_ms = static_cast<uint32_t>(number);
+        else if (key == "connect") config.connect_ms = static_cast<uint32_t>(number);
+        else if (key == "connect_fail") config.connect_fail = number;
+        else if (key == "mtbf") config.disconnect_mtbf_ms = static_cast<uint32_t>(number);
+        else if (key == "throughput") config.throughput_kbps = static_cast<uint32_t>(number);
+        else if (key == "log_mode") config.log_mode = static_cast<uint8_t>(number);
+        else if (key == "log_hours") config.log_hours = static_cast<uint32_t>(number);
+        else if (key == "file_hours") config.file_hours = static_cast<uint32_t>(number);
+        else if (key == "seed") config.seed = static_cast<uint64_t>(number);
+        else {
+            if (error) *error = "Unknown key: " + key;
+            return false;
+        }
+    }
+
+    if (LogFormat::SamplePeriod(config.log_mode) == 0 || config.file_hours == 0) {
+        if (error) *error = "log_mode must be 1-7 and file_hours non-zero";
+        return false;
+    }
+    return true;
+}
+
+FakePowermon::FakePowermon(const Config& config)
+    : config_(config)
+    , token_(std::make_shared<DeviceTimer::Token>())
+    , state_(Disconnected)
+    , generation_(0)
+    , serial_(0)
+    , local_(false)
+    , device_config_()
+    , log_cleared_at_(0)
+    , meter_time_(0)
+    , energy_mwh_(0)
+    , charge_mah_(0)
+    , power_on_(true) {
+    static std::atomic<uint64_t> instances(0);
+    rng_.seed(Mix(config_.seed + instances++));
+    device_config_.setLogMode(static_cast<PowermonConfig::LogMode>(config_.log_mode));
+}
+
+FakePowermon::~FakePowermon() {
+    DeviceTimer::Revoke(token_);
+}
+
+void FakePowermon::Synthesize(uint64_t serial, uint32_t time, PowermonLogFile::Sample& sample) {
+    SignalModel::Generate(SignalModel::PROFILE_DAILY, serial, time, false, sample);
+}
+
+void FakePowermon::Schedule(double delay_ms, std::function<void()> fn) {
+    DeviceTimer::Instance().Add(token_, delay_ms, std::move(fn));
+}
+
+double FakePowermon::SampleRtt() {
+    std::lock_guard<std::mutex> lock(rng_mutex_);
+    double rtt = config_.rtt_ms;
+    double jitter = config_.rtt_jitter_ms;
+
+    switch (config_.rtt_distribution) {
+        case RTT_FIXED:
+            break;
+        case RTT_UNIFORM:
+            rtt += std::uniform_real_distribution<double>(-jitter, jitter)(rng_);
+            break;
+        case RTT_NORMAL:
+            rtt = std::normal_distribution<double>(rtt, jitter)(rng_);
+            break;
+        case RTT_LOGNORMAL:
+            if (rtt > 0) {
+                double sigma = log(1.0 + jitter / rtt);
+                rtt *= exp(sigma * std::normal_distribution<double>(0.0, 1.0)(rng_));
+            }
+            break;
+    }
+    return std::max(0.0, rtt);
+}
+
+double FakePowermon::SampleExponential(double mean) {
+    std::lock_guard<std::mutex> lock(rng_mutex_);
+    return std::exponential_distribution<double>(1.0 / mean)(rng_);
+}
+
+bool FakePowermon::Chance(double probability) {
+    if (probability <= 0) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(rng_mutex_);
+    return std::uniform_real_distribution<double>(0.0, 1.0)(rng_) < probability;
+}
+
+void FakePowermon::Connect(uint64_t serial, bool local) {
+    if (state_ != Disconnected) {
+        return;
+    }
+    state_ = Connecting;
+    serial_ = serial;
+    local_ = local;
+    uint32_t generation = ++generation_;
+
+    {
+        std::lock_guard<std::mutex> lock(data_mutex_);
+        device_info_.serial = serial;
+    }
+
+    bool fail = Chance(config_.connect_fail);
+    double delay = config_.connect_ms + SampleRtt();
+
+    Schedule(delay, [this, generation, fail]() {
+        if (generation != generation_) {
+            return;
+        }
+        if (fail) {
+            state_ = Disconnected;
+            if (on_disconnect_) on_disconnect_(NO_ROUTE);
+            return;
+        }
+        state_ = Connected;
+        ScheduleDrop(generation);
+        if (on_connect_) on_connect_();
+    });
+}
+
+void FakePowermon::ScheduleDrop(uint32_t generation) {
+    if (config_.disconnect_mtbf_ms == 0) {
+        return;
+    }
+    Schedule(SampleExponential(config_.disconnect_mtbf_ms), [this, generation]() {
+        if (generation != generation_ || state_ != Connected) {
+            return;
+        }
+        ++generation_;
+        state_ = Disconnected;
+        if (on_disconnect_) on_disconnect_(READ_ERROR);
+    });
+}
+
+void FakePowermon::Exchange(size_t response_bytes, std::function<void(ResponseCode)> respond) {
+    if (state_ != Connected) {
+        Schedule(0, [respond]() { respond(RSP_CANCELLED); });
+        return;
+    }
+
+    uint32_t generation = generation_;
+    bool lost = Chance(config_.loss);
+    double delay = config_.timeout_ms;
+    if (!lost) {
+        delay = SampleRtt();
+        if (config_.throughput_kbps > 0) {
+            delay += static_cast<double>(response_bytes) * 8.0 / config_.throughput_kbps;
+        }
+    }
+
+    Schedule(delay, [this, generation, lost, respond]() {
+        if (generation != generation_) {
+            respond(RSP_CANCELLED);
+            return;
+        }
+        respond(lost ? RSP_TIMEOUT : RSP_SUCCESS);
+    });
+}
+
+void FakePowermon::Acknowledge(const std::function<void(ResponseCode)>& cb) {
+    Exchange(0, cb);
+}
+
+#ifndef POWERMON_NO_INIT_BLE
+bool FakePowermon::initBle(void) {
+    return false;
+}
+#endif
+
+void FakePowermon::connectWifi(const WifiAccessKey& key) {
+    uint64_t hash = HashBytes(key.channel_id, CHANNEL_ID_SIZE) ^ HashBytes(key.encryption_key, ENCRYPTION_KEY_SIZE);
+    Connect(hash & 0xFFFFFFFFFFFFULL, false);
+}
+
+void FakePowermon::connectWifi(uint32_t ipaddr) {
+    Connect(ipaddr, true);
+}
+
+void FakePowermon::connectBle(uint64_t ble_address) {
+    Connect(ble_address, true);
+}
+
+void FakePowermon::disconnect(void) {
+    if (state_ == Disconnected) {
+        return;
+    }
+    ++generation_;
+    state_ = Disconnected;
+    Schedule(0, [this]() {
+        if (on_disconnect_) on_disconnect_(CLOSED);
+    });
+}
+
+bool FakePowermon::isLocalConnection(void) const {
+    return local_;
+}
+
+void FakePowermon::setOnConnectCallback(const std::function<void(void)>& cb) {
+    on_connect_ = cb;
+}
+
+void FakePowermon::setOnDisconnectCallback(const std::function<void(DisconnectReason)>& cb) {
+    on_disconnect_ = cb;
+}
+
+void FakePowermon::setOnMonitorDataCallback(const std::function<void(const MonitorData&)>& cb) {
+    on_monitor_data_ = cb;
+}
+
+void FakePowermon::setOnWifiScanReportCallback(const std::function<void(const WifiScanResult*)>& cb) {
+    on_wifi_scan_ = cb;
+}
+
+const Powermon::DeviceInfo& FakePowermon::getLastDeviceInfo(void) const {
+    return device_info_;
+}
+
+void FakePowermon::requestGetInfo(const std::function<void(ResponseCode, const DeviceInfo&)>& cb) {
+    Exchange(sizeof(DeviceInfo), [this, cb](ResponseCode rsp) {
+        DeviceInfo info = DeviceInfo();
+        if (rsp == RSP_SUCCESS) {
+            std::lock_guard<std::mutex> lock(data_mutex_);
+            if (device_info_.name.empty()) {
+                std::ostringstream name;
+                name << "FakePowermon-" << std::hex << std::uppercase << (serial_ & 0xFFFFFF);
+                device_info_.name = name.str();
+            }
+            device_info_.firmware_version_bcd = FIRMWARE_VERSION_BCD;
+            device_info_.hardware_revision_bcd = HARDWARE_REVISION_BCD;
+            device_info_.serial = serial_;
+            device_info_.address = Mix(serial_) & 0xFFFFFFFFFFFFULL;
+            info = device_info_;
+        }
+        cb(rsp, info);
+    });
+}
+
+void FakePowermon::FillMonitorData(MonitorData& data) {
+    const uint32_t now = Now();
+    const uint64_t serial = serial_;
+
+    PowermonLogFile::Sample sample;
+    Synthesize(serial, now, sample);
+
+    std::lock_guard<std::mutex> lock(data_mutex_);
+    if (!power_on_) {
+        sample.current = 0;
+        sample.power = 0;
+        sample.ps = PS_OFF;
+    }
+
+    if (meter_time_ == 0) {
+        energy_mwh_ = static_cast<double>(Mix(serial) % 1000000) * 100.0;
+        charge_mah_ = static_cast<double>(Mix(serial + 1) % 1000000) * 10.0;
+    } else if (now > meter_time_) {
+        double hours = (now - meter_time_) / 3600.0;
+        energy_mwh_ += sample.power * 1000.0 * hours;
+        charge_mah_ += sample.current * 1000.0 * hours;
+    }
+    meter_time_ = now;
+
+    data.firmware_version_bcd = FIRMWARE_VERSION_BCD;
+    data.hardware_revision_bcd = HARDWARE_REVISION_BCD;
+    data.time = now;
+    data.flags = 0;
+    data.voltage1 = sample.voltage1;
+    data.voltage2 = sample.voltage2;
+    data.current = sample.current;
+    data.power = sample.power;
+    data.temperature = sample.temperature;
+    data.coulomb_meter = static_cast<int64_t>(charge_mah_);
+    data.energy_meter = static_cast<int64_t>(energy_mwh_);
+    data.power_status = static_cast<PowerStatus>(sample.ps);
+    data.fg_soc = sample.soc;
+    data.fg_runtime = sample.current < 0
+        ? static_cast<uint16_t>(std::min(65520.0, sample.soc / 100.0 * BATTERY_CAPACITY_AH / -sample.current * 60.0))
+        : 0xFFFF;
+    data.rssi = static_cast<int16_t>(-45 - static_cast<int>(Mix(serial ^ (now / 60)) % 30));
+}
+
+void FakePowermon::requestGetMonitorData(const std::function<void(ResponseCode, const MonitorData&)>& cb) {
+    Exchange(sizeof(MonitorData), [this, cb](ResponseCode rsp) {
+        MonitorData data = {};
+        if (rsp == RSP_SUCCESS) {
+            FillMonitorData(data);
+            if (on_monitor_data_) on_monitor_data_(data);
+        }
+        cb(rsp, data);
+    });
+}
+
+void FakePowermon::requestGetStatistics(const std::function<void(ResponseCode, const MonitorStatistics&)>& cb) {
+    Exchange(sizeof(MonitorStatistics), [this, cb](ResponseCode rsp) {
+        MonitorStatistics stats = {};
+        if (rsp == RSP_SUCCESS) {
+            stats.seconds_since_on = static_cast<uint32_t>(Mix(serial_) % (30 * 86400));
+            stats.voltage1_min = 12.3f;
+            stats.voltage1_max = 13.7f;
+            stats.peak_charge_current = 33.0f;
+            stats.peak_discharge_current = -33.0f;
+            stats.temperature_min = 11.0f;
+            stats.temperature_max = 33.0f;
+        }
+        cb(rsp, stats);
+    });
+}
+
+void FakePowermon::requestGetFgStatistics(const std::function<void(ResponseCode, const FuelgaugeStatistics&)>& cb) {
+    Exchange(sizeof(FuelgaugeStatistics), [this, cb](ResponseCode rsp) {
+        FuelgaugeStatistics stats = {};
+        if (rsp == RSP_SUCCESS) {
+            PowermonLogFile::Sample sample;
+            Synthesize(serial_, Now(), sample);
+            stats.time_since_last_full_charge = static_cast<uint32_t>(Mix(serial_) % 86400);
+            stats.full_charge_capacity = static_cast<float>(BATTERY_CAPACITY_AH);
+            stats.total_discharge = Mix(serial_ + 2) % 100000000;
+            stats.total_discharge_energy = stats.total_discharge * 13;
+            stats.total_charge = stats.total_discharge + stats.total_discharge / 20;
+            stats.total_charge_energy = stats.total_charge * 13;
+            stats.min_voltage = 12.3f;
+            stats.max_voltage = 13.7f;
+            stats.max_discharge_current = -33.0f;
+            stats.max_charge_current = 33.0f;
+            stats.deepest_discharge = 140.0f;
+            stats.last_discharge = 70.0f;
+            stats.soc = sample.soc;
+        }
+        cb(rsp, stats);
+    });
+}
+
+void FakePowermon::requestUnlock(const AuthKey& key, std::function<void(ResponseCode)> cb) {
+    Acknowledge(cb);
+}
+
+void FakePowermon::requestSetUserPasswordLock(const AuthKey& key, std::function<void(ResponseCode)> cb) {
+    Acknowledge(cb);
+}
+
+void FakePowermon::requestSetMasterPasswordLock(const AuthKey& key, std::function<void(ResponseCode)> cb) {
+    Acknowledge(cb);
+}
+
+void FakePowermon::requestClearUserPasswordLock(std::function<void(ResponseCode)> cb) {
+    Acknowledge(cb);
+}
+
+void FakePowermon::requestClearMasterPasswordLock(std::function<void(ResponseCode)> cb) {
+    Acknowledge(cb);
+}
+
+void FakePowermon::requestGetAuthKey(std::function<void(ResponseCode, const AuthKey&)> cb) {
+    Exchange(sizeof(AuthKey), [this, cb](ResponseCode rsp) {
+        AuthKey key = {};
+        uint64_t h = Mix(serial_);
+        memcpy(key.data, &h, sizeof(h));
+        cb(rsp, key);
+    });
+}
+
+void FakePowermon::requestResetAuthKey(std::function<void(ResponseCode)> cb) {
+    Acknowledge(cb);
+}
+
+void FakePowermon::requestResetEnergyMeter(const std::function<void(ResponseCode)>& cb) {
+    Exchange(0, [this, cb](ResponseCode rsp) {
+        if (rsp == RSP_SUCCESS) {
+            std::lock_guard<std::mutex> lock(data_mutex_);
+            energy_mwh_ = 0;
+        }
+        cb(rsp);
+    });
+}
+
+void FakePowermon::requestResetCoulombMeter(const std::function<void(ResponseCode)>& cb) {
+    Exchange(0, [this, cb](ResponseCode rsp) {
+        if (rsp == RSP_SUCCESS) {
+            std::lock_guard<std::mutex> lock(data_mutex_);
+            charge_mah_ = 0;
+        }
+        cb(rsp);
+    });
+}
+
+void FakePowermon::requestResetStatistics(const std::function<void(ResponseCode)>& cb) {
+    Acknowledge(cb);
+}
+
+void FakePowermon::requestSetPowerState(bool state, const std::function<void(ResponseCode)>& cb) {
+    Exchange(0, [this, state, cb](ResponseCode rsp) {
+        if (rsp == RSP_SUCCESS) {
+            std::lock_guard<std::mutex> lock(data_mutex_);
+            power_on_ = state;
+        }
+        cb(rsp);
+    });
+}
+
+void FakePowermon::requestGetConfig(const std::function<void(ResponseCode, const PowermonConfig&)>& cb) {
+    Exchange(sizeof(PowermonConfig), [this, cb](ResponseCode rsp) {
+        PowermonConfig config;
+        {
+            std::lock_guard<std::mutex> lock(data_mutex_);
+            config = device_config_;
+        }
+        cb(rsp, config);
+    });
+}
+
+void FakePowermon::requestSetConfig(const PowermonConfig& config, const std::function<void(ResponseCode)>& cb) {
+    Exchange(0, [this, config, cb](ResponseCode rsp) {
+        if (rsp == RSP_SUCCESS) {
+            std::lock_guard<std::mutex> lock(data_mutex_);
+            device_config_ = config;
+            if (LogFormat::SamplePeriod(config.getLogMode()) != 0) {
+                config_.log_mode = static_cast<uint8_t>(config.getLogMode());
+            }
+        }
+        cb(rsp);
+    });
+}
+
+void FakePowermon::requestResetConfig(const std::function<void(ResponseCode)>& cb) {
+    Acknowledge(cb);
+}
+
+void FakePowermon::requestRename(const char* name, const std::function<void(ResponseCode)>& cb) {
+    std::string new_name = name ? name : "";
+    Exchange(0, [this, new_name, cb](ResponseCode rsp) {
+        if (rsp == RSP_SUCCESS) {
+            std::lock_guard<std::mutex> lock(data_mutex_);
+            device_info_.name = new_name;
+        }
+        cb(rsp);
+    });
+}
+
+void FakePowermon::requestSetTime(uint32_t time, const std::function<void(ResponseCode)>& cb) {
+    Acknowledge(cb);
+}
+
+void FakePowermon::requestFgSynchronize(const std::function<void(ResponseCode)>& cb) {
+    Acknowledge(cb);
+}
+
+void FakePowermon::requestStartWifiScan(const std::function<void(ResponseCode)>& cb) {
+    // No networks around a build box, so no scan reports follow
+    Acknowledge(cb);
+}
+
+void FakePowermon::requestWifiConfigure(const WifiNetwork& network, const std::function<void(ResponseCode)>& cb) {
+    Acknowledge(cb);
+}
+
+void FakePowermon::requestGetWifiNetworks(const std::function<void(ResponseCode, const std::vector<WifiNetwork>&)>& cb) {
+    Exchange(0, [cb](ResponseCode rsp) {
+        cb(rsp, std::vector<WifiNetwork>());
+    });
+}
+
+void FakePowermon::requestAddWifiNetwork(const WifiNetwork& network, const std::function<void(ResponseCode)>& cb) {
+    Acknowledge(cb);
+}
+
+void FakePowermon::requestRemoveWifiNetwork(uint8_t index, const std::function<void(ResponseCode)>& cb) {
+    Acknowledge(cb);
+}
+
+void FakePowermon::requestGetAccessKeys(const std::function<void(ResponseCode, const WifiAccessKey&)>& cb) {
+    Exchange(sizeof(WifiAccessKey), [cb](ResponseCode rsp) {
+        WifiAccessKey key = {};
+        cb(rsp, key);
+    });
+}
+
+void FakePowermon::requestResetAccessKeys(const std::function<void(ResponseCode)>& cb) {
+    Acknowledge(cb);
+}
+
+void FakePowermon::requestZeroCurrentOffset(const std::function<void(ResponseCode)>& cb) {
+    Acknowledge(cb);
+}
+
+void FakePowermon::requestCalibrateCurrent(float value, const std::function<void(ResponseCode)>& cb) {
+    Acknowledge(cb);
+}
+
+void FakePowermon::requestGetSchedules(const std::function<void(ResponseCode, const std::vector<PowermonSchedule>&)>& cb) {
+    Exchange(0, [cb](ResponseCode rsp) {
+        cb(rsp, std::vector<PowermonSchedule>());
+    });
+}
+
+void FakePowermon::requestAddSchedules(const std::vector<PowermonSchedule>& schedules, const std::function<void(ResponseCode)>& cb) {
+    Acknowledge(cb);
+}
+
+void FakePowermon::requestUpdateSchedule(uint64_t old_schedule_descriptor, const PowermonSchedule& new_schedule,
+                                         const std::function<void(ResponseCode)>& cb) {
+    Acknowledge(cb);
+}
+
+void FakePowermon::requestDeleteSchedule(uint64_t schedule_descriptor, const std::function<void(ResponseCode)>& cb) {
+    Acknowledge(cb);
+}
+
+void FakePowermon::requestClearSchedules(const std::function<void(ResponseCode)>& cb) {
+    Acknowledge(cb);
+}
+
+void FakePowermon::requestCommitSchedules(const std::function<void(ResponseCode)>& cb) {
+    Acknowledge(cb);
+}
+
+uint32_t FakePowermon::SamplePeriod() const {
+    return LogFormat::SamplePeriod(config_.log_mode);
+}
+
+uint32_t FakePowermon::LogMask() const {
+    // V1, I, T, SOC and PS only; synthetic devices have no second voltage input
+    return 0;
+}
+
+void FakePowermon::ListLogFiles(uint32_t now, std::vector<LogFileDescriptor>& files) const {
+    const uint32_t period = SamplePeriod();
+    const uint32_t file_seconds = config_.file_hours * 3600;
+    const uint32_t history = config_.log_hours * 3600;
+
+    uint32_t start = now > history ? now - history : 0;
+    {
+        std::lock_guard<std::mutex> lock(data_mutex_);
+        start = std::max(start, log_cleared_at_);
+    }
+    start -= start % period;
+
+    // Files roll over on file_seconds boundaries; the last one is still growing
+    for (uint32_t file_start = start - start % file_seconds; file_start <= now; file_start += file_seconds) {
+        uint32_t first = std::max(file_start, start);
+        uint32_t end = std::min(file_start + file_seconds, now);
+        if (end <= first) {
+            continue;
+        }
+        uint32_t count = (end - first + period - 1) / period;
+        files.push_back({ first, LogFormat::FileSize(LogMask(), count) });
+    }
+}
+
+void FakePowermon::requestGetLogFileList(const std::function<void(ResponseCode, const std::vector<LogFileDescriptor>&)>& cb) {
+    uint32_t now = Now();
+    std::vector<LogFileDescriptor> files;
+    ListLogFiles(now, files);
+
+    Exchange(files.size() * sizeof(LogFileDescriptor), [cb, files](ResponseCode rsp) {
+        cb(rsp, rsp == RSP_SUCCESS ? files : std::vector<LogFileDescriptor>());
+    });
+}
+
+void FakePowermon::requestReadLogFile(uint32_t file_id, uint32_t offset, uint32_t read_size,
+                                      const std::function<void(ResponseCode, const uint8_t*, size_t)>& cb) {
+    std::vector<LogFileDescriptor> files;
+    ListLogFiles(Now(), files);
+
+    auto file = std::find_if(files.begin(), files.end(),
+        [file_id](const LogFileDescriptor& f) { return f.id == file_id; });
+    if (file == files.end() || offset > file->size) {
+        ResponseCode code = file == files.end() ? RSP_NOT_FOUND : RSP_INVALID_PARAM;
+        Exchange(0, [cb, code](ResponseCode rsp) {
+            cb(rsp == RSP_SUCCESS ? code : rsp, nullptr, 0);
+        });
+        return;
+    }
+
+    const uint32_t size = std::min(read_size, file->size - offset);
+    const uint32_t mask = LogMask();
+    const uint32_t period = SamplePeriod();
+    const uint32_t sample_count = LogFormat::SampleCount(mask, file->size);
+    const uint8_t mode = config_.log_mode;
+
+    Exchange(size, [this, cb, file_id, offset, size, mask, period, sample_count, mode](ResponseCode rsp) {
+        if (rsp != RSP_SUCCESS) {
+            cb(rsp, nullptr, 0);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(data_mutex_);
+            const ReadCache& cache = read_cache_;
+            if (cache.file_id == file_id && cache.offset == offset && cache.data.size() == size &&
+                cache.sample_count == sample_count) {
+                std::vector<uint8_t> data = cache.data;
+                cb(RSP_SUCCESS, data.data(), data.size());
+                return;
+            }
+        }
+
+        std::vector<uint8_t> data(size, 0);
+        LogFormat::Writer writer(data.data(), offset, size);
+
+        if (offset < LogFormat::HEADER_SIZE) {
+            LogFormat::Header header;
+            memset(&header, 0, sizeof(header));
+            header.mode = mode;
+            header.time = file_id;
+            header.mask = mask;
+            writer.WriteHeader(header);
+        }
+
+        uint32_t first, last;
+        LogFormat::Writer::RecordRange(mask, offset, size, first, last);
+        last = std::min(last, sample_count);
+
+        const uint64_t serial = serial_;
+        PowermonLogFile::Sample sample;
+        for (uint32_t i = first; i < last; i++) {
+            Synthesize(serial, file_id + i * period, sample);
+            writer.WriteRecord(mask, i, sample);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(data_mutex_);
+            read_cache_.file_id = file_id;
+            read_cache_.offset = offset;
+            read_cache_.sample_count = sample_count;
+            read_cache_.data = data;
+        }
+        cb(RSP_SUCCESS, data.data(), data.size());
+    });
+}
+
+void FakePowermon::requestClearLog(const std::function<void(ResponseCode)>& cb) {
+    Exchange(0, [this, cb](ResponseCode rsp) {
+        if (rsp == RSP_SUCCESS) {
+            std::lock_guard<std::mutex> lock(data_mutex_);
+            log_cleared_at_ = Now();
+        }
+        cb(rsp);
+    });
+}
+
+void FakePowermon::requestUpdateFirmware(const uint8_t* firmware_image, uint32_t size,
+                                         const std::function<bool(uint32_t, uint32_t)>& progress_cb,
+                                         const std::function<void(ResponseCode)>& done_cb) {
+    Exchange(size, [done_cb](ResponseCode rsp) {
+        done_cb(rsp == RSP_SUCCESS ? RSP_INVALID_REQ : rsp);
+    });
+}
+
+void FakePowermon::requestReadDebug(uint32_t offset, uint32_t read_size,
+                                    const std::function<void(ResponseCode, const uint8_t*, size_t)>& cb) {
+    Exchange(0, [cb](ResponseCode rsp) {
+        cb(rsp, nullptr, 0);
+    });
+}
+
+void FakePowermon::requestEraseDebug(const std::function<void(ResponseCode)>& cb) {
+    Acknowledge(cb);
+}
+
+void FakePowermon::requestReboot(const std::function<void(ResponseCode)>& cb) {
+    Exchange(0, [this, cb](ResponseCode rsp) {
+        cb(rsp);
+        if (rsp == RSP_SUCCESS && state_ == Connected) {
+            ++generation_;
+            state_ = Disconnected;
+            if (on_disconnect_) on_disconnect_(CLOSED);
+        }
+    });
+}
@@ -0,0 +1,193 @@
+#ifndef FAKE_POWERMON_H
+#define FAKE_POWERMON_H
+
+#include <powermon.h>
+#include <powermon_log.h>
+
+#include "device_timer.h"
+
+#include <stdint.h>
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+// In-process PowerMon for running the addon and the bridge without devices or
+// network. Requests complete on a shared timer thread after a round trip drawn
+// from a configurable distribution, can be lost (RSP_TIMEOUT after timeout_ms)
+// or cut short by random disconnects, and log files are synthesized on demand
+// from a deterministic per-serial signal, so the same device always serves the
+// same data.
+//
+// The device serial is derived from the connect target (access key, IP or BLE
+// address), so a fleet of access URLs maps to a fleet of distinct devices.
+class FakePowermon : public Powermon {
+public:
+    enum RttDistribution : uint8_t {
+        RTT_FIXED = 0,
+        RTT_UNIFORM,        // rtt_ms +/- rtt_jitter_ms
+        RTT_NORMAL,         // mean rtt_ms, stddev rtt_jitter_ms
+        RTT_LOGNORMAL       // median rtt_ms, long tail scaled by rtt_jitter_ms
+    };
+
+    struct Config {
+        RttDistribution rtt_distribution = RTT_LOGNORMAL;
+        double rtt_ms = 80;
+        double rtt_jitter_ms = 20;
+        double loss = 0;                    // probability a request gets no response
+        uint32_t timeout_ms = 5000;
+        uint32_t connect_ms = 300;
+        double connect_fail = 0;            // probability a connect attempt fails
+        uint32_t disconnect_mtbf_ms = 0;    // mean time between drops, 0 = never
+        uint32_t throughput_kbps = 0;       // log read transfer rate, 0 = unlimited
+        uint8_t log_mode = PowermonConfig::LOG_MODE_1_SEC;
+        uint32_t log_hours = 48;            // history held on the device
+        uint32_t file_hours = 24;           // hours per log file
+        uint64_t seed = 1;
+
+        // Parses "key=value,..." (e.g. the POWERMON_FAKE environment variable).
+        // Keys: rtt, jitter, dist (fixed|uniform|normal|lognormal), loss,
+        // timeout, connect, connect_fail, mtbf, throughput, log_mode,
+        // log_hours, file_hours, seed.
+        static bool Parse(const char* spec, Config& config, std::string* error);
+    };
+
+    explicit FakePowermon(const Config& config);
+    ~FakePowermon() override;
+
+    // Synthetic signal shared by monitor data and log files
+    static void Synthesize(uint64_t serial, uint32_t time, PowermonLogFile::Sample& sample);
+
+#ifndef POWERMON_NO_INIT_BLE    // v1.16 headers (libpowermon_bin_old) have no initBle()
+    bool initBle(void) override;
+#endif
+    void connectWifi(const WifiAccessKey& key) override;
+    void connectWifi(uint32_t ipaddr) override;
+    void connectBle(uint64_t ble_address) override;
+    void disconnect(void) override;
+    bool isLocalConnection(void) const override;
+
+    void setOnConnectCallback(const std::function<void(void)>& cb) override;
+    void setOnDisconnectCallback(const std::function<void(DisconnectReason)>& cb) override;
+    void setOnMonitorDataCallback(const std::function<void(const MonitorData&)>& cb) override;
+    void setOnWifiScanReportCallback(const std::function<void(const WifiScanResult*)>& cb) override;
+
+    const DeviceInfo& getLastDeviceInfo(void) const override;
+
+    void requestGetInfo(const std::function<void(ResponseCode, const DeviceInfo&)>& cb) override;
+    void requestGetMonitorData(const std::function<void(ResponseCode, const MonitorData&)>& cb) override;
+    void requestGetStatistics(const std::function<void(ResponseCode, const MonitorStatistics&)>& cb) override;
+    void requestGetFgStatistics(const std::function<void(ResponseCode, const FuelgaugeStatistics&)>& cb) override;
+
+    void requestUnlock(const AuthKey& key, std::function<void(ResponseCode)> cb) override;
+    void requestSetUserPasswordLock(const AuthKey& key, std::function<void(ResponseCode)> cb) override;
+    void requestSetMasterPasswordLock(const AuthKey& key, std::function<void(ResponseCode)> cb) override;
+    void requestClearUserPasswordLock(std::function<void(ResponseCode)> cb) override;
+    void requestClearMasterPasswordLock(std::function<void(ResponseCode)> cb) override;
+    void requestGetAuthKey(std::function<void(ResponseCode, const AuthKey&)> cb) override;
+    void requestResetAuthKey(std::function<void(ResponseCode)> cb) override;
+
+    void requestResetEnergyMeter(const std::function<void(ResponseCode)>& cb) override;
+    void requestResetCoulombMeter(const std::function<void(ResponseCode)>& cb) override;
+    void requestResetStatistics(const std::function<void(ResponseCode)>& cb) override;
+    void requestSetPowerState(bool state, const std::function<void(ResponseCode)>& cb) override;
+
+    void requestGetConfig(const std::function<void(ResponseCode, const PowermonConfig&)>& cb) override;
+    void requestSetConfig(const PowermonConfig& config, const std::function<void(ResponseCode)>& cb) override;
+    void requestResetConfig(const std::function<void(ResponseCode)>& cb) override;
+    void requestRename(const char* name, const std::function<void(ResponseCode)>& cb) override;
+    void requestSetTime(uint32_t time, const std::function<void(ResponseCode)>& cb) override;
+    void requestFgSynchronize(const std::function<void(ResponseCode)>& cb) override;
+
+    void requestStartWifiScan(const std::function<void(ResponseCode)>& cb) override;
+    void requestWifiConfigure(const WifiNetwork& network, const std::function<void(ResponseCode)>& cb) override;
+    void requestGetWifiNetworks(const std::function<void(ResponseCode, const std::vector<WifiNetwork>&)>& cb) override;
+    void requestAddWifiNetwork(const WifiNetwork& network, const std::function<void(ResponseCode)>& cb) override;
+    void requestRemoveWifiNetwork(uint8_t index, const std::function<void(ResponseCode)>& cb) override;
+    void requestGetAccessKeys(const std::function<void(ResponseCode, const WifiAccessKey&)>& cb) override;
+    void requestResetAccessKeys(const std::function<void(ResponseCode)>& cb) override;
+
+    void requestZeroCurrentOffset(const std::function<void(ResponseCode)>& cb) override;
+    void requestCalibrateCurrent(float value, const std::function<void(ResponseCode)>& cb) override;
+
+    void requestGetSchedules(const std::function<void(ResponseCode, const std::vector<PowermonSchedule>&)>& cb) override;
+    void requestAddSchedules(const std::vector<PowermonSchedule>& schedules, const std::function<void(ResponseCode)>& cb) override;
+    void requestUpdateSchedule(uint64_t old_schedule_descriptor, const PowermonSchedule& new_schedule,
+                               const std::function<void(ResponseCode)>& cb) override;
+    void requestDeleteSchedule(uint64_t schedule_descriptor, const std::function<void(ResponseCode)>& cb) override;
+    void requestClearSchedules(const std::function<void(ResponseCode)>& cb) override;
+    void requestCommitSchedules(const std::function<void(ResponseCode)>& cb) override;
+
+    void requestGetLogFileList(const std::function<void(ResponseCode, const std::vector<LogFileDescriptor>&)>& cb) override;
+    void requestReadLogFile(uint32_t file_id, uint32_t offset, uint32_t read_size,
+                            const std::function<void(ResponseCode, const uint8_t*, size_t)>& cb) override;
+    void requestClearLog(const std::function<void(ResponseCode)>& cb) override;
+
+    void requestUpdateFirmware(const uint8_t* firmware_image, uint32_t size, const std::function<bool(uint32_t, uint32_t)>& progress_cb,
+                               const std::function<void(ResponseCode)>& done_cb) override;
+    void requestReadDebug(uint32_t offset, uint32_t read_size,
+                          const std::function<void(ResponseCode, const uint8_t*, size_t)>& cb) override;
+    void requestEraseDebug(const std::function<void(ResponseCode)>& cb) override;
+    void requestReboot(const std::function<void(ResponseCode)>& cb) override;
+
+private:
+    Config config_;
+    std::shared_ptr<DeviceTimer::Token> token_;
+
+    std::mutex rng_mutex_;
+    std::mt19937_64 rng_;
+
+    std::atomic<uint8_t> state_;
+    std::atomic<uint32_t> generation_;
+    std::atomic<uint64_t> serial_;
+    bool local_;
+
+    std::function<void(void)> on_connect_;
+    std::function<void(DisconnectReason)> on_disconnect_;
+    std::function<void(const MonitorData&)> on_monitor_data_;
+    std::function<void(const WifiScanResult*)> on_wifi_scan_;
+
+    mutable std::mutex data_mutex_;
+    DeviceInfo device_info_;
+    PowermonConfig device_config_;
+    uint32_t log_cleared_at_;
+    uint32_t meter_time_;
+    double energy_mwh_;
+    double charge_mah_;
+    bool power_on_;
+
+    // Last log window served; repeated reads (benchmarks) skip synthesis
+    struct ReadCache {
+        uint32_t file_id = 0;
+        uint32_t offset = 0;
+        uint32_t sample_count = 0;
+        std::vector<uint8_t> data;
+    };
+    ReadCache read_cache_;
+
+    void Connect(uint64_t serial, bool local);
+    void Schedule(double delay_ms, std::function<void()> fn);
+
+    // Completes a request after a sampled round trip carrying response_bytes;
+    // respond() receives RSP_SUCCESS, RSP_TIMEOUT (lost) or RSP_CANCELLED
+    // (connection dropped before the response).
+    void Exchange(size_t response_bytes, std::function<void(ResponseCode)> respond);
+    void Acknowledge(const std::function<void(ResponseCode)>& cb);
+    void ScheduleDrop(uint32_t generation);
+
+    double SampleRtt();
+    double SampleExponential(double mean);
+    bool Chance(double probability);
+
+    uint32_t SamplePeriod() const;
+    uint32_t LogMask() const;
+    void ListLogFiles(uint32_t now, std::vector<LogFileDescriptor>& files) const;
+    void FillMonitorData(MonitorData& data);
+};
+
+#endif
@@ -0,0 +1,186 @@
+#include "instance_pool.h"
+#include "latency_stats.h"
+#include "powermon_factory.h"
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace InstancePool {
+
+namespace {
+
+struct Idle {
+    Powermon* powermon;
+    uint64_t generation;
+    bool ble_available;
+};
+
+std::mutex mutex;
+std::vector<Idle> idle;
+size_t max_idle = DEFAULT_MAX_IDLE;
+bool initialized = false;
+std::map<std::string, bool> ble_by_backend;
+Stats stats;
+
+// POWERMON_POOL_IDLE overrides the default limit; caller holds mutex
+void Initialize() {
+    if (initialized) {
+        return;
+    }
+    initialized = true;
+    const char* value = getenv("POWERMON_POOL_IDLE");
+    if (value != nullptr && *value != '\0') {
+        max_idle = std::min<size_t>(strtoul(value, nullptr, 10), MAX_IDLE_LIMIT);
+    }
+}
+
+// Creates an instance outside the pool lock, probing BLE the first time a
+// backend is used and calling initBle() afterwards only when it is available
+Powermon* CreateInstance(uint64_t* generation, bool* ble_available) {
+    const uint64_t start = LatencyStats::Now();
+    const std::string backend = PowermonFactory::Backend();
+    *generation = PowermonFactory::ReuseGeneration();
+    Powermon* powermon = PowermonFactory::Create();
+    if (powermon == nullptr) {
+        return nullptr;
+    }
+
+    bool known = false;
+    bool available = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = ble_by_backend.find(backend);
+        if (it != ble_by_backend.end()) {
+            known = true;
+            available = it->second;
+        }
+    }
+
+    if (!known || available) {
+        try {
+            available = powermon->initBle();
+        } catch (...) {
+            // BLE init failed (expected on servers without Bluetooth)
+            available = false;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!known) {
+        ble_by_backend[backend] = available;
+        stats.ble_probes++;
+    }
+    stats.created++;
+    stats.create_us += LatencyStats::Now() - start;
+    *ble_available = available;
+    return powermon;
+}
+
+}
+
+Powermon* Acquire(uint64_t* generation, bool* ble_available) {
+    const uint64_t current = PowermonFactory::ReuseGeneration();
+    std::vector<Powermon*> stale;
+    Powermon* powermon = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Initialize();
+        while (!idle.empty() && powermon == nullptr) {
+            const Idle entry = idle.back();
+            idle.pop_back();
+            if (current != 0 && entry.generation == current) {
+                powermon = entry.powermon;
+                *generation = entry.generation;
+                *ble_available = entry.ble_available;
+                stats.reused++;
+            } else {
+                stale.push_back(entry.powermon);
+                stats.deleted++;
+            }
+        }
+    }
+
+    for (Powermon* instance : stale) {
+        delete instance;
+    }
+    return powermon != nullptr ? powermon : CreateInstance(generation, ble_available);
+}
+
+void Release(Powermon* powermon, uint64_t generation, bool ble_available, bool reusable) {
+    if (powermon == nullptr) {
+        return;
+    }
+    if (reusable && generation != 0 && generation == PowermonFactory::ReuseGeneration()) {
+        // The previous owner's callbacks must not fire into the next one
+        powermon->setOnConnectCallback([]() {});
+        powermon->setOnDisconnectCallback([](Powermon::DisconnectReason) {});
+
+        std::lock_guard<std::mutex> lock(mutex);
+        Initialize();
+        if (idle.size() < max_idle) {
+            idle.push_back({ powermon, generation, ble_available });
+            stats.returned++;
+            return;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.deleted++;
+    }
+    delete powermon;
+}
+
+size_t Prewarm(size_t count) {
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            Initialize();
+            if (idle.size() >= std::min(count, max_idle)) {
+                return idle.size();
+            }
+        }
+        uint64_t generation = 0;
+        bool ble_available = false;
+        Powermon* powermon = CreateInstance(&generation, &ble_available);
+        if (powermon == nullptr || generation == 0) {
+            delete powermon;
+            std::lock_guard<std::mutex> lock(mutex);
+            return idle.size();
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        idle.push_back({ powermon, generation, ble_available });
+    }
+}
+
+void SetMaxIdle(size_t limit) {
+    std::vector<Idle> surplus;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Initialize();
+        max_idle = limit;
+        while (idle.size() > max_idle) {
+            surplus.push_back(idle.back());
+            idle.pop_back();
+            stats.deleted++;
+        }
+    }
+    for (const Idle& entry : surplus) {
+        delete entry.powermon;
+    }
+}
+
+void GetStats(Stats& out) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Initialize();
+    out = stats;
+    out.idle = idle.size();
+    out.max_idle = max_idle;
+}
+
+}
@@ -0,0 +1,49 @@
+#ifndef INSTANCE_POOL_H
+#define INSTANCE_POOL_H
+
+#include <powermon.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Disconnected Powermon instances kept for the next PowermonDevice, so a
+// reconnect storm does not pay createInstance() and an initBle() attempt per
+// device. initBle() is probed once per backend and the result cached: when
+// BLE is unavailable new instances skip the D-Bus attempt altogether.
+// Instances are tagged with PowermonFactory::ReuseGeneration() and dropped
+// instead of reused after a backend or recording change.
+namespace InstancePool {
+
+const size_t DEFAULT_MAX_IDLE = 64;
+// Upper bound for maxIdle and prewarm counts; each idle instance holds a
+// library instance and its buffers
+const size_t MAX_IDLE_LIMIT = 4096;
+
+struct Stats {
+    size_t idle = 0;
+    size_t max_idle = 0;
+    uint64_t created = 0;       // new library instances
+    uint64_t reused = 0;        // handed out from the pool
+    uint64_t returned = 0;      // taken back into the pool
+    uint64_t deleted = 0;       // not reusable, pool full or stale
+    uint64_t ble_probes = 0;    // initBle() attempts made to learn availability
+    uint64_t create_us = 0;     // total time in createInstance() and initBle()
+};
+
+// nullptr when the library fails to create an instance; generation is
+// handed back to Release()
+Powermon* Acquire(uint64_t* generation, bool* ble_available);
+// Takes a disconnected instance with no requests outstanding back when
+// reusable, deletes it otherwise
+void Release(Powermon* powermon, uint64_t generation, bool ble_available, bool reusable);
+
+// Fills the pool up to count idle instances (at most max_idle); returns the
+// number idle
+size_t Prewarm(size_t count);
+// Deletes idle instances beyond the new limit; 0 disables pooling
+void SetMaxIdle(size_t max_idle);
+void GetStats(Stats& out);
+
+}
+
+#endif
@@ -0,0 +1,91 @@
+#include "instance_reaper.h"
+#include "instance_pool.h"
+#include "latency_stats.h"
+#include "resource_stats.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace InstanceReaper {
+
+namespace {
+
+struct State;
+void Run(State& state);
+
+// Leaked with its thread, like DeviceTimer: the thread may still be waiting
+// at exit
+struct State {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<Job> queue;
+    Stats stats;
+
+    State() {
+        std::thread([this]() { Run(*this); }).detach();
+    }
+};
+
+State& Instance() {
+    static State* state = new State();
+    return *state;
+}
+
+void Reap(const Job& job) {
+    const uint64_t start = LatencyStats::Now();
+    const ResourceStats::Mark before = ResourceStats::Now();
+    if (job.disconnect) {
+        job.powermon->disconnect();
+    }
+    InstancePool::Release(job.powermon, job.generation, job.ble_available, job.reusable);
+    ResourceStats::Destroyed(before);
+
+    const uint64_t elapsed = LatencyStats::Now() - start;
+    State& state = Instance();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.stats.reaped++;
+    state.stats.reap_us += elapsed;
+    state.stats.max_reap_us = std::max(state.stats.max_reap_us, elapsed);
+}
+
+void Run(State& state) {
+    std::unique_lock<std::mutex> lock(state.mutex);
+    for (;;) {
+        if (state.queue.empty()) {
+            state.cv.wait(lock);
+            continue;
+        }
+        const Job job = state.queue.front();
+        state.queue.pop_front();
+        lock.unlock();
+        Reap(job);
+        lock.lock();
+    }
+}
+
+}
+
+void Retire(const Job& job) {
+    if (job.powermon == nullptr) {
+        return;
+    }
+    State& state = Instance();
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.queue.push_back(job);
+        state.stats.retired++;
+    }
+    state.cv.notify_one();
+}
+
+void GetStats(Stats& out) {
+    State& state = Instance();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    out = state.stats;
+    out.queued = state.queue.size();
+}
+
+}
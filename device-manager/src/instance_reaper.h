@@ -0,0 +1,40 @@
+#ifndef INSTANCE_REAPER_H
+#define INSTANCE_REAPER_H
+
+#include <powermon.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Tears down library instances given up by PowermonDevice.close() or the
+// wrapper's finalizer on one background thread: disconnect() and deleting a
+// Powermon join its threads, which took hundreds of milliseconds on the JS
+// thread when a GC cycle finalized many dead wrappers together. The thread
+// and its queue are leaked on purpose, like DeviceTimer: instances still
+// queued at exit are not torn down.
+namespace InstanceReaper {
+
+struct Job {
+    Powermon* powermon;
+    uint64_t generation;        // InstancePool tag
+    bool ble_available;
+    bool disconnect;            // connected or connecting when given up
+    bool reusable;              // idle: may go back to InstancePool
+};
+
+// The instance's callbacks must no longer reach the wrapper that owned it
+void Retire(const Job& job);
+
+struct Stats {
+    size_t queued = 0;
+    uint64_t retired = 0;       // jobs queued, all time
+    uint64_t reaped = 0;        // jobs finished, all time
+    uint64_t reap_us = 0;       // total time in disconnect() and Release()
+    uint64_t max_reap_us = 0;
+};
+
+void GetStats(Stats& out);
+
+}
+
+#endif
@@ -0,0 +1,169 @@
+#include "latency_stats.h"
+
+#include <chrono>
+
+LatencyHistogram::LatencyHistogram() {
+    Reset();
+}
+
+uint32_t LatencyHistogram::Index(uint64_t us) {
+    if (us < 128) {
+        return static_cast<uint32_t>(us);
+    }
+    // us >> shift is in [64, 128)
+    const uint32_t shift = 63 - __builtin_clzll(us) - 6;
+    const uint64_t index = 128 + (shift - 1) * 64 + ((us >> shift) - 64);
+    return index < BUCKETS ? static_cast<uint32_t>(index) : BUCKETS - 1;
+}
+
+uint64_t LatencyHistogram::Upper(uint32_t i) {
+    if (i < 128) {
+        return i;
+    }
+    const uint32_t shift = (i - 128) / 64 + 1;
+    const uint64_t sub = (i - 128) % 64 + 64;
+    return ((sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::Add(uint64_t us, bool ok) {
+    buckets_[Index(us)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(us, std::memory_order_relaxed);
+    if (!ok) {
+        errors_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uint64_t seen = min_.load(std::memory_order_relaxed);
+    while (us < seen && !min_.compare_exchange_weak(seen, us, std::memory_order_relaxed)) {
+    }
+    seen = max_.load(std::memory_order_relaxed);
+    while (us > seen && !max_.compare_exchange_weak(seen, us, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::Summarize(Summary& out) const {
+    out = Summary();
+
+    // Percentiles come from the bucket copy so they agree with each other even
+    // while other threads keep adding
+    uint64_t counts[BUCKETS];
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < BUCKETS; i++) {
+        counts[i] = buckets_[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    if (total == 0) {
+        return;
+    }
+
+    out.count = total;
+    out.errors = errors_.load(std::memory_order_relaxed);
+    out.min_us = min_.load(std::memory_order_relaxed);
+    out.max_us = max_.load(std::memory_order_relaxed);
+    const uint64_t count = count_.load(std::memory_order_relaxed);
+    out.mean_us = count ? static_cast<double>(sum_.load(std::memory_order_relaxed)) / count : 0;
+
+    const double ranks[] = { 50, 90, 99, 99.9 };
+    uint64_t* const values[] = { &out.p50_us, &out.p90_us, &out.p99_us, &out.p999_us };
+    uint64_t seen = 0;
+    uint32_t bucket = 0;
+    for (uint32_t r = 0; r < 4; r++) {
+        uint64_t rank = static_cast<uint64_t>(ranks[r] / 100.0 * total + 0.5);
+        if (rank < 1) {
+            rank = 1;
+        }
+        while (bucket < BUCKETS && seen + counts[bucket] < rank) {
+            seen += counts[bucket++];
+        }
+        const uint64_t upper = Upper(bucket < BUCKETS ? bucket : BUCKETS - 1);
+        *values[r] = upper < out.max_us ? upper : out.max_us;
+    }
+}
+
+void LatencyHistogram::Reset() {
+    for (uint32_t i = 0; i < BUCKETS; i++) {
+        buckets_[i].store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    errors_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    min_.store(UINT64_MAX, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+namespace LatencyStats {
+
+namespace {
+
+// [class + 1][op]; row 0 is every device
+std::atomic<LatencyHistogram*> histograms[257][OP_COUNT];
+
+LatencyHistogram* Get(uint32_t row, Op op) {
+    LatencyHistogram* histogram = histograms[row][op].load(std::memory_order_acquire);
+    if (histogram != nullptr) {
+        return histogram;
+    }
+    LatencyHistogram* created = new LatencyHistogram();
+    if (histograms[row][op].compare_exchange_strong(histogram, created, std::memory_order_acq_rel)) {
+        return created;
+    }
+    delete created;
+    return histogram;
+}
+
+}
+
+const char* OpName(Op op) {
+    static const char* const names[OP_COUNT] = {
+        "connect", "info", "monitor", "statistics", "fgStatistics", "logFiles", "readLog"
+    };
+    return op < OP_COUNT ? names[op] : "unknown";
+}
+
+uint64_t Now() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Record(Op op, uint8_t hardware_revision, uint64_t start_us, bool ok) {
+    const uint64_t now = Now();
+    const uint64_t us = now > start_us ? now - start_us : 0;
+    Get(0, op)->Add(us, ok);
+    Get(hardware_revision + 1u, op)->Add(us, ok);
+}
+
+void Summarize(Op op, int hardware_revision, LatencyHistogram::Summary& out) {
+    const uint32_t row = hardware_revision < 0 ? 0 : (hardware_revision & 0xFF) + 1u;
+    LatencyHistogram* histogram = histograms[row][op].load(std::memory_order_acquire);
+    if (histogram == nullptr) {
+        out = LatencyHistogram::Summary();
+        return;
+    }
+    histogram->Summarize(out);
+}
+
+void Classes(std::vector<uint8_t>& out) {
+    out.clear();
+    for (uint32_t row = 1; row < 257; row++) {
+        for (uint32_t op = 0; op < OP_COUNT; op++) {
+            LatencyHistogram* histogram = histograms[row][op].load(std::memory_order_acquire);
+            if (histogram != nullptr && histogram->Count() > 0) {
+                out.push_back(static_cast<uint8_t>(row - 1));
+                break;
+            }
+        }
+    }
+}
+
+void Reset() {
+    for (uint32_t row = 0; row < 257; row++) {
+        for (uint32_t op = 0; op < OP_COUNT; op++) {
+            LatencyHistogram* histogram = histograms[row][op].load(std::memory_order_acquire);
+            if (histogram != nullptr) {
+                histogram->Reset();
+            }
+        }
+    }
+}
+
+}
@@ -0,0 +1,81 @@
+#ifndef LATENCY_STATS_H
+#define LATENCY_STATS_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <vector>
+
+// Fixed-size log-linear (HDR-style) histogram of microsecond latencies.
+// Values below 128 us are exact; above that every power of two is split into
+// 64 buckets, so a reported percentile is within 1.6% of the true value.
+// Values above ~71 minutes land in the last bucket. Add() is lock-free
+// (relaxed atomics) and safe from any thread.
+class LatencyHistogram {
+public:
+    struct Summary {
+        uint64_t count = 0;
+        uint64_t errors = 0;
+        uint64_t min_us = 0;
+        uint64_t max_us = 0;
+        double mean_us = 0;
+        uint64_t p50_us = 0;
+        uint64_t p90_us = 0;
+        uint64_t p99_us = 0;
+        uint64_t p999_us = 0;
+    };
+
+    static const uint32_t BUCKETS = 128 + 64 * 25;
+
+    LatencyHistogram();
+
+    void Add(uint64_t us, bool ok);
+    void Summarize(Summary& out) const;
+    uint64_t Count() const { return count_.load(std::memory_order_relaxed); }
+    // Not atomic against concurrent Add(); a sample racing a reset may be lost
+    void Reset();
+
+    static uint32_t Index(uint64_t us);
+    // Largest value that maps to bucket i
+    static uint64_t Upper(uint32_t i);
+
+private:
+    std::atomic<uint64_t> buckets_[BUCKETS];
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> errors_;
+    std::atomic<uint64_t> sum_;
+    std::atomic<uint64_t> min_;
+    std::atomic<uint64_t> max_;
+};
+
+// Process-wide request latencies, one histogram per request type for all
+// devices and one per request type and device class (hardware revision, 0 when
+// not known yet). Histograms are allocated on first use and never freed.
+namespace LatencyStats {
+
+enum Op {
+    OP_CONNECT = 0,
+    OP_INFO,
+    OP_MONITOR,
+    OP_STATISTICS,
+    OP_FG_STATISTICS,
+    OP_LOG_FILES,
+    OP_READ_LOG,
+    OP_COUNT
+};
+
+const char* OpName(Op op);
+
+// Monotonic microseconds, the timestamp passed back to Record()
+uint64_t Now();
+void Record(Op op, uint8_t hardware_revision, uint64_t start_us, bool ok);
+
+// hardware_revision -1 summarizes all devices
+void Summarize(Op op, int hardware_revision, LatencyHistogram::Summary& out);
+// Device classes that have recorded anything, ascending
+void Classes(std::vector<uint8_t>& out);
+void Reset();
+
+}
+
+#endif
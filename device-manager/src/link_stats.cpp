@@ -0,0 +1,238 @@
+#include "link_stats.h"
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "latency_stats.h"
+
+namespace LinkStats {
+
+namespace {
+
+const uint16_t RSP_TIMEOUT = 0x0008;     // Powermon::RSP_TIMEOUT
+
+struct Slice {
+    uint64_t epoch = 0;             // time / SLICE_SECONDS + 1, 0 when unused
+    uint32_t requests = 0;
+    uint32_t errors = 0;
+    uint32_t timeouts = 0;
+    uint32_t connects = 0;
+    uint32_t connect_failures = 0;
+    uint32_t disconnects[REASONS] = {};
+    uint32_t rssi_samples = 0;
+    int32_t rssi_sum = 0;
+    int16_t rssi_min = 0;
+    uint32_t rtt_max_ms = 0;
+    uint16_t rtt[RTT_BUCKETS] = {};
+};
+
+}
+
+struct Device {
+    std::mutex mutex;
+    uint64_t serial = 0;
+    uint8_t hardware_revision = 0;
+    bool connected = false;
+    uint64_t first_seen_s = 0;
+    Slice slices[SLICES];
+};
+
+namespace {
+
+std::mutex table_mutex;
+std::map<std::string, Device*> by_channel;
+std::vector<std::unique_ptr<Device>> devices;
+
+uint64_t NowSeconds() {
+    return LatencyStats::Now() / 1000000;
+}
+
+// Current slice, cleared when it last held an older part of the window.
+// Caller holds device.mutex
+Slice& Current(Device& device) {
+    const uint64_t epoch = NowSeconds() / SLICE_SECONDS + 1;
+    Slice& slice = device.slices[epoch % SLICES];
+    if (slice.epoch != epoch) {
+        slice = Slice();
+        slice.epoch = epoch;
+    }
+    return slice;
+}
+
+void Increment(uint16_t& counter) {
+    if (counter < UINT16_MAX) {
+        counter++;
+    }
+}
+
+uint32_t Percentile(const uint32_t* rtt, uint64_t count, double q) {
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(q * count + 0.5));
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < RTT_BUCKETS; i++) {
+        seen += rtt[i];
+        if (seen >= rank) {
+            return RttUpper(i);
+        }
+    }
+    return RttUpper(RTT_BUCKETS - 1);
+}
+
+}
+
+uint32_t RttIndex(uint32_t ms) {
+    if (ms < 16) {
+        return ms;
+    }
+    const uint32_t octave = 31 - __builtin_clz(ms);
+    const uint32_t index = 16 + (octave - 4) * 8 + ((ms >> (octave - 3)) & 7);
+    return std::min(index, RTT_BUCKETS - 1);
+}
+
+uint32_t RttUpper(uint32_t i) {
+    if (i < 16) {
+        return i;
+    }
+    const uint32_t octave = 4 + (i - 16) / 8;
+    const uint32_t step = 1u << (octave - 3);
+    return (8 + (i - 16) % 8) * step + step - 1;
+}
+
+Device* Attach(const uint8_t* channel_id, size_t length) {
+    const std::string key(reinterpret_cast<const char*>(channel_id), length);
+    std::lock_guard<std::mutex> lock(table_mutex);
+    auto it = by_channel.find(key);
+    if (it != by_channel.end()) {
+        return it->second;
+    }
+    devices.emplace_back(new Device());
+    Device* device = devices.back().get();
+    device->first_seen_s = NowSeconds();
+    by_channel[key] = device;
+    return device;
+}
+
+void SetSerial(Device* device, uint64_t serial, uint8_t hardware_revision) {
+    if (device == nullptr) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(device->mutex);
+    device->serial = serial;
+    device->hardware_revision = hardware_revision;
+}
+
+void RequestDone(Device* device, uint64_t rtt_us, uint16_t code) {
+    if (device == nullptr) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(device->mutex);
+    Slice& slice = Current(*device);
+    slice.requests++;
+    if (code != 0) {
+        slice.errors++;
+        if (code == RSP_TIMEOUT) {
+            slice.timeouts++;
+        }
+        return;
+    }
+    const uint32_t ms = static_cast<uint32_t>(std::min<uint64_t>(rtt_us / 1000, UINT32_MAX));
+    Increment(slice.rtt[RttIndex(ms)]);
+    slice.rtt_max_ms = std::max(slice.rtt_max_ms, ms);
+}
+
+void Connected(Device* device) {
+    if (device == nullptr) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(device->mutex);
+    device->connected = true;
+    Current(*device).connects++;
+}
+
+void Disconnected(Device* device, uint8_t reason, bool while_connecting) {
+    if (device == nullptr) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(device->mutex);
+    device->connected = false;
+    Slice& slice = Current(*device);
+    if (while_connecting) {
+        slice.connects++;
+        slice.connect_failures++;
+    } else {
+        slice.disconnects[reason < REASONS ? reason : REASONS - 1]++;
+    }
+}
+
+void Rssi(Device* device, int16_t rssi) {
+    if (device == nullptr) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(device->mutex);
+    Slice& slice = Current(*device);
+    slice.rssi_min = slice.rssi_samples == 0 ? rssi : std::min(slice.rssi_min, rssi);
+    slice.rssi_sum += rssi;
+    slice.rssi_samples++;
+}
+
+void Snapshot(std::vector<Row>& out) {
+    std::vector<Device*> table;
+    {
+        std::lock_guard<std::mutex> lock(table_mutex);
+        for (const auto& device : devices) {
+            table.push_back(device.get());
+        }
+    }
+
+    const uint64_t now = NowSeconds();
+    const uint64_t epoch = now / SLICE_SECONDS + 1;
+    out.assign(table.size(), Row());
+    for (size_t d = 0; d < table.size(); d++) {
+        Device& device = *table[d];
+        Row& row = out[d];
+        uint32_t rtt[RTT_BUCKETS] = {};
+        uint64_t rtt_count = 0;
+        int64_t rssi_sum = 0;
+
+        std::lock_guard<std::mutex> lock(device.mutex);
+        row.serial = device.serial;
+        row.hardware_revision = device.hardware_revision;
+        row.connected = device.connected;
+        row.observed_seconds = static_cast<uint32_t>(std::min<uint64_t>(now - device.first_seen_s, WINDOW_SECONDS));
+        for (const Slice& slice : device.slices) {
+            if (slice.epoch == 0 || slice.epoch + SLICES <= epoch) {
+                continue;
+            }
+            row.requests += slice.requests;
+            row.errors += slice.errors;
+            row.timeouts += slice.timeouts;
+            row.connects += slice.connects;
+            row.connect_failures += slice.connect_failures;
+            for (uint32_t r = 0; r < REASONS; r++) {
+                row.disconnects[r] += slice.disconnects[r];
+            }
+            if (slice.rssi_samples > 0) {
+                row.rssi_min = row.rssi_samples == 0 ? slice.rssi_min : std::min(row.rssi_min, slice.rssi_min);
+                row.rssi_samples += slice.rssi_samples;
+                rssi_sum += slice.rssi_sum;
+            }
+            row.rtt_max_ms = std::max(row.rtt_max_ms, slice.rtt_max_ms);
+            for (uint32_t i = 0; i < RTT_BUCKETS; i++) {
+                rtt[i] += slice.rtt[i];
+                rtt_count += slice.rtt[i];
+            }
+        }
+        if (row.rssi_samples > 0) {
+            row.rssi_mean = static_cast<double>(rssi_sum) / row.rssi_samples;
+        }
+        if (rtt_count > 0) {
+            row.rtt_p50_ms = std::min(Percentile(rtt, rtt_count, 0.50), row.rtt_max_ms);
+            row.rtt_p90_ms = std::min(Percentile(rtt, rtt_count, 0.90), row.rtt_max_ms);
+            row.rtt_p99_ms = std::min(Percentile(rtt, rtt_count, 0.99), row.rtt_max_ms);
+        }
+    }
+}
+
+}
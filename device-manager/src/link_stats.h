@@ -0,0 +1,68 @@
+#ifndef LINK_STATS_H
+#define LINK_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+// Rolling per-device link quality: request round trips, timeouts, connect
+// failures, disconnects by reason and rssi over the last WINDOW_SECONDS.
+// Devices are keyed by their WiFi channel id, so the numbers survive the
+// PowermonDevice being recreated on every reconnect. Each device keeps
+// SLICES fixed time slices that are recycled as the window moves, with a
+// coarse log-linear round trip histogram per slice (~1.5 KB per device).
+// Entries are never freed.
+namespace LinkStats {
+
+const uint32_t SLICE_SECONDS = 600;
+const uint32_t SLICES = 6;
+const uint32_t WINDOW_SECONDS = SLICE_SECONDS * SLICES;
+const uint32_t REASONS = 8;     // Powermon::DisconnectReason, last one collects unknown values
+
+// Round trips in ms: exact below 16 ms, 8 buckets per power of two above,
+// up to ~131 s
+const uint32_t RTT_BUCKETS = 16 + 13 * 8;
+
+uint32_t RttIndex(uint32_t ms);
+// Largest value that maps to bucket i
+uint32_t RttUpper(uint32_t i);
+
+struct Device;
+
+// Table entry for a channel id, added on first use
+Device* Attach(const uint8_t* channel_id, size_t length);
+void SetSerial(Device* device, uint64_t serial, uint8_t hardware_revision);
+
+// A null device (not attached yet) is ignored by all of these
+void RequestDone(Device* device, uint64_t rtt_us, uint16_t code);
+void Connected(Device* device);
+void Disconnected(Device* device, uint8_t reason, bool while_connecting);
+void Rssi(Device* device, int16_t rssi);
+
+struct Row {
+    uint64_t serial = 0;            // 0 until known
+    uint8_t hardware_revision = 0;
+    bool connected = false;
+    uint32_t observed_seconds = 0;  // part of the window the device has been in the table
+    uint32_t requests = 0;
+    uint32_t errors = 0;            // includes timeouts
+    uint32_t timeouts = 0;
+    uint32_t rtt_p50_ms = 0;
+    uint32_t rtt_p90_ms = 0;
+    uint32_t rtt_p99_ms = 0;
+    uint32_t rtt_max_ms = 0;
+    uint32_t connects = 0;
+    uint32_t connect_failures = 0;
+    uint32_t disconnects[REASONS] = {};
+    uint32_t rssi_samples = 0;
+    int16_t rssi_min = 0;
+    double rssi_mean = 0;
+};
+
+// One row per attached device, in table order
+void Snapshot(std::vector<Row>& out);
+
+}
+
+#endif
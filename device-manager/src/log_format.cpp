@@ -0,0 +1,142 @@
+#include "log_format.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+
+namespace LogFormat {
+
+namespace {
+
+uint32_t Quantize(float value, float scale, int32_t min, int32_t max, uint32_t bits) {
+    double scaled = round(static_cast<double>(value) * scale);
+    if (!(scaled >= min)) {
+        scaled = min;
+    } else if (scaled > max) {
+        scaled = max;
+    }
+    // Signed fields are two's complement in 'bits' bits
+    return static_cast<uint32_t>(static_cast<int32_t>(scaled)) & ((1u << bits) - 1);
+}
+
+}
+
+bool ParseHeader(const uint8_t* data, size_t size, Header& header) {
+    if (data == nullptr || size < HEADER_SIZE) {
+        return false;
+    }
+
+    memcpy(&header, data, HEADER_SIZE);
+
+    if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+        return false;
+    }
+
+    return SamplePeriod(header.mode) != 0;
+}
+
+void WriteHeader(const Header& header, uint8_t* out) {
+    Header h = header;
+    memcpy(h.magic, MAGIC, sizeof(MAGIC));
+    memcpy(out, &h, HEADER_SIZE);
+}
+
+uint32_t SamplePeriod(uint8_t mode) {
+    switch (mode) {
+        case PowermonConfig::LOG_MODE_1_SEC: return 1;
+        case PowermonConfig::LOG_MODE_2_SEC: return 2;
+        case PowermonConfig::LOG_MODE_5_SEC: return 5;
+        case PowermonConfig::LOG_MODE_10_SEC: return 10;
+        case PowermonConfig::LOG_MODE_20_SEC: return 20;
+        case PowermonConfig::LOG_MODE_30_SEC: return 30;
+        case PowermonConfig::LOG_MODE_60_SEC: return 60;
+    }
+    return 0;
+}
+
+uint32_t SampleBits(uint32_t mask) {
+    uint32_t bits = V_BITS + I_BITS + T_BITS + SOC_BITS + PS_BITS;
+    if (mask & MASK_V2) {
+        bits += V_BITS;
+    }
+    return bits;
+}
+
+uint32_t SampleCount(uint32_t mask, uint32_t file_size) {
+    if (file_size <= HEADER_SIZE) {
+        return 0;
+    }
+    return static_cast<uint32_t>((static_cast<uint64_t>(file_size - HEADER_SIZE) * 8) / SampleBits(mask));
+}
+
+uint32_t FileSize(uint32_t mask, uint32_t sample_count) {
+    return HEADER_SIZE + static_cast<uint32_t>((static_cast<uint64_t>(sample_count) * SampleBits(mask) + 7) / 8);
+}
+
+Writer::Writer(uint8_t* out, uint64_t offset, size_t size)
+    : out_(out)
+    , begin_bit_(offset * 8)
+    , end_bit_((offset + size) * 8) {
+}
+
+void Writer::Put(uint64_t bit, uint32_t value, uint32_t bits) {
+    for (uint32_t i = 0; i < bits; i++, bit++) {
+        if (bit < begin_bit_ || bit >= end_bit_) {
+            continue;
+        }
+        if ((value >> (bits - 1 - i)) & 1) {
+            uint64_t pos = bit - begin_bit_;
+            out_[pos / 8] |= static_cast<uint8_t>(0x80 >> (pos % 8));
+        }
+    }
+}
+
+void Writer::WriteHeader(const Header& header) {
+    uint8_t bytes[HEADER_SIZE];
+    LogFormat::WriteHeader(header, bytes);
+    for (uint32_t i = 0; i < HEADER_SIZE; i++) {
+        Put(static_cast<uint64_t>(i) * 8, bytes[i], 8);
+    }
+}
+
+void Writer::WriteRecord(uint32_t mask, uint32_t index, const PowermonLogFile::Sample& sample) {
+    uint64_t bit = HEADER_BITS + static_cast<uint64_t>(index) * SampleBits(mask);
+
+    Put(bit, Quantize(sample.voltage1, 1000.0f, 0, (1 << V_BITS) - 1, V_BITS), V_BITS);
+    bit += V_BITS;
+    if (mask & MASK_V2) {
+        Put(bit, Quantize(sample.voltage2, 1000.0f, 0, (1 << V_BITS) - 1, V_BITS), V_BITS);
+        bit += V_BITS;
+    }
+    Put(bit, Quantize(sample.current, 1000.0f, -I_LIMIT, I_LIMIT - 1, I_BITS), I_BITS);
+    bit += I_BITS;
+    Put(bit, Quantize(sample.temperature, 4.0f, -(1 << (T_BITS - 1)), (1 << (T_BITS - 1)) - 1, T_BITS), T_BITS);
+    bit += T_BITS;
+    Put(bit, std::min<uint32_t>(sample.soc, (1 << SOC_BITS) - 1), SOC_BITS);
+    bit += SOC_BITS;
+    Put(bit, sample.ps & ((1 << PS_BITS) - 1), PS_BITS);
+}
+
+void Writer::RecordRange(uint32_t mask, uint64_t offset, size_t size, uint32_t& first, uint32_t& last) {
+    const uint64_t bits = SampleBits(mask);
+    const uint64_t begin_bit = offset * 8;
+    const uint64_t end_bit = (offset + size) * 8;
+
+    first = begin_bit <= HEADER_BITS ? 0 : static_cast<uint32_t>((begin_bit - HEADER_BITS) / bits);
+    last = end_bit <= HEADER_BITS ? 0 : static_cast<uint32_t>((end_bit - HEADER_BITS + bits - 1) / bits);
+}
+
+void Encode(const Header& header, const PowermonLogFile::Sample* samples, size_t count,
+            std::vector<uint8_t>& out) {
+    size_t size = FileSize(header.mask, static_cast<uint32_t>(count));
+    out.assign(size, 0);
+
+    Writer writer(out.data(), 0, size);
+    writer.WriteHeader(header);
+    for (size_t i = 0; i < count; i++) {
+        writer.WriteRecord(header.mask, static_cast<uint32_t>(i), samples[i]);
+    }
+}
+
+}
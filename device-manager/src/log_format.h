@@ -0,0 +1,92 @@
+#ifndef LOG_FORMAT_H
+#define LOG_FORMAT_H
+
+#include <powermon_log.h>
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <vector>
+
+// On-device layout of a PowerMon log file. PowermonLogFile keeps its Header and
+// Mask definitions private, so the parts we need to seek inside a file without
+// decoding all of it are mirrored here.
+//
+// A file is a 20 byte header followed by an MSB-first bitstream of fixed-width
+// records, one per sample period:
+//
+//   V1 (17 bits, mV) [V2 (17 bits, mV) if MASK_V2] I (21 bits, signed mA)
+//   T (10 bits, signed 0.25 C) SOC (7 bits) PS (4 bits)
+//
+// Records are not byte aligned; record k starts at bit HEADER_BITS + k * bits.
+namespace LogFormat {
+
+static const uint8_t MAGIC[4] = { 'P', 'M', 'O', 'N' };
+static const uint32_t HEADER_SIZE = 20;
+static const uint32_t HEADER_BITS = HEADER_SIZE * 8;
+
+static const uint32_t MASK_V2 = (1 << 1);
+static const uint32_t FLAG_POWER_VOLTAGE_SOURCE = (1 << 0);
+
+static const uint32_t V_BITS = 17;
+static const uint32_t I_BITS = 21;
+// PowermonLogFile::decode() sign-extends I from bit 19, so only +/-524.287 A
+// survive a round trip; the encoder saturates there
+static const int32_t I_LIMIT = 1 << (I_BITS - 2);
+static const uint32_t T_BITS = 10;
+static const uint32_t SOC_BITS = 7;
+static const uint32_t PS_BITS = 4;
+
+struct Header {
+    uint8_t magic[4];
+    uint8_t version;
+    uint8_t mode;
+    uint16_t reserved0;
+    uint32_t time;
+    uint32_t mask;
+    uint32_t flags;
+};
+
+static_assert(sizeof(Header) == HEADER_SIZE, "PowerMon log header must be 20 bytes");
+
+// Returns false if the buffer does not start with a valid log file header
+bool ParseHeader(const uint8_t* data, size_t size, Header& header);
+void WriteHeader(const Header& header, uint8_t* out);
+
+uint32_t SamplePeriod(uint8_t mode);
+uint32_t SampleBits(uint32_t mask);
+
+// Number of complete records in a file of the given size
+uint32_t SampleCount(uint32_t mask, uint32_t file_size);
+
+// Size in bytes of a file holding sample_count records
+uint32_t FileSize(uint32_t mask, uint32_t sample_count);
+
+// Produces the byte window [offset, offset + size) of a log file. Bits outside
+// the window are dropped, so any part of a file can be written without
+// encoding the records before it. The window must be zeroed by the caller.
+class Writer {
+public:
+    Writer(uint8_t* out, uint64_t offset, size_t size);
+
+    void WriteHeader(const Header& header);
+    void WriteRecord(uint32_t mask, uint32_t index, const PowermonLogFile::Sample& sample);
+
+    // Records that overlap the window, as [first, last)
+    static void RecordRange(uint32_t mask, uint64_t offset, size_t size, uint32_t& first, uint32_t& last);
+
+private:
+    uint8_t* out_;
+    uint64_t begin_bit_;
+    uint64_t end_bit_;
+
+    void Put(uint64_t bit, uint32_t value, uint32_t bits);
+};
+
+// Encodes a complete file; the inverse of PowermonLogFile::decode()
+void Encode(const Header& header, const PowermonLogFile::Sample* samples, size_t count,
+            std::vector<uint8_t>& out);
+
+}
+
+#endif
@@ -0,0 +1,147 @@
+#include "log_index.h"
+
+#include <string.h>
+
+uint32_t LogFileIndex::Entry::SampleCount() const {
+    return LogFormat::SampleCount(mask, size);
+}
+
+uint32_t LogFileIndex::Entry::EndTime() const {
+    uint32_t count = SampleCount();
+    return count == 0 ? start_time : start_time + (count - 1) * sample_period;
+}
+
+uint64_t LogFileIndex::Entry::BitOffset(uint32_t sample) const {
+    return LogFormat::HEADER_BITS + static_cast<uint64_t>(sample) * sample_bits;
+}
+
+bool LogFileIndex::Learn(uint32_t file_id, uint32_t file_size, const uint8_t* data, size_t size) {
+    LogFormat::Header header;
+    if (!LogFormat::ParseHeader(data, size, header)) {
+        return false;
+    }
+
+    Entry entry;
+    entry.file_id = file_id;
+    entry.size = file_size;
+    entry.start_time = header.time;
+    entry.mode = header.mode;
+    entry.mask = header.mask;
+    entry.flags = header.flags;
+    entry.sample_period = LogFormat::SamplePeriod(header.mode);
+    entry.sample_bits = LogFormat::SampleBits(header.mask);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_[file_id] = entry;
+    return true;
+}
+
+void LogFileIndex::UpdateSize(uint32_t file_id, uint32_t file_size) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(file_id);
+    if (it != entries_.end()) {
+        it->second.size = file_size;
+    }
+}
+
+void LogFileIndex::Forget(uint32_t file_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.erase(file_id);
+}
+
+bool LogFileIndex::Find(uint32_t file_id, Entry& entry) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(file_id);
+    if (it == entries_.end()) {
+        return false;
+    }
+    entry = it->second;
+    return true;
+}
+
+std::vector<LogFileIndex::Entry> LogFileIndex::Entries() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<Entry> result;
+    result.reserve(entries_.size());
+    for (const auto& it : entries_) {
+        result.push_back(it.second);
+    }
+    return result;
+}
+
+bool LogFileIndex::Locate(uint32_t file_id, uint32_t since, uint32_t until, Range& range) const {
+    Entry entry;
+    if (!Find(file_id, entry)) {
+        return false;
+    }
+
+    uint32_t count = entry.SampleCount();
+    if (count == 0 || since > until || until < entry.start_time || since > entry.EndTime()) {
+        return false;
+    }
+
+    // First sample at or after 'since', last sample at or before 'until'
+    uint32_t first = 0;
+    if (since > entry.start_time) {
+        first = (since - entry.start_time + entry.sample_period - 1) / entry.sample_period;
+    }
+    uint32_t last = count - 1;
+    if (until < entry.EndTime()) {
+        last = (until - entry.start_time) / entry.sample_period;
+    }
+    if (first > last) {
+        return false;
+    }
+
+    uint64_t begin_bit = entry.BitOffset(first);
+    uint64_t end_bit = entry.BitOffset(last + 1);
+
+    range.offset = static_cast<uint32_t>(begin_bit / 8);
+    range.size = static_cast<uint32_t>((end_bit + 7) / 8) - range.offset;
+    range.first_sample = first;
+    range.first_time = entry.start_time + first * entry.sample_period;
+    range.sample_count = last - first + 1;
+    return true;
+}
+
+bool LogFileIndex::DecodeRange(const Entry& entry, const Range& range, const uint8_t* data, size_t size,
+                               std::vector<PowermonLogFile::Sample>& samples) {
+    if (data == nullptr || size == 0) {
+        return false;
+    }
+
+    const uint32_t shift = static_cast<uint32_t>(entry.BitOffset(range.first_sample) % 8);
+
+    LogFormat::Header header;
+    memset(&header, 0, sizeof(header));
+    header.mode = entry.mode;
+    header.time = range.first_time;
+    header.mask = entry.mask;
+    header.flags = entry.flags;
+
+    std::vector<char> buffer(LogFormat::HEADER_SIZE + size);
+    LogFormat::WriteHeader(header, reinterpret_cast<uint8_t*>(buffer.data()));
+
+    uint8_t* out = reinterpret_cast<uint8_t*>(buffer.data()) + LogFormat::HEADER_SIZE;
+    if (shift == 0) {
+        memcpy(out, data, size);
+    } else {
+        // The leading 'shift' bits belong to the previous record; the zero bits
+        // shifted in at the end are never enough to form another record.
+        for (size_t i = 0; i < size; i++) {
+            uint8_t next = (i + 1 < size) ? data[i + 1] : 0;
+            out[i] = static_cast<uint8_t>((data[i] << shift) | (next >> (8 - shift)));
+        }
+    }
+
+    std::vector<PowermonLogFile::Sample> decoded;
+    if (PowermonLogFile::decode(buffer, decoded) == 0) {
+        return false;
+    }
+
+    if (decoded.size() > range.sample_count) {
+        decoded.resize(range.sample_count);
+    }
+    samples.insert(samples.end(), decoded.begin(), decoded.end());
+    return !decoded.empty();
+}
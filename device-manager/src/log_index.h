@@ -0,0 +1,62 @@
+#ifndef LOG_INDEX_H
+#define LOG_INDEX_H
+
+#include "log_format.h"
+
+#include <map>
+#include <mutex>
+#include <vector>
+
+// Per-device index of log files learned from their headers. Since the sample
+// period is fixed for a file, a header is enough to map any time to the byte
+// range holding its records, so partial syncs only read the bytes they need.
+class LogFileIndex {
+public:
+    struct Entry {
+        uint32_t file_id;
+        uint32_t size;
+        uint32_t start_time;
+        uint8_t mode;
+        uint32_t mask;
+        uint32_t flags;
+        uint32_t sample_period;
+        uint32_t sample_bits;
+
+        uint32_t SampleCount() const;
+        uint32_t EndTime() const;
+        uint64_t BitOffset(uint32_t sample) const;
+    };
+
+    // Bytes of a file covering records [first_sample, first_sample + sample_count)
+    struct Range {
+        uint32_t offset;
+        uint32_t size;
+        uint32_t first_sample;
+        uint32_t first_time;
+        uint32_t sample_count;
+    };
+
+    // Records the header of a file. Returns false if data is not a log file header.
+    bool Learn(uint32_t file_id, uint32_t file_size, const uint8_t* data, size_t size);
+    void UpdateSize(uint32_t file_id, uint32_t file_size);
+    void Forget(uint32_t file_id);
+
+    bool Find(uint32_t file_id, Entry& entry) const;
+    std::vector<Entry> Entries() const;
+
+    // Finds the bytes holding samples with since <= time <= until.
+    // Returns false if the file is unknown or has no samples in that window.
+    bool Locate(uint32_t file_id, uint32_t since, uint32_t until, Range& range) const;
+
+    // Decodes bytes read at range.offset. The records are not byte aligned, so the
+    // data is shifted back onto a byte boundary behind a synthesized header and
+    // handed to PowermonLogFile::decode.
+    static bool DecodeRange(const Entry& entry, const Range& range, const uint8_t* data, size_t size,
+                            std::vector<PowermonLogFile::Sample>& samples);
+
+private:
+    mutable std::mutex mutex_;
+    std::map<uint32_t, Entry> entries_;
+};
+
+#endif
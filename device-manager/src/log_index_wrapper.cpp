@@ -0,0 +1,259 @@
+#include "log_index_wrapper.h"
+#include "powermon_wrapper.h"
+#include "packed_samples_wrapper.h"
+
+#include <cmath>
+
+namespace {
+
+const char* const UINT32_RANGE = " must be an integer from 0 to 4294967295";
+
+// File ids, sizes, log timestamps and range fields are uint32 on the device
+bool ReadUint32(Napi::Value value, uint32_t& out) {
+    if (!value.IsNumber()) {
+        return false;
+    }
+    const double number = value.As<Napi::Number>().DoubleValue();
+    if (!(number >= 0 && number <= UINT32_MAX) || number != std::floor(number)) {
+        return false;
+    }
+    out = static_cast<uint32_t>(number);
+    return true;
+}
+
+bool IsBytes(Napi::Value value) {
+    return value.IsTypedArray() && value.As<Napi::TypedArray>().TypedArrayType() == napi_uint8_array;
+}
+
+void ThrowRange(Napi::Env env, const char* name) {
+    Napi::RangeError::New(env, std::string(name) + UINT32_RANGE).ThrowAsJavaScriptException();
+}
+
+}
+
+Napi::Object LogIndexWrapper::Init(Napi::Env env, Napi::Object exports) {
+    Napi::Function func = DefineClass(env, "LogIndex", {
+        InstanceMethod("learn", &LogIndexWrapper::Learn),
+        InstanceMethod("updateSize", &LogIndexWrapper::UpdateSize),
+        InstanceMethod("forget", &LogIndexWrapper::Forget),
+        InstanceMethod("has", &LogIndexWrapper::Has),
+        InstanceMethod("getEntry", &LogIndexWrapper::GetEntry),
+        InstanceMethod("entries", &LogIndexWrapper::GetEntries),
+        InstanceMethod("locate", &LogIndexWrapper::Locate),
+        InstanceMethod("decodeRange", &LogIndexWrapper::DecodeRange),
+    });
+
+    exports.Set("LogIndex", func);
+    return exports;
+}
+
+LogIndexWrapper::LogIndexWrapper(const Napi::CallbackInfo& info)
+    : Napi::ObjectWrap<LogIndexWrapper>(info) {
+}
+
+Napi::Object LogIndexWrapper::EntryToObject(Napi::Env env, const LogFileIndex::Entry& entry) {
+    Napi::Object obj = Napi::Object::New(env);
+    obj.Set("fileId", Napi::Number::New(env, entry.file_id));
+    obj.Set("size", Napi::Number::New(env, entry.size));
+    obj.Set("startTime", Napi::Number::New(env, entry.start_time));
+    obj.Set("endTime", Napi::Number::New(env, entry.EndTime()));
+    obj.Set("mode", Napi::Number::New(env, entry.mode));
+    obj.Set("mask", Napi::Number::New(env, entry.mask));
+    obj.Set("flags", Napi::Number::New(env, entry.flags));
+    obj.Set("samplePeriod", Napi::Number::New(env, entry.sample_period));
+    obj.Set("sampleBits", Napi::Number::New(env, entry.sample_bits));
+    obj.Set("sampleCount", Napi::Number::New(env, entry.SampleCount()));
+    return obj;
+}
+
+Napi::Object LogIndexWrapper::RangeToObject(Napi::Env env, const LogFileIndex::Range& range) {
+    Napi::Object obj = Napi::Object::New(env);
+    obj.Set("offset", Napi::Number::New(env, range.offset));
+    obj.Set("size", Napi::Number::New(env, range.size));
+    obj.Set("firstSample", Napi::Number::New(env, range.first_sample));
+    obj.Set("firstTime", Napi::Number::New(env, range.first_time));
+    obj.Set("sampleCount", Napi::Number::New(env, range.sample_count));
+    return obj;
+}
+
+Napi::Value LogIndexWrapper::Learn(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 3 || !info[0].IsNumber() || !info[1].IsNumber() || !IsBytes(info[2])) {
+        Napi::TypeError::New(env, "fileId, fileSize and header bytes expected")
+            .ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    uint32_t file_id, file_size;
+    if (!ReadUint32(info[0], file_id) || !ReadUint32(info[1], file_size)) {
+        ThrowRange(env, "fileId and fileSize");
+        return env.Undefined();
+    }
+    Napi::Uint8Array data = info[2].As<Napi::Uint8Array>();
+
+    return Napi::Boolean::New(env, index_.Learn(file_id, file_size, data.Data(), data.ByteLength()));
+}
+
+Napi::Value LogIndexWrapper::UpdateSize(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsNumber()) {
+        Napi::TypeError::New(env, "fileId and fileSize expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    uint32_t file_id, file_size;
+    if (!ReadUint32(info[0], file_id) || !ReadUint32(info[1], file_size)) {
+        ThrowRange(env, "fileId and fileSize");
+        return env.Undefined();
+    }
+
+    index_.UpdateSize(file_id, file_size);
+    return env.Undefined();
+}
+
+Napi::Value LogIndexWrapper::Forget(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsNumber()) {
+        Napi::TypeError::New(env, "fileId expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    uint32_t file_id;
+    if (!ReadUint32(info[0], file_id)) {
+        ThrowRange(env, "fileId");
+        return env.Undefined();
+    }
+
+    index_.Forget(file_id);
+    return env.Undefined();
+}
+
+Napi::Value LogIndexWrapper::Has(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsNumber()) {
+        Napi::TypeError::New(env, "fileId expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    uint32_t file_id;
+    if (!ReadUint32(info[0], file_id)) {
+        ThrowRange(env, "fileId");
+        return env.Undefined();
+    }
+
+    LogFileIndex::Entry entry;
+    return Napi::Boolean::New(env, index_.Find(file_id, entry));
+}
+
+Napi::Value LogIndexWrapper::GetEntry(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsNumber()) {
+        Napi::TypeError::New(env, "fileId expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    uint32_t file_id;
+    if (!ReadUint32(info[0], file_id)) {
+        ThrowRange(env, "fileId");
+        return env.Undefined();
+    }
+
+    LogFileIndex::Entry entry;
+    if (!index_.Find(file_id, entry)) {
+        return env.Null();
+    }
+    return EntryToObject(env, entry);
+}
+
+Napi::Value LogIndexWrapper::GetEntries(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    std::vector<LogFileIndex::Entry> entries = index_.Entries();
+    Napi::Array arr = Napi::Array::New(env, entries.size());
+    for (size_t i = 0; i < entries.size(); i++) {
+        arr.Set(i, EntryToObject(env, entries[i]));
+    }
+    return arr;
+}
+
+Napi::Value LogIndexWrapper::Locate(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsNumber()) {
+        Napi::TypeError::New(env, "fileId and since timestamp expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    uint32_t file_id, since;
+    uint32_t until = UINT32_MAX;
+    if (!ReadUint32(info[0], file_id) || !ReadUint32(info[1], since) ||
+        (info.Length() > 2 && !info[2].IsUndefined() && !ReadUint32(info[2], until))) {
+        ThrowRange(env, "fileId, since and until");
+        return env.Undefined();
+    }
+
+    LogFileIndex::Range range;
+    if (!index_.Locate(file_id, since, until, range)) {
+        return env.Null();
+    }
+    return RangeToObject(env, range);
+}
+
+Napi::Value LogIndexWrapper::DecodeRange(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 3 || !info[0].IsNumber() || !info[1].IsObject() || !IsBytes(info[2])) {
+        Napi::TypeError::New(env, "fileId, range and data expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    uint32_t file_id;
+    if (!ReadUint32(info[0], file_id)) {
+        ThrowRange(env, "fileId");
+        return env.Undefined();
+    }
+
+    Napi::Object r = info[1].As<Napi::Object>();
+    LogFileIndex::Range range;
+    if (!ReadUint32(r.Get("offset"), range.offset) || !ReadUint32(r.Get("size"), range.size) ||
+        !ReadUint32(r.Get("firstSample"), range.first_sample) || !ReadUint32(r.Get("firstTime"), range.first_time) ||
+        !ReadUint32(r.Get("sampleCount"), range.sample_count)) {
+        ThrowRange(env, "range offset, size, firstSample, firstTime and sampleCount");
+        return env.Undefined();
+    }
+
+    LogFileIndex::Entry entry;
+    if (!index_.Find(file_id, entry)) {
+        Napi::Error::New(env, "Log file not in index").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    Napi::Uint8Array data = info[2].As<Napi::Uint8Array>();
+
+    std::vector<PowermonLogFile::Sample> samples;
+    bool success = LogFileIndex::DecodeRange(entry, range, data.Data(), data.ByteLength(), samples);
+
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("success", Napi::Boolean::New(env, success));
+    result.Set("startTime", Napi::Number::New(env, range.first_time));
+
+    if (PackedSamplesWrapper::WantsPacked(info, 3)) {
+        PackedSamples packed;
+        packed.Append(samples);
+        result.Set("packed", PackedSamplesWrapper::ToObject(env, packed));
+        return result;
+    }
+
+    Napi::Array arr = Napi::Array::New(env, samples.size());
+    for (size_t i = 0; i < samples.size(); i++) {
+        arr.Set(i, PowermonWrapper::SampleToObject(env, samples[i]));
+    }
+    result.Set("samples", arr);
+
+    return result;
+}
@@ -0,0 +1,29 @@
+#ifndef LOG_INDEX_WRAPPER_H
+#define LOG_INDEX_WRAPPER_H
+
+#include <napi.h>
+
+#include "log_index.h"
+
+class LogIndexWrapper : public Napi::ObjectWrap<LogIndexWrapper> {
+public:
+    static Napi::Object Init(Napi::Env env, Napi::Object exports);
+    LogIndexWrapper(const Napi::CallbackInfo& info);
+
+    Napi::Value Learn(const Napi::CallbackInfo& info);
+    Napi::Value UpdateSize(const Napi::CallbackInfo& info);
+    Napi::Value Forget(const Napi::CallbackInfo& info);
+    Napi::Value Has(const Napi::CallbackInfo& info);
+    Napi::Value GetEntry(const Napi::CallbackInfo& info);
+    Napi::Value GetEntries(const Napi::CallbackInfo& info);
+    Napi::Value Locate(const Napi::CallbackInfo& info);
+    Napi::Value DecodeRange(const Napi::CallbackInfo& info);
+
+private:
+    LogFileIndex index_;
+
+    static Napi::Object EntryToObject(Napi::Env env, const LogFileIndex::Entry& entry);
+    static Napi::Object RangeToObject(Napi::Env env, const LogFileIndex::Range& range);
+};
+
+#endif
@@ -0,0 +1,276 @@
+#include "native_metrics.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+
+#include <atomic>
+
+#include "instance_reaper.h"
+#include "resource_stats.h"
+
+namespace NativeMetrics {
+
+namespace {
+
+const uint32_t REASONS = 8;     // Powermon::DisconnectReason, last one collects unknown values
+
+const char* const REASON_NAMES[REASONS] = {
+    "closed", "no_route", "failed", "unexpected_error", "unexpected_response", "write_error",
+    "read_error", "other"
+};
+
+std::atomic<int64_t> instances(0);
+std::atomic<int64_t> connected(0);
+std::atomic<int64_t> in_flight[LatencyStats::OP_COUNT];
+std::atomic<uint64_t> completed[LatencyStats::OP_COUNT];
+std::atomic<uint64_t> errors[LatencyStats::OP_COUNT];
+std::atomic<uint64_t> connect_failures[REASONS];
+std::atomic<uint64_t> disconnects[REASONS];
+std::atomic<int64_t> hibernating(0);
+std::atomic<uint64_t> hibernations(0);
+std::atomic<uint64_t> log_bytes(0);
+std::atomic<uint64_t> decode_bytes(0);
+std::atomic<uint64_t> decode_samples(0);
+std::atomic<int64_t> queue_depth(0);
+std::atomic<uint64_t> queue_dropped(0);
+
+LatencyHistogram& DecodeTime() {
+    static LatencyHistogram* histogram = new LatencyHistogram();
+    return *histogram;
+}
+
+LatencyHistogram& DeliveryDelay() {
+    static LatencyHistogram* histogram = new LatencyHistogram();
+    return *histogram;
+}
+
+void Append(std::string& out, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+void Append(std::string& out, const char* format, ...) {
+    char line[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    if (length > 0) {
+        out.append(line, length < static_cast<int>(sizeof(line)) ? length : sizeof(line) - 1);
+    }
+}
+
+void Header(std::string& out, const char* name, const char* type, const char* help) {
+    Append(out, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+// Summary with quantiles from a latency histogram, in seconds
+void Quantiles(std::string& out, const char* name, const char* labels, const LatencyHistogram::Summary& summary) {
+    const char* const separator = labels[0] ? "," : "";
+    const double quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+    const uint64_t values[] = { summary.p50_us, summary.p90_us, summary.p99_us, summary.p999_us };
+    for (uint32_t i = 0; i < 4; i++) {
+        Append(out, "%s{%s%squantile=\"%g\"} %.6f\n", name, labels, separator, quantiles[i], values[i] / 1e6);
+    }
+    const char* const open = labels[0] ? "{" : "";
+    const char* const close = labels[0] ? "}" : "";
+    Append(out, "%s_sum%s%s%s %.6f\n", name, open, labels, close, summary.mean_us * summary.count / 1e6);
+    Append(out, "%s_count%s%s%s %llu\n", name, open, labels, close,
+           static_cast<unsigned long long>(summary.count));
+}
+
+}
+
+void InstanceCreated() {
+    instances.fetch_add(1, std::memory_order_relaxed);
+}
+
+void InstanceDestroyed() {
+    instances.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void RequestStarted(LatencyStats::Op op) {
+    in_flight[op].fetch_add(1, std::memory_order_relaxed);
+}
+
+void RequestFinished(LatencyStats::Op op, bool ok) {
+    in_flight[op].fetch_sub(1, std::memory_order_relaxed);
+    completed[op].fetch_add(1, std::memory_order_relaxed);
+    if (!ok) {
+        errors[op].fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void ConnectStarted() {
+    RequestStarted(LatencyStats::OP_CONNECT);
+}
+
+void Connected() {
+    RequestFinished(LatencyStats::OP_CONNECT, true);
+    connected.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Disconnected(uint8_t reason, bool while_connecting) {
+    const uint32_t index = reason < REASONS ? reason : REASONS - 1;
+    if (while_connecting) {
+        RequestFinished(LatencyStats::OP_CONNECT, false);
+        connect_failures[index].fetch_add(1, std::memory_order_relaxed);
+    } else {
+        connected.fetch_sub(1, std::memory_order_relaxed);
+        disconnects[index].fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void Hibernated(bool was_connected) {
+    if (was_connected) {
+        connected.fetch_sub(1, std::memory_order_relaxed);
+        hibernations.fetch_add(1, std::memory_order_relaxed);
+    }
+    hibernating.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Woken() {
+    hibernating.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void LogBytesRead(size_t bytes) {
+    log_bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void Decoded(uint64_t duration_us, size_t bytes, size_t samples) {
+    DecodeTime().Add(duration_us, samples > 0);
+    decode_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    decode_samples.fetch_add(samples, std::memory_order_relaxed);
+}
+
+uint64_t Queued() {
+    queue_depth.fetch_add(1, std::memory_order_relaxed);
+    return LatencyStats::Now();
+}
+
+void Delivered(uint64_t queued_us) {
+    queue_depth.fetch_sub(1, std::memory_order_relaxed);
+    const uint64_t now = LatencyStats::Now();
+    DeliveryDelay().Add(now > queued_us ? now - queued_us : 0, true);
+}
+
+void Dropped() {
+    queue_depth.fetch_sub(1, std::memory_order_relaxed);
+    queue_dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Render(std::string& out) {
+    char labels[64];
+    LatencyHistogram::Summary summary;
+
+    Header(out, "dm_native_instances", "gauge", "PowermonDevice instances alive");
+    Append(out, "dm_native_instances %lld\n\n", static_cast<long long>(instances.load()));
+
+    Header(out, "dm_native_devices_connected", "gauge", "Devices connected according to library callbacks");
+    Append(out, "dm_native_devices_connected %lld\n\n", static_cast<long long>(connected.load()));
+
+    Header(out, "dm_native_devices_hibernating", "gauge", "Devices disconnected by hibernate() and not woken yet");
+    Append(out, "dm_native_devices_hibernating %lld\n\n", static_cast<long long>(hibernating.load()));
+
+    Header(out, "dm_native_hibernations_total", "counter", "Connected devices put into hibernation");
+    Append(out, "dm_native_hibernations_total %llu\n\n", static_cast<unsigned long long>(hibernations.load()));
+
+    Header(out, "dm_native_requests_in_flight", "gauge", "Library requests submitted and not yet answered");
+    for (uint32_t op = 0; op < LatencyStats::OP_COUNT; op++) {
+        Append(out, "dm_native_requests_in_flight{op=\"%s\"} %lld\n",
+               LatencyStats::OpName(static_cast<LatencyStats::Op>(op)), static_cast<long long>(in_flight[op].load()));
+    }
+    out += '\n';
+
+    Header(out, "dm_native_requests_total", "counter", "Library requests completed");
+    for (uint32_t op = 0; op < LatencyStats::OP_COUNT; op++) {
+        Append(out, "dm_native_requests_total{op=\"%s\"} %llu\n",
+               LatencyStats::OpName(static_cast<LatencyStats::Op>(op)), static_cast<unsigned long long>(completed[op].load()));
+    }
+    out += '\n';
+
+    Header(out, "dm_native_request_errors_total", "counter", "Library requests completed with an error code");
+    for (uint32_t op = 0; op < LatencyStats::OP_COUNT; op++) {
+        Append(out, "dm_native_request_errors_total{op=\"%s\"} %llu\n",
+               LatencyStats::OpName(static_cast<LatencyStats::Op>(op)), static_cast<unsigned long long>(errors[op].load()));
+    }
+    out += '\n';
+
+    Header(out, "dm_native_request_duration_seconds", "summary", "Submission to library callback, since the last getLatencyStats reset");
+    for (uint32_t op = 0; op < LatencyStats::OP_COUNT; op++) {
+        LatencyStats::Summarize(static_cast<LatencyStats::Op>(op), -1, summary);
+        if (summary.count == 0) {
+            continue;
+        }
+        snprintf(labels, sizeof(labels), "op=\"%s\"", LatencyStats::OpName(static_cast<LatencyStats::Op>(op)));
+        Quantiles(out, "dm_native_request_duration_seconds", labels, summary);
+    }
+    out += '\n';
+
+    Header(out, "dm_native_connect_failures_total", "counter", "Connect attempts that ended in a disconnect, by reason");
+    for (uint32_t reason = 0; reason < REASONS; reason++) {
+        Append(out, "dm_native_connect_failures_total{reason=\"%s\"} %llu\n", REASON_NAMES[reason],
+               static_cast<unsigned long long>(connect_failures[reason].load()));
+    }
+    out += '\n';
+
+    Header(out, "dm_native_disconnects_total", "counter", "Connected devices that disconnected, by reason");
+    for (uint32_t reason = 0; reason < REASONS; reason++) {
+        Append(out, "dm_native_disconnects_total{reason=\"%s\"} %llu\n", REASON_NAMES[reason],
+               static_cast<unsigned long long>(disconnects[reason].load()));
+    }
+    out += '\n';
+
+    Header(out, "dm_native_log_read_bytes_total", "counter", "Log file bytes returned by readLogFile");
+    Append(out, "dm_native_log_read_bytes_total %llu\n\n", static_cast<unsigned long long>(log_bytes.load()));
+
+    Header(out, "dm_native_log_decode_bytes_total", "counter", "Log bytes passed to decodeLogData");
+    Append(out, "dm_native_log_decode_bytes_total %llu\n\n", static_cast<unsigned long long>(decode_bytes.load()));
+
+    Header(out, "dm_native_log_decode_samples_total", "counter", "Samples returned by decodeLogData");
+    Append(out, "dm_native_log_decode_samples_total %llu\n\n", static_cast<unsigned long long>(decode_samples.load()));
+
+    Header(out, "dm_native_log_decode_seconds", "summary", "decodeLogData time, including conversion to JS");
+    DecodeTime().Summarize(summary);
+    Quantiles(out, "dm_native_log_decode_seconds", "", summary);
+    out += '\n';
+
+    Header(out, "dm_native_js_queue_depth", "gauge", "Library callbacks queued for the JS thread and not yet run");
+    Append(out, "dm_native_js_queue_depth %lld\n\n", static_cast<long long>(queue_depth.load()));
+
+    Header(out, "dm_native_js_queue_dropped_total", "counter", "Callbacks the thread-safe function refused");
+    Append(out, "dm_native_js_queue_dropped_total %llu\n\n", static_cast<unsigned long long>(queue_dropped.load()));
+
+    Header(out, "dm_native_js_callback_delay_seconds", "summary", "Library callback to JS callback start");
+    DeliveryDelay().Summarize(summary);
+    Quantiles(out, "dm_native_js_callback_delay_seconds", "", summary);
+    out += '\n';
+
+    ResourceStats::Process process;
+    ResourceStats::Snapshot(process);
+
+    Header(out, "dm_native_threads", "gauge", "Threads in the process (/proc/self/task)");
+    Append(out, "dm_native_threads %u\n\n", process.threads);
+
+    Header(out, "dm_native_rss_bytes", "gauge", "Resident set size of the process");
+    Append(out, "dm_native_rss_bytes %llu\n\n", static_cast<unsigned long long>(process.rss_bytes));
+
+    Header(out, "dm_native_instance_threads_created_total", "counter", "Threads started while creating library instances");
+    Append(out, "dm_native_instance_threads_created_total %lld\n\n", static_cast<long long>(process.threads_created));
+
+    Header(out, "dm_native_tsfns", "gauge", "Thread-safe functions created and not finalized yet");
+    Append(out, "dm_native_tsfns %lld\n\n", static_cast<long long>(process.tsfns));
+
+    Header(out, "dm_native_buffer_bytes", "gauge", "Native buffers held for JS");
+    Append(out, "dm_native_buffer_bytes{kind=\"callback\"} %lld\n", static_cast<long long>(process.callback_buffer_bytes));
+    Append(out, "dm_native_buffer_bytes{kind=\"packed_samples\"} %lld\n", static_cast<long long>(process.packed_sample_bytes));
+    out += '\n';
+
+    InstanceReaper::Stats reaper;
+    InstanceReaper::GetStats(reaper);
+
+    Header(out, "dm_native_instances_closing", "gauge", "Library instances queued for disconnect and deletion off the JS thread");
+    Append(out, "dm_native_instances_closing %llu\n\n", static_cast<unsigned long long>(reaper.queued));
+
+    Header(out, "dm_native_instance_close_seconds_total", "counter", "Time the reaper thread spent disconnecting and deleting instances");
+    Append(out, "dm_native_instance_close_seconds_total %.6f\n", reaper.reap_us / 1e6);
+}
+
+}
@@ -0,0 +1,46 @@
+#ifndef NATIVE_METRICS_H
+#define NATIVE_METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "latency_stats.h"
+
+// Process-wide counters and gauges kept by the addon with relaxed atomics, so
+// nothing on the request path takes a lock or touches JS. Render() writes them,
+// together with the LatencyStats percentiles, in Prometheus text format.
+namespace NativeMetrics {
+
+void InstanceCreated();
+void InstanceDestroyed();
+
+// op is in flight from RequestStarted() until the library's callback
+void RequestStarted(LatencyStats::Op op);
+void RequestFinished(LatencyStats::Op op, bool ok);
+
+// Connect attempts count as OP_CONNECT requests
+void ConnectStarted();
+void Connected();
+// A reason while connecting is a failed attempt, otherwise a dropped connection
+void Disconnected(uint8_t reason, bool while_connecting);
+// A device entering hibernation, by hibernate() (was_connected) or a failed
+// wake, and leaving it
+void Hibernated(bool was_connected);
+void Woken();
+
+void LogBytesRead(size_t bytes);
+void Decoded(uint64_t duration_us, size_t bytes, size_t samples);
+
+// Returns the enqueue timestamp to hand back to Delivered() once the JS
+// callback runs; Dropped() when the thread-safe function refused the call
+uint64_t Queued();
+void Delivered(uint64_t queued_us);
+void Dropped();
+
+void Render(std::string& out);
+
+}
+
+#endif
@@ -0,0 +1,156 @@
+#include "packed_samples.h"
+
+#include <algorithm>
+#include <limits>
+#include <math.h>
+
+namespace {
+
+template <typename T>
+T Scale(float value, float factor) {
+    double scaled = round(static_cast<double>(value) * factor);
+    // Absent channels (V2 without MASK_V2) decode as NaN
+    if (isnan(scaled)) {
+        return 0;
+    }
+    double lo = static_cast<double>(std::numeric_limits<T>::min());
+    double hi = static_cast<double>(std::numeric_limits<T>::max());
+    return static_cast<T>(std::min(std::max(scaled, lo), hi));
+}
+
+// Voltages are stored in 24-bit millivolts, split over two fields; the top
+// value marks a channel the log does not record, which decodes as NaN again
+const uint32_t VOLTAGE_ABSENT = 0xFFFFFF;
+const uint32_t VOLTAGE_MAX_MV = VOLTAGE_ABSENT - 1;
+
+uint32_t PackVoltage(float volts, uint8_t& hi) {
+    uint32_t mv = isnan(volts) ? VOLTAGE_ABSENT : std::min(Scale<uint32_t>(volts, 1000.0f), VOLTAGE_MAX_MV);
+    hi = static_cast<uint8_t>(mv >> 16);
+    return mv & 0xFFFF;
+}
+
+float UnpackVoltage(uint16_t lo, uint8_t hi) {
+    const uint32_t mv = (static_cast<uint32_t>(hi) << 16) | lo;
+    return mv == VOLTAGE_ABSENT ? NAN : mv / 1000.0f;
+}
+
+}
+
+PackedSample PackedSamples::Pack(const PowermonLogFile::Sample& sample, uint16_t dt) {
+    PackedSample record;
+    record.dt = dt;
+    record.voltage1 = static_cast<uint16_t>(PackVoltage(sample.voltage1, record.voltage1_hi));
+    record.voltage2 = static_cast<uint16_t>(PackVoltage(sample.voltage2, record.voltage2_hi));
+    record.temperature = Scale<int16_t>(sample.temperature, 100.0f);
+    record.current = Scale<int32_t>(sample.current, 1000.0f);
+    record.power = Scale<int32_t>(sample.power, 1000.0f);
+    record.soc = sample.soc;
+    record.power_status = sample.ps;
+    return record;
+}
+
+PowermonLogFile::Sample PackedSamples::Unpack(const PackedSample& record, uint32_t time) {
+    PowermonLogFile::Sample sample;
+    sample.time = time;
+    sample.voltage1 = UnpackVoltage(record.voltage1, record.voltage1_hi);
+    sample.voltage2 = UnpackVoltage(record.voltage2, record.voltage2_hi);
+    sample.temperature = record.temperature / 100.0f;
+    sample.current = record.current / 1000.0f;
+    sample.power = record.power / 1000.0f;
+    sample.soc = record.soc;
+    sample.ps = record.power_status;
+    return sample;
+}
+
+size_t PackedSamples::FindAnchor(const Anchor* anchors, size_t anchor_count, size_t index) {
+    const Anchor* it = std::upper_bound(anchors, anchors + anchor_count, index,
+        [](size_t i, const Anchor& anchor) { return i < anchor.index; });
+    return (it - anchors) - 1;
+}
+
+void PackedSamples::Decode(const PackedSample* records, size_t record_count,
+                           const Anchor* anchors, size_t anchor_count,
+                           size_t start, size_t count, std::vector<PowermonLogFile::Sample>& out) {
+    if (anchor_count == 0 || start >= record_count) {
+        return;
+    }
+    size_t end = std::min(record_count, start + count);
+
+    size_t a = FindAnchor(anchors, anchor_count, start);
+    uint32_t time = anchors[a].time;
+    for (size_t i = anchors[a].index + 1; i <= start; i++) {
+        time += records[i].dt;
+    }
+
+    out.reserve(out.size() + (end - start));
+    for (size_t i = start; i < end; i++) {
+        if (i > start) {
+            // Anchored records carry dt = 0 and take their time from the anchor
+            if (a + 1 < anchor_count && anchors[a + 1].index == i) {
+                time = anchors[++a].time;
+            } else {
+                time += records[i].dt;
+            }
+        }
+        out.push_back(Unpack(records[i], time));
+    }
+}
+
+void PackedSamples::Reserve(size_t count) {
+    records_.reserve(count);
+    anchors_.reserve(count / ANCHOR_INTERVAL + 1);
+}
+
+bool PackedSamples::Append(const PowermonLogFile::Sample& sample) {
+    size_t index = records_.size();
+
+    if (index > 0 && sample.time < last_time_) {
+        return false;
+    }
+
+    uint32_t delta = index > 0 ? sample.time - last_time_ : 0;
+    if (index % ANCHOR_INTERVAL == 0 || delta > UINT16_MAX) {
+        anchors_.push_back({ static_cast<uint32_t>(index), sample.time });
+        delta = 0;
+    }
+
+    records_.push_back(Pack(sample, static_cast<uint16_t>(delta)));
+    last_time_ = sample.time;
+    return true;
+}
+
+size_t PackedSamples::Append(const std::vector<PowermonLogFile::Sample>& samples) {
+    Reserve(records_.size() + samples.size());
+    size_t appended = 0;
+    for (const auto& sample : samples) {
+        if (Append(sample)) {
+            appended++;
+        }
+    }
+    return appended;
+}
+
+uint32_t PackedSamples::Time(size_t index) const {
+    size_t a = FindAnchor(anchors_.data(), anchors_.size(), index);
+    uint32_t time = anchors_[a].time;
+    for (size_t i = anchors_[a].index + 1; i <= index; i++) {
+        time += records_[i].dt;
+    }
+    return time;
+}
+
+PowermonLogFile::Sample PackedSamples::Get(size_t index) const {
+    return Unpack(records_[index], Time(index));
+}
+
+void PackedSamples::Decode(size_t start, size_t count, std::vector<PowermonLogFile::Sample>& out) const {
+    Decode(records_.data(), records_.size(), anchors_.data(), anchors_.size(), start, count, out);
+}
+
+void PackedSamples::Release(std::vector<PackedSample>& records, std::vector<Anchor>& anchors) {
+    records.swap(records_);
+    anchors.swap(anchors_);
+    records_.clear();
+    anchors_.clear();
+    last_time_ = 0;
+}
@@ -0,0 +1,81 @@
+#ifndef PACKED_SAMPLES_H
+#define PACKED_SAMPLES_H
+
+#include <powermon_log.h>
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <vector>
+
+// Compact in-memory encoding of decoded log samples: 20 bytes per sample
+// instead of 28 for PowermonLogFile::Sample (and ~200 for a JS object).
+//
+// Values are stored as scaled fixed-point integers and time as the delta from
+// the previous sample. Anchors record the absolute time of every
+// ANCHOR_INTERVAL-th sample (and of any sample whose delta does not fit in 16
+// bits), so any sample's time is found by summing at most ANCHOR_INTERVAL - 1
+// deltas. The record layout is fixed so JS can read it through typed-array
+// views (see lib/packed-samples.js).
+#pragma pack(push, 1)
+struct PackedSample {
+    uint16_t dt;            // seconds since the previous sample, 0 at an anchor
+    uint16_t voltage1;      // mV, low 16 bits
+    uint16_t voltage2;      // mV, low 16 bits
+    int16_t temperature;    // 0.01 C
+    int32_t current;        // mA
+    int32_t power;          // mW
+    uint8_t soc;
+    uint8_t power_status;
+    uint8_t voltage1_hi;    // mV, bits 16-23: up to 16.7 kV at the log's 1 mV;
+                            // all ones for a channel the log does not record
+    uint8_t voltage2_hi;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(PackedSample) == 20, "PackedSample layout is shared with lib/packed-samples.js");
+
+class PackedSamples {
+public:
+    static const uint32_t ANCHOR_INTERVAL = 256;
+
+    struct Anchor {
+        uint32_t index;
+        uint32_t time;
+    };
+
+    static PackedSample Pack(const PowermonLogFile::Sample& sample, uint16_t dt);
+    static PowermonLogFile::Sample Unpack(const PackedSample& record, uint32_t time);
+
+    // Decodes records [start, start + count) of an encoded series; anchors
+    // must be sorted by index and include index 0.
+    static void Decode(const PackedSample* records, size_t record_count,
+                       const Anchor* anchors, size_t anchor_count,
+                       size_t start, size_t count, std::vector<PowermonLogFile::Sample>& out);
+
+    void Reserve(size_t count);
+
+    // Samples must be appended in time order; returns false otherwise
+    bool Append(const PowermonLogFile::Sample& sample);
+    size_t Append(const std::vector<PowermonLogFile::Sample>& samples);
+
+    size_t Size() const { return records_.size(); }
+    uint32_t Time(size_t index) const;
+    PowermonLogFile::Sample Get(size_t index) const;
+    void Decode(size_t start, size_t count, std::vector<PowermonLogFile::Sample>& out) const;
+
+    const std::vector<PackedSample>& Records() const { return records_; }
+    const std::vector<Anchor>& Anchors() const { return anchors_; }
+
+    // Moves the storage out, leaving the series empty
+    void Release(std::vector<PackedSample>& records, std::vector<Anchor>& anchors);
+
+private:
+    std::vector<PackedSample> records_;
+    std::vector<Anchor> anchors_;
+    uint32_t last_time_ = 0;
+
+    static size_t FindAnchor(const Anchor* anchors, size_t anchor_count, size_t index);
+};
+
+#endif
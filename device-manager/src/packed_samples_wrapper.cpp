@@ -0,0 +1,223 @@
+#include "packed_samples_wrapper.h"
+#include "powermon_wrapper.h"
+#include "resource_stats.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+namespace PackedSamplesWrapper {
+
+namespace {
+
+struct Storage {
+    std::vector<PackedSample> records;
+    std::vector<PackedSamples::Anchor> anchors;
+};
+
+struct View {
+    const PackedSample* records;
+    size_t record_count;
+    const PackedSamples::Anchor* anchors;
+    size_t anchor_count;
+};
+
+View GetView(Napi::Object obj) {
+    Napi::ArrayBuffer records = obj.Get("records").As<Napi::ArrayBuffer>();
+    Napi::Uint32Array anchors = obj.Get("anchors").As<Napi::Uint32Array>();
+
+    View view;
+    view.records = static_cast<const PackedSample*>(records.Data());
+    view.record_count = records.ByteLength() / sizeof(PackedSample);
+    view.anchors = reinterpret_cast<const PackedSamples::Anchor*>(anchors.Data());
+    view.anchor_count = anchors.ElementLength() / 2;
+
+    Napi::Value count = obj.Get("count");
+    if (count.IsNumber()) {
+        view.record_count = std::min<size_t>(view.record_count, count.As<Napi::Number>().Uint32Value());
+    }
+    return view;
+}
+
+// Decode() trusts the anchors, so a packed object from JS is checked before
+// any record is read: anchors must be a Uint32Array of (index, time) pairs
+// starting at index 0, with indices strictly increasing and inside the
+// records. Returns what is wrong with it, or nullptr
+const char* CheckPacked(Napi::Object obj) {
+    if (!obj.Get("records").IsArrayBuffer()) {
+        return "packed.records must be an ArrayBuffer";
+    }
+    Napi::Value value = obj.Get("anchors");
+    if (!value.IsTypedArray() || value.As<Napi::TypedArray>().TypedArrayType() != napi_uint32_array) {
+        return "packed.anchors must be a Uint32Array";
+    }
+    if (value.As<Napi::Uint32Array>().ElementLength() % 2 != 0) {
+        return "packed.anchors must hold (index, time) pairs";
+    }
+
+    View view = GetView(obj);
+    if (view.anchor_count == 0) {
+        return view.record_count == 0 ? nullptr : "packed.anchors must not be empty";
+    }
+    if (view.anchors[0].index != 0) {
+        return "packed.anchors must start at index 0";
+    }
+    for (size_t a = 0; a < view.anchor_count; a++) {
+        if (view.anchors[a].index >= view.record_count) {
+            return "packed.anchors index out of range";
+        }
+        if (a > 0 && view.anchors[a].index <= view.anchors[a - 1].index) {
+            return "packed.anchors indices must be increasing";
+        }
+    }
+    return nullptr;
+}
+
+float ReadFloat(Napi::Object obj, const char* key) {
+    Napi::Value value = obj.Get(key);
+    return value.IsNumber() ? value.As<Napi::Number>().FloatValue() : 0.0f;
+}
+
+}
+
+Napi::Object ToObject(Napi::Env env, PackedSamples& samples) {
+    Storage* storage = new Storage();
+    samples.Release(storage->records, storage->anchors);
+
+    size_t count = storage->records.size();
+    Napi::Uint32Array anchors = Napi::Uint32Array::New(env, storage->anchors.size() * 2);
+    if (!storage->anchors.empty()) {
+        memcpy(anchors.Data(), storage->anchors.data(), storage->anchors.size() * sizeof(PackedSamples::Anchor));
+    }
+
+    Napi::ArrayBuffer records;
+    if (count == 0) {
+        records = Napi::ArrayBuffer::New(env, 0);
+        delete storage;
+    } else {
+        const int64_t bytes = storage->records.capacity() * sizeof(PackedSample) +
+                              storage->anchors.capacity() * sizeof(PackedSamples::Anchor);
+        ResourceStats::PackedHeld(bytes);
+        records = Napi::ArrayBuffer::New(env, storage->records.data(), count * sizeof(PackedSample),
+            [bytes](Napi::Env, void*, Storage* hint) {
+                ResourceStats::PackedHeld(-bytes);
+                delete hint;
+            }, storage);
+    }
+
+    Napi::Object obj = Napi::Object::New(env);
+    obj.Set("count", Napi::Number::New(env, static_cast<double>(count)));
+    obj.Set("records", records);
+    obj.Set("anchors", anchors);
+    return obj;
+}
+
+bool IsPacked(Napi::Value value) {
+    if (!value.IsObject() || value.IsArray()) {
+        return false;
+    }
+    return CheckPacked(value.As<Napi::Object>()) == nullptr;
+}
+
+bool WantsPacked(const Napi::CallbackInfo& info, size_t index) {
+    if (info.Length() <= index || !info[index].IsObject()) {
+        return false;
+    }
+    Napi::Value packed = info[index].As<Napi::Object>().Get("packed");
+    return packed.IsBoolean() && packed.As<Napi::Boolean>().Value();
+}
+
+bool ReadSamples(Napi::Value value, std::vector<PowermonLogFile::Sample>& out) {
+    if (IsPacked(value)) {
+        View view = GetView(value.As<Napi::Object>());
+        PackedSamples::Decode(view.records, view.record_count, view.anchors, view.anchor_count,
+                              0, view.record_count, out);
+        return true;
+    }
+
+    if (!value.IsArray()) {
+        return false;
+    }
+
+    Napi::Array samples = value.As<Napi::Array>();
+    out.reserve(out.size() + samples.Length());
+    for (uint32_t i = 0; i < samples.Length(); i++) {
+        Napi::Value item = samples.Get(i);
+        if (!item.IsObject()) {
+            return false;
+        }
+        Napi::Object obj = item.As<Napi::Object>();
+
+        PowermonLogFile::Sample sample;
+        Napi::Value time = obj.Get("time");
+        sample.time = time.IsNumber() ? time.As<Napi::Number>().Uint32Value() : 0;
+        sample.voltage1 = ReadFloat(obj, "voltage1");
+        sample.voltage2 = ReadFloat(obj, "voltage2");
+        sample.current = ReadFloat(obj, "current");
+        sample.power = ReadFloat(obj, "power");
+        sample.temperature = ReadFloat(obj, "temperature");
+        sample.soc = static_cast<uint8_t>(ReadFloat(obj, "soc"));
+        sample.ps = static_cast<uint8_t>(ReadFloat(obj, "powerStatus"));
+        out.push_back(sample);
+    }
+    return true;
+}
+
+Napi::Object Init(Napi::Env env, Napi::Object exports) {
+    exports.Set("packSamples", Napi::Function::New(env, PackSamples, "packSamples"));
+    exports.Set("unpackSamples", Napi::Function::New(env, UnpackSamples, "unpackSamples"));
+    return exports;
+}
+
+Napi::Value PackSamples(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    std::vector<PowermonLogFile::Sample> samples;
+    if (info.Length() < 1 || !info[0].IsArray() || !ReadSamples(info[0], samples)) {
+        Napi::TypeError::New(env, "Samples array expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    PackedSamples packed;
+    if (packed.Append(samples) != samples.size()) {
+        Napi::RangeError::New(env, "Samples must be sorted by time").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    return ToObject(env, packed);
+}
+
+Napi::Value UnpackSamples(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsObject() || info[0].IsArray()) {
+        Napi::TypeError::New(env, "Packed samples expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    const char* error = CheckPacked(info[0].As<Napi::Object>());
+    if (error != nullptr) {
+        Napi::TypeError::New(env, error).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    View view = GetView(info[0].As<Napi::Object>());
+
+    size_t start = 0;
+    size_t count = view.record_count;
+    if (info.Length() > 1 && info[1].IsNumber()) {
+        start = std::min<size_t>(info[1].As<Napi::Number>().Uint32Value(), view.record_count);
+    }
+    if (info.Length() > 2 && info[2].IsNumber()) {
+        count = info[2].As<Napi::Number>().Uint32Value();
+    }
+
+    std::vector<PowermonLogFile::Sample> samples;
+    PackedSamples::Decode(view.records, view.record_count, view.anchors, view.anchor_count, start, count, samples);
+
+    Napi::Array arr = Napi::Array::New(env, samples.size());
+    for (size_t i = 0; i < samples.size(); i++) {
+        arr.Set(i, PowermonWrapper::SampleToObject(env, samples[i]));
+    }
+    return arr;
+}
+
+}
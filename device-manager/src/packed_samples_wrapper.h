@@ -0,0 +1,37 @@
+#ifndef PACKED_SAMPLES_WRAPPER_H
+#define PACKED_SAMPLES_WRAPPER_H
+
+#include <napi.h>
+
+#include "packed_samples.h"
+
+// JS side of PackedSamples: { count, records: ArrayBuffer, anchors: Uint32Array }
+// where records holds count 20-byte PackedSample records and anchors holds
+// (index, time) pairs. lib/packed-samples.js wraps it with decode-on-read
+// accessors; every addon method that takes decoded samples also takes it.
+namespace PackedSamplesWrapper {
+
+Napi::Object Init(Napi::Env env, Napi::Object exports);
+
+// packSamples(samples) -> packed
+Napi::Value PackSamples(const Napi::CallbackInfo& info);
+
+// unpackSamples(packed[, start, count]) -> decoded sample objects
+Napi::Value UnpackSamples(const Napi::CallbackInfo& info);
+
+// Hands the storage to JS without copying the records
+Napi::Object ToObject(Napi::Env env, PackedSamples& samples);
+
+// True for a well-formed packed object; a malformed one (bad anchors, wrong
+// array types) is neither packed nor a samples array, so callers reject it
+bool IsPacked(Napi::Value value);
+
+// True when info[index] is an options object with packed: true
+bool WantsPacked(const Napi::CallbackInfo& info, size_t index);
+
+// Reads a packed object or an array of sample objects; false on a type error
+bool ReadSamples(Napi::Value value, std::vector<PowermonLogFile::Sample>& out);
+
+}
+
+#endif
@@ -0,0 +1,253 @@
+#include "poll_scheduler.h"
+#include "timer_wheel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+
+uint64_t NowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t TimerId(uint32_t device, PollScheduler::Kind kind) {
+    return static_cast<uint64_t>(device) * PollScheduler::KIND_COUNT + kind;
+}
+
+struct Device {
+    PollScheduler::Poller poll;
+    uint32_t period_ms[PollScheduler::KIND_COUNT] = {};
+    uint64_t due_ms[PollScheduler::KIND_COUNT] = {};
+    uint64_t connects = 0;      // scheduler thread only
+};
+
+// A request that came due, issued with the mutex released
+struct Due {
+    uint32_t id;
+    std::shared_ptr<Device> device;
+    PollScheduler::Kind kind;
+    uint64_t due_ms;
+    PollScheduler::Issue issue;
+};
+
+}
+
+struct PollScheduler::Shared {
+    const Options options;
+    const Flush flush;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    TimerWheel wheel;
+    std::unordered_map<uint32_t, std::shared_ptr<Device>> devices;
+    uint32_t next_id = 1;
+    std::vector<Result> results;
+    uint64_t first_result_ms = 0;   // when results went non-empty
+    bool stopping = false;
+    Stats stats;
+
+    Shared(const Options& options, Flush flush)
+        : options(options), flush(std::move(flush)), wheel(options.tick_ms, NowMs()) {}
+};
+
+PollScheduler::PollScheduler(const Options& options, Flush flush)
+    : shared_(std::make_shared<Shared>(options, std::move(flush))) {
+    thread_ = std::thread([shared = shared_]() { Run(shared); });
+}
+
+PollScheduler::~PollScheduler() {
+    Stop();
+}
+
+uint32_t PollScheduler::Add(Poller poller, const Periods& periods) {
+    auto device = std::make_shared<Device>();
+    device->poll = std::move(poller);
+    device->period_ms[MONITOR] = periods.monitor_ms;
+    device->period_ms[STATISTICS] = periods.statistics_ms;
+    device->period_ms[FG_STATISTICS] = periods.fg_statistics_ms;
+    device->period_ms[INFO] = periods.info ? INFO_CHECK_MS : 0;
+
+    std::lock_guard<std::mutex> lock(shared_->mutex);
+    const uint32_t id = shared_->next_id++;
+    const uint64_t now = NowMs();
+    // Fibonacci hashing of the id spreads first polls over the period
+    const uint64_t phase = static_cast<uint32_t>(id * 2654435761u);
+    for (int kind = 0; kind < KIND_COUNT; kind++) {
+        const uint32_t period = device->period_ms[kind];
+        if (period == 0) {
+            continue;
+        }
+        device->due_ms[kind] = kind == INFO ? now : now + phase % period;
+        shared_->wheel.Schedule(TimerId(id, static_cast<Kind>(kind)), device->due_ms[kind]);
+    }
+    shared_->devices[id] = std::move(device);
+    shared_->cv.notify_one();
+    return id;
+}
+
+bool PollScheduler::Remove(uint32_t device) {
+    // Its timers stay on the wheel and are dropped when they fire
+    std::lock_guard<std::mutex> lock(shared_->mutex);
+    return shared_->devices.erase(device) > 0;
+}
+
+void PollScheduler::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(shared_->mutex);
+        shared_->stopping = true;
+    }
+    shared_->cv.notify_one();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void PollScheduler::GetStats(Stats& out) const {
+    std::lock_guard<std::mutex> lock(shared_->mutex);
+    out = shared_->stats;
+    out.devices = shared_->devices.size();
+    out.timers = shared_->wheel.Size();
+    out.pending = shared_->results.size();
+}
+
+void PollScheduler::Answer(const Sink& sink, Result&& result) {
+    std::lock_guard<std::mutex> lock(sink->mutex);
+    if (result.code == Powermon::RSP_SUCCESS) {
+        sink->stats.answered++;
+    } else {
+        sink->stats.failed++;
+    }
+    if (sink->stopping) {
+        return;
+    }
+    if (sink->results.empty()) {
+        sink->first_result_ms = NowMs();
+    }
+    sink->results.push_back(std::move(result));
+    if (sink->results.size() >= sink->options.max_batch) {
+        sink->cv.notify_one();
+    }
+}
+
+const char* PollScheduler::KindName(Kind kind) {
+    switch (kind) {
+        case MONITOR: return "monitor";
+        case STATISTICS: return "statistics";
+        case FG_STATISTICS: return "fgStatistics";
+        case INFO: return "info";
+        default: return "unknown";
+    }
+}
+
+void PollScheduler::Run(const std::shared_ptr<Shared>& shared) {
+    Shared& s = *shared;
+    std::vector<uint64_t> expired;
+    std::vector<Due> due;
+    std::vector<Result> batch;
+
+    std::unique_lock<std::mutex> lock(s.mutex);
+    for (;;) {
+        const uint64_t now = NowMs();
+        expired.clear();
+        due.clear();
+        s.wheel.Advance(now, expired);
+        for (uint64_t timer : expired) {
+            const uint32_t id = static_cast<uint32_t>(timer / KIND_COUNT);
+            auto it = s.devices.find(id);
+            if (it == s.devices.end()) {
+                continue;
+            }
+            const Kind kind = static_cast<Kind>(timer % KIND_COUNT);
+            due.push_back({ id, it->second, kind, it->second->due_ms[kind], ISSUED });
+        }
+        s.stats.fired += expired.size();
+
+        const bool stopping = s.stopping;
+        if (!s.results.empty() &&
+            (stopping || s.results.size() >= s.options.max_batch || now >= s.first_result_ms + s.options.batch_ms)) {
+            batch.swap(s.results);
+        }
+
+        lock.unlock();
+        if (!stopping) {
+            for (Due& d : due) {
+                d.issue = d.device->poll(d.kind, d.id, d.device->connects, shared);
+            }
+        }
+        bool flushed = true;
+        const size_t batch_size = batch.size();
+        if (batch_size > 0) {
+            flushed = s.flush(std::move(batch));
+            batch.clear();
+        }
+        lock.lock();
+
+        if (batch_size > 0) {
+            s.stats.batches++;
+            (flushed ? s.stats.delivered : s.stats.dropped) += batch_size;
+        }
+        if (stopping) {
+            return;
+        }
+
+        for (const Due& d : due) {
+            const uint64_t lag = now > d.due_ms ? now - d.due_ms : 0;
+            s.stats.lag_ms += lag;
+            s.stats.max_lag_ms = std::max(s.stats.max_lag_ms, lag);
+            switch (d.issue) {
+                case ISSUED:
+                    s.stats.issued++;
+                    s.stats.issued_by_kind[d.kind]++;
+                    break;
+                case SKIPPED:
+                    s.stats.skipped++;
+                    break;
+                case GONE: {
+                    auto it = s.devices.find(d.id);
+                    if (it != s.devices.end() && it->second == d.device) {
+                        s.devices.erase(it);
+                        s.stats.gone++;
+                    }
+                    continue;
+                }
+                default:
+                    break;
+            }
+            if (s.devices.count(d.id) == 0) {
+                continue;
+            }
+
+            // Keep to the period's grid rather than drifting by the lag; a
+            // thread that ran more than a period late skips the missed ones
+            const uint32_t period = d.device->period_ms[d.kind];
+            uint64_t next = d.due_ms + period;
+            if (next <= now) {
+                s.stats.missed += (now - d.due_ms) / period;
+                next = now + period - (now - d.due_ms) % period;
+            }
+            d.device->due_ms[d.kind] = next;
+            s.wheel.Schedule(TimerId(d.id, d.kind), next);
+        }
+
+        uint64_t wake = UINT64_MAX;
+        uint64_t wheel_due;
+        if (s.wheel.NextDue(wheel_due)) {
+            wake = wheel_due;
+        }
+        if (!s.results.empty()) {
+            wake = std::min(wake, s.results.size() >= s.options.max_batch ? now : s.first_result_ms + s.options.batch_ms);
+        }
+        if (s.stopping || wake <= NowMs()) {
+            continue;
+        }
+        if (wake == UINT64_MAX) {
+            s.cv.wait(lock);
+        } else {
+            s.cv.wait_until(lock, std::chrono::steady_clock::time_point(std::chrono::milliseconds(wake)));
+        }
+    }
+}
@@ -0,0 +1,127 @@
+#ifndef POLL_SCHEDULER_H
+#define POLL_SCHEDULER_H
+
+#include <powermon.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Polls devices on its own thread: each device has a period per request kind
+// (monitor data, statistics, fuelgauge statistics), kept on a TimerWheel, and
+// device info is requested once per connection. Answers arrive on the library
+// threads and are handed to Flush in batches, at most batch_ms after the first
+// one or as soon as max_batch are waiting, so the JS thread takes one callback
+// per batch instead of one per request and a slow event loop delays delivery
+// but never the polls themselves. A device's first poll of each kind is spread
+// over its period by device id, so devices added together do not poll together.
+class PollScheduler {
+public:
+    enum Kind {
+        MONITOR,
+        STATISTICS,
+        FG_STATISTICS,
+        INFO,
+        KIND_COUNT
+    };
+
+    // What a Poller did with a due request
+    enum Issue {
+        ISSUED,
+        IDLE,       // nothing to do: device info already requested since the last connect
+        SKIPPED,    // not connected or hibernating, retried next period
+        GONE        // device closed: removed from the scheduler
+    };
+
+    struct Result {
+        uint32_t device;            // id returned by Add()
+        Kind kind;
+        Powermon::ResponseCode code;
+        uint64_t time_ms;           // wall clock when answered
+        uint64_t latency_us;        // issued to answered
+        // The one matching kind is set on success
+        Powermon::MonitorData monitor;
+        Powermon::MonitorStatistics statistics;
+        Powermon::FuelgaugeStatistics fg_statistics;
+        Powermon::DeviceInfo info;
+    };
+
+    // Scheduler state shared with request callbacks, which can answer after
+    // the scheduler is gone
+    struct Shared;
+    using Sink = std::shared_ptr<Shared>;
+
+    // Issues one request on the scheduler thread and later hands the answer
+    // to Answer(sink, ...). connects is the device's connect count when info
+    // was last requested, kept by the scheduler for the poller
+    using Poller = std::function<Issue(Kind kind, uint32_t device, uint64_t& connects, const Sink& sink)>;
+    // Runs on the scheduler thread; false when the batch was dropped
+    using Flush = std::function<bool(std::vector<Result>&& results)>;
+
+    static const uint32_t DEFAULT_TICK_MS = 10;
+    static const uint32_t DEFAULT_BATCH_MS = 1000;
+    static const size_t DEFAULT_MAX_BATCH = 256;
+    // How often a device is checked for a new connection to request info for
+    static const uint32_t INFO_CHECK_MS = 1000;
+
+    struct Options {
+        uint32_t tick_ms = DEFAULT_TICK_MS;
+        uint32_t batch_ms = DEFAULT_BATCH_MS;
+        size_t max_batch = DEFAULT_MAX_BATCH;
+    };
+
+    // 0 leaves a kind out
+    struct Periods {
+        uint32_t monitor_ms = 0;
+        uint32_t statistics_ms = 0;
+        uint32_t fg_statistics_ms = 0;
+        bool info = false;          // on every connect
+    };
+
+    struct Stats {
+        size_t devices = 0;
+        size_t timers = 0;
+        size_t pending = 0;         // answers waiting for the next batch
+        uint64_t fired = 0;         // timers that came due
+        uint64_t issued = 0;
+        uint64_t skipped = 0;
+        uint64_t missed = 0;        // periods passed over because the thread ran late
+        uint64_t gone = 0;
+        uint64_t answered = 0;
+        uint64_t failed = 0;        // answered with an error code
+        uint64_t batches = 0;
+        uint64_t delivered = 0;     // results in batches Flush accepted
+        uint64_t dropped = 0;       // results in batches Flush refused
+        uint64_t lag_ms = 0;        // total, timer due to fired
+        uint64_t max_lag_ms = 0;
+        uint64_t issued_by_kind[KIND_COUNT] = {};
+    };
+
+    PollScheduler(const Options& options, Flush flush);
+    ~PollScheduler();
+
+    // Returns the device id results carry
+    uint32_t Add(Poller poller, const Periods& periods);
+    // Requests already issued still answer
+    bool Remove(uint32_t device);
+    // Delivers the answers waiting and joins the thread; Flush is not called
+    // afterwards
+    void Stop();
+
+    void GetStats(Stats& out) const;
+
+    static void Answer(const Sink& sink, Result&& result);
+    static const char* KindName(Kind kind);
+
+private:
+    std::shared_ptr<Shared> shared_;
+    std::thread thread_;
+
+    static void Run(const std::shared_ptr<Shared>& shared);
+};
+
+#endif
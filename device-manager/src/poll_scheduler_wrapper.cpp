@@ -0,0 +1,212 @@
+#include "poll_scheduler_wrapper.h"
+#include "native_metrics.h"
+#include "powermon_wrapper.h"
+
+#include <cmath>
+
+namespace {
+
+// An integer from min to UINT32_MAX, or fallback when absent. Checked as a
+// double first: Uint32Value() would wrap 2^32 + 5 to 5 without complaint
+bool ReadUint32(Napi::Object options, const char* name, uint32_t fallback, uint32_t& out, uint32_t min = 0) {
+    Napi::Value value = options.Get(name);
+    if (value.IsUndefined()) {
+        out = fallback;
+        return true;
+    }
+    if (!value.IsNumber()) {
+        return false;
+    }
+    const double number = value.As<Napi::Number>().DoubleValue();
+    if (!(number >= min && number <= UINT32_MAX) || number != std::floor(number)) {
+        return false;
+    }
+    out = static_cast<uint32_t>(number);
+    return true;
+}
+
+}
+
+Napi::Object PollSchedulerWrapper::Init(Napi::Env env, Napi::Object exports) {
+    Napi::Function func = DefineClass(env, "PollScheduler", {
+        InstanceMethod("add", &PollSchedulerWrapper::Add),
+        InstanceMethod("remove", &PollSchedulerWrapper::Remove),
+        InstanceMethod("stop", &PollSchedulerWrapper::Stop),
+        InstanceMethod("stats", &PollSchedulerWrapper::GetStats),
+    });
+
+    exports.Set("PollScheduler", func);
+    return exports;
+}
+
+PollSchedulerWrapper::PollSchedulerWrapper(const Napi::CallbackInfo& info)
+    : Napi::ObjectWrap<PollSchedulerWrapper>(info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsObject() || !info[0].As<Napi::Object>().Get("onResults").IsFunction()) {
+        Napi::TypeError::New(env, "Options with an onResults callback expected").ThrowAsJavaScriptException();
+        return;
+    }
+    Napi::Object options = info[0].As<Napi::Object>();
+
+    PollScheduler::Options scheduler_options;
+    uint32_t max_batch = 0;
+    if (!ReadUint32(options, "tickMs", PollScheduler::DEFAULT_TICK_MS, scheduler_options.tick_ms) ||
+        !ReadUint32(options, "batchMs", PollScheduler::DEFAULT_BATCH_MS, scheduler_options.batch_ms) ||
+        !ReadUint32(options, "maxBatch", PollScheduler::DEFAULT_MAX_BATCH, max_batch, 1)) {
+        Napi::RangeError::New(env, "tickMs and batchMs must be integers from 0 to 4294967295, "
+                                   "maxBatch from 1").ThrowAsJavaScriptException();
+        return;
+    }
+    scheduler_options.max_batch = max_batch;
+
+    // Unref'd: a scheduler left running does not keep the process alive
+    results_tsfn_ = Napi::ThreadSafeFunction::New(env, options.Get("onResults").As<Napi::Function>(), "PollSchedulerResults", 0, 1);
+    results_tsfn_.Unref(env);
+
+    scheduler_.reset(new PollScheduler(scheduler_options, [tsfn = results_tsfn_](std::vector<PollScheduler::Result>&& results) {
+        auto batch = std::make_shared<std::vector<PollScheduler::Result>>(std::move(results));
+        const uint64_t queued = NativeMetrics::Queued();
+        napi_status status = tsfn.NonBlockingCall([batch, queued](Napi::Env env, Napi::Function callback) {
+            NativeMetrics::Delivered(queued);
+            callback.Call({ ResultsToArray(env, *batch) });
+        });
+        if (status != napi_ok) {
+            NativeMetrics::Dropped();
+            return false;
+        }
+        return true;
+    }));
+}
+
+PollSchedulerWrapper::~PollSchedulerWrapper() {
+    Shutdown();
+}
+
+void PollSchedulerWrapper::Shutdown() {
+    if (!scheduler_) {
+        return;
+    }
+    // The last batch is queued before the thread-safe function goes
+    scheduler_->Stop();
+    scheduler_.reset();
+    results_tsfn_.Release();
+}
+
+Napi::Array PollSchedulerWrapper::ResultsToArray(Napi::Env env, const std::vector<PollScheduler::Result>& results) {
+    Napi::Array arr = Napi::Array::New(env, results.size());
+    for (size_t i = 0; i < results.size(); i++) {
+        const PollScheduler::Result& result = results[i];
+        const bool success = result.code == Powermon::RSP_SUCCESS;
+
+        Napi::Object obj = Napi::Object::New(env);
+        obj.Set("id", Napi::Number::New(env, result.device));
+        obj.Set("kind", Napi::String::New(env, PollScheduler::KindName(result.kind)));
+        obj.Set("success", Napi::Boolean::New(env, success));
+        obj.Set("code", Napi::Number::New(env, static_cast<int>(result.code)));
+        obj.Set("at", Napi::Number::New(env, static_cast<double>(result.time_ms)));
+        obj.Set("latencyMs", Napi::Number::New(env, result.latency_us / 1000.0));
+        if (success) {
+            switch (result.kind) {
+                case PollScheduler::MONITOR:
+                    obj.Set("data", PowermonWrapper::MonitorDataToObject(env, result.monitor));
+                    break;
+                case PollScheduler::STATISTICS:
+                    obj.Set("data", PowermonWrapper::MonitorStatisticsToObject(env, result.statistics));
+                    break;
+                case PollScheduler::FG_STATISTICS:
+                    obj.Set("data", PowermonWrapper::FuelgaugeStatisticsToObject(env, result.fg_statistics));
+                    break;
+                case PollScheduler::INFO:
+                    obj.Set("data", PowermonWrapper::DeviceInfoToObject(env, result.info));
+                    break;
+                default:
+                    break;
+            }
+        }
+        arr.Set(i, obj);
+    }
+    return arr;
+}
+
+Napi::Value PollSchedulerWrapper::Add(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (!scheduler_) {
+        Napi::Error::New(env, "Scheduler is stopped").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    PollScheduler::Poller poller = info.Length() > 0 ? PowermonWrapper::PollerFor(env, info[0]) : nullptr;
+    if (!poller) {
+        Napi::TypeError::New(env, "Open PowermonDevice expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    if (info.Length() < 2 || !info[1].IsObject()) {
+        Napi::TypeError::New(env, "Periods object expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    Napi::Object options = info[1].As<Napi::Object>();
+
+    PollScheduler::Periods periods;
+    if (!ReadUint32(options, "monitorMs", 0, periods.monitor_ms) ||
+        !ReadUint32(options, "statisticsMs", 0, periods.statistics_ms) ||
+        !ReadUint32(options, "fgStatisticsMs", 0, periods.fg_statistics_ms)) {
+        Napi::RangeError::New(env, "Periods must be integers from 0 to 4294967295").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    periods.info = options.Get("info").ToBoolean().Value();
+
+    return Napi::Number::New(env, scheduler_->Add(std::move(poller), periods));
+}
+
+Napi::Value PollSchedulerWrapper::Remove(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsNumber()) {
+        Napi::TypeError::New(env, "Id expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    const bool removed = scheduler_ && scheduler_->Remove(info[0].As<Napi::Number>().Uint32Value());
+    return Napi::Boolean::New(env, removed);
+}
+
+Napi::Value PollSchedulerWrapper::Stop(const Napi::CallbackInfo& info) {
+    Shutdown();
+    return info.Env().Undefined();
+}
+
+Napi::Value PollSchedulerWrapper::GetStats(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    PollScheduler::Stats stats;
+    if (scheduler_) {
+        scheduler_->GetStats(stats);
+    }
+
+    Napi::Object issued = Napi::Object::New(env);
+    for (int kind = 0; kind < PollScheduler::KIND_COUNT; kind++) {
+        issued.Set(PollScheduler::KindName(static_cast<PollScheduler::Kind>(kind)),
+                   Napi::Number::New(env, static_cast<double>(stats.issued_by_kind[kind])));
+    }
+
+    Napi::Object obj = Napi::Object::New(env);
+    obj.Set("running", Napi::Boolean::New(env, static_cast<bool>(scheduler_)));
+    obj.Set("devices", Napi::Number::New(env, static_cast<double>(stats.devices)));
+    obj.Set("timers", Napi::Number::New(env, static_cast<double>(stats.timers)));
+    obj.Set("pending", Napi::Number::New(env, static_cast<double>(stats.pending)));
+    obj.Set("fired", Napi::Number::New(env, static_cast<double>(stats.fired)));
+    obj.Set("issued", Napi::Number::New(env, static_cast<double>(stats.issued)));
+    obj.Set("issuedByKind", issued);
+    obj.Set("skipped", Napi::Number::New(env, static_cast<double>(stats.skipped)));
+    obj.Set("missed", Napi::Number::New(env, static_cast<double>(stats.missed)));
+    obj.Set("gone", Napi::Number::New(env, static_cast<double>(stats.gone)));
+    obj.Set("answered", Napi::Number::New(env, static_cast<double>(stats.answered)));
+    obj.Set("failed", Napi::Number::New(env, static_cast<double>(stats.failed)));
+    obj.Set("batches", Napi::Number::New(env, static_cast<double>(stats.batches)));
+    obj.Set("delivered", Napi::Number::New(env, static_cast<double>(stats.delivered)));
+    obj.Set("dropped", Napi::Number::New(env, static_cast<double>(stats.dropped)));
+    obj.Set("meanLagMs", Napi::Number::New(env, stats.fired > 0 ? static_cast<double>(stats.lag_ms) / stats.fired : 0.0));
+    obj.Set("maxLagMs", Napi::Number::New(env, static_cast<double>(stats.max_lag_ms)));
+    return obj;
+}
@@ -0,0 +1,32 @@
+#ifndef POLL_SCHEDULER_WRAPPER_H
+#define POLL_SCHEDULER_WRAPPER_H
+
+#include <napi.h>
+
+#include <memory>
+#include <vector>
+
+#include "poll_scheduler.h"
+
+class PollSchedulerWrapper : public Napi::ObjectWrap<PollSchedulerWrapper> {
+public:
+    static Napi::Object Init(Napi::Env env, Napi::Object exports);
+    PollSchedulerWrapper(const Napi::CallbackInfo& info);
+    ~PollSchedulerWrapper();
+
+    Napi::Value Add(const Napi::CallbackInfo& info);
+    Napi::Value Remove(const Napi::CallbackInfo& info);
+    Napi::Value Stop(const Napi::CallbackInfo& info);
+    Napi::Value GetStats(const Napi::CallbackInfo& info);
+
+private:
+    std::unique_ptr<PollScheduler> scheduler_;
+    // onResults, one call per batch
+    Napi::ThreadSafeFunction results_tsfn_;
+
+    void Shutdown();
+
+    static Napi::Array ResultsToArray(Napi::Env env, const std::vector<PollScheduler::Result>& results);
+};
+
+#endif
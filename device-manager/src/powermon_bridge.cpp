@@ -1,3 +1,4 @@
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -8,6 +9,11 @@
 #include <powermon.h>
 #include <powermon_log.h>
 
+#include "powermon_factory.h"
+#include "request_trace.h"
+#include "usdt_probes.h"
+
+#include <algorithm>
 #include <string>
 #include <sstream>
 #include <iomanip>
@@ -23,6 +29,29 @@ static std::atomic<bool> should_exit(false);
 static std::mutex response_mutex;
 static std::condition_variable response_cv;
 static std::string current_cmd_id;
+static std::atomic<uint64_t> connect_trace(0);
+static std::atomic<uint64_t> connect_start_us(0);
+
+// RequestTrace marks for one request; the whole bridge process is one device
+struct TracedRequest {
+    LatencyStats::Op op;
+    uint64_t id;
+    uint64_t start;
+
+    explicit TracedRequest(LatencyStats::Op op)
+        : op(op), id(RequestTrace::Begin(op, getpid())), start(LatencyStats::Now()) {
+        POWERMON_PROBE2(request_submit, op, getpid());
+    }
+
+    void Answered(uint16_t code) const {
+        RequestTrace::Mark(id, op, getpid(), RequestTrace::PHASE_CALLBACK, code);
+        POWERMON_PROBE4(request_done, op, getpid(), code, LatencyStats::Now() - start);
+    }
+    void Written() const {
+        RequestTrace::Mark(id, op, getpid(), RequestTrace::PHASE_WRITTEN);
+        POWERMON_PROBE3(reply_written, op, getpid(), LatencyStats::Now() - start);
+    }
+};
 
 static void output_event(const char* event, const char* data = nullptr) {
     if (data) {
@@ -214,7 +243,11 @@ static void cmd_connect(const std::string& cmd_id, const std::string& url) {
         return;
     }
     
+    RequestTrace::NameDevice(getpid(), "bridge " + std::string(id.name));
     connecting = true;
+    connect_trace = RequestTrace::Begin(LatencyStats::OP_CONNECT, getpid());
+    connect_start_us = LatencyStats::Now();
+    POWERMON_PROBE1(connect_start, getpid());
     powermon->connectWifi(id.access_key);
     output_result(cmd_id, true, 0);
 }
@@ -241,12 +274,15 @@ static void cmd_get_info(const std::string& cmd_id) {
     
     std::atomic<bool> done(false);
     std::string id_copy = cmd_id;
-    powermon->requestGetInfo([&done, id_copy](Powermon::ResponseCode code, const Powermon::DeviceInfo& info) {
+    const TracedRequest trace(LatencyStats::OP_INFO);
+    powermon->requestGetInfo([&done, id_copy, trace](Powermon::ResponseCode code, const Powermon::DeviceInfo& info) {
+        trace.Answered(code);
         if (code == Powermon::RSP_SUCCESS) {
             output_result(id_copy, true, code, device_info_to_json(info).c_str());
         } else {
             output_result(id_copy, false, code);
         }
+        trace.Written();
         done = true;
     });
     
@@ -261,12 +297,15 @@ static void cmd_get_monitor_data(const std::string& cmd_id) {
     
     std::atomic<bool> done(false);
     std::string id_copy = cmd_id;
-    powermon->requestGetMonitorData([&done, id_copy](Powermon::ResponseCode code, const Powermon::MonitorData& data) {
+    const TracedRequest trace(LatencyStats::OP_MONITOR);
+    powermon->requestGetMonitorData([&done, id_copy, trace](Powermon::ResponseCode code, const Powermon::MonitorData& data) {
+        trace.Answered(code);
         if (code == Powermon::RSP_SUCCESS) {
             output_result(id_copy, true, code, monitor_data_to_json(data).c_str());
         } else {
             output_result(id_copy, false, code);
         }
+        trace.Written();
         done = true;
     });
     
@@ -281,12 +320,15 @@ static void cmd_get_statistics(const std::string& cmd_id) {
     
     std::atomic<bool> done(false);
     std::string id_copy = cmd_id;
-    powermon->requestGetStatistics([&done, id_copy](Powermon::ResponseCode code, const Powermon::MonitorStatistics& stats) {
+    const TracedRequest trace(LatencyStats::OP_STATISTICS);
+    powermon->requestGetStatistics([&done, id_copy, trace](Powermon::ResponseCode code, const Powermon::MonitorStatistics& stats) {
+        trace.Answered(code);
         if (code == Powermon::RSP_SUCCESS) {
             output_result(id_copy, true, code, monitor_stats_to_json(stats).c_str());
         } else {
             output_result(id_copy, false, code);
         }
+        trace.Written();
         done = true;
     });
     
@@ -301,12 +343,15 @@ static void cmd_get_fg_statistics(const std::string& cmd_id) {
     
     std::atomic<bool> done(false);
     std::string id_copy = cmd_id;
-    powermon->requestGetFgStatistics([&done, id_copy](Powermon::ResponseCode code, const Powermon::FuelgaugeStatistics& stats) {
+    const TracedRequest trace(LatencyStats::OP_FG_STATISTICS);
+    powermon->requestGetFgStatistics([&done, id_copy, trace](Powermon::ResponseCode code, const Powermon::FuelgaugeStatistics& stats) {
+        trace.Answered(code);
         if (code == Powermon::RSP_SUCCESS) {
             output_result(id_copy, true, code, fg_stats_to_json(stats).c_str());
         } else {
             output_result(id_copy, false, code);
         }
+        trace.Written();
         done = true;
     });
     
@@ -321,12 +366,15 @@ static void cmd_get_log_files(const std::string& cmd_id) {
     
     std::atomic<bool> done(false);
     std::string id_copy = cmd_id;
-    powermon->requestGetLogFileList([&done, id_copy](Powermon::ResponseCode code, const std::vector<Powermon::LogFileDescriptor>& files) {
+    const TracedRequest trace(LatencyStats::OP_LOG_FILES);
+    powermon->requestGetLogFileList([&done, id_copy, trace](Powermon::ResponseCode code, const std::vector<Powermon::LogFileDescriptor>& files) {
+        trace.Answered(code);
         if (code == Powermon::RSP_SUCCESS) {
             output_result(id_copy, true, code, log_files_to_json(files).c_str());
         } else {
             output_result(id_copy, false, code);
         }
+        trace.Written();
         done = true;
     });
     
@@ -341,7 +389,9 @@ static void cmd_read_log_file(const std::string& cmd_id, uint32_t file_id, uint3
     
     std::atomic<bool> done(false);
     std::string id_copy = cmd_id;
-    powermon->requestReadLogFile(file_id, offset, size, [&done, id_copy](Powermon::ResponseCode code, const uint8_t* data, size_t len) {
+    const TracedRequest trace(LatencyStats::OP_READ_LOG);
+    powermon->requestReadLogFile(file_id, offset, size, [&done, id_copy, trace](Powermon::ResponseCode code, const uint8_t* data, size_t len) {
+        trace.Answered(code);
         if (code == Powermon::RSP_SUCCESS && data && len > 0) {
             std::ostringstream ss;
             ss << "\"";
@@ -353,6 +403,7 @@ static void cmd_read_log_file(const std::string& cmd_id, uint32_t file_id, uint3
         } else {
             output_result(id_copy, code == Powermon::RSP_SUCCESS, code);
         }
+        trace.Written();
         done = true;
     });
     
@@ -368,11 +419,14 @@ static void cmd_stream_monitor(const std::string& cmd_id, int interval_ms, int c
     int samples = 0;
     while (!should_exit && connected && (count == 0 || samples < count)) {
         std::atomic<bool> done(false);
-        powermon->requestGetMonitorData([&done](Powermon::ResponseCode code, const Powermon::MonitorData& data) {
+        const TracedRequest trace(LatencyStats::OP_MONITOR);
+        powermon->requestGetMonitorData([&done, trace](Powermon::ResponseCode code, const Powermon::MonitorData& data) {
+            trace.Answered(code);
             if (code == Powermon::RSP_SUCCESS) {
                 std::string json = monitor_data_to_json(data);
                 output_event("monitor", ("\"data\":" + json).c_str());
             }
+            trace.Written();
             done = true;
         });
         
@@ -389,6 +443,44 @@ static void cmd_stream_monitor(const std::string& cmd_id, int interval_ms, int c
     output_result(cmd_id, true, 0);
 }
 
+// trace <events>: start tracing into a ring of that many events (0 stops)
+static void cmd_trace(const std::string& cmd_id, const std::string& arg) {
+    char* end = nullptr;
+    errno = 0;
+    const unsigned long long events = strtoull(arg.c_str(), &end, 10);
+    if (arg.empty() || arg[0] == '-' || *end != '\0' || errno != 0 || events > RequestTrace::MAX_EVENTS) {
+        output_error(cmd_id, ("Event count must be an integer from 0 to " +
+                              std::to_string(RequestTrace::MAX_EVENTS)).c_str());
+        return;
+    }
+    RequestTrace::Enable(static_cast<size_t>(events));
+    std::ostringstream ss;
+    ss << "{\"events\":" << RequestTrace::Capacity() << "}";
+    output_result(cmd_id, true, 0, ss.str().c_str());
+}
+
+// tracedump <path>: write the Chrome trace JSON; without a path it is the result data
+static void cmd_trace_dump(const std::string& cmd_id, const std::string& path) {
+    std::string trace;
+    RequestTrace::Dump(trace);
+    if (path.empty()) {
+        // Results are one line each; the trace's newlines all sit between
+        // tokens (names are escaped), so dropping them keeps the JSON intact
+        trace.erase(std::remove(trace.begin(), trace.end(), '\n'), trace.end());
+        output_result(cmd_id, true, 0, trace.c_str());
+        return;
+    }
+    
+    FILE* f = fopen(path.c_str(), "w");
+    if (f == nullptr || fwrite(trace.data(), 1, trace.size(), f) != trace.size()) {
+        if (f) fclose(f);
+        output_error(cmd_id, "Cannot write trace file");
+        return;
+    }
+    fclose(f);
+    output_result(cmd_id, true, 0, ("\"" + escape_json_string(path) + "\"").c_str());
+}
+
 static void handle_signal(int sig) {
     should_exit = true;
 }
@@ -445,6 +537,14 @@ static void parse_command(const std::string& line) {
         int count = 0;
         iss >> interval_ms >> count;
         cmd_stream_monitor(cmd_id, interval_ms, count);
+    } else if (cmd == "trace") {
+        std::string events;
+        iss >> events;
+        cmd_trace(cmd_id, events);
+    } else if (cmd == "tracedump") {
+        std::string path;
+        std::getline(iss >> std::ws, path);
+        cmd_trace_dump(cmd_id, path);
     } else if (cmd == "quit" || cmd == "exit") {
         should_exit = true;
         output_result(cmd_id, true, 0);
@@ -458,24 +558,33 @@ int main(int argc, char** argv) {
     signal(SIGTERM, handle_signal);
     signal(SIGPIPE, SIG_IGN);
     
-    powermon = Powermon::createInstance();
+    powermon = PowermonFactory::Create();
     if (powermon == nullptr) {
         output_fatal("Failed to create Powermon instance");
         return EXIT_FAILURE;
     }
     
     powermon->setOnConnectCallback([]() {
+        const uint64_t trace = connect_trace.exchange(0);
+        RequestTrace::Mark(trace, LatencyStats::OP_CONNECT, getpid(), RequestTrace::PHASE_CALLBACK);
+        POWERMON_PROBE2(connect_done, getpid(), LatencyStats::Now() - connect_start_us);
         connected = true;
         connecting = false;
         output_event("connected");
+        RequestTrace::Mark(trace, LatencyStats::OP_CONNECT, getpid(), RequestTrace::PHASE_WRITTEN);
     });
     
     powermon->setOnDisconnectCallback([](Powermon::DisconnectReason reason) {
+        // Ends a failed connect attempt's trace; 0 (nothing) after a connect
+        const uint64_t trace = connect_trace.exchange(0);
+        RequestTrace::Mark(trace, LatencyStats::OP_CONNECT, getpid(), RequestTrace::PHASE_CALLBACK, reason);
+        POWERMON_PROBE3(disconnect, getpid(), reason, connecting.load());
         connected = false;
         connecting = false;
         std::ostringstream ss;
         ss << "\"reason\":" << (int)reason;
         output_event("disconnected", ss.str().c_str());
+        RequestTrace::Mark(trace, LatencyStats::OP_CONNECT, getpid(), RequestTrace::PHASE_WRITTEN);
     });
     
     output_event("ready");
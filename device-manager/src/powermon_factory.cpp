@@ -0,0 +1,211 @@
+#include "powermon_factory.h"
+#include "device_trace.h"
+#include "fake_powermon.h"
+#include "recording_powermon.h"
+#include "replay_powermon.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace PowermonFactory {
+
+namespace {
+
+const char* TRACE_SUFFIX = ".pmtrace";
+
+std::mutex mutex;
+bool initialized = false;
+std::string backend = "vendor";
+FakePowermon::Config fake_config;
+ReplayPowermon::Config replay_config;
+std::vector<std::shared_ptr<const ReplayPowermon::Trace>> replay_traces;
+size_t replay_next = 0;
+std::string record_dir;
+uint32_t record_count = 0;
+uint64_t generation = 1;
+
+bool EndsWith(const std::string& s, const std::string& suffix) {
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// A trace file, or every *.pmtrace in a directory (dealt to devices in name order)
+bool LoadTraces(const std::string& path, std::vector<std::shared_ptr<const ReplayPowermon::Trace>>& traces,
+                std::string* error) {
+    std::vector<std::string> paths;
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+        DIR* dir = opendir(path.c_str());
+        if (dir != nullptr) {
+            while (struct dirent* entry = readdir(dir)) {
+                if (EndsWith(entry->d_name, TRACE_SUFFIX)) {
+                    paths.push_back(path + "/" + entry->d_name);
+                }
+            }
+            closedir(dir);
+        }
+        std::sort(paths.begin(), paths.end());
+        if (paths.empty()) {
+            if (error) *error = "No " + std::string(TRACE_SUFFIX) + " files in " + path;
+            return false;
+        }
+    } else {
+        paths.push_back(path);
+    }
+
+    traces.clear();
+    for (const std::string& p : paths) {
+        std::shared_ptr<const ReplayPowermon::Trace> trace = ReplayPowermon::Trace::Load(p, error);
+        if (!trace) {
+            return false;
+        }
+        traces.push_back(trace);
+    }
+    return true;
+}
+
+// Reads the environment once; a bad POWERMON_FAKE or POWERMON_REPLAY spec
+// falls back to defaults (no traces: replayed devices never connect)
+void Initialize() {
+    if (initialized) {
+        return;
+    }
+    initialized = true;
+
+    const char* name = getenv("POWERMON_BACKEND");
+    if (name != nullptr && (std::string(name) == "fake" || std::string(name) == "replay")) {
+        backend = name;
+    }
+
+    FakePowermon::Config config;
+    std::string error;
+    if (FakePowermon::Config::Parse(getenv("POWERMON_FAKE"), config, &error)) {
+        fake_config = config;
+    } else {
+        fprintf(stderr, "POWERMON_FAKE ignored: %s\n", error.c_str());
+    }
+
+    if (backend == "replay") {
+        ReplayPowermon::Config replay;
+        if (!ReplayPowermon::Config::Parse(getenv("POWERMON_REPLAY"), replay, &error) ||
+            !LoadTraces(replay.trace, replay_traces, &error)) {
+            fprintf(stderr, "POWERMON_REPLAY ignored: %s\n", error.c_str());
+        }
+        replay_config = replay;
+    }
+
+    const char* record = getenv("POWERMON_RECORD");
+    if (record != nullptr) {
+        record_dir = record;
+    }
+}
+
+Powermon* CreateBackend() {
+    if (backend == "fake") {
+        return new FakePowermon(fake_config);
+    }
+    if (backend == "replay") {
+        std::shared_ptr<const ReplayPowermon::Trace> trace = replay_traces.empty()
+            ? std::make_shared<const ReplayPowermon::Trace>()
+            : replay_traces[replay_next++ % replay_traces.size()];
+        return new ReplayPowermon(trace, replay_config);
+    }
+    return Powermon::createInstance();
+}
+
+}
+
+Powermon* Create() {
+    std::lock_guard<std::mutex> lock(mutex);
+    Initialize();
+    Powermon* powermon = CreateBackend();
+    if (record_dir.empty()) {
+        return powermon;
+    }
+
+    std::string path = record_dir + "/trace-" + std::to_string(getpid()) + "-" +
+                       std::to_string(record_count++) + TRACE_SUFFIX;
+    std::shared_ptr<DeviceTrace::Writer> writer = std::make_shared<DeviceTrace::Writer>();
+    std::string error;
+    if (!writer->Open(path, &error)) {
+        fprintf(stderr, "POWERMON_RECORD: %s\n", error.c_str());
+        return powermon;
+    }
+    return new RecordingPowermon(powermon, writer);
+}
+
+bool SetBackend(const std::string& name, const std::string& spec, std::string* error) {
+    FakePowermon::Config config;
+    ReplayPowermon::Config replay;
+    std::vector<std::shared_ptr<const ReplayPowermon::Trace>> traces;
+
+    if (name == "replay") {
+        if (!ReplayPowermon::Config::Parse(spec.c_str(), replay, error) ||
+            !LoadTraces(replay.trace, traces, error)) {
+            return false;
+        }
+    } else if (name == "vendor" || name == "fake") {
+        if (!FakePowermon::Config::Parse(spec.c_str(), config, error)) {
+            return false;
+        }
+    } else {
+        if (error) *error = "Unknown backend: " + name;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    Initialize();
+    backend = name;
+    generation++;
+    if (name == "replay") {
+        replay_config = replay;
+        replay_traces = traces;
+        replay_next = 0;
+    } else {
+        fake_config = config;
+    }
+    return true;
+}
+
+bool SetRecording(const std::string& dir, std::string* error) {
+    if (!dir.empty()) {
+        struct stat st;
+        if (stat(dir.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+            if (error) *error = "Not a directory: " + dir;
+            return false;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    Initialize();
+    record_dir = dir;
+    generation++;
+    return true;
+}
+
+std::string Backend() {
+    std::lock_guard<std::mutex> lock(mutex);
+    Initialize();
+    return backend;
+}
+
+bool IsFake() {
+    std::lock_guard<std::mutex> lock(mutex);
+    Initialize();
+    return backend == "fake";
+}
+
+uint64_t ReuseGeneration() {
+    std::lock_guard<std::mutex> lock(mutex);
+    Initialize();
+    return (backend == "replay" || !record_dir.empty()) ? 0 : generation;
+}
+
+}
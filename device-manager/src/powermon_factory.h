@@ -0,0 +1,36 @@
+#ifndef POWERMON_FACTORY_H
+#define POWERMON_FACTORY_H
+
+#include <powermon.h>
+
+#include <string>
+
+// Creates Powermon instances for the addon and the bridge. The backend is
+// "vendor" (Powermon::createInstance(), the default), "fake" (FakePowermon,
+// configured from a "key=value,..." spec) or "replay" (ReplayPowermon playing
+// back recorded traces). POWERMON_BACKEND, POWERMON_FAKE and POWERMON_REPLAY
+// select them from the environment; SetBackend() overrides them.
+//
+// With POWERMON_RECORD (or SetRecording()) naming a directory, every device
+// created is wrapped in a RecordingPowermon writing
+// <dir>/trace-<pid>-<n>.pmtrace, whatever the backend.
+namespace PowermonFactory {
+
+Powermon* Create();
+
+// spec is the fake spec for "vendor" and "fake", the replay spec for "replay"
+bool SetBackend(const std::string& backend, const std::string& spec, std::string* error);
+// An empty dir stops recording devices created afterwards
+bool SetRecording(const std::string& dir, std::string* error);
+std::string Backend();
+bool IsFake();
+
+// Tag for instances that may be handed to another device once disconnected
+// (InstancePool): changes with SetBackend() and SetRecording(), and is 0 while
+// instances must not be reused (replay deals one trace per instance,
+// recording writes one file per instance). Read it before Create().
+uint64_t ReuseGeneration();
+
+}
+
+#endif
@@ -1,7 +1,201 @@
 #include "powermon_wrapper.h"
+#include "packed_samples_wrapper.h"
+#include "powermon_factory.h"
+#include "instance_pool.h"
+#include "instance_reaper.h"
+#include "latency_stats.h"
+#include "link_stats.h"
+#include "native_metrics.h"
+#include "request_trace.h"
+#include "resource_stats.h"
+#include "usdt_probes.h"
 #include <powermon_log.h>
 #include <sstream>
 #include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace {
+
+// Instance ids for RequestTrace
+std::atomic<uint32_t> next_device_id(1);
+
+// A pool size or prewarm count: an integer from 0 to MAX_IDLE_LIMIT
+bool ReadPoolCount(Napi::Value value, size_t& out) {
+    if (!value.IsNumber()) {
+        return false;
+    }
+    const double number = value.As<Napi::Number>().DoubleValue();
+    if (!(number >= 0 && number <= InstancePool::MAX_IDLE_LIMIT) || number != std::floor(number)) {
+        return false;
+    }
+    out = static_cast<size_t>(number);
+    return true;
+}
+
+// What a request's completion needs to account for it
+struct RequestTiming {
+    LatencyStats::Op op;
+    uint8_t hardware_revision;
+    uint32_t device;
+    uint64_t start;
+    uint64_t trace;     // RequestTrace id, 0 when tracing is off
+    LinkStats::Device* link;
+    std::shared_ptr<ResourceStats::Instance> resources;
+};
+
+RequestTiming RequestStart(LatencyStats::Op op, uint8_t hardware_revision, uint32_t device, LinkStats::Device* link,
+                           const std::shared_ptr<ResourceStats::Instance>& resources) {
+    NativeMetrics::RequestStarted(op);
+    ResourceStats::RequestStarted(*resources);
+    POWERMON_PROBE2(request_submit, op, device);
+    return { op, hardware_revision, device, LatencyStats::Now(), RequestTrace::Begin(op, device), link, resources };
+}
+
+void RequestDone(const RequestTiming& timing, Powermon::ResponseCode code) {
+    NativeMetrics::RequestFinished(timing.op, code == Powermon::RSP_SUCCESS);
+    ResourceStats::RequestAnswered(*timing.resources);
+    LatencyStats::Record(timing.op, timing.hardware_revision, timing.start, code == Powermon::RSP_SUCCESS);
+    RequestTrace::Mark(timing.trace, timing.op, timing.device, RequestTrace::PHASE_CALLBACK, code);
+    LinkStats::RequestDone(timing.link, LatencyStats::Now() - timing.start, code);
+    POWERMON_PROBE4(request_done, timing.op, timing.device, code, LatencyStats::Now() - timing.start);
+}
+
+// NonBlockingCall that keeps the JS queue depth and callback delay metrics,
+// and marks the JS callback's start and end when the request is traced.
+// bytes is the payload the callback holds until it runs
+template<typename Callback>
+void Deliver(const Napi::ThreadSafeFunction& tsfn, const RequestTiming& timing, Callback callback, size_t bytes = 0) {
+    const uint64_t queued = NativeMetrics::Queued();
+    ResourceStats::CallbackQueued(*timing.resources, bytes);
+    napi_status status = tsfn.NonBlockingCall([callback = std::move(callback), queued, timing, bytes](Napi::Env env, Napi::Function js) {
+        NativeMetrics::Delivered(queued);
+        POWERMON_PROBE3(tsfn_dequeue, timing.op, timing.device, LatencyStats::Now() - queued);
+        RequestTrace::Mark(timing.trace, timing.op, timing.device, RequestTrace::PHASE_JS_START);
+        callback(env, js);
+        RequestTrace::Mark(timing.trace, timing.op, timing.device, RequestTrace::PHASE_JS_DONE);
+        ResourceStats::CallbackDone(*timing.resources, bytes);
+    });
+    POWERMON_PROBE3(tsfn_enqueue, timing.op, timing.device, status);
+    if (status != napi_ok) {
+        NativeMetrics::Dropped();
+        ResourceStats::CallbackDone(*timing.resources, bytes);
+    }
+}
+
+// Answers the pending hibernate() or wake() callback: { success, latencyMs }
+// for a wake, { success: false, reason } when it failed or the device closed
+void SettleSleep(Napi::ThreadSafeFunction& tsfn, const RequestTiming& timing, bool success, Powermon::DisconnectReason reason, uint64_t latency_us) {
+    if (!tsfn) {
+        return;
+    }
+    Deliver(tsfn, timing, [success, reason, latency_us](Napi::Env env, Napi::Function callback) {
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("success", Napi::Boolean::New(env, success));
+        if (!success) {
+            result.Set("reason", Napi::Number::New(env, static_cast<int>(reason)));
+        } else if (latency_us > 0) {
+            result.Set("latencyMs", Napi::Number::New(env, latency_us / 1000.0));
+        }
+        callback.Call({result});
+    });
+    tsfn.Release();
+    tsfn = Napi::ThreadSafeFunction();
+}
+
+// Thread-safe function for a JS callback, counted until it is finalized
+Napi::ThreadSafeFunction NewCallback(Napi::Env env, Napi::Function callback, const char* name,
+                                     const std::shared_ptr<ResourceStats::Instance>& resources) {
+    ResourceStats::TsfnCreated(*resources);
+    return Napi::ThreadSafeFunction::New(env, callback, name, 0, 1, [resources](Napi::Env) {
+        ResourceStats::TsfnFinalized(*resources);
+    });
+}
+
+// Library instance acquired by PowermonDevice.create() on a worker thread and
+// handed to the constructor in an External
+struct Adopted {
+    Powermon* powermon = nullptr;
+    uint64_t generation = 0;
+    bool ble_available = false;
+    ResourceStats::Mark before = {};
+    ResourceStats::Mark after = {};
+};
+
+// createInstance() and the BLE probe can block on D-Bus for seconds, so
+// PowermonDevice.create() runs them on the libuv thread pool
+class CreateWorker : public Napi::AsyncWorker {
+public:
+    explicit CreateWorker(Napi::Env env)
+        : Napi::AsyncWorker(env, "PowermonDeviceCreate")
+        , deferred_(Napi::Promise::Deferred::New(env)) {}
+
+    Napi::Promise Promise() const { return deferred_.Promise(); }
+
+protected:
+    void Execute() override {
+        adopted_.before = ResourceStats::Now();
+        adopted_.powermon = InstancePool::Acquire(&adopted_.generation, &adopted_.ble_available);
+        adopted_.after = ResourceStats::Now();
+    }
+
+    void OnOK() override {
+        Napi::Env env = Env();
+        if (adopted_.powermon == nullptr) {
+            deferred_.Reject(Napi::Error::New(env, "Failed to create Powermon instance").Value());
+            return;
+        }
+        Napi::FunctionReference* constructor = env.GetInstanceData<Napi::FunctionReference>();
+        deferred_.Resolve(constructor->New({ Napi::External<Adopted>::New(env, &adopted_) }));
+    }
+
+private:
+    Napi::Promise::Deferred deferred_;
+    Adopted adopted_;
+};
+
+// InstancePool::Prewarm() for PowermonDevice.prewarmPool()
+class PrewarmWorker : public Napi::AsyncWorker {
+public:
+    PrewarmWorker(Napi::Env env, size_t count)
+        : Napi::AsyncWorker(env, "PowermonDevicePrewarm")
+        , deferred_(Napi::Promise::Deferred::New(env))
+        , count_(count) {}
+
+    Napi::Promise Promise() const { return deferred_.Promise(); }
+
+protected:
+    void Execute() override {
+        InstancePool::Prewarm(count_);
+    }
+
+    void OnOK() override;
+
+private:
+    Napi::Promise::Deferred deferred_;
+    size_t count_;
+};
+
+// A PollScheduler answer, payload left to the caller
+PollScheduler::Result PollAnswer(uint32_t id, PollScheduler::Kind kind, const RequestTiming& timing, Powermon::ResponseCode code) {
+    PollScheduler::Result result = {};
+    result.device = id;
+    result.kind = kind;
+    result.code = code;
+    result.time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    result.latency_us = LatencyStats::Now() - timing.start;
+    return result;
+}
+
+std::string DeviceTraceName(const std::string& name, uint64_t serial) {
+    std::stringstream ss;
+    ss << name << " " << std::hex << std::uppercase << std::setfill('0') << std::setw(16) << serial;
+    return ss.str();
+}
+
+}
 
 Napi::Object PowermonWrapper::Init(Napi::Env env, Napi::Object exports) {
     Napi::Function func = DefineClass(env, "PowermonDevice", {
@@ -10,9 +204,27 @@ Napi::Object PowermonWrapper::Init(Napi::Env env, Napi::Object exports) {
         StaticMethod("decodeLogData", &PowermonWrapper::DecodeLogData),
         StaticMethod("getHardwareString", &PowermonWrapper::GetHardwareString),
         StaticMethod("getPowerStatusString", &PowermonWrapper::GetPowerStatusString),
+        StaticMethod("setBackend", &PowermonWrapper::SetBackend),
+        StaticMethod("getBackend", &PowermonWrapper::GetBackend),
+        StaticMethod("setRecording", &PowermonWrapper::SetRecording),
+        StaticMethod("getLatencyStats", &PowermonWrapper::GetLatencyStats),
+        StaticMethod("getMetrics", &PowermonWrapper::GetMetrics),
+        StaticMethod("getLinkStats", &PowermonWrapper::GetLinkStats),
+        StaticMethod("getResourceStats", &PowermonWrapper::GetResourceStats),
+        StaticMethod("configurePool", &PowermonWrapper::ConfigurePool),
+        StaticMethod("getPoolStats", &PowermonWrapper::GetPoolStats),
+        StaticMethod("prewarmPool", &PowermonWrapper::PrewarmPool),
+        StaticMethod("create", &PowermonWrapper::Create),
+        StaticMethod("setTracing", &PowermonWrapper::SetTracing),
+        StaticMethod("dumpTrace", &PowermonWrapper::DumpTrace),
         
         InstanceMethod("connect", &PowermonWrapper::Connect),
         InstanceMethod("disconnect", &PowermonWrapper::Disconnect),
+        InstanceMethod("close", &PowermonWrapper::Close),
+        InstanceMethod("hibernate", &PowermonWrapper::Hibernate),
+        InstanceMethod("wake", &PowermonWrapper::Wake),
+        InstanceMethod("isHibernating", &PowermonWrapper::IsHibernating),
+        InstanceMethod("getConnectEstimate", &PowermonWrapper::GetConnectEstimate),
         InstanceMethod("isConnected", &PowermonWrapper::IsConnected),
         InstanceMethod("isBleAvailable", &PowermonWrapper::IsBleAvailable),
         InstanceMethod("getInfo", &PowermonWrapper::GetInfo),
@@ -21,6 +233,7 @@ Napi::Object PowermonWrapper::Init(Napi::Env env, Napi::Object exports) {
         InstanceMethod("getFuelgaugeStatistics", &PowermonWrapper::GetFuelgaugeStatistics),
         InstanceMethod("getLogFileList", &PowermonWrapper::GetLogFileList),
         InstanceMethod("readLogFile", &PowermonWrapper::ReadLogFile),
+        InstanceMethod("getResourceStats", &PowermonWrapper::GetResources),
     });
 
     Napi::FunctionReference* constructor = new Napi::FunctionReference();
@@ -34,67 +247,190 @@ Napi::Object PowermonWrapper::Init(Napi::Env env, Napi::Object exports) {
 PowermonWrapper::PowermonWrapper(const Napi::CallbackInfo& info) 
     : Napi::ObjectWrap<PowermonWrapper>(info)
     , powermon_(nullptr)
+    , closed_(false)
     , connected_(false)
     , connecting_(false)
-    , ble_available_(false) {
-    
-    // With libpowermon v1.11+, createInstance() no longer requires BLE
-    // BLE is now initialized separately via initBle()
-    powermon_ = Powermon::createInstance();
+    , ble_available_(false)
+    , hardware_revision_(0)
+    , connect_start_us_(0)
+    , connect_trace_(0)
+    , device_id_(next_device_id++)
+    , link_(nullptr)
+    , resources_(std::make_shared<ResourceStats::Instance>())
+    , pool_generation_(0)
+    , owner_(std::make_shared<Owner>())
+    , sleep_(AWAKE)
+    , connect_samples_(0)
+    , connect_srtt_us_(0)
+    , connect_rttvar_us_(0) {
+    
+    owner_->wrapper = this;
+    if (info.Length() > 0 && info[0].IsExternal()) {
+        // PowermonDevice.create(): acquired on a worker thread
+        const Adopted& adopted = *info[0].As<Napi::External<Adopted>>().Data();
+        powermon_ = adopted.powermon;
+        pool_generation_ = adopted.generation;
+        ble_available_ = adopted.ble_available;
+        ResourceStats::Created(*resources_, adopted.before, adopted.after);
+    } else {
+        // A pooled instance when one is idle; otherwise createInstance() and, if
+        // BLE is available (probed once, WiFi works without it), initBle()
+        const ResourceStats::Mark before = ResourceStats::Now();
+        bool ble_available = false;
+        powermon_ = InstancePool::Acquire(&pool_generation_, &ble_available);
+        ble_available_ = ble_available;
+        ResourceStats::Created(*resources_, before);
+    }
+    NativeMetrics::InstanceCreated();
     
     if (powermon_ != nullptr) {
         SetupCallbacks();
-        
-        // Try to initialize BLE (optional - WiFi works without it)
-        try {
-            ble_available_ = powermon_->initBle();
-        } catch (...) {
-            // BLE init failed (expected on servers without Bluetooth)
-            // WiFi connections will still work
-            ble_available_ = false;
-        }
     }
 }
 
 PowermonWrapper::~PowermonWrapper() {
+    NativeMetrics::InstanceDestroyed();
+    // Devices dropped without close()
+    Retire();
+}
+
+// Detaches the library instance and queues its disconnect and deletion on
+// the reaper thread. Callbacks still in flight finish first; later ones find
+// no owner
+void PowermonWrapper::Retire() {
+    if (closed_) {
+        return;
+    }
+    closed_ = true;
+    
+    std::lock_guard<std::mutex> polling(owner_->poll_mutex);
+    std::lock_guard<std::mutex> lock(owner_->mutex);
+    owner_->wrapper = nullptr;
+    SettleSleep(sleep_tsfn_, { LatencyStats::OP_CONNECT, hardware_revision_, device_id_, 0, 0, link_, resources_ }, false, Powermon::CLOSED, 0);
     CleanupCallbacks();
-    if (powermon_) {
-        if (connected_) {
-            powermon_->disconnect();
-        }
-        delete powermon_;
-        powermon_ = nullptr;
+    if (powermon_ == nullptr) {
+        ResourceStats::Destroyed(ResourceStats::Now());
+        return;
+    }
+    
+    // Only an idle instance goes back to the pool: one still connected or
+    // disconnecting, or with requests outstanding, would call back into its
+    // next owner
+    const bool active = connected_ || connecting_;
+    const bool idle = !active && sleep_ != FALLING_ASLEEP && resources_->pending_requests.load() == 0;
+    if (active) {
+        // The library's own disconnect callback will find no owner
+        OnDisconnected(Powermon::CLOSED);
+    }
+    if (sleep_ == FALLING_ASLEEP || sleep_ == ASLEEP) {
+        NativeMetrics::Woken();
     }
+    sleep_ = AWAKE;
+    InstanceReaper::Retire({ powermon_, pool_generation_, ble_available_, active, idle });
+    powermon_ = nullptr;
 }
 
 void PowermonWrapper::SetupCallbacks() {
-    powermon_->setOnConnectCallback([this]() {
-        connected_ = true;
-        connecting_ = false;
-        if (on_connect_tsfn_) {
-            on_connect_tsfn_.NonBlockingCall([](Napi::Env env, Napi::Function callback) {
-                callback.Call({});
-            });
+    powermon_->setOnConnectCallback([owner = owner_]() {
+        std::lock_guard<std::mutex> lock(owner->mutex);
+        if (owner->wrapper != nullptr) {
+            owner->wrapper->OnConnected();
         }
     });
     
-    powermon_->setOnDisconnectCallback([this](Powermon::DisconnectReason reason) {
-        connected_ = false;
-        connecting_ = false;
-        if (on_disconnect_tsfn_) {
-            on_disconnect_tsfn_.NonBlockingCall([reason](Napi::Env env, Napi::Function callback) {
-                callback.Call({Napi::Number::New(env, static_cast<int>(reason))});
-            });
+    powermon_->setOnDisconnectCallback([owner = owner_](Powermon::DisconnectReason reason) {
+        std::lock_guard<std::mutex> lock(owner->mutex);
+        if (owner->wrapper != nullptr) {
+            owner->wrapper->OnDisconnected(reason);
         }
     });
 }
 
+// Library callbacks, with owner_->mutex held
+void PowermonWrapper::OnConnected() {
+    const RequestTiming timing = { LatencyStats::OP_CONNECT, hardware_revision_, device_id_, connect_start_us_, connect_trace_, link_, resources_ };
+    const uint64_t elapsed = LatencyStats::Now() - timing.start;
+    LatencyStats::Record(timing.op, timing.hardware_revision, timing.start, true);
+    NativeMetrics::Connected();
+    LinkStats::Connected(timing.link);
+    RequestTrace::Mark(timing.trace, timing.op, timing.device, RequestTrace::PHASE_CALLBACK);
+    POWERMON_PROBE2(connect_done, timing.device, elapsed);
+    connected_ = true;
+    connecting_ = false;
+    
+    if (connect_samples_ == 0) {
+        connect_srtt_us_ = elapsed;
+        connect_rttvar_us_ = elapsed / 2.0;
+    } else {
+        connect_rttvar_us_ = 0.75 * connect_rttvar_us_ + 0.25 * std::fabs(connect_srtt_us_ - elapsed);
+        connect_srtt_us_ = 0.875 * connect_srtt_us_ + 0.125 * elapsed;
+    }
+    connect_samples_++;
+    
+    if (sleep_ == WAKING) {
+        sleep_ = AWAKE;
+        SettleSleep(sleep_tsfn_, timing, true, Powermon::CLOSED, elapsed);
+        return;
+    }
+    if (on_connect_tsfn_) {
+        Deliver(on_connect_tsfn_, timing, [](Napi::Env env, Napi::Function callback) {
+            callback.Call({});
+        });
+    }
+}
+
+void PowermonWrapper::OnDisconnected(Powermon::DisconnectReason reason) {
+    if (sleep_ == ASLEEP) {
+        return;
+    }
+    if (sleep_ == FALLING_ASLEEP) {
+        // hibernate() settled its accounting already
+        sleep_ = ASLEEP;
+        SettleSleep(sleep_tsfn_, { LatencyStats::OP_CONNECT, hardware_revision_, device_id_, 0, 0, link_, resources_ }, true, reason, 0);
+        return;
+    }
+    
+    const bool was_connecting = connecting_.exchange(false);
+    const bool was_connected = connected_.exchange(false);
+    // A failed connect attempt counts as an errored connect; its trace
+    // ends with the onDisconnect callback
+    const RequestTiming timing = { LatencyStats::OP_CONNECT, hardware_revision_, device_id_,
+                                   connect_start_us_, was_connecting ? connect_trace_.load() : 0, link_, resources_ };
+    if (was_connecting) {
+        LatencyStats::Record(timing.op, timing.hardware_revision, timing.start, false);
+        RequestTrace::Mark(timing.trace, timing.op, timing.device, RequestTrace::PHASE_CALLBACK, reason);
+    }
+    if (was_connecting || was_connected) {
+        NativeMetrics::Disconnected(reason, was_connecting);
+        LinkStats::Disconnected(timing.link, reason, was_connecting);
+        POWERMON_PROBE3(disconnect, timing.device, reason, was_connecting);
+    }
+    if (sleep_ == WAKING) {
+        // A failed wake leaves the device hibernating
+        sleep_ = ASLEEP;
+        NativeMetrics::Hibernated(false);
+        SettleSleep(sleep_tsfn_, timing, false, reason, 0);
+        return;
+    }
+    if (on_disconnect_tsfn_) {
+        Deliver(on_disconnect_tsfn_, timing, [reason](Napi::Env env, Napi::Function callback) {
+            callback.Call({Napi::Number::New(env, static_cast<int>(reason))});
+        });
+    }
+}
+
 void PowermonWrapper::CleanupCallbacks() {
     if (on_connect_tsfn_) {
         on_connect_tsfn_.Release();
+        on_connect_tsfn_ = Napi::ThreadSafeFunction();
     }
     if (on_disconnect_tsfn_) {
         on_disconnect_tsfn_.Release();
+        on_disconnect_tsfn_ = Napi::ThreadSafeFunction();
+    }
+    if (sleep_tsfn_) {
+        sleep_tsfn_.Release();
+        sleep_tsfn_ = Napi::ThreadSafeFunction();
     }
 }
 
@@ -166,6 +502,11 @@ Napi::Value PowermonWrapper::ParseAccessURL(const Napi::CallbackInfo& info) {
 Napi::Value PowermonWrapper::Connect(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
     
+    if (closed_) {
+        Napi::Error::New(env, "Device is closed").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    
     // With libpowermon v1.17+, powermon_ is always created (BLE is optional)
     // Only check that powermon_ exists - WiFi works without BLE
     if (powermon_ == nullptr) {
@@ -185,24 +526,27 @@ Napi::Value PowermonWrapper::Connect(const Napi::CallbackInfo& info) {
         return env.Undefined();
     }
     
+    {
+        // A hibernating device is woken by wake(); connect() starts over
+        std::lock_guard<std::mutex> lock(owner_->mutex);
+        if (sleep_ == FALLING_ASLEEP) {
+            Napi::TypeError::New(env, "Still hibernating").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        if (sleep_ == ASLEEP) {
+            sleep_ = AWAKE;
+            NativeMetrics::Woken();
+        }
+    }
+    
     Napi::Object options = info[0].As<Napi::Object>();
     
     if (options.Has("onConnect") && options.Get("onConnect").IsFunction()) {
-        on_connect_tsfn_ = Napi::ThreadSafeFunction::New(
-            env,
-            options.Get("onConnect").As<Napi::Function>(),
-            "OnConnectCallback",
-            0, 1
-        );
+        on_connect_tsfn_ = NewCallback(env, options.Get("onConnect").As<Napi::Function>(), "OnConnectCallback", resources_);
     }
     
     if (options.Has("onDisconnect") && options.Get("onDisconnect").IsFunction()) {
-        on_disconnect_tsfn_ = Napi::ThreadSafeFunction::New(
-            env,
-            options.Get("onDisconnect").As<Napi::Function>(),
-            "OnDisconnectCallback",
-            0, 1
-        );
+        on_disconnect_tsfn_ = NewCallback(env, options.Get("onDisconnect").As<Napi::Function>(), "OnDisconnectCallback", resources_);
     }
     
     if (options.Has("accessKey") && options.Get("accessKey").IsObject()) {
@@ -222,8 +566,8 @@ Napi::Value PowermonWrapper::Connect(const Napi::CallbackInfo& info) {
             }
         }
         
-        connecting_ = true;
-        powermon_->connectWifi(access_key_);
+        link_ = LinkStats::Attach(access_key_.channel_id, CHANNEL_ID_SIZE);
+        StartConnect();
         
     } else if (options.Has("url") && options.Get("url").IsString()) {
         std::string url = options.Get("url").As<Napi::String>().Utf8Value();
@@ -235,8 +579,11 @@ Napi::Value PowermonWrapper::Connect(const Napi::CallbackInfo& info) {
         }
         
         access_key_ = id.access_key;
-        connecting_ = true;
-        powermon_->connectWifi(access_key_);
+        hardware_revision_ = id.hardware_revision_bcd;
+        RequestTrace::NameDevice(device_id_, DeviceTraceName(id.name, id.serial));
+        link_ = LinkStats::Attach(access_key_.channel_id, CHANNEL_ID_SIZE);
+        LinkStats::SetSerial(link_, id.serial, id.hardware_revision_bcd);
+        StartConnect();
         
     } else {
         Napi::TypeError::New(env, "Either 'accessKey' or 'url' option required")
@@ -247,13 +594,100 @@ Napi::Value PowermonWrapper::Connect(const Napi::CallbackInfo& info) {
     return env.Undefined();
 }
 
+void PowermonWrapper::StartConnect() {
+    connecting_ = true;
+    connect_start_us_ = LatencyStats::Now();
+    connect_trace_ = RequestTrace::Begin(LatencyStats::OP_CONNECT, device_id_);
+    NativeMetrics::ConnectStarted();
+    POWERMON_PROBE1(connect_start, device_id_);
+    powermon_->connectWifi(access_key_);
+}
+
 Napi::Value PowermonWrapper::Disconnect(const Napi::CallbackInfo& info) {
+    {
+        std::lock_guard<std::mutex> lock(owner_->mutex);
+        if (sleep_ == ASLEEP) {
+            sleep_ = AWAKE;
+            NativeMetrics::Woken();
+        }
+    }
     if (connected_ || connecting_) {
         powermon_->disconnect();
     }
     return info.Env().Undefined();
 }
 
+Napi::Value PowermonWrapper::Hibernate(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    
+    if (info.Length() < 1 || !info[0].IsFunction()) {
+        Napi::TypeError::New(env, "Callback function expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(owner_->mutex);
+        if (!connected_ || sleep_ != AWAKE) {
+            Napi::TypeError::New(env, "Not connected").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        // Requests fail fast from here on; the disconnect is not reported to
+        // onDisconnect or counted as a dropped link
+        sleep_ = FALLING_ASLEEP;
+        connected_ = false;
+        sleep_tsfn_ = NewCallback(env, info[0].As<Napi::Function>(), "HibernateCallback", resources_);
+        NativeMetrics::Hibernated(true);
+    }
+    powermon_->disconnect();
+    return env.Undefined();
+}
+
+Napi::Value PowermonWrapper::Wake(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    
+    if (info.Length() < 1 || !info[0].IsFunction()) {
+        Napi::TypeError::New(env, "Callback function expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(owner_->mutex);
+        if (sleep_ != ASLEEP) {
+            Napi::TypeError::New(env, "Not hibernating").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        sleep_ = WAKING;
+        sleep_tsfn_ = NewCallback(env, info[0].As<Napi::Function>(), "WakeCallback", resources_);
+        NativeMetrics::Woken();
+    }
+    StartConnect();
+    return env.Undefined();
+}
+
+Napi::Value PowermonWrapper::IsHibernating(const Napi::CallbackInfo& info) {
+    std::lock_guard<std::mutex> lock(owner_->mutex);
+    return Napi::Boolean::New(info.Env(), sleep_ != AWAKE);
+}
+
+Napi::Value PowermonWrapper::GetConnectEstimate(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    std::lock_guard<std::mutex> lock(owner_->mutex);
+    
+    // Lead time to start a connect ahead of when it must be up: the
+    // retransmission timeout formula, SRTT + 4 * RTTVAR
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("samples", Napi::Number::New(env, static_cast<double>(connect_samples_)));
+    result.Set("meanMs", Napi::Number::New(env, connect_srtt_us_ / 1000.0));
+    result.Set("deviationMs", Napi::Number::New(env, connect_rttvar_us_ / 1000.0));
+    result.Set("leadMs", Napi::Number::New(env, (connect_srtt_us_ + 4 * connect_rttvar_us_) / 1000.0));
+    return result;
+}
+
+Napi::Value PowermonWrapper::Close(const Napi::CallbackInfo& info) {
+    Retire();
+    return info.Env().Undefined();
+}
+
 Napi::Value PowermonWrapper::IsConnected(const Napi::CallbackInfo& info) {
     return Napi::Boolean::New(info.Env(), connected_.load());
 }
@@ -372,12 +806,22 @@ Napi::Value PowermonWrapper::GetInfo(const Napi::CallbackInfo& info) {
         return env.Undefined();
     }
     
-    Napi::ThreadSafeFunction tsfn = Napi::ThreadSafeFunction::New(
-        env, info[0].As<Napi::Function>(), "GetInfoCallback", 0, 1
-    );
+    Napi::ThreadSafeFunction tsfn = NewCallback(env, info[0].As<Napi::Function>(), "GetInfoCallback", resources_);
     
-    powermon_->requestGetInfo([tsfn](Powermon::ResponseCode code, const Powermon::DeviceInfo& device_info) mutable {
-        tsfn.NonBlockingCall([code, device_info](Napi::Env env, Napi::Function callback) {
+    const RequestTiming timing = RequestStart(LatencyStats::OP_INFO, hardware_revision_, device_id_, link_, resources_);
+    powermon_->requestGetInfo([owner = owner_, tsfn, timing](Powermon::ResponseCode code, const Powermon::DeviceInfo& device_info) mutable {
+        RequestDone(timing, code);
+        if (code == Powermon::RSP_SUCCESS) {
+            {
+                std::lock_guard<std::mutex> lock(owner->mutex);
+                if (owner->wrapper != nullptr) {
+                    owner->wrapper->hardware_revision_ = device_info.hardware_revision_bcd;
+                }
+            }
+            RequestTrace::NameDevice(timing.device, DeviceTraceName(device_info.name, device_info.serial));
+            LinkStats::SetSerial(timing.link, device_info.serial, device_info.hardware_revision_bcd);
+        }
+        Deliver(tsfn, timing, [code, device_info](Napi::Env env, Napi::Function callback) {
             Napi::Object result = Napi::Object::New(env);
             result.Set("success", Napi::Boolean::New(env, code == Powermon::RSP_SUCCESS));
             result.Set("code", Napi::Number::New(env, static_cast<int>(code)));
@@ -407,12 +851,15 @@ Napi::Value PowermonWrapper::GetMonitorData(const Napi::CallbackInfo& info) {
         return env.Undefined();
     }
     
-    Napi::ThreadSafeFunction tsfn = Napi::ThreadSafeFunction::New(
-        env, info[0].As<Napi::Function>(), "GetMonitorDataCallback", 0, 1
-    );
+    Napi::ThreadSafeFunction tsfn = NewCallback(env, info[0].As<Napi::Function>(), "GetMonitorDataCallback", resources_);
     
-    powermon_->requestGetMonitorData([tsfn](Powermon::ResponseCode code, const Powermon::MonitorData& data) mutable {
-        tsfn.NonBlockingCall([code, data](Napi::Env env, Napi::Function callback) {
+    const RequestTiming timing = RequestStart(LatencyStats::OP_MONITOR, hardware_revision_, device_id_, link_, resources_);
+    powermon_->requestGetMonitorData([tsfn, timing](Powermon::ResponseCode code, const Powermon::MonitorData& data) mutable {
+        RequestDone(timing, code);
+        if (code == Powermon::RSP_SUCCESS) {
+            LinkStats::Rssi(timing.link, data.rssi);
+        }
+        Deliver(tsfn, timing, [code, data](Napi::Env env, Napi::Function callback) {
             Napi::Object result = Napi::Object::New(env);
             result.Set("success", Napi::Boolean::New(env, code == Powermon::RSP_SUCCESS));
             result.Set("code", Napi::Number::New(env, static_cast<int>(code)));
@@ -442,12 +889,12 @@ Napi::Value PowermonWrapper::GetStatistics(const Napi::CallbackInfo& info) {
         return env.Undefined();
     }
     
-    Napi::ThreadSafeFunction tsfn = Napi::ThreadSafeFunction::New(
-        env, info[0].As<Napi::Function>(), "GetStatisticsCallback", 0, 1
-    );
+    Napi::ThreadSafeFunction tsfn = NewCallback(env, info[0].As<Napi::Function>(), "GetStatisticsCallback", resources_);
     
-    powermon_->requestGetStatistics([tsfn](Powermon::ResponseCode code, const Powermon::MonitorStatistics& stats) mutable {
-        tsfn.NonBlockingCall([code, stats](Napi::Env env, Napi::Function callback) {
+    const RequestTiming timing = RequestStart(LatencyStats::OP_STATISTICS, hardware_revision_, device_id_, link_, resources_);
+    powermon_->requestGetStatistics([tsfn, timing](Powermon::ResponseCode code, const Powermon::MonitorStatistics& stats) mutable {
+        RequestDone(timing, code);
+        Deliver(tsfn, timing, [code, stats](Napi::Env env, Napi::Function callback) {
             Napi::Object result = Napi::Object::New(env);
             result.Set("success", Napi::Boolean::New(env, code == Powermon::RSP_SUCCESS));
             result.Set("code", Napi::Number::New(env, static_cast<int>(code)));
@@ -477,12 +924,12 @@ Napi::Value PowermonWrapper::GetFuelgaugeStatistics(const Napi::CallbackInfo& in
         return env.Undefined();
     }
     
-    Napi::ThreadSafeFunction tsfn = Napi::ThreadSafeFunction::New(
-        env, info[0].As<Napi::Function>(), "GetFgStatisticsCallback", 0, 1
-    );
+    Napi::ThreadSafeFunction tsfn = NewCallback(env, info[0].As<Napi::Function>(), "GetFgStatisticsCallback", resources_);
     
-    powermon_->requestGetFgStatistics([tsfn](Powermon::ResponseCode code, const Powermon::FuelgaugeStatistics& stats) mutable {
-        tsfn.NonBlockingCall([code, stats](Napi::Env env, Napi::Function callback) {
+    const RequestTiming timing = RequestStart(LatencyStats::OP_FG_STATISTICS, hardware_revision_, device_id_, link_, resources_);
+    powermon_->requestGetFgStatistics([tsfn, timing](Powermon::ResponseCode code, const Powermon::FuelgaugeStatistics& stats) mutable {
+        RequestDone(timing, code);
+        Deliver(tsfn, timing, [code, stats](Napi::Env env, Napi::Function callback) {
             Napi::Object result = Napi::Object::New(env);
             result.Set("success", Napi::Boolean::New(env, code == Powermon::RSP_SUCCESS));
             result.Set("code", Napi::Number::New(env, static_cast<int>(code)));
@@ -499,6 +946,108 @@ Napi::Value PowermonWrapper::GetFuelgaugeStatistics(const Napi::CallbackInfo& in
     return env.Undefined();
 }
 
+PollScheduler::Poller PowermonWrapper::PollerFor(Napi::Env env, Napi::Value value) {
+    Napi::FunctionReference* constructor = env.GetInstanceData<Napi::FunctionReference>();
+    if (!value.IsObject() || !value.As<Napi::Object>().InstanceOf(constructor->Value())) {
+        return nullptr;
+    }
+    PowermonWrapper* wrapper = Unwrap(value.As<Napi::Object>());
+    if (wrapper == nullptr || wrapper->closed_) {
+        return nullptr;
+    }
+    
+    return [owner = wrapper->owner_](PollScheduler::Kind kind, uint32_t id, uint64_t& connects, const PollScheduler::Sink& sink) {
+        std::lock_guard<std::mutex> polling(owner->poll_mutex);
+        PowermonWrapper* wrapper;
+        {
+            std::lock_guard<std::mutex> lock(owner->mutex);
+            wrapper = owner->wrapper;
+            if (wrapper == nullptr) {
+                return PollScheduler::GONE;
+            }
+            if (!wrapper->connected_ || wrapper->sleep_ != AWAKE) {
+                return PollScheduler::SKIPPED;
+            }
+            if (kind == PollScheduler::INFO) {
+                if (wrapper->connect_samples_ == connects) {
+                    return PollScheduler::IDLE;
+                }
+                connects = wrapper->connect_samples_;
+            }
+        }
+        // The library may call back on another thread before the request
+        // returns, so it is issued without the owner lock; Retire() waits
+        // for poll_mutex, which keeps wrapper and powermon_ alive meanwhile
+        return wrapper->IssuePoll(kind, id, sink);
+    };
+}
+
+// Same accounting as the JS requests, answered to the scheduler's next batch
+// instead of a callback
+PollScheduler::Issue PowermonWrapper::IssuePoll(PollScheduler::Kind kind, uint32_t id, const PollScheduler::Sink& sink) {
+    switch (kind) {
+        case PollScheduler::MONITOR: {
+            const RequestTiming timing = RequestStart(LatencyStats::OP_MONITOR, hardware_revision_, device_id_, link_, resources_);
+            powermon_->requestGetMonitorData([sink, id, timing](Powermon::ResponseCode code, const Powermon::MonitorData& data) {
+                RequestDone(timing, code);
+                PollScheduler::Result result = PollAnswer(id, PollScheduler::MONITOR, timing, code);
+                if (code == Powermon::RSP_SUCCESS) {
+                    LinkStats::Rssi(timing.link, data.rssi);
+                    result.monitor = data;
+                }
+                PollScheduler::Answer(sink, std::move(result));
+            });
+            return PollScheduler::ISSUED;
+        }
+        case PollScheduler::STATISTICS: {
+            const RequestTiming timing = RequestStart(LatencyStats::OP_STATISTICS, hardware_revision_, device_id_, link_, resources_);
+            powermon_->requestGetStatistics([sink, id, timing](Powermon::ResponseCode code, const Powermon::MonitorStatistics& stats) {
+                RequestDone(timing, code);
+                PollScheduler::Result result = PollAnswer(id, PollScheduler::STATISTICS, timing, code);
+                if (code == Powermon::RSP_SUCCESS) {
+                    result.statistics = stats;
+                }
+                PollScheduler::Answer(sink, std::move(result));
+            });
+            return PollScheduler::ISSUED;
+        }
+        case PollScheduler::FG_STATISTICS: {
+            const RequestTiming timing = RequestStart(LatencyStats::OP_FG_STATISTICS, hardware_revision_, device_id_, link_, resources_);
+            powermon_->requestGetFgStatistics([sink, id, timing](Powermon::ResponseCode code, const Powermon::FuelgaugeStatistics& stats) {
+                RequestDone(timing, code);
+                PollScheduler::Result result = PollAnswer(id, PollScheduler::FG_STATISTICS, timing, code);
+                if (code == Powermon::RSP_SUCCESS) {
+                    result.fg_statistics = stats;
+                }
+                PollScheduler::Answer(sink, std::move(result));
+            });
+            return PollScheduler::ISSUED;
+        }
+        case PollScheduler::INFO: {
+            const RequestTiming timing = RequestStart(LatencyStats::OP_INFO, hardware_revision_, device_id_, link_, resources_);
+            powermon_->requestGetInfo([owner = owner_, sink, id, timing](Powermon::ResponseCode code, const Powermon::DeviceInfo& device_info) {
+                RequestDone(timing, code);
+                PollScheduler::Result result = PollAnswer(id, PollScheduler::INFO, timing, code);
+                if (code == Powermon::RSP_SUCCESS) {
+                    {
+                        std::lock_guard<std::mutex> lock(owner->mutex);
+                        if (owner->wrapper != nullptr) {
+                            owner->wrapper->hardware_revision_ = device_info.hardware_revision_bcd;
+                        }
+                    }
+                    RequestTrace::NameDevice(timing.device, DeviceTraceName(device_info.name, device_info.serial));
+                    LinkStats::SetSerial(timing.link, device_info.serial, device_info.hardware_revision_bcd);
+                    result.info = device_info;
+                }
+                PollScheduler::Answer(sink, std::move(result));
+            });
+            return PollScheduler::ISSUED;
+        }
+        default:
+            return PollScheduler::IDLE;
+    }
+}
+
 Napi::Value PowermonWrapper::GetLogFileList(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
     
@@ -512,14 +1061,14 @@ Napi::Value PowermonWrapper::GetLogFileList(const Napi::CallbackInfo& info) {
         return env.Undefined();
     }
     
-    Napi::ThreadSafeFunction tsfn = Napi::ThreadSafeFunction::New(
-        env, info[0].As<Napi::Function>(), "GetLogFileListCallback", 0, 1
-    );
+    Napi::ThreadSafeFunction tsfn = NewCallback(env, info[0].As<Napi::Function>(), "GetLogFileListCallback", resources_);
     
-    powermon_->requestGetLogFileList([tsfn](Powermon::ResponseCode code, 
+    const RequestTiming timing = RequestStart(LatencyStats::OP_LOG_FILES, hardware_revision_, device_id_, link_, resources_);
+    powermon_->requestGetLogFileList([tsfn, timing](Powermon::ResponseCode code, 
         const std::vector<Powermon::LogFileDescriptor>& files) mutable {
         
-        tsfn.NonBlockingCall([code, files](Napi::Env env, Napi::Function callback) {
+        RequestDone(timing, code);
+        Deliver(tsfn, timing, [code, files](Napi::Env env, Napi::Function callback) {
             Napi::Object result = Napi::Object::New(env);
             result.Set("success", Napi::Boolean::New(env, code == Powermon::RSP_SUCCESS));
             result.Set("code", Napi::Number::New(env, static_cast<int>(code)));
@@ -563,19 +1112,21 @@ Napi::Value PowermonWrapper::ReadLogFile(const Napi::CallbackInfo& info) {
         return env.Undefined();
     }
     
-    Napi::ThreadSafeFunction tsfn = Napi::ThreadSafeFunction::New(
-        env, info[3].As<Napi::Function>(), "ReadLogFileCallback", 0, 1
-    );
+    Napi::ThreadSafeFunction tsfn = NewCallback(env, info[3].As<Napi::Function>(), "ReadLogFileCallback", resources_);
     
+    const RequestTiming timing = RequestStart(LatencyStats::OP_READ_LOG, hardware_revision_, device_id_, link_, resources_);
     powermon_->requestReadLogFile(file_id, offset, read_size, 
-        [tsfn](Powermon::ResponseCode code, const uint8_t* data, size_t size) mutable {
+        [tsfn, timing](Powermon::ResponseCode code, const uint8_t* data, size_t size) mutable {
         
+        RequestDone(timing, code);
         std::vector<uint8_t> data_copy;
         if (code == Powermon::RSP_SUCCESS && data && size > 0) {
             data_copy.assign(data, data + size);
+            NativeMetrics::LogBytesRead(size);
         }
+        const size_t held = data_copy.size();
         
-        tsfn.NonBlockingCall([code, data_copy](Napi::Env env, Napi::Function callback) {
+        Deliver(tsfn, timing, [code, data_copy](Napi::Env env, Napi::Function callback) {
             Napi::Object result = Napi::Object::New(env);
             result.Set("success", Napi::Boolean::New(env, code == Powermon::RSP_SUCCESS));
             result.Set("code", Napi::Number::New(env, static_cast<int>(code)));
@@ -587,7 +1138,7 @@ Napi::Value PowermonWrapper::ReadLogFile(const Napi::CallbackInfo& info) {
             }
             
             callback.Call({result});
-        });
+        }, held);
         tsfn.Release();
     });
     
@@ -618,6 +1169,8 @@ Napi::Value PowermonWrapper::DecodeLogData(const Napi::CallbackInfo& info) {
         return env.Null();
     }
     
+    const uint64_t decode_start = LatencyStats::Now();
+    POWERMON_PROBE1(decode_start, data.size());
     std::vector<PowermonLogFile::Sample> samples;
     uint32_t start_time = PowermonLogFile::decode(data, samples);
     
@@ -627,15 +1180,371 @@ Napi::Value PowermonWrapper::DecodeLogData(const Napi::CallbackInfo& info) {
     result.Set("success", Napi::Boolean::New(env, success));
     result.Set("startTime", Napi::Number::New(env, start_time));
     
+    if (PackedSamplesWrapper::WantsPacked(info, 1)) {
+        PackedSamples packed;
+        packed.Append(samples);
+        result.Set("packed", PackedSamplesWrapper::ToObject(env, packed));
+        NativeMetrics::Decoded(LatencyStats::Now() - decode_start, data.size(), samples.size());
+        POWERMON_PROBE3(decode_done, data.size(), samples.size(), LatencyStats::Now() - decode_start);
+        return result;
+    }
+
     Napi::Array arr = Napi::Array::New(env, samples.size());
     for (size_t i = 0; i < samples.size(); i++) {
         arr.Set(i, SampleToObject(env, samples[i]));
     }
     result.Set("samples", arr);
+    NativeMetrics::Decoded(LatencyStats::Now() - decode_start, data.size(), samples.size());
+    POWERMON_PROBE3(decode_done, data.size(), samples.size(), LatencyStats::Now() - decode_start);
     
     return result;
 }
 
+Napi::Value PowermonWrapper::SetBackend(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    
+    if (info.Length() < 1 || !info[0].IsString()) {
+        Napi::TypeError::New(env, "Backend name expected ('vendor', 'fake' or 'replay')")
+            .ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    
+    std::string spec;
+    if (info.Length() > 1 && info[1].IsString()) {
+        spec = info[1].As<Napi::String>().Utf8Value();
+    }
+    
+    // Only affects devices created afterwards
+    std::string error;
+    if (!PowermonFactory::SetBackend(info[0].As<Napi::String>().Utf8Value(), spec, &error)) {
+        Napi::Error::New(env, error).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    return env.Undefined();
+}
+
+Napi::Value PowermonWrapper::GetBackend(const Napi::CallbackInfo& info) {
+    return Napi::String::New(info.Env(), PowermonFactory::Backend());
+}
+
+Napi::Value PowermonWrapper::SetRecording(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    
+    std::string dir;
+    if (info.Length() > 0 && info[0].IsString()) {
+        dir = info[0].As<Napi::String>().Utf8Value();
+    } else if (info.Length() > 0 && !info[0].IsNull() && !info[0].IsUndefined()) {
+        Napi::TypeError::New(env, "Trace directory expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    
+    // Only affects devices created afterwards
+    std::string error;
+    if (!PowermonFactory::SetRecording(dir, &error)) {
+        Napi::Error::New(env, error).ThrowAsJavaScriptException();
+    }
+    return env.Undefined();
+}
+
+static Napi::Object LatencySummaryToObject(Napi::Env env, const LatencyHistogram::Summary& summary) {
+    Napi::Object obj = Napi::Object::New(env);
+    obj.Set("count", Napi::Number::New(env, static_cast<double>(summary.count)));
+    obj.Set("errors", Napi::Number::New(env, static_cast<double>(summary.errors)));
+    obj.Set("minMs", Napi::Number::New(env, summary.min_us / 1000.0));
+    obj.Set("meanMs", Napi::Number::New(env, summary.mean_us / 1000.0));
+    obj.Set("p50Ms", Napi::Number::New(env, summary.p50_us / 1000.0));
+    obj.Set("p90Ms", Napi::Number::New(env, summary.p90_us / 1000.0));
+    obj.Set("p99Ms", Napi::Number::New(env, summary.p99_us / 1000.0));
+    obj.Set("p999Ms", Napi::Number::New(env, summary.p999_us / 1000.0));
+    obj.Set("maxMs", Napi::Number::New(env, summary.max_us / 1000.0));
+    return obj;
+}
+
+Napi::Value PowermonWrapper::GetLatencyStats(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    
+    bool reset = false;
+    if (info.Length() > 0 && info[0].IsObject()) {
+        Napi::Object options = info[0].As<Napi::Object>();
+        reset = options.Has("reset") && options.Get("reset").ToBoolean().Value();
+    }
+    
+    LatencyHistogram::Summary summary;
+    Napi::Object result = Napi::Object::New(env);
+    for (uint32_t op = 0; op < LatencyStats::OP_COUNT; op++) {
+        LatencyStats::Summarize(static_cast<LatencyStats::Op>(op), -1, summary);
+        result.Set(LatencyStats::OpName(static_cast<LatencyStats::Op>(op)), LatencySummaryToObject(env, summary));
+    }
+    
+    // Keyed by hardware revision ("0x41"); 0x00 is devices whose class is not known yet
+    std::vector<uint8_t> classes;
+    LatencyStats::Classes(classes);
+    Napi::Object by_class = Napi::Object::New(env);
+    for (uint8_t hardware_revision : classes) {
+        Napi::Object entry = Napi::Object::New(env);
+        entry.Set("hardwareString", Napi::String::New(env,
+            hardware_revision ? Powermon::getHardwareString(hardware_revision) : std::string("unknown")));
+        for (uint32_t op = 0; op < LatencyStats::OP_COUNT; op++) {
+            LatencyStats::Summarize(static_cast<LatencyStats::Op>(op), hardware_revision, summary);
+            if (summary.count > 0) {
+                entry.Set(LatencyStats::OpName(static_cast<LatencyStats::Op>(op)), LatencySummaryToObject(env, summary));
+            }
+        }
+        
+        std::stringstream key;
+        key << "0x" << std::hex << std::setfill('0') << std::setw(2) << static_cast<int>(hardware_revision);
+        by_class.Set(key.str(), entry);
+    }
+    result.Set("byClass", by_class);
+    
+    if (reset) {
+        LatencyStats::Reset();
+    }
+    return result;
+}
+
+Napi::Value PowermonWrapper::GetMetrics(const Napi::CallbackInfo& info) {
+    std::string text;
+    text.reserve(8192);
+    NativeMetrics::Render(text);
+    return Napi::String::New(info.Env(), text);
+}
+
+Napi::Value PowermonWrapper::GetLinkStats(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    
+    std::vector<LinkStats::Row> rows;
+    LinkStats::Snapshot(rows);
+    const size_t count = rows.size();
+    
+    // One column per statistic, indexed by device; disconnects is count x REASONS
+    Napi::Array serial = Napi::Array::New(env, count);
+    Napi::Uint8Array hardware_revision = Napi::Uint8Array::New(env, count);
+    Napi::Uint8Array connected = Napi::Uint8Array::New(env, count);
+    Napi::Uint32Array observed_seconds = Napi::Uint32Array::New(env, count);
+    Napi::Uint32Array requests = Napi::Uint32Array::New(env, count);
+    Napi::Uint32Array errors = Napi::Uint32Array::New(env, count);
+    Napi::Uint32Array timeouts = Napi::Uint32Array::New(env, count);
+    Napi::Float64Array timeout_rate = Napi::Float64Array::New(env, count);
+    Napi::Uint32Array rtt_p50 = Napi::Uint32Array::New(env, count);
+    Napi::Uint32Array rtt_p90 = Napi::Uint32Array::New(env, count);
+    Napi::Uint32Array rtt_p99 = Napi::Uint32Array::New(env, count);
+    Napi::Uint32Array rtt_max = Napi::Uint32Array::New(env, count);
+    Napi::Uint32Array connects = Napi::Uint32Array::New(env, count);
+    Napi::Uint32Array connect_failures = Napi::Uint32Array::New(env, count);
+    Napi::Uint32Array disconnects = Napi::Uint32Array::New(env, count * LinkStats::REASONS);
+    Napi::Float64Array disconnects_per_hour = Napi::Float64Array::New(env, count);
+    Napi::Int16Array rssi_min = Napi::Int16Array::New(env, count);
+    Napi::Float64Array rssi_mean = Napi::Float64Array::New(env, count);
+    
+    for (size_t i = 0; i < count; i++) {
+        const LinkStats::Row& row = rows[i];
+        std::string serial_hex;
+        if (row.serial != 0) {
+            std::stringstream ss;
+            ss << std::hex << std::uppercase << std::setfill('0') << std::setw(16) << row.serial;
+            serial_hex = ss.str();
+        }
+        serial.Set(i, Napi::String::New(env, serial_hex));
+        hardware_revision[i] = row.hardware_revision;
+        connected[i] = row.connected ? 1 : 0;
+        observed_seconds[i] = row.observed_seconds;
+        requests[i] = row.requests;
+        errors[i] = row.errors;
+        timeouts[i] = row.timeouts;
+        timeout_rate[i] = row.requests > 0 ? static_cast<double>(row.timeouts) / row.requests : 0;
+        rtt_p50[i] = row.rtt_p50_ms;
+        rtt_p90[i] = row.rtt_p90_ms;
+        rtt_p99[i] = row.rtt_p99_ms;
+        rtt_max[i] = row.rtt_max_ms;
+        connects[i] = row.connects;
+        connect_failures[i] = row.connect_failures;
+        uint32_t dropped = 0;
+        for (uint32_t r = 0; r < LinkStats::REASONS; r++) {
+            disconnects[i * LinkStats::REASONS + r] = row.disconnects[r];
+            dropped += row.disconnects[r];
+        }
+        disconnects_per_hour[i] = dropped * 3600.0 / std::max<uint32_t>(row.observed_seconds, 60);
+        rssi_min[i] = row.rssi_min;
+        rssi_mean[i] = row.rssi_samples > 0 ? row.rssi_mean : NAN;
+    }
+    
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("count", Napi::Number::New(env, static_cast<double>(count)));
+    result.Set("windowSeconds", Napi::Number::New(env, LinkStats::WINDOW_SECONDS));
+    result.Set("serial", serial);
+    result.Set("hardwareRevision", hardware_revision);
+    result.Set("connected", connected);
+    result.Set("observedSeconds", observed_seconds);
+    result.Set("requests", requests);
+    result.Set("errors", errors);
+    result.Set("timeouts", timeouts);
+    result.Set("timeoutRate", timeout_rate);
+    result.Set("rttP50Ms", rtt_p50);
+    result.Set("rttP90Ms", rtt_p90);
+    result.Set("rttP99Ms", rtt_p99);
+    result.Set("rttMaxMs", rtt_max);
+    result.Set("connects", connects);
+    result.Set("connectFailures", connect_failures);
+    result.Set("disconnects", disconnects);
+    result.Set("disconnectsPerHour", disconnects_per_hour);
+    result.Set("rssiMin", rssi_min);
+    result.Set("rssiMean", rssi_mean);
+    return result;
+}
+
+Napi::Value PowermonWrapper::GetResources(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    const ResourceStats::Instance& resources = *resources_;
+    
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("threadsCreated", Napi::Number::New(env, resources.threads_created.load()));
+    result.Set("rssDeltaBytes", Napi::Number::New(env, static_cast<double>(resources.rss_delta_bytes.load())));
+    result.Set("pendingRequests", Napi::Number::New(env, static_cast<double>(resources.pending_requests.load())));
+    result.Set("queuedCallbacks", Napi::Number::New(env, static_cast<double>(resources.queued_callbacks.load())));
+    result.Set("tsfns", Napi::Number::New(env, static_cast<double>(resources.tsfns.load())));
+    result.Set("callbackBufferBytes", Napi::Number::New(env, static_cast<double>(resources.buffer_bytes.load())));
+    return result;
+}
+
+Napi::Value PowermonWrapper::GetResourceStats(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    ResourceStats::Process process;
+    ResourceStats::Snapshot(process);
+    
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("instances", Napi::Number::New(env, static_cast<double>(process.instances)));
+    result.Set("threads", Napi::Number::New(env, process.threads));
+    result.Set("rssBytes", Napi::Number::New(env, static_cast<double>(process.rss_bytes)));
+    result.Set("peakRssBytes", Napi::Number::New(env, static_cast<double>(process.peak_rss_bytes)));
+    result.Set("threadsCreated", Napi::Number::New(env, static_cast<double>(process.threads_created)));
+    result.Set("threadsReleased", Napi::Number::New(env, static_cast<double>(process.threads_released)));
+    // Means over every instance created so far
+    const double created = process.created > 0 ? static_cast<double>(process.created) : 1.0;
+    result.Set("threadsPerInstance", Napi::Number::New(env, process.threads_created / created));
+    result.Set("rssPerInstanceBytes", Napi::Number::New(env, process.rss_delta_bytes / created));
+    result.Set("pendingRequests", Napi::Number::New(env, static_cast<double>(process.pending_requests)));
+    result.Set("queuedCallbacks", Napi::Number::New(env, static_cast<double>(process.queued_callbacks)));
+    result.Set("tsfns", Napi::Number::New(env, static_cast<double>(process.tsfns)));
+    result.Set("callbackBufferBytes", Napi::Number::New(env, static_cast<double>(process.callback_buffer_bytes)));
+    result.Set("packedSampleBytes", Napi::Number::New(env, static_cast<double>(process.packed_sample_bytes)));
+    return result;
+}
+
+static Napi::Object PoolStatsToObject(Napi::Env env) {
+    InstancePool::Stats stats;
+    InstancePool::GetStats(stats);
+    InstanceReaper::Stats reaper;
+    InstanceReaper::GetStats(reaper);
+    
+    Napi::Object obj = Napi::Object::New(env);
+    obj.Set("idle", Napi::Number::New(env, static_cast<double>(stats.idle)));
+    obj.Set("maxIdle", Napi::Number::New(env, static_cast<double>(stats.max_idle)));
+    obj.Set("created", Napi::Number::New(env, static_cast<double>(stats.created)));
+    obj.Set("reused", Napi::Number::New(env, static_cast<double>(stats.reused)));
+    obj.Set("returned", Napi::Number::New(env, static_cast<double>(stats.returned)));
+    obj.Set("deleted", Napi::Number::New(env, static_cast<double>(stats.deleted)));
+    obj.Set("bleProbes", Napi::Number::New(env, static_cast<double>(stats.ble_probes)));
+    obj.Set("createMeanMs", Napi::Number::New(env,
+        stats.created > 0 ? stats.create_us / 1000.0 / stats.created : 0.0));
+    obj.Set("closing", Napi::Number::New(env, static_cast<double>(reaper.queued)));
+    obj.Set("closed", Napi::Number::New(env, static_cast<double>(reaper.reaped)));
+    obj.Set("closeMeanMs", Napi::Number::New(env,
+        reaper.reaped > 0 ? reaper.reap_us / 1000.0 / reaper.reaped : 0.0));
+    obj.Set("closeMaxMs", Napi::Number::New(env, reaper.max_reap_us / 1000.0));
+    return obj;
+}
+
+Napi::Value PowermonWrapper::ConfigurePool(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    
+    if (info.Length() < 1 || !info[0].IsObject()) {
+        Napi::TypeError::New(env, "Options object expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    
+    // Prewarming creates library instances, so it is left to prewarmPool(),
+    // which does it off the JS thread
+    Napi::Object options = info[0].As<Napi::Object>();
+    Napi::Value max_idle = options.Get("maxIdle");
+    if (!max_idle.IsUndefined()) {
+        size_t limit = 0;
+        if (!ReadPoolCount(max_idle, limit)) {
+            Napi::RangeError::New(env, "maxIdle must be an integer from 0 to " +
+                std::to_string(InstancePool::MAX_IDLE_LIMIT)).ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        InstancePool::SetMaxIdle(limit);
+    }
+    return PoolStatsToObject(env);
+}
+
+Napi::Value PowermonWrapper::GetPoolStats(const Napi::CallbackInfo& info) {
+    return PoolStatsToObject(info.Env());
+}
+
+void PrewarmWorker::OnOK() {
+    deferred_.Resolve(PoolStatsToObject(Env()));
+}
+
+Napi::Value PowermonWrapper::PrewarmPool(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    
+    if (info.Length() < 1 || !info[0].IsNumber()) {
+        Napi::TypeError::New(env, "Instance count expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    
+    size_t count = 0;
+    if (!ReadPoolCount(info[0], count)) {
+        Napi::RangeError::New(env, "Instance count must be an integer from 0 to " +
+            std::to_string(InstancePool::MAX_IDLE_LIMIT)).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    
+    PrewarmWorker* worker = new PrewarmWorker(env, count);
+    Napi::Promise promise = worker->Promise();
+    worker->Queue();
+    return promise;
+}
+
+Napi::Value PowermonWrapper::Create(const Napi::CallbackInfo& info) {
+    CreateWorker* worker = new CreateWorker(info.Env());
+    Napi::Promise promise = worker->Promise();
+    worker->Queue();
+    return promise;
+}
+
+Napi::Value PowermonWrapper::SetTracing(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    
+    // setTracing(false), setTracing(true) or setTracing(<ring size in events>)
+    size_t events = 0;
+    if (info.Length() > 0 && info[0].IsNumber()) {
+        const double value = info[0].As<Napi::Number>().DoubleValue();
+        if (!(value >= 0 && value <= RequestTrace::MAX_EVENTS) || value != std::floor(value)) {
+            Napi::RangeError::New(env, "Event count must be an integer from 0 to " +
+                std::to_string(RequestTrace::MAX_EVENTS)).ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        events = static_cast<size_t>(value);
+    } else if (info.Length() > 0 && info[0].IsBoolean()) {
+        events = info[0].As<Napi::Boolean>().Value() ? RequestTrace::DEFAULT_EVENTS : 0;
+    } else {
+        Napi::TypeError::New(env, "Boolean or event count expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    
+    RequestTrace::Enable(events);
+    return env.Undefined();
+}
+
+Napi::Value PowermonWrapper::DumpTrace(const Napi::CallbackInfo& info) {
+    std::string trace;
+    RequestTrace::Dump(trace);
+    return Napi::String::New(info.Env(), trace);
+}
+
 Napi::Value PowermonWrapper::GetHardwareString(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
     
@@ -10,6 +10,10 @@
 #include <queue>
 #include <functional>
 
+#include "link_stats.h"
+#include "poll_scheduler.h"
+#include "resource_stats.h"
+
 class PowermonWrapper : public Napi::ObjectWrap<PowermonWrapper> {
 public:
     static Napi::Object Init(Napi::Env env, Napi::Object exports);
@@ -21,6 +25,11 @@ public:
 
     Napi::Value Connect(const Napi::CallbackInfo& info);
     Napi::Value Disconnect(const Napi::CallbackInfo& info);
+    Napi::Value Close(const Napi::CallbackInfo& info);
+    Napi::Value Hibernate(const Napi::CallbackInfo& info);
+    Napi::Value Wake(const Napi::CallbackInfo& info);
+    Napi::Value IsHibernating(const Napi::CallbackInfo& info);
+    Napi::Value GetConnectEstimate(const Napi::CallbackInfo& info);
     Napi::Value IsConnected(const Napi::CallbackInfo& info);
     Napi::Value IsBleAvailable(const Napi::CallbackInfo& info);
     
@@ -31,23 +40,93 @@ public:
     
     Napi::Value GetLogFileList(const Napi::CallbackInfo& info);
     Napi::Value ReadLogFile(const Napi::CallbackInfo& info);
+    Napi::Value GetResources(const Napi::CallbackInfo& info);
     
     static Napi::Value DecodeLogData(const Napi::CallbackInfo& info);
     static Napi::Value GetHardwareString(const Napi::CallbackInfo& info);
     static Napi::Value GetPowerStatusString(const Napi::CallbackInfo& info);
+    static Napi::Value SetBackend(const Napi::CallbackInfo& info);
+    static Napi::Value GetBackend(const Napi::CallbackInfo& info);
+    static Napi::Value SetRecording(const Napi::CallbackInfo& info);
+    static Napi::Value GetLatencyStats(const Napi::CallbackInfo& info);
+    static Napi::Value GetMetrics(const Napi::CallbackInfo& info);
+    static Napi::Value GetLinkStats(const Napi::CallbackInfo& info);
+    static Napi::Value GetResourceStats(const Napi::CallbackInfo& info);
+    static Napi::Value ConfigurePool(const Napi::CallbackInfo& info);
+    static Napi::Value GetPoolStats(const Napi::CallbackInfo& info);
+    static Napi::Value PrewarmPool(const Napi::CallbackInfo& info);
+    static Napi::Value Create(const Napi::CallbackInfo& info);
+    static Napi::Value SetTracing(const Napi::CallbackInfo& info);
+    static Napi::Value DumpTrace(const Napi::CallbackInfo& info);
+
+    static Napi::Object SampleToObject(Napi::Env env, const PowermonLogFile::Sample& sample);
+
+    // Issues PollScheduler requests for a PowermonDevice; empty when value
+    // is not one or it is closed
+    static PollScheduler::Poller PollerFor(Napi::Env env, Napi::Value value);
 
 private:
+    // bench/wrapper_bench.cpp times the conversion helpers directly
+    friend class WrapperBench;
+    // Batches of PollScheduler results use the conversion helpers
+    friend class PollSchedulerWrapper;
+
+    // Outlives the wrapper so library callbacks can tell it is gone: they
+    // run with the mutex held, and Retire() takes it to clear wrapper.
+    // PollScheduler's thread holds poll_mutex while it issues a request,
+    // and Retire() takes it first, so powermon_ is not handed to the reaper
+    // under a request being issued
+    struct Owner {
+        std::mutex poll_mutex;
+        std::mutex mutex;
+        PowermonWrapper* wrapper;
+    };
+
+    // hibernate() disconnects without telling onDisconnect, wake() reconnects
+    // with the same access key without telling onConnect
+    enum Sleep {
+        AWAKE,
+        FALLING_ASLEEP,     // disconnect() issued by hibernate()
+        ASLEEP,
+        WAKING              // connectWifi() issued by wake()
+    };
+
     Powermon* powermon_;
+    bool closed_;                   // powermon_ handed to InstanceReaper
     std::atomic<bool> connected_;
     std::atomic<bool> connecting_;
     std::atomic<bool> ble_available_;
+    // Device class for LatencyStats: from the access URL, then from getInfo()
+    std::atomic<uint8_t> hardware_revision_;
+    std::atomic<uint64_t> connect_start_us_;
+    std::atomic<uint64_t> connect_trace_;
+    const uint32_t device_id_;      // RequestTrace process id
+    // LinkStats entry for the channel id, set by connect()
+    std::atomic<LinkStats::Device*> link_;
+    std::shared_ptr<ResourceStats::Instance> resources_;
+    uint64_t pool_generation_;      // InstancePool tag of powermon_
+    std::shared_ptr<Owner> owner_;
     Powermon::WifiAccessKey access_key_;
     
+    // Guarded by owner_->mutex
+    Sleep sleep_;
+    // Connect time estimate, updated by every connect (RFC 6298 SRTT/RTTVAR)
+    uint64_t connect_samples_;
+    double connect_srtt_us_;
+    double connect_rttvar_us_;
+    
     Napi::ThreadSafeFunction on_connect_tsfn_;
     Napi::ThreadSafeFunction on_disconnect_tsfn_;
+    // hibernate() or wake() callback, one at a time
+    Napi::ThreadSafeFunction sleep_tsfn_;
     
     void SetupCallbacks();
+    void StartConnect();
+    void OnConnected();
+    void OnDisconnected(Powermon::DisconnectReason reason);
     void CleanupCallbacks();
+    void Retire();
+    PollScheduler::Issue IssuePoll(PollScheduler::Kind kind, uint32_t id, const PollScheduler::Sink& sink);
     
     template<typename T>
     static Napi::Object CreateResultObject(Napi::Env env, Powermon::ResponseCode code, const T& data);
@@ -57,7 +136,6 @@ private:
     static Napi::Object MonitorStatisticsToObject(Napi::Env env, const Powermon::MonitorStatistics& stats);
     static Napi::Object FuelgaugeStatisticsToObject(Napi::Env env, const Powermon::FuelgaugeStatistics& stats);
     static Napi::Object LogFileDescriptorToObject(Napi::Env env, const Powermon::LogFileDescriptor& desc);
-    static Napi::Object SampleToObject(Napi::Env env, const PowermonLogFile::Sample& sample);
 };
 
 #endif
@@ -0,0 +1,352 @@
+#include "recording_powermon.h"
+
+using DeviceTrace::Op;
+
+RecordingPowermon::RecordingPowermon(Powermon* inner, std::shared_ptr<DeviceTrace::Writer> writer)
+    : writer_(writer)
+    , inner_(inner)
+    , connect_at_(0)
+    , connecting_(false)
+    , closing_(false) {
+    inner_->setOnConnectCallback([this]() { OnConnect(); });
+    inner_->setOnDisconnectCallback([this](DisconnectReason reason) { OnDisconnect(reason); });
+    inner_->setOnMonitorDataCallback([this](const MonitorData& data) { OnMonitorData(data); });
+}
+
+RecordingPowermon::~RecordingPowermon() {
+    // The inner device goes first so none of its callbacks run after this
+    inner_.reset();
+    writer_->Close();
+}
+
+void RecordingPowermon::StartConnect() {
+    connect_at_ = writer_->Now();
+    connecting_ = true;
+    closing_ = false;
+}
+
+void RecordingPowermon::OnConnect() {
+    connecting_ = false;
+
+    DeviceTrace::Record record;
+    record.op = DeviceTrace::OP_CONNECT;
+    record.at_us = connect_at_;
+    record.latency_us = writer_->Now() - record.at_us;
+    record.payload.push_back(inner_->isLocalConnection() ? 1 : 0);
+    writer_->Write(record);
+
+    if (on_connect_) on_connect_();
+}
+
+void RecordingPowermon::OnDisconnect(DisconnectReason reason) {
+    DeviceTrace::Record record;
+    record.code = reason;
+    if (connecting_) {
+        record.op = DeviceTrace::OP_CONNECT_FAILED;
+        record.at_us = connect_at_;
+        record.latency_us = writer_->Now() - record.at_us;
+    } else {
+        record.op = DeviceTrace::OP_DISCONNECTED;
+        record.at_us = writer_->Now();
+    }
+    connecting_ = false;
+
+    // Disconnects the application asked for are replayed by its own call
+    if (record.op != DeviceTrace::OP_DISCONNECTED || !closing_) {
+        writer_->Write(record);
+    }
+    writer_->Flush();
+
+    if (on_disconnect_) on_disconnect_(reason);
+}
+
+void RecordingPowermon::OnMonitorData(const MonitorData& data) {
+    DeviceTrace::Record record;
+    record.op = DeviceTrace::OP_MONITOR_PUSH;
+    record.at_us = writer_->Now();
+    DeviceTrace::Encode(data, record.payload);
+    writer_->Write(record);
+
+    if (on_monitor_data_) on_monitor_data_(data);
+}
+
+std::function<void(Powermon::ResponseCode)> RecordingPowermon::Record(Op op, const std::function<void(ResponseCode)>& cb) {
+    std::shared_ptr<DeviceTrace::Writer> writer = writer_;
+    uint64_t at = writer->Now();
+    return [writer, op, at, cb](ResponseCode rsp) {
+        DeviceTrace::Record record;
+        record.op = op;
+        record.code = rsp;
+        record.at_us = at;
+        record.latency_us = writer->Now() - at;
+        writer->Write(record);
+        cb(rsp);
+    };
+}
+
+template <typename T>
+std::function<void(Powermon::ResponseCode, const T&)> RecordingPowermon::Record(
+        Op op, const std::function<void(ResponseCode, const T&)>& cb) {
+    std::shared_ptr<DeviceTrace::Writer> writer = writer_;
+    uint64_t at = writer->Now();
+    return [writer, op, at, cb](ResponseCode rsp, const T& value) {
+        DeviceTrace::Record record;
+        record.op = op;
+        record.code = rsp;
+        record.at_us = at;
+        record.latency_us = writer->Now() - at;
+        if (rsp == RSP_SUCCESS) {
+            DeviceTrace::Encode(value, record.payload);
+        }
+        writer->Write(record);
+        cb(rsp, value);
+    };
+}
+
+std::function<void(Powermon::ResponseCode, const uint8_t*, size_t)> RecordingPowermon::Record(
+        Op op, std::vector<uint8_t> key, const std::function<void(ResponseCode, const uint8_t*, size_t)>& cb) {
+    std::shared_ptr<DeviceTrace::Writer> writer = writer_;
+    uint64_t at = writer->Now();
+    return [writer, op, at, key, cb](ResponseCode rsp, const uint8_t* data, size_t size) {
+        DeviceTrace::Record record;
+        record.op = op;
+        record.code = rsp;
+        record.at_us = at;
+        record.latency_us = writer->Now() - at;
+        record.key = key;
+        if (rsp == RSP_SUCCESS && data != nullptr) {
+            record.payload.assign(data, data + size);
+        }
+        writer->Write(record);
+        cb(rsp, data, size);
+    };
+}
+
+#ifndef POWERMON_NO_INIT_BLE
+bool RecordingPowermon::initBle(void) {
+    return inner_->initBle();
+}
+#endif
+
+void RecordingPowermon::connectWifi(const WifiAccessKey& key) {
+    StartConnect();
+    inner_->connectWifi(key);
+}
+
+void RecordingPowermon::connectWifi(uint32_t ipaddr) {
+    StartConnect();
+    inner_->connectWifi(ipaddr);
+}
+
+void RecordingPowermon::connectBle(uint64_t ble_address) {
+    StartConnect();
+    inner_->connectBle(ble_address);
+}
+
+void RecordingPowermon::disconnect(void) {
+    closing_ = true;
+    inner_->disconnect();
+}
+
+bool RecordingPowermon::isLocalConnection(void) const {
+    return inner_->isLocalConnection();
+}
+
+void RecordingPowermon::setOnConnectCallback(const std::function<void(void)>& cb) {
+    on_connect_ = cb;
+}
+
+void RecordingPowermon::setOnDisconnectCallback(const std::function<void(DisconnectReason)>& cb) {
+    on_disconnect_ = cb;
+}
+
+void RecordingPowermon::setOnMonitorDataCallback(const std::function<void(const MonitorData&)>& cb) {
+    on_monitor_data_ = cb;
+}
+
+void RecordingPowermon::setOnWifiScanReportCallback(const std::function<void(const WifiScanResult*)>& cb) {
+    inner_->setOnWifiScanReportCallback(cb);
+}
+
+const Powermon::DeviceInfo& RecordingPowermon::getLastDeviceInfo(void) const {
+    return inner_->getLastDeviceInfo();
+}
+
+void RecordingPowermon::requestGetInfo(const std::function<void(ResponseCode, const DeviceInfo&)>& cb) {
+    inner_->requestGetInfo(Record(DeviceTrace::OP_GET_INFO, cb));
+}
+
+void RecordingPowermon::requestGetMonitorData(const std::function<void(ResponseCode, const MonitorData&)>& cb) {
+    inner_->requestGetMonitorData(Record(DeviceTrace::OP_GET_MONITOR_DATA, cb));
+}
+
+void RecordingPowermon::requestGetStatistics(const std::function<void(ResponseCode, const MonitorStatistics&)>& cb) {
+    inner_->requestGetStatistics(Record(DeviceTrace::OP_GET_STATISTICS, cb));
+}
+
+void RecordingPowermon::requestGetFgStatistics(const std::function<void(ResponseCode, const FuelgaugeStatistics&)>& cb) {
+    inner_->requestGetFgStatistics(Record(DeviceTrace::OP_GET_FG_STATISTICS, cb));
+}
+
+void RecordingPowermon::requestUnlock(const AuthKey& key, std::function<void(ResponseCode)> cb) {
+    inner_->requestUnlock(key, Record(DeviceTrace::OP_UNLOCK, cb));
+}
+
+void RecordingPowermon::requestSetUserPasswordLock(const AuthKey& key, std::function<void(ResponseCode)> cb) {
+    inner_->requestSetUserPasswordLock(key, Record(DeviceTrace::OP_SET_USER_PASSWORD_LOCK, cb));
+}
+
+void RecordingPowermon::requestSetMasterPasswordLock(const AuthKey& key, std::function<void(ResponseCode)> cb) {
+    inner_->requestSetMasterPasswordLock(key, Record(DeviceTrace::OP_SET_MASTER_PASSWORD_LOCK, cb));
+}
+
+void RecordingPowermon::requestClearUserPasswordLock(std::function<void(ResponseCode)> cb) {
+    inner_->requestClearUserPasswordLock(Record(DeviceTrace::OP_CLEAR_USER_PASSWORD_LOCK, cb));
+}
+
+void RecordingPowermon::requestClearMasterPasswordLock(std::function<void(ResponseCode)> cb) {
+    inner_->requestClearMasterPasswordLock(Record(DeviceTrace::OP_CLEAR_MASTER_PASSWORD_LOCK, cb));
+}
+
+void RecordingPowermon::requestGetAuthKey(std::function<void(ResponseCode, const AuthKey&)> cb) {
+    inner_->requestGetAuthKey(Record(DeviceTrace::OP_GET_AUTH_KEY, cb));
+}
+
+void RecordingPowermon::requestResetAuthKey(std::function<void(ResponseCode)> cb) {
+    inner_->requestResetAuthKey(Record(DeviceTrace::OP_RESET_AUTH_KEY, cb));
+}
+
+void RecordingPowermon::requestResetEnergyMeter(const std::function<void(ResponseCode)>& cb) {
+    inner_->requestResetEnergyMeter(Record(DeviceTrace::OP_RESET_ENERGY_METER, cb));
+}
+
+void RecordingPowermon::requestResetCoulombMeter(const std::function<void(ResponseCode)>& cb) {
+    inner_->requestResetCoulombMeter(Record(DeviceTrace::OP_RESET_COULOMB_METER, cb));
+}
+
+void RecordingPowermon::requestResetStatistics(const std::function<void(ResponseCode)>& cb) {
+    inner_->requestResetStatistics(Record(DeviceTrace::OP_RESET_STATISTICS, cb));
+}
+
+void RecordingPowermon::requestSetPowerState(bool state, const std::function<void(ResponseCode)>& cb) {
+    inner_->requestSetPowerState(state, Record(DeviceTrace::OP_SET_POWER_STATE, cb));
+}
+
+void RecordingPowermon::requestGetConfig(const std::function<void(ResponseCode, const PowermonConfig&)>& cb) {
+    inner_->requestGetConfig(Record(DeviceTrace::OP_GET_CONFIG, cb));
+}
+
+void RecordingPowermon::requestSetConfig(const PowermonConfig& config, const std::function<void(ResponseCode)>& cb) {
+    inner_->requestSetConfig(config, Record(DeviceTrace::OP_SET_CONFIG, cb));
+}
+
+void RecordingPowermon::requestResetConfig(const std::function<void(ResponseCode)>& cb) {
+    inner_->requestResetConfig(Record(DeviceTrace::OP_RESET_CONFIG, cb));
+}
+
+void RecordingPowermon::requestRename(const char* name, const std::function<void(ResponseCode)>& cb) {
+    inner_->requestRename(name, Record(DeviceTrace::OP_RENAME, cb));
+}
+
+void RecordingPowermon::requestSetTime(uint32_t time, const std::function<void(ResponseCode)>& cb) {
+    inner_->requestSetTime(time, Record(DeviceTrace::OP_SET_TIME, cb));
+}
+
+void RecordingPowermon::requestFgSynchronize(const std::function<void(ResponseCode)>& cb) {
+    inner_->requestFgSynchronize(Record(DeviceTrace::OP_FG_SYNCHRONIZE, cb));
+}
+
+void RecordingPowermon::requestStartWifiScan(const std::function<void(ResponseCode)>& cb) {
+    inner_->requestStartWifiScan(Record(DeviceTrace::OP_START_WIFI_SCAN, cb));
+}
+
+void RecordingPowermon::requestWifiConfigure(const WifiNetwork& network, const std::function<void(ResponseCode)>& cb) {
+    inner_->requestWifiConfigure(network, Record(DeviceTrace::OP_WIFI_CONFIGURE, cb));
+}
+
+void RecordingPowermon::requestGetWifiNetworks(const std::function<void(ResponseCode, const std::vector<WifiNetwork>&)>& cb) {
+    inner_->requestGetWifiNetworks(Record(DeviceTrace::OP_GET_WIFI_NETWORKS, cb));
+}
+
+void RecordingPowermon::requestAddWifiNetwork(const WifiNetwork& network, const std::function<void(ResponseCode)>& cb) {
+    inner_->requestAddWifiNetwork(network, Record(DeviceTrace::OP_ADD_WIFI_NETWORK, cb));
+}
+
+void RecordingPowermon::requestRemoveWifiNetwork(uint8_t index, const std::function<void(ResponseCode)>& cb) {
+    inner_->requestRemoveWifiNetwork(index, Record(DeviceTrace::OP_REMOVE_WIFI_NETWORK, cb));
+}
+
+void RecordingPowermon::requestGetAccessKeys(const std::function<void(ResponseCode, const WifiAccessKey&)>& cb) {
+    inner_->requestGetAccessKeys(Record(DeviceTrace::OP_GET_ACCESS_KEYS, cb));
+}
+
+void RecordingPowermon::requestResetAccessKeys(const std::function<void(ResponseCode)>& cb) {
+    inner_->requestResetAccessKeys(Record(DeviceTrace::OP_RESET_ACCESS_KEYS, cb));
+}
+
+void RecordingPowermon::requestZeroCurrentOffset(const std::function<void(ResponseCode)>& cb) {
+    inner_->requestZeroCurrentOffset(Record(DeviceTrace::OP_ZERO_CURRENT_OFFSET, cb));
+}
+
+void RecordingPowermon::requestCalibrateCurrent(float value, const std::function<void(ResponseCode)>& cb) {
+    inner_->requestCalibrateCurrent(value, Record(DeviceTrace::OP_CALIBRATE_CURRENT, cb));
+}
+
+void RecordingPowermon::requestGetSchedules(const std::function<void(ResponseCode, const std::vector<PowermonSchedule>&)>& cb) {
+    inner_->requestGetSchedules(Record(DeviceTrace::OP_GET_SCHEDULES, cb));
+}
+
+void RecordingPowermon::requestAddSchedules(const std::vector<PowermonSchedule>& schedules, const std::function<void(ResponseCode)>& cb) {
+    inner_->requestAddSchedules(schedules, Record(DeviceTrace::OP_ADD_SCHEDULES, cb));
+}
+
+void RecordingPowermon::requestUpdateSchedule(uint64_t old_schedule_descriptor, const PowermonSchedule& new_schedule,
+                                              const std::function<void(ResponseCode)>& cb) {
+    inner_->requestUpdateSchedule(old_schedule_descriptor, new_schedule, Record(DeviceTrace::OP_UPDATE_SCHEDULE, cb));
+}
+
+void RecordingPowermon::requestDeleteSchedule(uint64_t schedule_descriptor, const std::function<void(ResponseCode)>& cb) {
+    inner_->requestDeleteSchedule(schedule_descriptor, Record(DeviceTrace::OP_DELETE_SCHEDULE, cb));
+}
+
+void RecordingPowermon::requestClearSchedules(const std::function<void(ResponseCode)>& cb) {
+    inner_->requestClearSchedules(Record(DeviceTrace::OP_CLEAR_SCHEDULES, cb));
+}
+
+void RecordingPowermon::requestCommitSchedules(const std::function<void(ResponseCode)>& cb) {
+    inner_->requestCommitSchedules(Record(DeviceTrace::OP_COMMIT_SCHEDULES, cb));
+}
+
+void RecordingPowermon::requestGetLogFileList(const std::function<void(ResponseCode, const std::vector<LogFileDescriptor>&)>& cb) {
+    inner_->requestGetLogFileList(Record(DeviceTrace::OP_GET_LOG_FILE_LIST, cb));
+}
+
+void RecordingPowermon::requestReadLogFile(uint32_t file_id, uint32_t offset, uint32_t read_size,
+                                           const std::function<void(ResponseCode, const uint8_t*, size_t)>& cb) {
+    inner_->requestReadLogFile(file_id, offset, read_size,
+        Record(DeviceTrace::OP_READ_LOG_FILE, DeviceTrace::Key(file_id, offset, read_size), cb));
+}
+
+void RecordingPowermon::requestClearLog(const std::function<void(ResponseCode)>& cb) {
+    inner_->requestClearLog(Record(DeviceTrace::OP_CLEAR_LOG, cb));
+}
+
+void RecordingPowermon::requestUpdateFirmware(const uint8_t* firmware_image, uint32_t size,
+                                              const std::function<bool(uint32_t, uint32_t)>& progress_cb,
+                                              const std::function<void(ResponseCode)>& done_cb) {
+    inner_->requestUpdateFirmware(firmware_image, size, progress_cb, Record(DeviceTrace::OP_UPDATE_FIRMWARE, done_cb));
+}
+
+void RecordingPowermon::requestReadDebug(uint32_t offset, uint32_t read_size,
+                                         const std::function<void(ResponseCode, const uint8_t*, size_t)>& cb) {
+    inner_->requestReadDebug(offset, read_size,
+        Record(DeviceTrace::OP_READ_DEBUG, DeviceTrace::Key(offset, read_size), cb));
+}
+
+void RecordingPowermon::requestEraseDebug(const std::function<void(ResponseCode)>& cb) {
+    inner_->requestEraseDebug(Record(DeviceTrace::OP_ERASE_DEBUG, cb));
+}
+
+void RecordingPowermon::requestReboot(const std::function<void(ResponseCode)>& cb) {
+    inner_->requestReboot(Record(DeviceTrace::OP_REBOOT, cb));
+}
@@ -0,0 +1,127 @@
+#ifndef RECORDING_POWERMON_H
+#define RECORDING_POWERMON_H
+
+#include <powermon.h>
+
+#include "device_trace.h"
+
+#include <stdint.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Wraps another Powermon and writes everything it does to a DeviceTrace:
+// each request's response code, payload and latency, the outcome and latency
+// of each connect, unsolicited disconnects and pushed monitor data. Calls and
+// callbacks pass through unchanged, so recording can be switched on in front
+// of the vendor library in production (POWERMON_RECORD) and the traces
+// replayed offline with ReplayPowermon.
+//
+// WiFi scan reports and firmware update progress are passed through but not
+// recorded.
+class RecordingPowermon : public Powermon {
+public:
+    // Takes ownership of inner; writer must be open
+    RecordingPowermon(Powermon* inner, std::shared_ptr<DeviceTrace::Writer> writer);
+    ~RecordingPowermon() override;
+
+#ifndef POWERMON_NO_INIT_BLE
+    bool initBle(void) override;
+#endif
+    void connectWifi(const WifiAccessKey& key) override;
+    void connectWifi(uint32_t ipaddr) override;
+    void connectBle(uint64_t ble_address) override;
+    void disconnect(void) override;
+    bool isLocalConnection(void) const override;
+
+    void setOnConnectCallback(const std::function<void(void)>& cb) override;
+    void setOnDisconnectCallback(const std::function<void(DisconnectReason)>& cb) override;
+    void setOnMonitorDataCallback(const std::function<void(const MonitorData&)>& cb) override;
+    void setOnWifiScanReportCallback(const std::function<void(const WifiScanResult*)>& cb) override;
+
+    const DeviceInfo& getLastDeviceInfo(void) const override;
+
+    void requestGetInfo(const std::function<void(ResponseCode, const DeviceInfo&)>& cb) override;
+    void requestGetMonitorData(const std::function<void(ResponseCode, const MonitorData&)>& cb) override;
+    void requestGetStatistics(const std::function<void(ResponseCode, const MonitorStatistics&)>& cb) override;
+    void requestGetFgStatistics(const std::function<void(ResponseCode, const FuelgaugeStatistics&)>& cb) override;
+
+    void requestUnlock(const AuthKey& key, std::function<void(ResponseCode)> cb) override;
+    void requestSetUserPasswordLock(const AuthKey& key, std::function<void(ResponseCode)> cb) override;
+    void requestSetMasterPasswordLock(const AuthKey& key, std::function<void(ResponseCode)> cb) override;
+    void requestClearUserPasswordLock(std::function<void(ResponseCode)> cb) override;
+    void requestClearMasterPasswordLock(std::function<void(ResponseCode)> cb) override;
+    void requestGetAuthKey(std::function<void(ResponseCode, const AuthKey&)> cb) override;
+    void requestResetAuthKey(std::function<void(ResponseCode)> cb) override;
+
+    void requestResetEnergyMeter(const std::function<void(ResponseCode)>& cb) override;
+    void requestResetCoulombMeter(const std::function<void(ResponseCode)>& cb) override;
+    void requestResetStatistics(const std::function<void(ResponseCode)>& cb) override;
+    void requestSetPowerState(bool state, const std::function<void(ResponseCode)>& cb) override;
+
+    void requestGetConfig(const std::function<void(ResponseCode, const PowermonConfig&)>& cb) override;
+    void requestSetConfig(const PowermonConfig& config, const std::function<void(ResponseCode)>& cb) override;
+    void requestResetConfig(const std::function<void(ResponseCode)>& cb) override;
+    void requestRename(const char* name, const std::function<void(ResponseCode)>& cb) override;
+    void requestSetTime(uint32_t time, const std::function<void(ResponseCode)>& cb) override;
+    void requestFgSynchronize(const std::function<void(ResponseCode)>& cb) override;
+
+    void requestStartWifiScan(const std::function<void(ResponseCode)>& cb) override;
+    void requestWifiConfigure(const WifiNetwork& network, const std::function<void(ResponseCode)>& cb) override;
+    void requestGetWifiNetworks(const std::function<void(ResponseCode, const std::vector<WifiNetwork>&)>& cb) override;
+    void requestAddWifiNetwork(const WifiNetwork& network, const std::function<void(ResponseCode)>& cb) override;
+    void requestRemoveWifiNetwork(uint8_t index, const std::function<void(ResponseCode)>& cb) override;
+    void requestGetAccessKeys(const std::function<void(ResponseCode, const WifiAccessKey&)>& cb) override;
+    void requestResetAccessKeys(const std::function<void(ResponseCode)>& cb) override;
+
+    void requestZeroCurrentOffset(const std::function<void(ResponseCode)>& cb) override;
+    void requestCalibrateCurrent(float value, const std::function<void(ResponseCode)>& cb) override;
+
+    void requestGetSchedules(const std::function<void(ResponseCode, const std::vector<PowermonSchedule>&)>& cb) override;
+    void requestAddSchedules(const std::vector<PowermonSchedule>& schedules, const std::function<void(ResponseCode)>& cb) override;
+    void requestUpdateSchedule(uint64_t old_schedule_descriptor, const PowermonSchedule& new_schedule,
+                               const std::function<void(ResponseCode)>& cb) override;
+    void requestDeleteSchedule(uint64_t schedule_descriptor, const std::function<void(ResponseCode)>& cb) override;
+    void requestClearSchedules(const std::function<void(ResponseCode)>& cb) override;
+    void requestCommitSchedules(const std::function<void(ResponseCode)>& cb) override;
+
+    void requestGetLogFileList(const std::function<void(ResponseCode, const std::vector<LogFileDescriptor>&)>& cb) override;
+    void requestReadLogFile(uint32_t file_id, uint32_t offset, uint32_t read_size,
+                            const std::function<void(ResponseCode, const uint8_t*, size_t)>& cb) override;
+    void requestClearLog(const std::function<void(ResponseCode)>& cb) override;
+
+    void requestUpdateFirmware(const uint8_t* firmware_image, uint32_t size, const std::function<bool(uint32_t, uint32_t)>& progress_cb,
+                               const std::function<void(ResponseCode)>& done_cb) override;
+    void requestReadDebug(uint32_t offset, uint32_t read_size,
+                          const std::function<void(ResponseCode, const uint8_t*, size_t)>& cb) override;
+    void requestEraseDebug(const std::function<void(ResponseCode)>& cb) override;
+    void requestReboot(const std::function<void(ResponseCode)>& cb) override;
+
+private:
+    std::shared_ptr<DeviceTrace::Writer> writer_;
+    std::unique_ptr<Powermon> inner_;
+
+    std::atomic<uint64_t> connect_at_;
+    std::atomic<bool> connecting_;
+    std::atomic<bool> closing_;
+
+    std::function<void(void)> on_connect_;
+    std::function<void(DisconnectReason)> on_disconnect_;
+    std::function<void(const MonitorData&)> on_monitor_data_;
+
+    void StartConnect();
+    void OnConnect();
+    void OnDisconnect(DisconnectReason reason);
+    void OnMonitorData(const MonitorData& data);
+
+    // Wrap a request's callback so its completion is recorded under op
+    std::function<void(ResponseCode)> Record(DeviceTrace::Op op, const std::function<void(ResponseCode)>& cb);
+    template <typename T>
+    std::function<void(ResponseCode, const T&)> Record(DeviceTrace::Op op, const std::function<void(ResponseCode, const T&)>& cb);
+    std::function<void(ResponseCode, const uint8_t*, size_t)> Record(DeviceTrace::Op op, std::vector<uint8_t> key,
+        const std::function<void(ResponseCode, const uint8_t*, size_t)>& cb);
+};
+
+#endif
@@ -0,0 +1,482 @@
+#include "replay_powermon.h"
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <sstream>
+
+using DeviceTrace::Op;
+using DeviceTrace::Record;
+
+bool ReplayPowermon::Config::Parse(const char* spec, Config& config, std::string* error) {
+    if (spec == nullptr) {
+        return true;
+    }
+
+    std::istringstream in(spec);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        if (item.empty()) {
+            continue;
+        }
+        size_t eq = item.find('=');
+        if (eq == std::string::npos) {
+            if (error) *error = "Expected key=value: " + item;
+            return false;
+        }
+        std::string key = item.substr(0, eq);
+        std::string value = item.substr(eq + 1);
+
+        if (key == "trace") {
+            config.trace = value;
+            continue;
+        }
+
+        char* end = nullptr;
+        double number = strtod(value.c_str(), &end);
+        if (end == value.c_str() || *end != '\0' || number < 0) {
+            if (error) *error = "Invalid value for " + key + ": " + value;
+            return false;
+        }
+
+        if (key == "scale") config.scale = number;
+        else if (key == "loop") config.loop = number != 0;
+        else {
+            if (error) *error = "Unknown key: " + key;
+            return false;
+        }
+    }
+
+    if (config.trace.empty()) {
+        if (error) *error = "trace is required";
+        return false;
+    }
+    return true;
+}
+
+std::shared_ptr<const ReplayPowermon::Trace> ReplayPowermon::Trace::Load(const std::string& path, std::string* error) {
+    std::shared_ptr<Trace> trace = std::make_shared<Trace>();
+    trace->path = path;
+    if (!DeviceTrace::Load(path, trace->records, error)) {
+        return nullptr;
+    }
+
+    for (size_t i = 0; i < trace->records.size(); i++) {
+        const Record& record = trace->records[i];
+        switch (record.op) {
+            case DeviceTrace::OP_CONNECT:
+            case DeviceTrace::OP_CONNECT_FAILED:
+                trace->sessions.push_back({ i, std::vector<size_t>() });
+                break;
+            case DeviceTrace::OP_DISCONNECTED:
+            case DeviceTrace::OP_MONITOR_PUSH:
+                // Events before the first connect have nothing to follow
+                if (!trace->sessions.empty()) {
+                    trace->sessions.back().events.push_back(i);
+                }
+                break;
+            default:
+                trace->responses[std::make_pair(static_cast<uint8_t>(record.op), record.key)].push_back(i);
+                break;
+        }
+    }
+    return trace;
+}
+
+ReplayPowermon::ReplayPowermon(std::shared_ptr<const Trace> trace, const Config& config)
+    : trace_(trace)
+    , config_(config)
+    , token_(std::make_shared<DeviceTimer::Token>())
+    , state_(Disconnected)
+    , generation_(0)
+    , local_(false)
+    , device_info_()
+    , next_session_(0) {
+}
+
+ReplayPowermon::~ReplayPowermon() {
+    DeviceTimer::Revoke(token_);
+}
+
+void ReplayPowermon::Schedule(double delay_ms, std::function<void()> fn) {
+    DeviceTimer::Instance().Add(token_, delay_ms, std::move(fn));
+}
+
+double ReplayPowermon::Delay(uint64_t us) const {
+    return static_cast<double>(us) / 1000.0 * config_.scale;
+}
+
+const Record* ReplayPowermon::NextResponse(Op op, const std::vector<uint8_t>& key) {
+    auto responses = trace_->responses.find(std::make_pair(static_cast<uint8_t>(op), key));
+    if (responses == trace_->responses.end()) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t& next = next_response_[responses->first];
+    if (next == responses->second.size()) {
+        if (!config_.loop) {
+            return nullptr;
+        }
+        next = 0;
+    }
+    return &trace_->records[responses->second[next++]];
+}
+
+void ReplayPowermon::Connect() {
+    if (state_ != Disconnected) {
+        return;
+    }
+    state_ = Connecting;
+    uint32_t generation = ++generation_;
+
+    const Trace::Session* session = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (next_session_ == trace_->sessions.size() && config_.loop) {
+            next_session_ = 0;
+        }
+        if (next_session_ < trace_->sessions.size()) {
+            session = &trace_->sessions[next_session_++];
+        }
+    }
+
+    if (session == nullptr) {
+        Schedule(0, [this, generation]() {
+            if (generation != generation_) {
+                return;
+            }
+            state_ = Disconnected;
+            if (on_disconnect_) on_disconnect_(NO_ROUTE);
+        });
+        return;
+    }
+
+    const Record& connect = trace_->records[session->connect];
+    Schedule(Delay(connect.latency_us), [this, generation, session, &connect]() {
+        if (generation != generation_) {
+            return;
+        }
+        if (connect.op == DeviceTrace::OP_CONNECT_FAILED) {
+            state_ = Disconnected;
+            if (on_disconnect_) on_disconnect_(static_cast<DisconnectReason>(connect.code));
+            return;
+        }
+
+        state_ = Connected;
+        local_ = !connect.payload.empty() && connect.payload[0] != 0;
+        if (on_connect_) on_connect_();
+
+        // Replay what followed this connect at the same offsets from it
+        const uint64_t connected_at = connect.at_us + connect.latency_us;
+        for (size_t index : session->events) {
+            const Record& event = trace_->records[index];
+            uint64_t offset = event.at_us > connected_at ? event.at_us - connected_at : 0;
+            Schedule(Delay(offset), [this, generation, &event]() {
+                if (generation != generation_ || state_ != Connected) {
+                    return;
+                }
+                if (event.op == DeviceTrace::OP_DISCONNECTED) {
+                    ++generation_;
+                    state_ = Disconnected;
+                    if (on_disconnect_) on_disconnect_(static_cast<DisconnectReason>(event.code));
+                    return;
+                }
+                MonitorData data;
+                if (DeviceTrace::Decode(event.payload, data) && on_monitor_data_) {
+                    on_monitor_data_(data);
+                }
+            });
+        }
+    });
+}
+
+void ReplayPowermon::Respond(Op op, const std::vector<uint8_t>& key,
+                             std::function<void(ResponseCode, const Record*)> respond) {
+    if (state_ != Connected) {
+        Schedule(0, [respond]() { respond(RSP_CANCELLED, nullptr); });
+        return;
+    }
+
+    const Record* record = NextResponse(op, key);
+    if (record == nullptr) {
+        ResponseCode code = key.empty() ? RSP_INVALID_REQ : RSP_NOT_FOUND;
+        Schedule(0, [respond, code]() { respond(code, nullptr); });
+        return;
+    }
+
+    uint32_t generation = generation_;
+    Schedule(Delay(record->latency_us), [this, generation, record, respond]() {
+        if (generation != generation_) {
+            respond(RSP_CANCELLED, nullptr);
+            return;
+        }
+        respond(static_cast<ResponseCode>(record->code), record);
+    });
+}
+
+void ReplayPowermon::Replay(Op op, const std::function<void(ResponseCode)>& cb) {
+    Respond(op, std::vector<uint8_t>(), [cb](ResponseCode rsp, const Record*) {
+        cb(rsp);
+    });
+}
+
+template <typename T>
+void ReplayPowermon::Replay(Op op, const std::function<void(ResponseCode, const T&)>& cb) {
+    Respond(op, std::vector<uint8_t>(), [cb](ResponseCode rsp, const Record* record) {
+        T value = T();
+        if (record != nullptr && rsp == RSP_SUCCESS) {
+            DeviceTrace::Decode(record->payload, value);
+        }
+        cb(rsp, value);
+    });
+}
+
+void ReplayPowermon::Replay(Op op, const std::vector<uint8_t>& key,
+                            const std::function<void(ResponseCode, const uint8_t*, size_t)>& cb) {
+    Respond(op, key, [cb](ResponseCode rsp, const Record* record) {
+        if (record == nullptr || record->payload.empty()) {
+            cb(rsp, nullptr, 0);
+            return;
+        }
+        cb(rsp, record->payload.data(), record->payload.size());
+    });
+}
+
+#ifndef POWERMON_NO_INIT_BLE
+bool ReplayPowermon::initBle(void) {
+    return false;
+}
+#endif
+
+void ReplayPowermon::connectWifi(const WifiAccessKey& key) {
+    Connect();
+}
+
+void ReplayPowermon::connectWifi(uint32_t ipaddr) {
+    Connect();
+}
+
+void ReplayPowermon::connectBle(uint64_t ble_address) {
+    Connect();
+}
+
+void ReplayPowermon::disconnect(void) {
+    if (state_ == Disconnected) {
+        return;
+    }
+    ++generation_;
+    state_ = Disconnected;
+    Schedule(0, [this]() {
+        if (on_disconnect_) on_disconnect_(CLOSED);
+    });
+}
+
+bool ReplayPowermon::isLocalConnection(void) const {
+    return local_;
+}
+
+void ReplayPowermon::setOnConnectCallback(const std::function<void(void)>& cb) {
+    on_connect_ = cb;
+}
+
+void ReplayPowermon::setOnDisconnectCallback(const std::function<void(DisconnectReason)>& cb) {
+    on_disconnect_ = cb;
+}
+
+void ReplayPowermon::setOnMonitorDataCallback(const std::function<void(const MonitorData&)>& cb) {
+    on_monitor_data_ = cb;
+}
+
+void ReplayPowermon::setOnWifiScanReportCallback(const std::function<void(const WifiScanResult*)>& cb) {
+    on_wifi_scan_ = cb;
+}
+
+const Powermon::DeviceInfo& ReplayPowermon::getLastDeviceInfo(void) const {
+    return device_info_;
+}
+
+void ReplayPowermon::requestGetInfo(const std::function<void(ResponseCode, const DeviceInfo&)>& cb) {
+    Respond(DeviceTrace::OP_GET_INFO, std::vector<uint8_t>(), [this, cb](ResponseCode rsp, const Record* record) {
+        DeviceInfo info = DeviceInfo();
+        if (record != nullptr && rsp == RSP_SUCCESS && DeviceTrace::Decode(record->payload, info)) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            device_info_ = info;
+        }
+        cb(rsp, info);
+    });
+}
+
+void ReplayPowermon::requestGetMonitorData(const std::function<void(ResponseCode, const MonitorData&)>& cb) {
+    Replay(DeviceTrace::OP_GET_MONITOR_DATA, cb);
+}
+
+void ReplayPowermon::requestGetStatistics(const std::function<void(ResponseCode, const MonitorStatistics&)>& cb) {
+    Replay(DeviceTrace::OP_GET_STATISTICS, cb);
+}
+
+void ReplayPowermon::requestGetFgStatistics(const std::function<void(ResponseCode, const FuelgaugeStatistics&)>& cb) {
+    Replay(DeviceTrace::OP_GET_FG_STATISTICS, cb);
+}
+
+void ReplayPowermon::requestUnlock(const AuthKey& key, std::function<void(ResponseCode)> cb) {
+    Replay(DeviceTrace::OP_UNLOCK, cb);
+}
+
+void ReplayPowermon::requestSetUserPasswordLock(const AuthKey& key, std::function<void(ResponseCode)> cb) {
+    Replay(DeviceTrace::OP_SET_USER_PASSWORD_LOCK, cb);
+}
+
+void ReplayPowermon::requestSetMasterPasswordLock(const AuthKey& key, std::function<void(ResponseCode)> cb) {
+    Replay(DeviceTrace::OP_SET_MASTER_PASSWORD_LOCK, cb);
+}
+
+void ReplayPowermon::requestClearUserPasswordLock(std::function<void(ResponseCode)> cb) {
+    Replay(DeviceTrace::OP_CLEAR_USER_PASSWORD_LOCK, cb);
+}
+
+void ReplayPowermon::requestClearMasterPasswordLock(std::function<void(ResponseCode)> cb) {
+    Replay(DeviceTrace::OP_CLEAR_MASTER_PASSWORD_LOCK, cb);
+}
+
+void ReplayPowermon::requestGetAuthKey(std::function<void(ResponseCode, const AuthKey&)> cb) {
+    Replay(DeviceTrace::OP_GET_AUTH_KEY, cb);
+}
+
+void ReplayPowermon::requestResetAuthKey(std::function<void(ResponseCode)> cb) {
+    Replay(DeviceTrace::OP_RESET_AUTH_KEY, cb);
+}
+
+void ReplayPowermon::requestResetEnergyMeter(const std::function<void(ResponseCode)>& cb) {
+    Replay(DeviceTrace::OP_RESET_ENERGY_METER, cb);
+}
+
+void ReplayPowermon::requestResetCoulombMeter(const std::function<void(ResponseCode)>& cb) {
+    Replay(DeviceTrace::OP_RESET_COULOMB_METER, cb);
+}
+
+void ReplayPowermon::requestResetStatistics(const std::function<void(ResponseCode)>& cb) {
+    Replay(DeviceTrace::OP_RESET_STATISTICS, cb);
+}
+
+void ReplayPowermon::requestSetPowerState(bool state, const std::function<void(ResponseCode)>& cb) {
+    Replay(DeviceTrace::OP_SET_POWER_STATE, cb);
+}
+
+void ReplayPowermon::requestGetConfig(const std::function<void(ResponseCode, const PowermonConfig&)>& cb) {
+    Replay(DeviceTrace::OP_GET_CONFIG, cb);
+}
+
+void ReplayPowermon::requestSetConfig(const PowermonConfig& config, const std::function<void(ResponseCode)>& cb) {
+    Replay(DeviceTrace::OP_SET_CONFIG, cb);
+}
+
+void ReplayPowermon::requestResetConfig(const std::function<void(ResponseCode)>& cb) {
+    Replay(DeviceTrace::OP_RESET_CONFIG, cb);
+}
+
+void ReplayPowermon::requestRename(const char* name, const std::function<void(ResponseCode)>& cb) {
+    Replay(DeviceTrace::OP_RENAME, cb);
+}
+
+void ReplayPowermon::requestSetTime(uint32_t time, const std::function<void(ResponseCode)>& cb) {
+    Replay(DeviceTrace::OP_SET_TIME, cb);
+}
+
+void ReplayPowermon::requestFgSynchronize(const std::function<void(ResponseCode)>& cb) {
+    Replay(DeviceTrace::OP_FG_SYNCHRONIZE, cb);
+}
+
+void ReplayPowermon::requestStartWifiScan(const std::function<void(ResponseCode)>& cb) {
+    // Scan reports are not recorded, so none follow
+    Replay(DeviceTrace::OP_START_WIFI_SCAN, cb);
+}
+
+void ReplayPowermon::requestWifiConfigure(const WifiNetwork& network, const std::function<void(ResponseCode)>& cb) {
+    Replay(DeviceTrace::OP_WIFI_CONFIGURE, cb);
+}
+
+void ReplayPowermon::requestGetWifiNetworks(const std::function<void(ResponseCode, const std::vector<WifiNetwork>&)>& cb) {
+    Replay(DeviceTrace::OP_GET_WIFI_NETWORKS, cb);
+}
+
+void ReplayPowermon::requestAddWifiNetwork(const WifiNetwork& network, const std::function<void(ResponseCode)>& cb) {
+    Replay(DeviceTrace::OP_ADD_WIFI_NETWORK, cb);
+}
+
+void ReplayPowermon::requestRemoveWifiNetwork(uint8_t index, const std::function<void(ResponseCode)>& cb) {
+    Replay(DeviceTrace::OP_REMOVE_WIFI_NETWORK, cb);
+}
+
+void ReplayPowermon::requestGetAccessKeys(const std::function<void(ResponseCode, const WifiAccessKey&)>& cb) {
+    Replay(DeviceTrace::OP_GET_ACCESS_KEYS, cb);
+}
+
+void ReplayPowermon::requestResetAccessKeys(const std::function<void(ResponseCode)>& cb) {
+    Replay(DeviceTrace::OP_RESET_ACCESS_KEYS, cb);
+}
+
+void ReplayPowermon::requestZeroCurrentOffset(const std::function<void(ResponseCode)>& cb) {
+    Replay(DeviceTrace::OP_ZERO_CURRENT_OFFSET, cb);
+}
+
+void ReplayPowermon::requestCalibrateCurrent(float value, const std::function<void(ResponseCode)>& cb) {
+    Replay(DeviceTrace::OP_CALIBRATE_CURRENT, cb);
+}
+
+void ReplayPowermon::requestGetSchedules(const std::function<void(ResponseCode, const std::vector<PowermonSchedule>&)>& cb) {
+    Replay(DeviceTrace::OP_GET_SCHEDULES, cb);
+}
+
+void ReplayPowermon::requestAddSchedules(const std::vector<PowermonSchedule>& schedules, const std::function<void(ResponseCode)>& cb) {
+    Replay(DeviceTrace::OP_ADD_SCHEDULES, cb);
+}
+
+void ReplayPowermon::requestUpdateSchedule(uint64_t old_schedule_descriptor, const PowermonSchedule& new_schedule,
+                                           const std::function<void(ResponseCode)>& cb) {
+    Replay(DeviceTrace::OP_UPDATE_SCHEDULE, cb);
+}
+
+void ReplayPowermon::requestDeleteSchedule(uint64_t schedule_descriptor, const std::function<void(ResponseCode)>& cb) {
+    Replay(DeviceTrace::OP_DELETE_SCHEDULE, cb);
+}
+
+void ReplayPowermon::requestClearSchedules(const std::function<void(ResponseCode)>& cb) {
+    Replay(DeviceTrace::OP_CLEAR_SCHEDULES, cb);
+}
+
+void ReplayPowermon::requestCommitSchedules(const std::function<void(ResponseCode)>& cb) {
+    Replay(DeviceTrace::OP_COMMIT_SCHEDULES, cb);
+}
+
+void ReplayPowermon::requestGetLogFileList(const std::function<void(ResponseCode, const std::vector<LogFileDescriptor>&)>& cb) {
+    Replay(DeviceTrace::OP_GET_LOG_FILE_LIST, cb);
+}
+
+void ReplayPowermon::requestReadLogFile(uint32_t file_id, uint32_t offset, uint32_t read_size,
+                                        const std::function<void(ResponseCode, const uint8_t*, size_t)>& cb) {
+    Replay(DeviceTrace::OP_READ_LOG_FILE, DeviceTrace::Key(file_id, offset, read_size), cb);
+}
+
+void ReplayPowermon::requestClearLog(const std::function<void(ResponseCode)>& cb) {
+    Replay(DeviceTrace::OP_CLEAR_LOG, cb);
+}
+
+void ReplayPowermon::requestUpdateFirmware(const uint8_t* firmware_image, uint32_t size,
+                                           const std::function<bool(uint32_t, uint32_t)>& progress_cb,
+                                           const std::function<void(ResponseCode)>& done_cb) {
+    Replay(DeviceTrace::OP_UPDATE_FIRMWARE, done_cb);
+}
+
+void ReplayPowermon::requestReadDebug(uint32_t offset, uint32_t read_size,
+                                      const std::function<void(ResponseCode, const uint8_t*, size_t)>& cb) {
+    Replay(DeviceTrace::OP_READ_DEBUG, DeviceTrace::Key(offset, read_size), cb);
+}
+
+void ReplayPowermon::requestEraseDebug(const std::function<void(ResponseCode)>& cb) {
+    Replay(DeviceTrace::OP_ERASE_DEBUG, cb);
+}
+
+void ReplayPowermon::requestReboot(const std::function<void(ResponseCode)>& cb) {
+    Replay(DeviceTrace::OP_REBOOT, cb);
+}
@@ -0,0 +1,173 @@
+#ifndef REPLAY_POWERMON_H
+#define REPLAY_POWERMON_H
+
+#include <powermon.h>
+
+#include "device_timer.h"
+#include "device_trace.h"
+
+#include <stdint.h>
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Plays a DeviceTrace recorded by RecordingPowermon back as a device. Each
+// request gets the next recorded response for the same request (log and
+// debug reads are matched on file, offset and size) after the recorded
+// latency times Config::scale, on the same timer thread FakePowermon uses.
+// Connects succeed or fail as they did when recorded, and the unsolicited
+// disconnects and pushed monitor data that followed each connect are replayed
+// at their recorded offsets from it.
+//
+// A request with no recorded response left fails with RSP_INVALID_REQ
+// (RSP_NOT_FOUND for reads), so a replay that drifts from its recording shows
+// up in the results instead of hanging.
+class ReplayPowermon : public Powermon {
+public:
+    struct Config {
+        std::string trace;          // trace file, or a directory of *.pmtrace files
+        double scale = 1;           // latency multiplier; 0 answers immediately
+        bool loop = true;           // start over when a request's responses run out
+
+        // Parses "key=value,..." (e.g. the POWERMON_REPLAY environment
+        // variable). Keys: trace, scale, loop (0|1).
+        static bool Parse(const char* spec, Config& config, std::string* error);
+    };
+
+    // A loaded trace indexed for playback, shared by every device replaying it
+    struct Trace {
+        std::string path;
+        std::vector<DeviceTrace::Record> records;
+
+        // Responses per (op, key), in recorded order
+        std::map<std::pair<uint8_t, std::vector<uint8_t>>, std::vector<size_t>> responses;
+
+        // Connect outcomes in order, each with the events that followed it
+        struct Session {
+            size_t connect;
+            std::vector<size_t> events;
+        };
+        std::vector<Session> sessions;
+
+        static std::shared_ptr<const Trace> Load(const std::string& path, std::string* error);
+    };
+
+    ReplayPowermon(std::shared_ptr<const Trace> trace, const Config& config);
+    ~ReplayPowermon() override;
+
+#ifndef POWERMON_NO_INIT_BLE
+    bool initBle(void) override;
+#endif
+    void connectWifi(const WifiAccessKey& key) override;
+    void connectWifi(uint32_t ipaddr) override;
+    void connectBle(uint64_t ble_address) override;
+    void disconnect(void) override;
+    bool isLocalConnection(void) const override;
+
+    void setOnConnectCallback(const std::function<void(void)>& cb) override;
+    void setOnDisconnectCallback(const std::function<void(DisconnectReason)>& cb) override;
+    void setOnMonitorDataCallback(const std::function<void(const MonitorData&)>& cb) override;
+    void setOnWifiScanReportCallback(const std::function<void(const WifiScanResult*)>& cb) override;
+
+    const DeviceInfo& getLastDeviceInfo(void) const override;
+
+    void requestGetInfo(const std::function<void(ResponseCode, const DeviceInfo&)>& cb) override;
+    void requestGetMonitorData(const std::function<void(ResponseCode, const MonitorData&)>& cb) override;
+    void requestGetStatistics(const std::function<void(ResponseCode, const MonitorStatistics&)>& cb) override;
+    void requestGetFgStatistics(const std::function<void(ResponseCode, const FuelgaugeStatistics&)>& cb) override;
+
+    void requestUnlock(const AuthKey& key, std::function<void(ResponseCode)> cb) override;
+    void requestSetUserPasswordLock(const AuthKey& key, std::function<void(ResponseCode)> cb) override;
+    void requestSetMasterPasswordLock(const AuthKey& key, std::function<void(ResponseCode)> cb) override;
+    void requestClearUserPasswordLock(std::function<void(ResponseCode)> cb) override;
+    void requestClearMasterPasswordLock(std::function<void(ResponseCode)> cb) override;
+    void requestGetAuthKey(std::function<void(ResponseCode, const AuthKey&)> cb) override;
+    void requestResetAuthKey(std::function<void(ResponseCode)> cb) override;
+
+    void requestResetEnergyMeter(const std::function<void(ResponseCode)>& cb) override;
+    void requestResetCoulombMeter(const std::function<void(ResponseCode)>& cb) override;
+    void requestResetStatistics(const std::function<void(ResponseCode)>& cb) override;
+    void requestSetPowerState(bool state, const std::function<void(ResponseCode)>& cb) override;
+
+    void requestGetConfig(const std::function<void(ResponseCode, const PowermonConfig&)>& cb) override;
+    void requestSetConfig(const PowermonConfig& config, const std::function<void(ResponseCode)>& cb) override;
+    void requestResetConfig(const std::function<void(ResponseCode)>& cb) override;
+    void requestRename(const char* name, const std::function<void(ResponseCode)>& cb) override;
+    void requestSetTime(uint32_t time, const std::function<void(ResponseCode)>& cb) override;
+    void requestFgSynchronize(const std::function<void(ResponseCode)>& cb) override;
+
+    void requestStartWifiScan(const std::function<void(ResponseCode)>& cb) override;
+    void requestWifiConfigure(const WifiNetwork& network, const std::function<void(ResponseCode)>& cb) override;
+    void requestGetWifiNetworks(const std::function<void(ResponseCode, const std::vector<WifiNetwork>&)>& cb) override;
+    void requestAddWifiNetwork(const WifiNetwork& network, const std::function<void(ResponseCode)>& cb) override;
+    void requestRemoveWifiNetwork(uint8_t index, const std::function<void(ResponseCode)>& cb) override;
+    void requestGetAccessKeys(const std::function<void(ResponseCode, const WifiAccessKey&)>& cb) override;
+    void requestResetAccessKeys(const std::function<void(ResponseCode)>& cb) override;
+
+    void requestZeroCurrentOffset(const std::function<void(ResponseCode)>& cb) override;
+    void requestCalibrateCurrent(float value, const std::function<void(ResponseCode)>& cb) override;
+
+    void requestGetSchedules(const std::function<void(ResponseCode, const std::vector<PowermonSchedule>&)>& cb) override;
+    void requestAddSchedules(const std::vector<PowermonSchedule>& schedules, const std::function<void(ResponseCode)>& cb) override;
+    void requestUpdateSchedule(uint64_t old_schedule_descriptor, const PowermonSchedule& new_schedule,
+                               const std::function<void(ResponseCode)>& cb) override;
+    void requestDeleteSchedule(uint64_t schedule_descriptor, const std::function<void(ResponseCode)>& cb) override;
+    void requestClearSchedules(const std::function<void(ResponseCode)>& cb) override;
+    void requestCommitSchedules(const std::function<void(ResponseCode)>& cb) override;
+
+    void requestGetLogFileList(const std::function<void(ResponseCode, const std::vector<LogFileDescriptor>&)>& cb) override;
+    void requestReadLogFile(uint32_t file_id, uint32_t offset, uint32_t read_size,
+                            const std::function<void(ResponseCode, const uint8_t*, size_t)>& cb) override;
+    void requestClearLog(const std::function<void(ResponseCode)>& cb) override;
+
+    void requestUpdateFirmware(const uint8_t* firmware_image, uint32_t size, const std::function<bool(uint32_t, uint32_t)>& progress_cb,
+                               const std::function<void(ResponseCode)>& done_cb) override;
+    void requestReadDebug(uint32_t offset, uint32_t read_size,
+                          const std::function<void(ResponseCode, const uint8_t*, size_t)>& cb) override;
+    void requestEraseDebug(const std::function<void(ResponseCode)>& cb) override;
+    void requestReboot(const std::function<void(ResponseCode)>& cb) override;
+
+private:
+    std::shared_ptr<const Trace> trace_;
+    Config config_;
+    std::shared_ptr<DeviceTimer::Token> token_;
+
+    std::atomic<uint8_t> state_;
+    std::atomic<uint32_t> generation_;
+    std::atomic<bool> local_;
+
+    std::function<void(void)> on_connect_;
+    std::function<void(DisconnectReason)> on_disconnect_;
+    std::function<void(const MonitorData&)> on_monitor_data_;
+    std::function<void(const WifiScanResult*)> on_wifi_scan_;
+
+    mutable std::mutex mutex_;
+    DeviceInfo device_info_;
+    size_t next_session_;
+    std::map<std::pair<uint8_t, std::vector<uint8_t>>, size_t> next_response_;
+
+    void Connect();
+    void Schedule(double delay_ms, std::function<void()> fn);
+    double Delay(uint64_t us) const;
+
+    // Next recorded response for (op, key), or nullptr when there is none
+    const DeviceTrace::Record* NextResponse(DeviceTrace::Op op, const std::vector<uint8_t>& key);
+
+    // Answers a request with its next recorded response; respond() gets the
+    // record, or nullptr with RSP_CANCELLED, RSP_INVALID_REQ or RSP_NOT_FOUND
+    void Respond(DeviceTrace::Op op, const std::vector<uint8_t>& key,
+                 std::function<void(ResponseCode, const DeviceTrace::Record*)> respond);
+    void Replay(DeviceTrace::Op op, const std::function<void(ResponseCode)>& cb);
+    template <typename T>
+    void Replay(DeviceTrace::Op op, const std::function<void(ResponseCode, const T&)>& cb);
+    void Replay(DeviceTrace::Op op, const std::vector<uint8_t>& key,
+                const std::function<void(ResponseCode, const uint8_t*, size_t)>& cb);
+};
+
+#endif
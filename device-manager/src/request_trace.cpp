@@ -0,0 +1,250 @@
+#include "request_trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace RequestTrace {
+
+namespace {
+
+struct Event {
+    uint64_t time_us;
+    uint64_t request;
+    uint32_t device;
+    uint16_t code;
+    uint8_t op;
+    uint8_t phase;
+};
+
+// Seqlock per slot: seq is 0 while the slot is written, else the event's
+// position in the stream plus one
+struct Slot {
+    std::atomic<uint64_t> seq;
+    Event event;
+};
+
+struct Ring {
+    explicit Ring(size_t capacity) : slots(new Slot[capacity]), capacity(capacity), head(0), start(0) {
+        for (size_t i = 0; i < capacity; i++) {
+            slots[i].seq.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    Slot* slots;
+    size_t capacity;
+    std::atomic<uint64_t> head;
+    // Events before this position were cleared; Dump() skips them
+    std::atomic<uint64_t> start;
+};
+
+// Writers may still hold a replaced ring, so old rings are never freed; they
+// wait in retired, at most one per capacity, to be reused by Enable()
+std::atomic<Ring*> ring(nullptr);
+std::mutex enable_mutex;
+std::vector<Ring*> retired;
+std::atomic<uint64_t> next_request(1);
+
+std::mutex names_mutex;
+std::map<uint32_t, std::string> names;
+
+struct StartFromEnvironment {
+    StartFromEnvironment() {
+        const char* events = getenv("POWERMON_TRACE");
+        if (events != nullptr && *events != '\0') {
+            const size_t count = strtoull(events, nullptr, 10);
+            Enable(count > 0 ? count : DEFAULT_EVENTS);
+        }
+    }
+} start_from_environment;
+
+void AppendEscaped(std::string& out, const std::string& s) {
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+        }
+        out += (static_cast<unsigned char>(c) >= 0x20) ? c : ' ';
+    }
+}
+
+void AppendSlice(std::string& out, char phase, const char* name, uint64_t request, uint32_t device,
+                 uint64_t time_us, uint64_t base_us, const char* args) {
+    char line[256];
+    snprintf(line, sizeof(line),
+             ",\n{\"ph\":\"%c\",\"cat\":\"request\",\"name\":\"%s\",\"id\":\"0x%llx\",\"pid\":%u,\"tid\":%u,\"ts\":%llu%s}",
+             phase, name, static_cast<unsigned long long>(request), device, device,
+             static_cast<unsigned long long>(time_us - base_us), args);
+    out += line;
+}
+
+}
+
+bool Enabled() {
+    return ring.load(std::memory_order_relaxed) != nullptr;
+}
+
+void Enable(size_t events) {
+    events = std::min(events, MAX_EVENTS);
+    std::lock_guard<std::mutex> lock(enable_mutex);
+
+    Ring* current = ring.load(std::memory_order_relaxed);
+    if (current != nullptr && current->capacity == events) {
+        current->start.store(current->head.load(std::memory_order_relaxed), std::memory_order_release);
+        return;
+    }
+
+    Ring* next = nullptr;
+    if (events > 0) {
+        auto it = std::find_if(retired.begin(), retired.end(),
+            [events](const Ring* r) { return r->capacity == events; });
+        if (it != retired.end()) {
+            next = *it;
+            retired.erase(it);
+            next->start.store(next->head.load(std::memory_order_relaxed), std::memory_order_release);
+        } else {
+            next = new Ring(events);
+        }
+    }
+    ring.store(next, std::memory_order_release);
+    if (current != nullptr) {
+        retired.push_back(current);
+    }
+}
+
+size_t Capacity() {
+    Ring* current = ring.load(std::memory_order_acquire);
+    return current ? current->capacity : 0;
+}
+
+uint64_t Begin(LatencyStats::Op op, uint32_t device) {
+    if (!Enabled()) {
+        return 0;
+    }
+    const uint64_t request = next_request.fetch_add(1, std::memory_order_relaxed);
+    Mark(request, op, device, PHASE_SUBMIT);
+    return request;
+}
+
+void Mark(uint64_t request, LatencyStats::Op op, uint32_t device, Phase phase, uint16_t code) {
+    Ring* current = ring.load(std::memory_order_acquire);
+    if (current == nullptr || request == 0) {
+        return;
+    }
+
+    const uint64_t position = current->head.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = current->slots[position % current->capacity];
+    slot.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.event.time_us = LatencyStats::Now();
+    slot.event.request = request;
+    slot.event.device = device;
+    slot.event.code = code;
+    slot.event.op = static_cast<uint8_t>(op);
+    slot.event.phase = static_cast<uint8_t>(phase);
+    slot.seq.store(position + 1, std::memory_order_release);
+}
+
+void NameDevice(uint32_t device, const std::string& name) {
+    if (!Enabled()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(names_mutex);
+    names[device] = name;
+}
+
+void Dump(std::string& out) {
+    out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+          "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":0,\"args\":{\"name\":\"powermon\"}}";
+
+    Ring* current = ring.load(std::memory_order_acquire);
+    if (current == nullptr) {
+        out += "]}\n";
+        return;
+    }
+
+    const uint64_t start = current->start.load(std::memory_order_acquire);
+    std::vector<Event> events;
+    events.reserve(current->capacity);
+    for (size_t i = 0; i < current->capacity; i++) {
+        Slot& slot = current->slots[i];
+        const uint64_t before = slot.seq.load(std::memory_order_acquire);
+        if (before == 0 || before <= start) {
+            continue;
+        }
+        Event event = slot.event;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.seq.load(std::memory_order_relaxed) == before) {
+            events.push_back(event);
+        }
+    }
+
+    // One entry per request with its phase times; requests whose submit has
+    // been overwritten, or that have not been answered yet, are left out
+    struct Request {
+        uint32_t device = 0;
+        uint8_t op = 0;
+        uint16_t code = 0;
+        uint64_t at[PHASE_COUNT] = {};
+    };
+    std::map<uint64_t, Request> requests;
+    uint64_t base_us = UINT64_MAX;
+    for (const Event& event : events) {
+        Request& request = requests[event.request];
+        request.device = event.device;
+        request.op = event.op;
+        if (event.phase == PHASE_CALLBACK) {
+            request.code = event.code;
+        }
+        if (event.phase < PHASE_COUNT) {
+            request.at[event.phase] = event.time_us;
+        }
+        base_us = std::min(base_us, event.time_us);
+    }
+
+    std::map<uint32_t, bool> devices;
+    char args[64];
+    for (const auto& entry : requests) {
+        const Request& request = entry.second;
+        const uint64_t* at = request.at;
+        if (at[PHASE_SUBMIT] == 0 || at[PHASE_CALLBACK] == 0) {
+            continue;
+        }
+        devices[request.device] = true;
+
+        const uint64_t end = std::max({ at[PHASE_CALLBACK], at[PHASE_JS_START], at[PHASE_JS_DONE], at[PHASE_WRITTEN] });
+        const char* name = LatencyStats::OpName(static_cast<LatencyStats::Op>(request.op));
+        snprintf(args, sizeof(args), ",\"args\":{\"code\":%u}", request.code);
+
+        AppendSlice(out, 'b', name, entry.first, request.device, at[PHASE_SUBMIT], base_us, args);
+        AppendSlice(out, 'b', "relay", entry.first, request.device, at[PHASE_SUBMIT], base_us, "");
+        AppendSlice(out, 'e', "relay", entry.first, request.device, at[PHASE_CALLBACK], base_us, "");
+        if (at[PHASE_JS_START] != 0) {
+            AppendSlice(out, 'b', "queued", entry.first, request.device, at[PHASE_CALLBACK], base_us, "");
+            AppendSlice(out, 'e', "queued", entry.first, request.device, at[PHASE_JS_START], base_us, "");
+            if (at[PHASE_JS_DONE] != 0) {
+                AppendSlice(out, 'b', "js", entry.first, request.device, at[PHASE_JS_START], base_us, "");
+                AppendSlice(out, 'e', "js", entry.first, request.device, at[PHASE_JS_DONE], base_us, "");
+            }
+        } else if (at[PHASE_WRITTEN] != 0) {
+            AppendSlice(out, 'b', "output", entry.first, request.device, at[PHASE_CALLBACK], base_us, "");
+            AppendSlice(out, 'e', "output", entry.first, request.device, at[PHASE_WRITTEN], base_us, "");
+        }
+        AppendSlice(out, 'e', name, entry.first, request.device, end, base_us, "");
+    }
+
+    std::lock_guard<std::mutex> lock(names_mutex);
+    for (const auto& device : devices) {
+        auto name = names.find(device.first);
+        out += ",\n{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":" + std::to_string(device.first) + ",\"args\":{\"name\":\"";
+        AppendEscaped(out, name != names.end() ? name->second : "device " + std::to_string(device.first));
+        out += "\"}}";
+    }
+    out += "]}\n";
+}
+
+}
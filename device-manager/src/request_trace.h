@@ -0,0 +1,57 @@
+#ifndef REQUEST_TRACE_H
+#define REQUEST_TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "latency_stats.h"
+
+// Opt-in request lifecycle tracing for the addon and the bridge. Each request
+// gets an id at submission; Mark() stores a timestamped phase in a lock-free
+// ring of the most recent events, and Dump() turns the ring into Chrome
+// trace_event JSON (chrome://tracing, ui.perfetto.dev). Every device is a
+// process in the trace and every request a nested async slice:
+//
+//   <op>      submit .. last phase seen
+//     relay   submit .. library callback (network, relay and library)
+//     queued  library callback .. JS callback start (thread-safe function queue)
+//     js      JS callback start .. JS callback done
+//     output  library callback .. reply written (bridge)
+//
+// Off by default; POWERMON_TRACE=<events> enables it at startup.
+namespace RequestTrace {
+
+enum Phase : uint8_t {
+    PHASE_SUBMIT = 0,
+    PHASE_CALLBACK,
+    PHASE_JS_START,
+    PHASE_JS_DONE,
+    PHASE_WRITTEN,
+    PHASE_COUNT
+};
+
+const size_t DEFAULT_EVENTS = 1 << 20;
+// 32 bytes an event: 512 MB
+const size_t MAX_EVENTS = 1 << 24;
+
+bool Enabled();
+// events 0 disables; the ring is cleared either way. Larger counts are capped
+// at MAX_EVENTS. Rings are kept once allocated, since a writer may still hold
+// one, and reused for the same capacity, so toggling does not allocate again
+void Enable(size_t events);
+size_t Capacity();
+
+// 0 when tracing is off, so callers can skip the later Mark()s
+uint64_t Begin(LatencyStats::Op op, uint32_t device);
+void Mark(uint64_t request, LatencyStats::Op op, uint32_t device, Phase phase, uint16_t code = 0);
+
+// Track name in the trace, e.g. the device name and serial
+void NameDevice(uint32_t device, const std::string& name);
+
+void Dump(std::string& out);
+
+}
+
+#endif
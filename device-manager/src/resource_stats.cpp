@@ -0,0 +1,144 @@
+#include "resource_stats.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace ResourceStats {
+
+namespace {
+
+std::atomic<int64_t> instances(0);
+std::atomic<int64_t> created(0);
+std::atomic<int64_t> threads_created(0);
+std::atomic<int64_t> threads_released(0);
+std::atomic<int64_t> rss_delta_bytes(0);
+std::atomic<int64_t> pending_requests(0);
+std::atomic<int64_t> queued_callbacks(0);
+std::atomic<int64_t> tsfns(0);
+std::atomic<int64_t> callback_buffer_bytes(0);
+std::atomic<int64_t> packed_sample_bytes(0);
+
+void Add(std::atomic<int64_t>& total, std::atomic<int64_t>& own, int64_t delta) {
+    total.fetch_add(delta, std::memory_order_relaxed);
+    own.fetch_add(delta, std::memory_order_relaxed);
+}
+
+}
+
+uint32_t ThreadCount() {
+    DIR* dir = opendir("/proc/self/task");
+    if (dir == nullptr) {
+        return 0;
+    }
+    uint32_t count = 0;
+    while (struct dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] != '.') {
+            count++;
+        }
+    }
+    closedir(dir);
+    return count;
+}
+
+uint64_t RssBytes() {
+    FILE* file = fopen("/proc/self/statm", "r");
+    if (file == nullptr) {
+        return 0;
+    }
+    unsigned long long size = 0, resident = 0;
+    const int fields = fscanf(file, "%llu %llu", &size, &resident);
+    fclose(file);
+    return fields == 2 ? resident * static_cast<uint64_t>(sysconf(_SC_PAGESIZE)) : 0;
+}
+
+uint64_t PeakRssBytes() {
+    FILE* file = fopen("/proc/self/status", "r");
+    if (file == nullptr) {
+        return 0;
+    }
+    char line[128];
+    unsigned long long kb = 0;
+    while (fgets(line, sizeof(line), file)) {
+        if (strncmp(line, "VmHWM:", 6) == 0) {
+            sscanf(line + 6, "%llu", &kb);
+            break;
+        }
+    }
+    fclose(file);
+    return kb * 1024;
+}
+
+Mark Now() {
+    return { ThreadCount(), RssBytes() };
+}
+
+void Created(Instance& instance, const Mark& before) {
+    Created(instance, before, Now());
+}
+
+void Created(Instance& instance, const Mark& before, const Mark& after) {
+    const int32_t threads = static_cast<int32_t>(after.threads) - static_cast<int32_t>(before.threads);
+    const int64_t rss = static_cast<int64_t>(after.rss) - static_cast<int64_t>(before.rss);
+    instance.threads_created.store(threads, std::memory_order_relaxed);
+    instance.rss_delta_bytes.store(rss, std::memory_order_relaxed);
+    threads_created.fetch_add(threads, std::memory_order_relaxed);
+    rss_delta_bytes.fetch_add(rss, std::memory_order_relaxed);
+    created.fetch_add(1, std::memory_order_relaxed);
+    instances.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Destroyed(const Mark& before) {
+    const int64_t threads = static_cast<int64_t>(before.threads) - static_cast<int64_t>(ThreadCount());
+    threads_released.fetch_add(threads, std::memory_order_relaxed);
+    instances.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void RequestStarted(Instance& instance) {
+    Add(pending_requests, instance.pending_requests, 1);
+}
+
+void RequestAnswered(Instance& instance) {
+    Add(pending_requests, instance.pending_requests, -1);
+}
+
+void CallbackQueued(Instance& instance, int64_t bytes) {
+    Add(queued_callbacks, instance.queued_callbacks, 1);
+    Add(callback_buffer_bytes, instance.buffer_bytes, bytes);
+}
+
+void CallbackDone(Instance& instance, int64_t bytes) {
+    Add(queued_callbacks, instance.queued_callbacks, -1);
+    Add(callback_buffer_bytes, instance.buffer_bytes, -bytes);
+}
+
+void TsfnCreated(Instance& instance) {
+    Add(tsfns, instance.tsfns, 1);
+}
+
+void TsfnFinalized(Instance& instance) {
+    Add(tsfns, instance.tsfns, -1);
+}
+
+void PackedHeld(int64_t bytes) {
+    packed_sample_bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void Snapshot(Process& out) {
+    out.instances = instances.load(std::memory_order_relaxed);
+    out.threads = ThreadCount();
+    out.rss_bytes = RssBytes();
+    out.peak_rss_bytes = PeakRssBytes();
+    out.threads_created = threads_created.load(std::memory_order_relaxed);
+    out.threads_released = threads_released.load(std::memory_order_relaxed);
+    out.rss_delta_bytes = rss_delta_bytes.load(std::memory_order_relaxed);
+    out.created = created.load(std::memory_order_relaxed);
+    out.pending_requests = pending_requests.load(std::memory_order_relaxed);
+    out.queued_callbacks = queued_callbacks.load(std::memory_order_relaxed);
+    out.tsfns = tsfns.load(std::memory_order_relaxed);
+    out.callback_buffer_bytes = callback_buffer_bytes.load(std::memory_order_relaxed);
+    out.packed_sample_bytes = packed_sample_bytes.load(std::memory_order_relaxed);
+}
+
+}
@@ -0,0 +1,74 @@
+#ifndef RESOURCE_STATS_H
+#define RESOURCE_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+// What PowermonDevice instances cost the process: threads and RSS taken by
+// creating the library instance (/proc/self deltas around createInstance()
+// and initBle(), so an estimate when other threads start or exit meanwhile),
+// requests the library has not answered, callbacks queued for the JS thread,
+// thread-safe functions not finalized yet and payload bytes held for them.
+// Every per-instance change is mirrored in process-wide totals.
+namespace ResourceStats {
+
+// Shared with the instance's thread-safe function finalizers, which can run
+// after the PowermonDevice is gone
+struct Instance {
+    std::atomic<int32_t> threads_created{0};
+    std::atomic<int64_t> rss_delta_bytes{0};
+    std::atomic<int64_t> pending_requests{0};
+    std::atomic<int64_t> queued_callbacks{0};
+    std::atomic<int64_t> tsfns{0};
+    std::atomic<int64_t> buffer_bytes{0};
+};
+
+uint32_t ThreadCount();         // entries in /proc/self/task
+uint64_t RssBytes();            // /proc/self/statm
+uint64_t PeakRssBytes();        // VmHWM in /proc/self/status
+
+// Process snapshot taken before creating (or deleting) the library instance
+struct Mark {
+    uint32_t threads;
+    uint64_t rss;
+};
+Mark Now();
+void Created(Instance& instance, const Mark& before);
+// For an instance created on another thread, between before and after
+void Created(Instance& instance, const Mark& before, const Mark& after);
+// Threads that exited while the library instance was deleted
+void Destroyed(const Mark& before);
+
+void RequestStarted(Instance& instance);
+void RequestAnswered(Instance& instance);
+void CallbackQueued(Instance& instance, int64_t bytes);
+void CallbackDone(Instance& instance, int64_t bytes);
+void TsfnCreated(Instance& instance);
+void TsfnFinalized(Instance& instance);
+
+// Packed sample storage handed to JS, freed by the ArrayBuffer finalizer
+void PackedHeld(int64_t bytes);
+
+struct Process {
+    int64_t instances = 0;
+    uint32_t threads = 0;
+    uint64_t rss_bytes = 0;
+    uint64_t peak_rss_bytes = 0;
+    int64_t threads_created = 0;    // by instance creation, all time
+    int64_t threads_released = 0;   // by instance deletion, all time
+    int64_t rss_delta_bytes = 0;    // instance creation, all time
+    int64_t created = 0;            // instances measured
+    int64_t pending_requests = 0;
+    int64_t queued_callbacks = 0;
+    int64_t tsfns = 0;
+    int64_t callback_buffer_bytes = 0;
+    int64_t packed_sample_bytes = 0;
+};
+
+void Snapshot(Process& out);
+
+}
+
+#endif
@@ -0,0 +1,279 @@
+#include "sample_merger.h"
+
+#include <algorithm>
+#include <iterator>
+#include <string.h>
+
+namespace {
+
+bool EarlierThan(const SampleMerger::Point& point, int64_t time_ms) {
+    return point.time_ms < time_ms;
+}
+
+}
+
+SampleMerger::SampleMerger(int64_t tolerance_ms, int64_t hold_ms, int64_t history_ms)
+    : tolerance_ms_(tolerance_ms)
+    , hold_ms_(hold_ms)
+    , history_ms_(history_ms) {
+    memset(&stats_, 0, sizeof(stats_));
+}
+
+void SampleMerger::Inherit(Point& to, const Point& from) {
+    const uint16_t missing = from.fields & ~to.fields;
+    if (missing & HAS_ENERGY) {
+        to.energy = from.energy;
+    }
+    if (missing & HAS_CHARGE) {
+        to.charge = from.charge;
+    }
+    if (missing & HAS_RUNTIME) {
+        to.runtime = from.runtime;
+    }
+    if (missing & HAS_RSSI) {
+        to.rssi = from.rssi;
+    }
+    if (missing & HAS_VOLTAGE1) {
+        to.voltage1 = from.voltage1;
+    }
+    if (missing & HAS_VOLTAGE2) {
+        to.voltage2 = from.voltage2;
+    }
+    if (missing & HAS_CURRENT) {
+        to.current = from.current;
+    }
+    if (missing & HAS_POWER) {
+        to.power = from.power;
+    }
+    if (missing & HAS_TEMPERATURE) {
+        to.temperature = from.temperature;
+    }
+    if (missing & HAS_SOC) {
+        to.soc = from.soc;
+    }
+    if (missing & HAS_POWER_STATUS) {
+        to.power_status = from.power_status;
+    }
+    to.fields |= missing;
+}
+
+size_t SampleMerger::FindNearest(const std::vector<Point>& points, int64_t time_ms) const {
+    auto it = std::lower_bound(points.begin(), points.end(), time_ms, EarlierThan);
+    size_t best = SIZE_MAX;
+    int64_t best_distance = tolerance_ms_ + 1;
+
+    if (it != points.end() && it->time_ms - time_ms < best_distance) {
+        best = it - points.begin();
+        best_distance = it->time_ms - time_ms;
+    }
+    if (it != points.begin() && time_ms - (it - 1)->time_ms < best_distance) {
+        best = (it - 1) - points.begin();
+    }
+    return best;
+}
+
+bool SampleMerger::NearEmittedPoll(const DeviceState& state, int64_t time_ms) const {
+    auto it = std::lower_bound(state.emitted_polls.begin(), state.emitted_polls.end(), time_ms - tolerance_ms_);
+    return it != state.emitted_polls.end() && *it <= time_ms + tolerance_ms_;
+}
+
+bool SampleMerger::InEmittedLogs(const DeviceState& state, int64_t time_ms, int64_t slack_ms) const {
+    // Last interval starting at or before time_ms + slack is the only candidate
+    auto it = std::upper_bound(state.emitted_logs.begin(), state.emitted_logs.end(), time_ms + slack_ms,
+        [](int64_t t, const Interval& interval) { return t < interval.start; });
+    if (it == state.emitted_logs.begin()) {
+        return false;
+    }
+    --it;
+    return it->end + slack_ms >= time_ms;
+}
+
+void SampleMerger::RecordEmitted(DeviceState& state, const Point& point) {
+    const int64_t time_ms = point.time_ms;
+
+    if (point.source == SOURCE_POLL) {
+        std::vector<int64_t>& polls = state.emitted_polls;
+        if (polls.empty() || time_ms > polls.back()) {
+            polls.push_back(time_ms);
+        } else {
+            polls.insert(std::lower_bound(polls.begin(), polls.end(), time_ms), time_ms);
+        }
+        return;
+    }
+
+    std::vector<Interval>& logs = state.emitted_logs;
+
+    // Common case: log samples are emitted in time order
+    if (!logs.empty() && time_ms >= logs.back().start) {
+        Interval& last = logs.back();
+        if (time_ms - last.end <= tolerance_ms_) {
+            last.end = std::max(last.end, time_ms);
+        } else {
+            logs.push_back({ time_ms, time_ms });
+        }
+        return;
+    }
+
+    auto it = std::lower_bound(logs.begin(), logs.end(), time_ms,
+        [](const Interval& interval, int64_t t) { return interval.start < t; });
+    it = logs.insert(it, { time_ms, time_ms });
+
+    if (it + 1 != logs.end() && (it + 1)->start - it->end <= tolerance_ms_) {
+        it->end = std::max(it->end, (it + 1)->end);
+        logs.erase(it + 1);
+    }
+    if (it != logs.begin() && it->start - (it - 1)->end <= tolerance_ms_) {
+        (it - 1)->end = std::max((it - 1)->end, it->end);
+        logs.erase(it);
+    }
+}
+
+bool SampleMerger::AddPoll(int64_t device_id, const Point& point) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    DeviceState& state = devices_[device_id];
+
+    if (NearEmittedPoll(state, point.time_ms) || InEmittedLogs(state, point.time_ms, tolerance_ms_)) {
+        stats_.polls_dropped++;
+        return false;
+    }
+
+    size_t nearest = FindNearest(state.pending, point.time_ms);
+    if (nearest != SIZE_MAX) {
+        Point& match = state.pending[nearest];
+        if (match.source == SOURCE_LOG) {
+            Inherit(match, point);
+            stats_.polls_superseded++;
+        } else {
+            stats_.polls_dropped++;
+        }
+        return false;
+    }
+
+    Point p = point;
+    p.source = SOURCE_POLL;
+    auto pos = std::lower_bound(state.pending.begin(), state.pending.end(), p.time_ms, EarlierThan);
+    state.pending.insert(pos, p);
+    stats_.polls_accepted++;
+    return true;
+}
+
+size_t SampleMerger::AddLog(int64_t device_id, const Point* points, size_t count) {
+    if (count == 0) {
+        return 0;
+    }
+
+    std::vector<Point> batch(points, points + count);
+    for (Point& p : batch) {
+        p.source = SOURCE_LOG;
+    }
+    if (!std::is_sorted(batch.begin(), batch.end(), [](const Point& a, const Point& b) { return a.time_ms < b.time_ms; })) {
+        std::stable_sort(batch.begin(), batch.end(), [](const Point& a, const Point& b) { return a.time_ms < b.time_ms; });
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    DeviceState& state = devices_[device_id];
+
+    enum Claim : uint8_t { FREE = 0, DROPPED = 1, SUPERSEDES = 2 };
+    std::vector<uint8_t> claims(batch.size(), FREE);
+    const int64_t first = batch.front().time_ms - tolerance_ms_;
+    const int64_t last = batch.back().time_ms + tolerance_ms_;
+
+    // A poll already written claims its nearest log sample, which is dropped
+    for (auto it = std::lower_bound(state.emitted_polls.begin(), state.emitted_polls.end(), first);
+         it != state.emitted_polls.end() && *it <= last; ++it) {
+        size_t nearest = FindNearest(batch, *it);
+        if (nearest != SIZE_MAX) {
+            claims[nearest] = DROPPED;
+        }
+    }
+
+    // A pending poll is replaced by its nearest log sample
+    bool superseded = false;
+    for (auto it = std::lower_bound(state.pending.begin(), state.pending.end(), first, EarlierThan);
+         it != state.pending.end() && it->time_ms <= last; ++it) {
+        if (it->source != SOURCE_POLL) {
+            continue;
+        }
+        size_t nearest = FindNearest(batch, it->time_ms);
+        if (nearest != SIZE_MAX && claims[nearest] == FREE) {
+            Inherit(batch[nearest], *it);
+            claims[nearest] = SUPERSEDES;
+            it->source = 0xFF;
+            superseded = true;
+            stats_.polls_superseded++;
+        }
+    }
+    if (superseded) {
+        state.pending.erase(std::remove_if(state.pending.begin(), state.pending.end(),
+            [](const Point& p) { return p.source == 0xFF; }), state.pending.end());
+    }
+
+    std::vector<Point> accepted;
+    accepted.reserve(batch.size());
+    for (size_t i = 0; i < batch.size(); i++) {
+        const Point& p = batch[i];
+        bool duplicate = claims[i] == DROPPED || InEmittedLogs(state, p.time_ms, 0) ||
+            (!accepted.empty() && accepted.back().time_ms == p.time_ms);
+        if (!duplicate) {
+            auto it = std::lower_bound(state.pending.begin(), state.pending.end(), p.time_ms, EarlierThan);
+            duplicate = it != state.pending.end() && it->time_ms == p.time_ms && it->source == SOURCE_LOG;
+        }
+        if (duplicate) {
+            stats_.logs_dropped++;
+            continue;
+        }
+        accepted.push_back(p);
+    }
+
+    if (!accepted.empty()) {
+        std::vector<Point> merged;
+        merged.reserve(state.pending.size() + accepted.size());
+        std::merge(state.pending.begin(), state.pending.end(), accepted.begin(), accepted.end(),
+            std::back_inserter(merged), [](const Point& a, const Point& b) { return a.time_ms < b.time_ms; });
+        state.pending.swap(merged);
+    }
+
+    stats_.logs_accepted += accepted.size();
+    return accepted.size();
+}
+
+void SampleMerger::Drain(int64_t now_ms, std::vector<Output>& out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const int64_t cutoff = now_ms - hold_ms_;
+    const int64_t horizon = now_ms - history_ms_;
+
+    for (auto& it : devices_) {
+        DeviceState& state = it.second;
+
+        auto end = std::upper_bound(state.pending.begin(), state.pending.end(), cutoff,
+            [](int64_t t, const Point& point) { return t < point.time_ms; });
+
+        for (auto p = state.pending.begin(); p != end; ++p) {
+            out.push_back({ it.first, *p });
+            RecordEmitted(state, *p);
+        }
+        stats_.emitted += end - state.pending.begin();
+        state.pending.erase(state.pending.begin(), end);
+
+        state.emitted_polls.erase(state.emitted_polls.begin(),
+            std::lower_bound(state.emitted_polls.begin(), state.emitted_polls.end(), horizon));
+        state.emitted_logs.erase(state.emitted_logs.begin(),
+            std::find_if(state.emitted_logs.begin(), state.emitted_logs.end(),
+                [horizon](const Interval& interval) { return interval.end >= horizon; }));
+    }
+}
+
+void SampleMerger::RemoveDevice(int64_t device_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    devices_.erase(device_id);
+}
+
+SampleMerger::Stats SampleMerger::GetStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats = stats_;
+    stats.pending = 0;
+    for (const auto& it : devices_) {
+        stats.pending += it.second.pending.size();
+    }
+    return stats;
+}
@@ -0,0 +1,116 @@
+#ifndef SAMPLE_MERGER_H
+#define SAMPLE_MERGER_H
+
+#include <stdint.h>
+
+#include <map>
+#include <mutex>
+#include <vector>
+
+// Merges the live poll stream and the log backfill stream of each device into
+// one time-ordered stream.
+//
+// Log samples have a higher resolution than polls, so the log sample nearest
+// to a poll (within tolerance_ms) replaces it and inherits the fields it lacks
+// (the poll-only energy and coulomb meters, runtime and rssi, and any channel
+// the log does not record); the other log samples around it
+// are kept as-is. Points are held for hold_ms of sample time before being
+// emitted so a backfill arriving shortly after a poll can still replace it.
+// Once emitted, a compact history of poll times and log coverage drops later
+// duplicates (a log file read twice, or a backfill overlapping written polls)
+// for history_ms.
+class SampleMerger {
+public:
+    enum Source : uint8_t {
+        SOURCE_POLL = 0,
+        SOURCE_LOG = 1
+    };
+
+    // Fields that were set; the others are emitted as null
+    enum Fields : uint16_t {
+        HAS_ENERGY = (1 << 0),
+        HAS_CHARGE = (1 << 1),
+        HAS_RUNTIME = (1 << 2),
+        HAS_RSSI = (1 << 3),
+        HAS_VOLTAGE1 = (1 << 4),
+        HAS_VOLTAGE2 = (1 << 5),
+        HAS_CURRENT = (1 << 6),
+        HAS_POWER = (1 << 7),
+        HAS_TEMPERATURE = (1 << 8),
+        HAS_SOC = (1 << 9),
+        HAS_POWER_STATUS = (1 << 10)
+    };
+
+    struct Point {
+        int64_t time_ms;
+        float voltage1;
+        float voltage2;
+        float current;
+        float power;
+        float temperature;
+        double energy;
+        double charge;
+        int32_t runtime;
+        int16_t rssi;
+        uint8_t soc;
+        uint8_t power_status;
+        uint8_t source;
+        uint16_t fields;
+    };
+
+    struct Output {
+        int64_t device_id;
+        Point point;
+    };
+
+    struct Stats {
+        uint64_t polls_accepted;
+        uint64_t logs_accepted;
+        uint64_t polls_superseded;
+        uint64_t polls_dropped;
+        uint64_t logs_dropped;
+        uint64_t emitted;
+        uint64_t pending;
+    };
+
+    SampleMerger(int64_t tolerance_ms, int64_t hold_ms, int64_t history_ms);
+
+    bool AddPoll(int64_t device_id, const Point& point);
+    size_t AddLog(int64_t device_id, const Point* points, size_t count);
+
+    // Emits every pending point with time_ms <= now_ms - hold_ms, grouped by
+    // device and sorted by time within each device.
+    void Drain(int64_t now_ms, std::vector<Output>& out);
+
+    void RemoveDevice(int64_t device_id);
+    Stats GetStats() const;
+
+private:
+    struct Interval {
+        int64_t start;
+        int64_t end;
+    };
+
+    struct DeviceState {
+        std::vector<Point> pending;             // sorted by time_ms
+        std::vector<int64_t> emitted_polls;     // sorted
+        std::vector<Interval> emitted_logs;     // sorted, non-overlapping
+    };
+
+    int64_t tolerance_ms_;
+    int64_t hold_ms_;
+    int64_t history_ms_;
+
+    mutable std::mutex mutex_;
+    std::map<int64_t, DeviceState> devices_;
+    Stats stats_;
+
+    bool NearEmittedPoll(const DeviceState& state, int64_t time_ms) const;
+    bool InEmittedLogs(const DeviceState& state, int64_t time_ms, int64_t slack_ms) const;
+    void RecordEmitted(DeviceState& state, const Point& point);
+    size_t FindNearest(const std::vector<Point>& points, int64_t time_ms) const;
+
+    static void Inherit(Point& to, const Point& from);
+};
+
+#endif
@@ -0,0 +1,279 @@
+#include "sample_merger_wrapper.h"
+#include "packed_samples_wrapper.h"
+#include "powermon.h"
+
+#include <math.h>
+#include <string.h>
+
+namespace {
+
+const int64_t DEFAULT_TOLERANCE_MS = 2000;
+const int64_t DEFAULT_HOLD_MS = 30000;
+const int64_t DEFAULT_HISTORY_MS = 3600000;
+
+int64_t GetOption(Napi::Object options, const char* key, int64_t fallback) {
+    Napi::Value value = options.Get(key);
+    if (!value.IsNumber()) {
+        return fallback;
+    }
+    return value.As<Napi::Number>().Int64Value();
+}
+
+// Absent, null or NaN (a channel the log does not record) leave a field unset
+bool ReadNumber(Napi::Object obj, const char* key, double& out) {
+    Napi::Value value = obj.Get(key);
+    if (!value.IsNumber()) {
+        return false;
+    }
+    out = value.As<Napi::Number>().DoubleValue();
+    return !isnan(out);
+}
+
+void ReadFloat(Napi::Object obj, const char* key, float& out, uint16_t& fields, uint16_t bit) {
+    double value;
+    if (ReadNumber(obj, key, value)) {
+        out = static_cast<float>(value);
+        fields |= bit;
+    }
+}
+
+void ReadByte(Napi::Object obj, const char* key, uint8_t& out, uint16_t& fields, uint16_t bit) {
+    double value;
+    if (ReadNumber(obj, key, value)) {
+        out = static_cast<uint8_t>(value);
+        fields |= bit;
+    }
+}
+
+void SetFloat(float value, float& out, uint16_t& fields, uint16_t bit) {
+    if (!isnan(value)) {
+        out = value;
+        fields |= bit;
+    }
+}
+
+Napi::Value NumberOrNull(Napi::Env env, uint16_t fields, uint16_t bit, double value) {
+    return (fields & bit) ? Napi::Number::New(env, value) : env.Null();
+}
+
+}
+
+Napi::Object SampleMergerWrapper::Init(Napi::Env env, Napi::Object exports) {
+    Napi::Function func = DefineClass(env, "SampleMerger", {
+        InstanceMethod("addPoll", &SampleMergerWrapper::AddPoll),
+        InstanceMethod("addLog", &SampleMergerWrapper::AddLog),
+        InstanceMethod("drain", &SampleMergerWrapper::Drain),
+        InstanceMethod("removeDevice", &SampleMergerWrapper::RemoveDevice),
+        InstanceMethod("stats", &SampleMergerWrapper::GetStats),
+    });
+
+    exports.Set("SampleMerger", func);
+    return exports;
+}
+
+SampleMergerWrapper::SampleMergerWrapper(const Napi::CallbackInfo& info)
+    : Napi::ObjectWrap<SampleMergerWrapper>(info) {
+    int64_t tolerance_ms = DEFAULT_TOLERANCE_MS;
+    int64_t hold_ms = DEFAULT_HOLD_MS;
+    int64_t history_ms = DEFAULT_HISTORY_MS;
+
+    if (info.Length() > 0 && info[0].IsObject()) {
+        Napi::Object options = info[0].As<Napi::Object>();
+        tolerance_ms = GetOption(options, "toleranceMs", tolerance_ms);
+        hold_ms = GetOption(options, "holdMs", hold_ms);
+        history_ms = GetOption(options, "historyMs", history_ms);
+    }
+
+    merger_.reset(new SampleMerger(tolerance_ms, hold_ms, history_ms));
+}
+
+bool SampleMergerWrapper::ReadPoint(Napi::Object obj, SampleMerger::Point& point) {
+    memset(&point, 0, sizeof(point));
+
+    ReadFloat(obj, "voltage1", point.voltage1, point.fields, SampleMerger::HAS_VOLTAGE1);
+    ReadFloat(obj, "voltage2", point.voltage2, point.fields, SampleMerger::HAS_VOLTAGE2);
+    ReadFloat(obj, "current", point.current, point.fields, SampleMerger::HAS_CURRENT);
+    ReadFloat(obj, "power", point.power, point.fields, SampleMerger::HAS_POWER);
+    ReadFloat(obj, "temperature", point.temperature, point.fields, SampleMerger::HAS_TEMPERATURE);
+    ReadByte(obj, "soc", point.soc, point.fields, SampleMerger::HAS_SOC);
+    ReadByte(obj, "powerStatus", point.power_status, point.fields, SampleMerger::HAS_POWER_STATUS);
+
+    double value;
+    if (ReadNumber(obj, "energy", value)) {
+        point.energy = value;
+        point.fields |= SampleMerger::HAS_ENERGY;
+    }
+    if (ReadNumber(obj, "charge", value)) {
+        point.charge = value;
+        point.fields |= SampleMerger::HAS_CHARGE;
+    }
+    if (ReadNumber(obj, "runtime", value)) {
+        point.runtime = static_cast<int32_t>(value);
+        point.fields |= SampleMerger::HAS_RUNTIME;
+    }
+    if (ReadNumber(obj, "rssi", value)) {
+        point.rssi = static_cast<int16_t>(value);
+        point.fields |= SampleMerger::HAS_RSSI;
+    }
+
+    return true;
+}
+
+Napi::Object SampleMergerWrapper::OutputToObject(Napi::Env env, const SampleMerger::Output& output) {
+    const SampleMerger::Point& p = output.point;
+
+    Napi::Object obj = Napi::Object::New(env);
+    obj.Set("deviceId", Napi::Number::New(env, static_cast<double>(output.device_id)));
+    obj.Set("recordedAt", Napi::Date::New(env, static_cast<double>(p.time_ms)));
+    obj.Set("voltage1", NumberOrNull(env, p.fields, SampleMerger::HAS_VOLTAGE1, p.voltage1));
+    obj.Set("voltage2", NumberOrNull(env, p.fields, SampleMerger::HAS_VOLTAGE2, p.voltage2));
+    obj.Set("current", NumberOrNull(env, p.fields, SampleMerger::HAS_CURRENT, p.current));
+    obj.Set("power", NumberOrNull(env, p.fields, SampleMerger::HAS_POWER, p.power));
+    obj.Set("temperature", NumberOrNull(env, p.fields, SampleMerger::HAS_TEMPERATURE, p.temperature));
+    obj.Set("soc", NumberOrNull(env, p.fields, SampleMerger::HAS_SOC, p.soc));
+    obj.Set("energy", NumberOrNull(env, p.fields, SampleMerger::HAS_ENERGY, p.energy));
+    obj.Set("charge", NumberOrNull(env, p.fields, SampleMerger::HAS_CHARGE, p.charge));
+    obj.Set("runtime", NumberOrNull(env, p.fields, SampleMerger::HAS_RUNTIME, p.runtime));
+    obj.Set("rssi", NumberOrNull(env, p.fields, SampleMerger::HAS_RSSI, p.rssi));
+    obj.Set("powerStatus", NumberOrNull(env, p.fields, SampleMerger::HAS_POWER_STATUS, p.power_status));
+    obj.Set("powerStatusString", (p.fields & SampleMerger::HAS_POWER_STATUS)
+        ? Napi::Value(Napi::String::New(env,
+              Powermon::getPowerStatusString(static_cast<Powermon::PowerStatus>(p.power_status))))
+        : env.Null());
+    obj.Set("source", Napi::String::New(env, p.source == SampleMerger::SOURCE_LOG ? "backfill" : "poll"));
+    return obj;
+}
+
+Napi::Value SampleMergerWrapper::AddPoll(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsObject()) {
+        Napi::TypeError::New(env, "deviceId and measurement expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    Napi::Object measurement = info[1].As<Napi::Object>();
+    Napi::Value recorded_at = measurement.Get("recordedAt");
+
+    SampleMerger::Point point;
+    ReadPoint(measurement, point);
+    if (recorded_at.IsDate()) {
+        point.time_ms = static_cast<int64_t>(recorded_at.As<Napi::Date>().ValueOf());
+    } else if (recorded_at.IsNumber()) {
+        point.time_ms = recorded_at.As<Napi::Number>().Int64Value();
+    } else {
+        Napi::TypeError::New(env, "measurement.recordedAt must be a Date or number").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    int64_t device_id = info[0].As<Napi::Number>().Int64Value();
+    return Napi::Boolean::New(env, merger_->AddPoll(device_id, point));
+}
+
+Napi::Value SampleMergerWrapper::AddLog(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    bool packed = info.Length() > 1 && PackedSamplesWrapper::IsPacked(info[1]);
+    if (info.Length() < 2 || !info[0].IsNumber() || !(packed || info[1].IsArray())) {
+        Napi::TypeError::New(env, "deviceId and samples array expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    int64_t device_id = info[0].As<Napi::Number>().Int64Value();
+    int64_t offset_ms = 0;
+    if (info.Length() > 2 && info[2].IsNumber()) {
+        offset_ms = info[2].As<Napi::Number>().Int64Value();
+    }
+
+    std::vector<SampleMerger::Point> points;
+
+    if (packed) {
+        std::vector<PowermonLogFile::Sample> samples;
+        PackedSamplesWrapper::ReadSamples(info[1], samples);
+        points.resize(samples.size());
+        for (size_t i = 0; i < samples.size(); i++) {
+            SampleMerger::Point& point = points[i];
+            memset(&point, 0, sizeof(point));
+            point.time_ms = static_cast<int64_t>(samples[i].time) * 1000 + offset_ms;
+            SetFloat(samples[i].voltage1, point.voltage1, point.fields, SampleMerger::HAS_VOLTAGE1);
+            SetFloat(samples[i].voltage2, point.voltage2, point.fields, SampleMerger::HAS_VOLTAGE2);
+            SetFloat(samples[i].current, point.current, point.fields, SampleMerger::HAS_CURRENT);
+            SetFloat(samples[i].power, point.power, point.fields, SampleMerger::HAS_POWER);
+            SetFloat(samples[i].temperature, point.temperature, point.fields, SampleMerger::HAS_TEMPERATURE);
+            point.soc = samples[i].soc;
+            point.power_status = samples[i].ps;
+            point.fields |= SampleMerger::HAS_SOC | SampleMerger::HAS_POWER_STATUS;
+        }
+        size_t accepted = merger_->AddLog(device_id, points.data(), points.size());
+        return Napi::Number::New(env, static_cast<double>(accepted));
+    }
+
+    Napi::Array samples = info[1].As<Napi::Array>();
+    points.reserve(samples.Length());
+
+    for (uint32_t i = 0; i < samples.Length(); i++) {
+        Napi::Value value = samples.Get(i);
+        if (!value.IsObject()) {
+            continue;
+        }
+        Napi::Object sample = value.As<Napi::Object>();
+
+        double time = 0;
+        if (!ReadNumber(sample, "time", time)) {
+            continue;
+        }
+
+        SampleMerger::Point point;
+        ReadPoint(sample, point);
+        point.time_ms = static_cast<int64_t>(time * 1000.0) + offset_ms;
+        points.push_back(point);
+    }
+
+    size_t accepted = merger_->AddLog(device_id, points.data(), points.size());
+    return Napi::Number::New(env, static_cast<double>(accepted));
+}
+
+Napi::Value SampleMergerWrapper::Drain(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsNumber()) {
+        Napi::TypeError::New(env, "now timestamp (ms) expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    std::vector<SampleMerger::Output> outputs;
+    merger_->Drain(info[0].As<Napi::Number>().Int64Value(), outputs);
+
+    Napi::Array arr = Napi::Array::New(env, outputs.size());
+    for (size_t i = 0; i < outputs.size(); i++) {
+        arr.Set(i, OutputToObject(env, outputs[i]));
+    }
+    return arr;
+}
+
+Napi::Value SampleMergerWrapper::RemoveDevice(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsNumber()) {
+        Napi::TypeError::New(env, "deviceId expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    merger_->RemoveDevice(info[0].As<Napi::Number>().Int64Value());
+    return env.Undefined();
+}
+
+Napi::Value SampleMergerWrapper::GetStats(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    SampleMerger::Stats stats = merger_->GetStats();
+
+    Napi::Object obj = Napi::Object::New(env);
+    obj.Set("pollsAccepted", Napi::Number::New(env, static_cast<double>(stats.polls_accepted)));
+    obj.Set("logsAccepted", Napi::Number::New(env, static_cast<double>(stats.logs_accepted)));
+    obj.Set("pollsSuperseded", Napi::Number::New(env, static_cast<double>(stats.polls_superseded)));
+    obj.Set("pollsDropped", Napi::Number::New(env, static_cast<double>(stats.polls_dropped)));
+    obj.Set("logsDropped", Napi::Number::New(env, static_cast<double>(stats.logs_dropped)));
+    obj.Set("emitted", Napi::Number::New(env, static_cast<double>(stats.emitted)));
+    obj.Set("pending", Napi::Number::New(env, static_cast<double>(stats.pending)));
+    return obj;
+}
@@ -0,0 +1,28 @@
+#ifndef SAMPLE_MERGER_WRAPPER_H
+#define SAMPLE_MERGER_WRAPPER_H
+
+#include <napi.h>
+
+#include <memory>
+
+#include "sample_merger.h"
+
+class SampleMergerWrapper : public Napi::ObjectWrap<SampleMergerWrapper> {
+public:
+    static Napi::Object Init(Napi::Env env, Napi::Object exports);
+    SampleMergerWrapper(const Napi::CallbackInfo& info);
+
+    Napi::Value AddPoll(const Napi::CallbackInfo& info);
+    Napi::Value AddLog(const Napi::CallbackInfo& info);
+    Napi::Value Drain(const Napi::CallbackInfo& info);
+    Napi::Value RemoveDevice(const Napi::CallbackInfo& info);
+    Napi::Value GetStats(const Napi::CallbackInfo& info);
+
+private:
+    std::unique_ptr<SampleMerger> merger_;
+
+    static bool ReadPoint(Napi::Object obj, SampleMerger::Point& point);
+    static Napi::Object OutputToObject(Napi::Env env, const SampleMerger::Output& output);
+};
+
+#endif
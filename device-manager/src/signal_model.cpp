@@ -0,0 +1,205 @@
+#include "signal_model.h"
+
+#include <powermon.h>
+
+#include <math.h>
+
+namespace SignalModel {
+
+namespace {
+
+const double TWO_PI = 6.283185307179586;
+const double PI = 3.141592653589793;
+
+// Uniform in [-0.5, 0.5), fixed per (h, time)
+double Noise(uint64_t h, uint32_t time) {
+    return static_cast<double>(Mix(h ^ time) & 0xFFFF) / 65535.0 - 0.5;
+}
+
+// Uniform in [min, max], fixed per bits
+double Uniform(uint64_t bits, double min, double max) {
+    return min + (max - min) * static_cast<double>(bits & 0xFFFFFF) / 16777215.0;
+}
+
+void Daily(uint64_t h, uint32_t time, bool with_v2, PowermonLogFile::Sample& sample) {
+    // Daily charge/discharge cycle offset per device, a 10 minute ripple and
+    // a little per-sample noise
+    double day = sin(TWO_PI * (static_cast<double>(h % 86400) + time) / 86400.0);
+    double ripple = sin(TWO_PI * time / 600.0 + static_cast<double>((h >> 20) % 628) / 100.0);
+    double noise = Noise(h, time);
+
+    sample.current = static_cast<float>(25.0 * day + 4.0 * ripple + 0.4 * noise);
+    sample.voltage1 = static_cast<float>(12.9 + 0.3 * day + 0.02 * sample.current);
+    sample.voltage2 = with_v2 ? static_cast<float>(12.7 + 0.05 * day) : 0.0f;
+    sample.temperature = static_cast<float>(22.0 + 10.0 * day + noise);
+    sample.soc = static_cast<uint8_t>(60.0 + 35.0 * day);
+    sample.ps = Powermon::PS_ON;
+}
+
+void Truck(uint64_t h, uint32_t time, bool with_v2, PowermonLogFile::Sample& sample) {
+    uint32_t local = time + static_cast<uint32_t>(h % 86400);
+    uint32_t day = local / 86400;
+    uint32_t tod = local % 86400;
+
+    // Two driving legs a day, each starting up to an hour late
+    uint64_t d = Mix(h ^ day);
+    uint32_t leg1 = 6 * 3600 + static_cast<uint32_t>(d % 3600);
+    uint32_t leg2 = 13 * 3600 + static_cast<uint32_t>((d >> 16) % 3600);
+    bool driving = (tod >= leg1 && tod < leg1 + 5 * 3600) || (tod >= leg2 && tod < leg2 + 4 * 3600);
+
+    double noise = Noise(h, time);
+    double ambient = sin(TWO_PI * (static_cast<double>(tod) - 9.0 * 3600) / 86400.0);
+
+    // State of charge: recovers while driving, drains overnight and at the midday stop
+    double soc;
+    if (tod < leg1) {
+        soc = 85.0 - 40.0 * (static_cast<double>(tod) + 86400 - (leg2 + 4 * 3600)) / (86400 - (leg2 + 4 * 3600) + leg1);
+    } else if (tod < leg1 + 5 * 3600) {
+        soc = 45.0 + 40.0 * (1.0 - exp(-static_cast<double>(tod - leg1) / 5400.0));
+    } else if (tod < leg2) {
+        soc = 84.0 - 10.0 * static_cast<double>(tod - leg1 - 5 * 3600) / (leg2 - leg1 - 5 * 3600);
+    } else if (tod < leg2 + 4 * 3600) {
+        soc = 74.0 + 12.0 * (1.0 - exp(-static_cast<double>(tod - leg2) / 3600.0));
+    } else {
+        soc = 85.0 - 40.0 * static_cast<double>(tod - leg2 - 4 * 3600) / (86400 - (leg2 + 4 * 3600) + leg1);
+    }
+
+    if (driving) {
+        // Alternator absorption charge tapering with state of charge
+        uint32_t start = tod >= leg2 ? leg2 : leg1;
+        double taper = exp(-static_cast<double>(tod - start) / 2400.0);
+        sample.current = static_cast<float>(6.0 + 55.0 * taper + 1.5 * noise);
+        sample.voltage1 = static_cast<float>(14.1 + 0.05 * sin(TWO_PI * time / 37.0) + 0.02 * noise);
+        sample.voltage2 = with_v2 ? static_cast<float>(14.0 + 0.02 * noise) : 0.0f;
+    } else {
+        // Hotel load with the cab compressor cycling 40% of a 20 minute period
+        bool compressor = ((time + (h >> 24) % 1200) % 1200) < 480;
+        sample.current = static_cast<float>(-(compressor ? 38.0 : 6.5) - 1.0 * noise);
+        sample.voltage1 = static_cast<float>(12.4 + 0.012 * soc + 0.004 * sample.current);
+        sample.voltage2 = with_v2 ? static_cast<float>(12.65 - 0.01 * noise) : 0.0f;
+    }
+
+    sample.temperature = static_cast<float>(20.0 + 9.0 * ambient + (driving ? 4.0 : 0.0) + 0.5 * noise);
+    sample.soc = static_cast<uint8_t>(soc);
+    sample.ps = Powermon::PS_ON;
+}
+
+void Solar(uint64_t h, uint32_t time, bool with_v2, PowermonLogFile::Sample& sample) {
+    uint32_t tod = (time + static_cast<uint32_t>(h % 7200)) % 86400;
+    double sun = (tod > 6 * 3600 && tod < 18 * 3600) ? sin(PI * (tod - 6.0 * 3600) / (12.0 * 3600)) : 0.0;
+
+    // Passing clouds: two incommensurate slow waves
+    double phase = static_cast<double>((h >> 12) % 628) / 100.0;
+    double cloud = 0.65 + 0.35 * sin(TWO_PI * time / 1500.0 + phase) * sin(TWO_PI * time / 370.0);
+    double noise = Noise(h, time);
+    double charge = 30.0 * sun * cloud;
+
+    sample.current = static_cast<float>(charge - 3.0 + 0.2 * noise);
+    sample.voltage1 = static_cast<float>(12.8 + 0.03 * charge + 0.01 * noise);
+    sample.voltage2 = with_v2 ? static_cast<float>(sun > 0 ? 17.5 + 3.0 * cloud * sun : 0.3 * sun) : 0.0f;
+    sample.temperature = static_cast<float>(12.0 + 18.0 * sun + noise);
+    sample.soc = static_cast<uint8_t>(70.0 + 25.0 * sin(PI * (static_cast<double>(tod) - 9.0 * 3600) / 86400.0));
+    sample.ps = Powermon::PS_ON;
+}
+
+void Edge(uint64_t h, uint32_t time, bool with_v2, PowermonLogFile::Sample& sample) {
+    uint64_t r = Mix(h ^ (static_cast<uint64_t>(time) << 1));
+
+    switch (r % 8) {
+        case 0:     // largest encodable values
+            sample.voltage1 = 131.071f;
+            sample.voltage2 = 131.071f;
+            sample.current = 524.287f;
+            sample.temperature = 127.75f;
+            sample.soc = 127;
+            sample.ps = 15;
+            break;
+        case 1:     // smallest encodable values
+            sample.voltage1 = 0.0f;
+            sample.voltage2 = 0.0f;
+            sample.current = -524.288f;
+            sample.temperature = -128.0f;
+            sample.soc = 0;
+            sample.ps = Powermon::PS_OFF;
+            break;
+        case 2:     // one LSB either side of zero
+            sample.voltage1 = 0.001f;
+            sample.voltage2 = 0.001f;
+            sample.current = (r & 8) ? 0.001f : -0.001f;
+            sample.temperature = (r & 16) ? 0.25f : -0.25f;
+            sample.soc = 1;
+            sample.ps = Powermon::PS_ON;
+            break;
+        case 3:     // out of range, saturates in the encoder
+            sample.voltage1 = 250.0f;
+            sample.voltage2 = -5.0f;
+            sample.current = (r & 8) ? 5000.0f : -5000.0f;
+            sample.temperature = (r & 16) ? 400.0f : -400.0f;
+            sample.soc = 200;
+            sample.ps = 15;
+            break;
+        default:    // anywhere in range
+            sample.voltage1 = static_cast<float>(Uniform(r >> 8, 0.0, 131.071));
+            sample.voltage2 = static_cast<float>(Uniform(r >> 32, 0.0, 131.071));
+            sample.current = static_cast<float>(Uniform(Mix(r), -524.288, 524.287));
+            sample.temperature = static_cast<float>(Uniform(Mix(r + 1), -128.0, 127.75));
+            sample.soc = static_cast<uint8_t>((r >> 40) % 101);
+            sample.ps = static_cast<uint8_t>((r >> 48) % (Powermon::PS_HTD + 1));
+            break;
+    }
+
+    if (!with_v2) {
+        sample.voltage2 = 0.0f;
+    }
+}
+
+}
+
+bool ParseProfile(const std::string& name, Profile& profile) {
+    if (name == "daily") {
+        profile = PROFILE_DAILY;
+    } else if (name == "truck") {
+        profile = PROFILE_TRUCK;
+    } else if (name == "solar") {
+        profile = PROFILE_SOLAR;
+    } else if (name == "edge") {
+        profile = PROFILE_EDGE;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* ProfileName(Profile profile) {
+    switch (profile) {
+        case PROFILE_DAILY: return "daily";
+        case PROFILE_TRUCK: return "truck";
+        case PROFILE_SOLAR: return "solar";
+        case PROFILE_EDGE: return "edge";
+    }
+    return "unknown";
+}
+
+void Generate(Profile profile, uint64_t seed, uint32_t time, bool with_v2, PowermonLogFile::Sample& sample) {
+    const uint64_t h = Mix(seed);
+
+    sample.time = time;
+    switch (profile) {
+        case PROFILE_TRUCK: Truck(h, time, with_v2, sample); break;
+        case PROFILE_SOLAR: Solar(h, time, with_v2, sample); break;
+        case PROFILE_EDGE: Edge(h, time, with_v2, sample); break;
+        default: Daily(h, time, with_v2, sample); break;
+    }
+    sample.power = sample.voltage1 * sample.current;
+}
+
+uint64_t Mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+}
@@ -0,0 +1,35 @@
+#ifndef SIGNAL_MODEL_H
+#define SIGNAL_MODEL_H
+
+#include <powermon_log.h>
+
+#include <stdint.h>
+
+#include <string>
+
+// Deterministic synthetic PowerMon signals for the fake device and the log
+// generator. Every sample is a pure function of (profile, seed, time), so any
+// window of a series can be produced without generating the samples before it
+// and the same seed always yields the same data.
+namespace SignalModel {
+
+enum Profile : uint8_t {
+    PROFILE_DAILY = 0,      // daily charge/discharge sine with ripple (fake device default)
+    PROFILE_TRUCK,          // alternator charging while driving, hotel load with compressor cycling when parked
+    PROFILE_SOLAR,          // zero at night, cloud-modulated charging by day, small constant load
+    PROFILE_EDGE            // field extremes, sign changes and every power status, for decoder fuzzing
+};
+
+// Accepts daily, truck, solar and edge
+bool ParseProfile(const std::string& name, Profile& profile);
+const char* ProfileName(Profile profile);
+
+// voltage2 is only populated when with_v2 is set (files logged with MASK_V2)
+void Generate(Profile profile, uint64_t seed, uint32_t time, bool with_v2, PowermonLogFile::Sample& sample);
+
+// 64-bit finalizer used to derive per-device and per-sample values
+uint64_t Mix(uint64_t x);
+
+}
+
+#endif
@@ -0,0 +1,118 @@
+#include "timer_wheel.h"
+
+#include <algorithm>
+
+namespace {
+
+const uint32_t SLOT_BITS = 6;      // log2(TimerWheel::SLOTS)
+
+uint64_t LevelSpan(uint32_t level) {
+    return 1ULL << (SLOT_BITS * level);
+}
+
+}
+
+TimerWheel::TimerWheel(uint32_t tick_ms, uint64_t now_ms)
+    : tick_ms_(std::max<uint32_t>(1, tick_ms)), now_(now_ms / tick_ms_), size_(0) {
+    std::fill(occupied_, occupied_ + LEVELS, 0);
+}
+
+void TimerWheel::Schedule(uint64_t id, uint64_t due_ms) {
+    Insert({ id, (due_ms + tick_ms_ - 1) / tick_ms_ });
+    size_++;
+}
+
+void TimerWheel::Insert(const Timer& timer) {
+    const uint64_t due = std::max(timer.due, now_);
+    const uint64_t delta = due - now_;
+
+    uint32_t level = 0;
+    while (level < LEVELS - 1 && delta >= LevelSpan(level + 1)) {
+        level++;
+    }
+    // Past the wheel's span: park in the last slot to come round, re-filed
+    // from there
+    const uint64_t placed = delta < LevelSpan(LEVELS) ? due : now_ + LevelSpan(LEVELS) - 1;
+    const uint32_t slot = static_cast<uint32_t>((placed >> (SLOT_BITS * level)) & (SLOTS - 1));
+
+    slots_[level][slot].push_back(timer);
+    occupied_[level] |= 1ULL << slot;
+}
+
+void TimerWheel::Cascade(uint32_t level) {
+    const uint32_t slot = static_cast<uint32_t>((now_ >> (SLOT_BITS * level)) & (SLOTS - 1));
+    if (!(occupied_[level] & (1ULL << slot))) {
+        return;
+    }
+    std::vector<Timer> timers;
+    timers.swap(slots_[level][slot]);
+    occupied_[level] &= ~(1ULL << slot);
+    for (const Timer& timer : timers) {
+        Insert(timer);
+    }
+}
+
+void TimerWheel::Advance(uint64_t now_ms, std::vector<uint64_t>& expired) {
+    const uint64_t target = now_ms / tick_ms_;
+    if (size_ == 0) {
+        now_ = std::max(now_, target + 1);
+        return;
+    }
+
+    while (now_ <= target) {
+        // Upper slots whose range starts at this tick move down first
+        for (uint32_t level = LEVELS - 1; level > 0; level--) {
+            if ((now_ & (LevelSpan(level) - 1)) == 0) {
+                Cascade(level);
+            }
+        }
+
+        const uint32_t slot = static_cast<uint32_t>(now_ & (SLOTS - 1));
+        if (occupied_[0] & (1ULL << slot)) {
+            std::vector<Timer> timers;
+            timers.swap(slots_[0][slot]);
+            occupied_[0] &= ~(1ULL << slot);
+            for (const Timer& timer : timers) {
+                if (timer.due <= now_) {
+                    expired.push_back(timer.id);
+                    size_--;
+                } else {
+                    Insert(timer);
+                }
+            }
+        }
+        now_++;
+
+        if (size_ == 0) {
+            now_ = std::max(now_, target + 1);
+            return;
+        }
+        // Nothing left in level 0: skip to the next level-1 boundary
+        if (occupied_[0] == 0 && (now_ & (SLOTS - 1)) != 0) {
+            now_ = std::min(target + 1, (now_ | (SLOTS - 1)) + 1);
+        }
+    }
+}
+
+bool TimerWheel::NextDue(uint64_t& due_ms) const {
+    if (size_ == 0) {
+        return false;
+    }
+    const uint32_t shift = static_cast<uint32_t>(now_ & (SLOTS - 1));
+    uint64_t due = UINT64_MAX;
+    if (occupied_[0] != 0) {
+        const uint64_t bits = occupied_[0];
+        const uint64_t rotated = shift == 0 ? bits : (bits >> shift) | (bits << (SLOTS - shift));
+        due = now_ + __builtin_ctzll(rotated);
+    }
+    // A coarser timer can come due right after the next cascade, before
+    // anything already in level 0, so wake for that boundary too
+    for (uint32_t level = 1; level < LEVELS; level++) {
+        if (occupied_[level] != 0) {
+            due = std::min(due, shift == 0 ? now_ : (now_ | (SLOTS - 1)) + 1);
+            break;
+        }
+    }
+    due_ms = due * tick_ms_;
+    return true;
+}
@@ -0,0 +1,55 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+// Hierarchical timing wheel: LEVELS wheels of SLOTS slots, level k slots
+// spanning SLOTS^k ticks. A timer goes into the coarsest level that still
+// tells it apart from the current tick and moves down one level each time
+// that slot comes round, so scheduling is O(1) and a tick only touches the
+// timers due in it. With 10 ms ticks the wheel spans 64^4 ticks (about 46
+// hours); later timers wait in the last slot and are re-filed when it comes
+// round. Not thread-safe: PollScheduler guards it with its own mutex.
+class TimerWheel {
+public:
+    static const uint32_t SLOTS = 64;
+    static const uint32_t LEVELS = 4;
+
+    TimerWheel(uint32_t tick_ms, uint64_t now_ms);
+
+    uint32_t TickMs() const { return tick_ms_; }
+    size_t Size() const { return size_; }
+
+    // id fires at the first Advance() reaching due_ms; due times in the
+    // past fire at the next tick. Ids are not checked for duplicates
+    void Schedule(uint64_t id, uint64_t due_ms);
+
+    // Moves the wheel to now_ms and appends the ids that came due, in tick
+    // order
+    void Advance(uint64_t now_ms, std::vector<uint64_t>& expired);
+
+    // When Advance() next has work to do: the first occupied tick of level 0
+    // or, when coarser levels hold timers, the next level-1 boundary if that
+    // comes first. false when the wheel is empty
+    bool NextDue(uint64_t& due_ms) const;
+
+private:
+    struct Timer {
+        uint64_t id;
+        uint64_t due;       // tick
+    };
+
+    const uint32_t tick_ms_;
+    uint64_t now_;          // current tick, everything before it has fired
+    size_t size_;
+    std::vector<Timer> slots_[LEVELS][SLOTS];
+    uint64_t occupied_[LEVELS];     // bit per non-empty slot
+
+    void Insert(const Timer& timer);
+    void Cascade(uint32_t level);
+};
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef USDT_PROBES_H
+#define USDT_PROBES_H
+
+// USDT (SystemTap/DTrace style) static probes in the "powermon" provider, for
+// bpftrace and perf on a live process:
+//
+//   bpftrace -e 'usdt:./build/Release/powermon_addon.node:powermon:request_done
+//                { @us[arg0] = hist(arg3); }'
+//
+// With <sys/sdt.h> (systemtap-sdt-dev / systemtap-sdt-devel) a probe is one
+// nop plus an ELF note; bpftrace patches the nop only while attached. The
+// arguments are plain integers the caller already has. Without the header, or
+// with POWERMON_NO_USDT defined, the probes compile to nothing.
+//
+//   request_submit(op, device)
+//   request_done(op, device, code, latency_us)       library callback
+//   reply_written(op, device, latency_us)            bridge reply on stdout, since submit
+//   connect_start(device)
+//   connect_done(device, latency_us)
+//   disconnect(device, reason, was_connecting)
+//   decode_start(bytes)
+//   decode_done(bytes, samples, duration_us)
+//   tsfn_enqueue(op, device, status)                 napi_status of NonBlockingCall
+//   tsfn_dequeue(op, device, delay_us)               JS callback starting
+//
+// op is a LatencyStats::Op, device the addon's instance id (the pid in the
+// bridge), code a Powermon::ResponseCode and reason a DisconnectReason.
+
+#if !defined(POWERMON_NO_USDT) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define POWERMON_USDT 1
+#endif
+#endif
+
+#ifdef POWERMON_USDT
+#define POWERMON_PROBE1(name, a) DTRACE_PROBE1(powermon, name, a)
+#define POWERMON_PROBE2(name, a, b) DTRACE_PROBE2(powermon, name, a, b)
+#define POWERMON_PROBE3(name, a, b, c) DTRACE_PROBE3(powermon, name, a, b, c)
+#define POWERMON_PROBE4(name, a, b, c, d) DTRACE_PROBE4(powermon, name, a, b, c, d)
+#else
+#define POWERMON_PROBE1(name, a) do {} while (0)
+#define POWERMON_PROBE2(name, a, b) do {} while (0)
+#define POWERMON_PROBE3(name, a, b, c) do {} while (0)
+#define POWERMON_PROBE4(name, a, b, c, d) do {} while (0)
+#endif
+
+#endif
@@ -0,0 +1,91 @@
+// Standalone checks for TimerWheel (make test)
+#include "timer_wheel.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <vector>
+
+namespace {
+
+int failures = 0;
+
+void Check(bool ok, const char* what, unsigned long long detail) {
+    if (!ok) {
+        fprintf(stderr, "FAIL %s (%llu)\n", what, detail);
+        failures++;
+    }
+}
+
+// Runs the wheel the way PollScheduler does: sleep until NextDue(), then
+// Advance() to it. Returns the time each id fired at
+std::map<uint64_t, uint64_t> RunUntilEmpty(TimerWheel& wheel) {
+    std::map<uint64_t, uint64_t> fired;
+    std::vector<uint64_t> expired;
+    uint64_t due;
+    while (wheel.NextDue(due)) {
+        expired.clear();
+        wheel.Advance(due, expired);
+        for (uint64_t id : expired) {
+            fired[id] = due;
+        }
+    }
+    return fired;
+}
+
+// A timer filed in level 1 must not wait for a later level-0 timer
+void CoarseTimerBeforeFineOne() {
+    TimerWheel wheel(10, 0);
+    std::vector<uint64_t> expired;
+    wheel.Schedule(1, 700);         // +70 ticks: level 1
+    wheel.Advance(400, expired);
+    wheel.Schedule(2, 1000);        // +60 ticks from now: level 0
+    std::map<uint64_t, uint64_t> fired = RunUntilEmpty(wheel);
+    Check(fired[1] == 700, "+70 tick timer fires on time", fired[1]);
+    Check(fired[2] == 1000, "+100 tick timer fires on time", fired[2]);
+}
+
+// Random timers scheduled as time moves fire at their due tick, never early
+void RandomTimers() {
+    std::mt19937_64 rng(1);
+    TimerWheel wheel(10, 0);
+    std::map<uint64_t, uint64_t> due_at;
+    std::vector<uint64_t> expired;
+    uint64_t now = 0;
+    for (uint64_t id = 1; id <= 20000; id++) {
+        now += rng() % 50;
+        expired.clear();
+        wheel.Advance(now, expired);
+        for (uint64_t e : expired) {
+            Check(now >= due_at[e], "no early fire", e);
+        }
+        const uint64_t due = now + 10 + (rng() % 4 == 0 ? rng() % 10000000 : rng() % 5000);
+        due_at[id] = (due + 9) / 10 * 10;
+        wheel.Schedule(id, due);
+    }
+    uint64_t next;
+    while (wheel.NextDue(next)) {
+        expired.clear();
+        wheel.Advance(std::max(next, now), expired);
+        for (uint64_t e : expired) {
+            Check(std::max(next, now) == std::max(due_at[e], now), "fires at its due tick", e);
+        }
+        now = std::max(next, now);
+    }
+}
+
+}
+
+int main() {
+    CoarseTimerBeforeFineOne();
+    RandomTimers();
+    if (failures > 0) {
+        fprintf(stderr, "%d failures\n", failures);
+        return EXIT_FAILURE;
+    }
+    printf("timer_wheel_test: ok\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,729 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <unistd.h>
+#include <signal.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+//this is the only file needed to be included
+//also link the powermon_lib.a together with your application
+//the following extra linker command line options are needed:
+//-lstdc++ -lbluetooth -ldbus-1
+#include <powermon.h>
+
+//when built next to the device manager (see Makefile.bench) instances come from its factory,
+//so POWERMON_BACKEND=fake or replay turns this into a load test that needs no devices
+#ifdef POWERMON_BENCH_FACTORY
+#include "powermon_factory.h"
+#endif
+
+
+//PowerMon Bench: opens N connections to a list of devices with limited connect concurrency,
+//keeps each one busy with a mix of requests and reports connect times, per-request round trip
+//percentiles, log read throughput and disconnect reasons.
+
+
+typedef std::chrono::steady_clock Clock;
+
+
+enum RequestType
+{
+	REQ_INFO = 0,
+	REQ_MONITOR,
+	REQ_STATISTICS,
+	REQ_FG_STATISTICS,
+	REQ_LOG_FILES,
+	REQ_READ_LOG,
+	REQ_COUNT
+};
+
+static const char* const REQUEST_NAMES[REQ_COUNT] = { "info", "monitor", "statistics", "fgstatistics", "logfiles", "readlog" };
+
+
+//Log-linear histogram of microsecond values: exact below 64us, then 32 buckets per power of two (~3% resolution)
+class Histogram
+{
+public:
+	Histogram(): mBuckets(64 + 32 * 40, 0), mCount(0), mSum(0), mMax(0)
+	{
+	}
+
+	void add(uint64_t us)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mBuckets[index(us)]++;
+		mCount++;
+		mSum += us;
+		if (us > mMax)
+			mMax = us;
+	}
+
+	uint64_t count(void)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		return mCount;
+	}
+
+	double mean(void)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		return mCount ? (double)mSum / mCount : 0;
+	}
+
+	uint64_t max(void)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		return mMax;
+	}
+
+	//upper bound of the bucket holding the p-th percentile
+	uint64_t percentile(double p)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		if (mCount == 0)
+			return 0;
+
+		uint64_t rank = (uint64_t)(p / 100.0 * mCount + 0.5);
+		if (rank < 1)
+			rank = 1;
+
+		uint64_t seen = 0;
+		for (size_t i = 0; i < mBuckets.size(); i++)
+		{
+			seen += mBuckets[i];
+			if (seen >= rank)
+				return upper(i) < mMax ? upper(i) : mMax;
+		}
+		return mMax;
+	}
+
+private:
+	std::mutex mMutex;
+	std::vector<uint64_t> mBuckets;
+	uint64_t mCount;
+	uint64_t mSum;
+	uint64_t mMax;
+
+	size_t index(uint64_t us) const
+	{
+		if (us < 64)
+			return us;
+
+		const uint32_t exponent = 63 - __builtin_clzll(us) - 5;		//us >> exponent is in [32, 64)
+		const size_t i = 64 + (exponent - 1) * 32 + ((us >> exponent) - 32);
+		return i < mBuckets.size() ? i : mBuckets.size() - 1;
+	}
+
+	uint64_t upper(size_t i) const
+	{
+		if (i < 64)
+			return i;
+
+		const uint32_t exponent = (i - 64) / 32 + 1;
+		return ((((i - 64) % 32) + 33) << exponent) - 1;
+	}
+};
+
+
+struct RequestStats
+{
+	Histogram rtt;
+	std::atomic<uint64_t> errors{0};
+	std::atomic<uint64_t> codes[16] = {};		//response codes, last one collects anything larger
+};
+
+
+enum DeviceState
+{
+	DEV_IDLE = 0,
+	DEV_CONNECTING,
+	DEV_CONNECTED,
+	DEV_CLOSING,
+	DEV_DONE
+};
+
+
+struct Device
+{
+	uint32_t index = 0;
+	Powermon::DeviceIdentifier id;
+	Powermon* powermon = nullptr;
+
+	std::atomic<int32_t> state{DEV_IDLE};
+	std::atomic<bool> busy{false};				//a request is in flight
+	std::atomic<bool> attempted{false};			//the first connect attempt has finished
+	std::atomic<int64_t> next_due_us{0};
+
+	Clock::time_point connect_start;
+	Clock::time_point request_start;
+	uint32_t next_request = 0;
+
+	std::vector<Powermon::LogFileDescriptor> files;
+	uint32_t read_offset = 0;
+};
+
+
+struct Options
+{
+	std::vector<std::string> urls;
+	uint32_t connections = 0;
+	uint32_t concurrency = 16;
+	double duration_s = 30;
+	uint32_t interval_ms = 1000;
+	uint32_t read_size = 65536;
+	std::vector<RequestType> mix;
+	bool reconnect = false;
+	const char* json_path = nullptr;
+};
+
+
+static volatile bool interrupted = false;
+
+static const Clock::time_point start_time = Clock::now();
+
+static Histogram connect_time;
+static RequestStats request_stats[REQ_COUNT];
+static std::atomic<uint64_t> connect_failures[256];
+static std::atomic<uint64_t> disconnects[256];
+static std::atomic<uint64_t> read_bytes{0};
+static std::atomic<uint32_t> connecting{0};
+static std::atomic<uint32_t> first_attempts{0};
+
+
+static int64_t now_us(void)
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start_time).count();
+}
+
+
+static uint64_t elapsed_us(Clock::time_point since)
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - since).count();
+}
+
+
+static void usage(const char* argv0)
+{
+	fprintf(stderr,
+		"Usage: %s [options] [access URL ...]\n"
+		"  -f <file>        read access URLs from file, one per line ('#' starts a comment)\n"
+		"  -n <count>       connections to open, cycling through the URLs (default: one per URL)\n"
+		"  -c <count>       connect attempts in flight (default 16)\n"
+		"  -d <seconds>     request phase duration, from when every connection has been\n"
+		"                   attempted once (default 30)\n"
+		"  -i <ms>          pause between a device's requests, 0 = back to back (default 1000)\n"
+		"  -r <list>        request mix, comma separated: info, monitor, statistics, fgstatistics,\n"
+		"                   logfiles, readlog (default monitor)\n"
+		"  -s <bytes>       log read size (default 65536)\n"
+		"  -x               reconnect after a disconnect or failed connect\n"
+		"  -o <file>        also write the results as JSON\n",
+		argv0);
+}
+
+
+static bool parse_mix(const char* list, std::vector<RequestType> &mix)
+{
+	mix.clear();
+	std::string item;
+	for (const char* p = list; ; p++)
+	{
+		if (*p == ',' || *p == '\0')
+		{
+			bool found = false;
+			for (uint32_t i = 0; i < REQ_COUNT; i++)
+			{
+				if (item == REQUEST_NAMES[i])
+				{
+					mix.push_back((RequestType)i);
+					found = true;
+				}
+			}
+			if (!found)
+			{
+				fprintf(stderr, "Unknown request type: %s\n", item.c_str());
+				return false;
+			}
+			item.clear();
+			if (*p == '\0')
+				break;
+		}
+		else
+		{
+			item += *p;
+		}
+	}
+	return !mix.empty();
+}
+
+
+static bool read_url_file(const char* path, std::vector<std::string> &urls)
+{
+	FILE* f = fopen(path, "r");
+	if (f == nullptr)
+	{
+		fprintf(stderr, "Cannot open %s\n", path);
+		return false;
+	}
+
+	char line[2048];
+	while (fgets(line, sizeof(line), f))
+	{
+		char* end = strchr(line, '#');
+		if (end)
+			*end = '\0';
+
+		std::string url(line);
+		url.erase(0, url.find_first_not_of(" \t\r\n"));
+		url.erase(url.find_last_not_of(" \t\r\n") + 1);
+		if (!url.empty())
+			urls.push_back(url);
+	}
+	fclose(f);
+	return true;
+}
+
+
+static bool parse_args(int32_t argc, char** argv, Options &options)
+{
+	int32_t c;
+	while ((c = getopt(argc, argv, "f:n:c:d:i:r:s:xo:h")) != -1)
+	{
+		switch (c)
+		{
+			case 'f':
+				if (!read_url_file(optarg, options.urls))
+					return false;
+				break;
+			case 'n': options.connections = strtoul(optarg, nullptr, 10); break;
+			case 'c': options.concurrency = strtoul(optarg, nullptr, 10); break;
+			case 'd': options.duration_s = atof(optarg); break;
+			case 'i': options.interval_ms = strtoul(optarg, nullptr, 10); break;
+			case 'r':
+				if (!parse_mix(optarg, options.mix))
+					return false;
+				break;
+			case 's': options.read_size = strtoul(optarg, nullptr, 10); break;
+			case 'x': options.reconnect = true; break;
+			case 'o': options.json_path = optarg; break;
+			default: return false;
+		}
+	}
+
+	for (int32_t i = optind; i < argc; i++)
+		options.urls.push_back(argv[i]);
+
+	if (options.urls.empty())
+	{
+		fprintf(stderr, "No access URLs given\n");
+		return false;
+	}
+	if (options.connections == 0)
+		options.connections = options.urls.size();
+	if (options.concurrency == 0)
+		options.concurrency = 1;
+	if (options.mix.empty())
+		options.mix.push_back(REQ_MONITOR);
+	if (options.read_size == 0)
+		options.read_size = 65536;
+
+	return true;
+}
+
+
+static void finish_request(Device* device, RequestType type, uint16_t code, const Options &options)
+{
+	RequestStats &stats = request_stats[type];
+	stats.rtt.add(elapsed_us(device->request_start));
+	stats.codes[code < 15 ? code : 15]++;
+	if (code != Powermon::RSP_SUCCESS)
+		stats.errors++;
+
+	device->next_due_us = now_us() + (int64_t)options.interval_ms * 1000;
+	device->busy = false;
+}
+
+
+static void issue_request(Device* device, const Options &options)
+{
+	RequestType type = options.mix[device->next_request++ % options.mix.size()];
+
+	//log reads need the file list first
+	if (type == REQ_READ_LOG && device->files.empty())
+		type = REQ_LOG_FILES;
+
+	device->busy = true;
+	device->request_start = Clock::now();
+
+	Powermon* const powermon = device->powermon;
+	switch (type)
+	{
+		case REQ_INFO:
+			powermon->requestGetInfo([device, &options](Powermon::ResponseCode code, const Powermon::DeviceInfo &info)
+			{
+				finish_request(device, REQ_INFO, code, options);
+			});
+			break;
+
+		case REQ_MONITOR:
+			powermon->requestGetMonitorData([device, &options](Powermon::ResponseCode code, const Powermon::MonitorData &data)
+			{
+				finish_request(device, REQ_MONITOR, code, options);
+			});
+			break;
+
+		case REQ_STATISTICS:
+			powermon->requestGetStatistics([device, &options](Powermon::ResponseCode code, const Powermon::MonitorStatistics &stats)
+			{
+				finish_request(device, REQ_STATISTICS, code, options);
+			});
+			break;
+
+		case REQ_FG_STATISTICS:
+			powermon->requestGetFgStatistics([device, &options](Powermon::ResponseCode code, const Powermon::FuelgaugeStatistics &stats)
+			{
+				finish_request(device, REQ_FG_STATISTICS, code, options);
+			});
+			break;
+
+		case REQ_LOG_FILES:
+			powermon->requestGetLogFileList([device, &options](Powermon::ResponseCode code, const std::vector<Powermon::LogFileDescriptor> &files)
+			{
+				if (code == Powermon::RSP_SUCCESS)
+				{
+					device->files = files;
+					device->read_offset = 0;
+				}
+				finish_request(device, REQ_LOG_FILES, code, options);
+			});
+			break;
+
+		case REQ_READ_LOG:
+		{
+			//read the newest file from the start, in read_size chunks, wrapping around at its end
+			const Powermon::LogFileDescriptor file = device->files.back();
+			powermon->requestReadLogFile(file.id, device->read_offset, options.read_size,
+				[device, file, &options](Powermon::ResponseCode code, const uint8_t* data, size_t size)
+			{
+				if (code == Powermon::RSP_SUCCESS)
+				{
+					read_bytes += size;
+					device->read_offset += size;
+					if (size == 0 || device->read_offset >= file.size)
+						device->read_offset = 0;
+				}
+				else
+				{
+					device->files.clear();		//list again, the file may have rolled over
+				}
+				finish_request(device, REQ_READ_LOG, code, options);
+			});
+			break;
+		}
+
+		default:
+			device->busy = false;
+			break;
+	}
+}
+
+
+static void start_connect(Device* device)
+{
+	device->state = DEV_CONNECTING;
+	device->connect_start = Clock::now();
+	connecting++;
+	device->powermon->connectWifi(device->id.access_key);
+}
+
+
+//leaves the object open so that callers can append fields
+static void json_histogram(FILE* f, const char* name, Histogram &h)
+{
+	fprintf(f, "\"%s\":{\"count\":%lu,\"meanUs\":%.1f,\"p50Us\":%lu,\"p90Us\":%lu,\"p99Us\":%lu,\"p999Us\":%lu,\"maxUs\":%lu",
+		name, h.count(), h.mean(), h.percentile(50), h.percentile(90), h.percentile(99), h.percentile(99.9), h.max());
+}
+
+
+static void print_histogram(const char* name, Histogram &h, uint64_t errors)
+{
+	printf("%-14s %9lu %7lu %9.1f %9.1f %9.1f %9.1f %9.1f\n", name, h.count(), errors,
+		h.percentile(50) / 1000.0, h.percentile(90) / 1000.0, h.percentile(99) / 1000.0,
+		h.percentile(99.9) / 1000.0, h.max() / 1000.0);
+}
+
+
+static void report(const Options &options, double ramp_s, double run_s, uint32_t connected_at_end)
+{
+	printf("\nConnections: %u requested, %u connected at end, ramp %.1fs, run %.1fs\n",
+		options.connections, connected_at_end, ramp_s, run_s);
+
+	printf("\n%-14s %9s %7s %9s %9s %9s %9s %9s\n", "", "count", "errors", "p50 ms", "p90 ms", "p99 ms", "p99.9 ms", "max ms");
+	print_histogram("connect", connect_time, 0);
+	for (uint32_t i = 0; i < REQ_COUNT; i++)
+		if (request_stats[i].rtt.count())
+			print_histogram(REQUEST_NAMES[i], request_stats[i].rtt, request_stats[i].errors);
+
+	if (read_bytes)
+		printf("\nLog read: %.1f MB, %.1f kB/s\n", read_bytes / 1e6, run_s > 0 ? read_bytes / 1e3 / run_s : 0);
+
+	for (uint32_t i = 0; i < REQ_COUNT; i++)
+	{
+		if (request_stats[i].errors == 0)
+			continue;
+		printf("\n%s response codes:", REQUEST_NAMES[i]);
+		for (uint32_t code = 0; code < 16; code++)
+			if (request_stats[i].codes[code])
+				printf(" %u=%lu", code, (uint64_t)request_stats[i].codes[code]);
+	}
+
+	bool header = false;
+	for (uint32_t reason = 0; reason < 256; reason++)
+	{
+		if (connect_failures[reason] == 0 && disconnects[reason] == 0)
+			continue;
+		if (!header)
+		{
+			printf("\n\n%-8s %16s %12s\n", "reason", "connect failed", "dropped");
+			header = true;
+		}
+		printf("%-8u %16lu %12lu\n", reason, (uint64_t)connect_failures[reason], (uint64_t)disconnects[reason]);
+	}
+	printf("\n");
+
+	if (options.json_path == nullptr)
+		return;
+
+	FILE* f = fopen(options.json_path, "w");
+	if (f == nullptr)
+	{
+		fprintf(stderr, "Cannot write %s\n", options.json_path);
+		return;
+	}
+
+	fprintf(f, "{\"connections\":%u,\"connectedAtEnd\":%u,\"rampS\":%.3f,\"runS\":%.3f,\"intervalMs\":%u,",
+		options.connections, connected_at_end, ramp_s, run_s, options.interval_ms);
+	json_histogram(f, "connect", connect_time);
+	fprintf(f, "},\"requests\":{");
+	bool first = true;
+	for (uint32_t i = 0; i < REQ_COUNT; i++)
+	{
+		if (request_stats[i].rtt.count() == 0)
+			continue;
+		fprintf(f, "%s", first ? "" : ",");
+		first = false;
+		json_histogram(f, REQUEST_NAMES[i], request_stats[i].rtt);
+		fprintf(f, ",\"errors\":%lu,\"codes\":{", (uint64_t)request_stats[i].errors);
+		bool first_code = true;
+		for (uint32_t code = 0; code < 16; code++)
+		{
+			if (request_stats[i].codes[code] == 0)
+				continue;
+			fprintf(f, "%s\"%u\":%lu", first_code ? "" : ",", code, (uint64_t)request_stats[i].codes[code]);
+			first_code = false;
+		}
+		fprintf(f, "}}");
+	}
+	fprintf(f, "},\"readBytes\":%lu,\"readBytesPerS\":%.1f,", (uint64_t)read_bytes, run_s > 0 ? read_bytes / run_s : 0);
+
+	fprintf(f, "\"connectFailures\":{");
+	first = true;
+	for (uint32_t reason = 0; reason < 256; reason++)
+	{
+		if (connect_failures[reason] == 0)
+			continue;
+		fprintf(f, "%s\"%u\":%lu", first ? "" : ",", reason, (uint64_t)connect_failures[reason]);
+		first = false;
+	}
+	fprintf(f, "},\"disconnects\":{");
+	first = true;
+	for (uint32_t reason = 0; reason < 256; reason++)
+	{
+		if (disconnects[reason] == 0)
+			continue;
+		fprintf(f, "%s\"%u\":%lu", first ? "" : ",", reason, (uint64_t)disconnects[reason]);
+		first = false;
+	}
+	fprintf(f, "}}\n");
+	fclose(f);
+}
+
+
+int32_t main(int32_t argc, char** argv)
+{
+	Options options;
+	if (!parse_args(argc, argv, options))
+	{
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	signal(SIGINT, [](int) { interrupted = true; });
+	signal(SIGTERM, [](int) { interrupted = true; });
+
+	//one instance per connection, each with its own callbacks
+	std::vector<Device*> devices;
+	for (uint32_t i = 0; i < options.connections; i++)
+	{
+		Device* device = new Device();
+		device->index = i;
+
+		const std::string &url = options.urls[i % options.urls.size()];
+		if (!device->id.fromURL(url.c_str()))
+		{
+			fprintf(stderr, "Invalid access URL: %s\n", url.c_str());
+			return EXIT_FAILURE;
+		}
+
+#ifdef POWERMON_BENCH_FACTORY
+		device->powermon = PowermonFactory::Create();
+#else
+		device->powermon = Powermon::createInstance();
+#endif
+		if (device->powermon == nullptr)
+		{
+			fprintf(stderr, "Cannot create the Powermon instance\n");
+			return EXIT_FAILURE;
+		}
+
+		device->powermon->setOnConnectCallback([device]()
+		{
+			connect_time.add(elapsed_us(device->connect_start));
+			device->next_due_us = 0;
+			device->state = DEV_CONNECTED;
+			connecting--;
+			if (!device->attempted.exchange(true))
+				first_attempts++;
+		});
+
+		device->powermon->setOnDisconnectCallback([device, &options](Powermon::DisconnectReason reason)
+		{
+			const int32_t state = device->state;
+			if (state == DEV_CONNECTING)
+			{
+				connect_failures[reason]++;
+				connecting--;
+				if (!device->attempted.exchange(true))
+					first_attempts++;
+			}
+			else if (state == DEV_CONNECTED)
+			{
+				disconnects[reason]++;
+			}
+
+			device->busy = false;
+			device->files.clear();
+			device->state = (state != DEV_CLOSING && options.reconnect) ? DEV_IDLE : DEV_DONE;
+		});
+
+		devices.push_back(device);
+	}
+
+#ifdef POWERMON_BENCH_FACTORY
+	fprintf(stderr, "Backend: %s\n", PowermonFactory::Backend().c_str());
+#endif
+	fprintf(stderr, "Opening %u connections to %zu devices, %u at a time\n",
+		options.connections, options.urls.size(), options.concurrency);
+
+	//connect ramp, then the request phase; requests start on each device as soon as it is connected
+	const Clock::time_point ramp_start = Clock::now();
+	Clock::time_point run_start;
+	bool running = false;
+	uint32_t next_connect = 0;
+	int64_t next_progress_us = now_us() + 1000000;
+	uint64_t last_requests = 0;
+
+	while (!interrupted)
+	{
+		const int64_t now = now_us();
+
+		for (Device* device : devices)
+		{
+			const int32_t state = device->state;
+			if (state == DEV_IDLE && connecting < options.concurrency && (next_connect >= options.connections || device->index < next_connect))
+			{
+				//reconnect
+				start_connect(device);
+			}
+			else if (state == DEV_CONNECTED && !device->busy && now >= device->next_due_us)
+			{
+				issue_request(device, options);
+			}
+		}
+
+		while (next_connect < options.connections && connecting < options.concurrency)
+			start_connect(devices[next_connect++]);
+
+		if (!running && first_attempts == options.connections)
+		{
+			running = true;
+			run_start = Clock::now();
+			fprintf(stderr, "Every connection attempted once in %.1fs, running for %.0fs\n",
+				elapsed_us(ramp_start) / 1e6, options.duration_s);
+		}
+
+		if (running && elapsed_us(run_start) >= options.duration_s * 1e6)
+			break;
+
+		if (now >= next_progress_us)
+		{
+			uint64_t requests = 0, errors = 0;
+			for (uint32_t i = 0; i < REQ_COUNT; i++)
+			{
+				requests += request_stats[i].rtt.count();
+				errors += request_stats[i].errors;
+			}
+			uint32_t connected = 0;
+			for (Device* device : devices)
+				if (device->state == DEV_CONNECTED)
+					connected++;
+
+			fprintf(stderr, "t=%5.1fs connected=%u connecting=%u requests/s=%lu errors=%lu\n",
+				elapsed_us(ramp_start) / 1e6, connected, (uint32_t)connecting, requests - last_requests, errors);
+			last_requests = requests;
+			next_progress_us += 1000000;
+		}
+
+		usleep(1000);
+	}
+
+	const double ramp_s = std::chrono::duration<double>((running ? run_start : Clock::now()) - ramp_start).count();
+	const double run_s = running ? elapsed_us(run_start) / 1e6 : 0;
+
+	//let requests in flight finish, then close every connection
+	const Clock::time_point drain_start = Clock::now();
+	for (Device* device : devices)
+		while (device->busy && device->state == DEV_CONNECTED && elapsed_us(drain_start) < 15000000)
+			usleep(1000);
+
+	uint32_t connected_at_end = 0;
+	for (Device* device : devices)
+	{
+		if (device->state == DEV_CONNECTED)
+		{
+			connected_at_end++;
+			device->state = DEV_CLOSING;
+			device->powermon->disconnect();
+		}
+	}
+
+	const Clock::time_point close_start = Clock::now();
+	for (Device* device : devices)
+		while ((device->state == DEV_CLOSING || device->state == DEV_CONNECTING) && elapsed_us(close_start) < 10000000)
+			usleep(1000);
+
+	report(options, ramp_s, run_s, connected_at_end);
+
+	for (Device* device : devices)
+	{
+		delete device->powermon;
+		delete device;
+	}
+
+	return EXIT_SUCCESS;
+}